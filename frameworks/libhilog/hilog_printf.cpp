@@ -25,6 +25,7 @@
 #include <sys/stat.h>
 #include <sys/types.h>
 #include <sstream>
+#include <string_view>
 
 #ifdef __LINUX__
 #include <atomic>
@@ -45,6 +46,7 @@
 #include "hilog/log.h"
 #include "hilog_common.h"
 #include "vsnprintf_s_p.h"
+#include "log_binary.h"
 #include "log_utils.h"
 #include "log_print.h"
 #ifdef __OHOS__
@@ -75,6 +77,9 @@ static bool g_sandboxIsExclude = false;
 static std::mutex g_sandboxMutex;
 #endif
 
+HILOG_PUBLIC_API
+unsigned int g_hiLogLevelGeneration = 1;
+
 HILOG_PUBLIC_API
 extern "C" const char* GetLastFatalMessage()
 {
@@ -114,10 +119,62 @@ void HiLogSetAppMinLogLevel(LogLevel level)
     HiLogSetAppLogLevel(level, PREFER_CLOSE_LOG);
 }
 
+static void BumpLevelGeneration()
+{
+    (void)__atomic_add_fetch(&g_hiLogLevelGeneration, 1, __ATOMIC_RELEASE);
+}
+
+// Any parameter set may be a log level, the call sites check their level again after it. Cached call sites
+// don't call into libhilog, so the commit id is compared by HiLogIsLoggable() and HiLogCallsiteUpdate() only.
+static void RefreshLevelGeneration()
+{
+#if not (defined( __WINDOWS__ ) || defined( __MAC__ ) || defined( __LINUX__ ))
+    static std::atomic<long long> lastCommitId(-1);
+    long long commitId = GetPropertiesCommitId();
+    if (lastCommitId.load(std::memory_order_relaxed) != commitId && lastCommitId.exchange(commitId) != commitId) {
+        BumpLevelGeneration();
+    }
+#endif
+}
+
+unsigned int HiLogLevelGeneration()
+{
+    RefreshLevelGeneration();
+    return __atomic_load_n(&g_hiLogLevelGeneration, __ATOMIC_ACQUIRE);
+}
+
 void HiLogSetAppLogLevel(LogLevel level, PreferStrategy prefer)
 {
     g_logLevel = level;
     g_preferStrategy = prefer;
+    BumpLevelGeneration();
+}
+
+unsigned int HiLogCallsiteUpdate(HiLogCallsite *callsite, unsigned int domain, const char *tag)
+{
+    // A site is keyed by the first domain and tag it logs with, NULL tags are never cached
+    unsigned int domainKey = 0;
+    const char *tagKey = nullptr;
+    if (tag == nullptr) {
+        return 0;
+    }
+    if (!__atomic_compare_exchange_n(&callsite->domain, &domainKey, domain + 1, false, __ATOMIC_ACQ_REL,
+        __ATOMIC_ACQUIRE) && domainKey != domain + 1) {
+        return 0;
+    }
+    if (!__atomic_compare_exchange_n(&callsite->tag, &tagKey, tag, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE) &&
+        tagKey != tag) {
+        return 0;
+    }
+    unsigned int generation = HiLogLevelGeneration();
+    // Loggability only grows with the level
+    unsigned int level = LOG_DEBUG;
+    while (level < LOG_LEVEL_MAX && !HiLogIsLoggable(domain, tag, static_cast<LogLevel>(level))) {
+        level++;
+    }
+    unsigned int state = (generation << HILOG_CALLSITE_LEVEL_BITS) | level;
+    __atomic_store_n(&callsite->state, state, __ATOMIC_RELEASE);
+    return state;
 }
 
 int HilogGetSocketFd(void)
@@ -142,7 +199,7 @@ static bool IsAppDomain(unsigned int domain)
     return (domain >= DOMAIN_APP_MIN) && (domain <= DOMAIN_APP_MAX);
 }
 
-static uint16_t GetFinalLevel(unsigned int domain, const std::string& tag)
+static uint16_t GetFinalLevel(unsigned int domain, std::string_view tag)
 {
     // Priority: TagLevel > DomainLevel > GlobalLevel
     // LOG_LEVEL_MIN is default Level
@@ -218,6 +275,25 @@ static bool IsNeedProcFlowCtr(const LogType type)
     }
     return false;
 }
+
+static bool IsBinaryFormatOn()
+{
+    static bool binaryOn = IsProcessBinaryOn(GetProgName());
+    return binaryOn;
+}
+
+static int WriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt, uint16_t fmtLen)
+{
+    static bool shmOn = IsProcessShmOn(GetProgName());
+    static bool batchOn = IsProcessBatchOn(GetProgName());
+    if (shmOn) {
+        return HilogShmWriteLogMessage(header, tag, tagLen, fmt, fmtLen);
+    }
+    if (batchOn) {
+        return HilogStageLogMessage(header, tag, tagLen, fmt, fmtLen);
+    }
+    return HilogWriteLogMessage(header, tag, tagLen, fmt, fmtLen);
+}
 #else
 static int PrintLog(HilogMsg& header, const char *tag, uint16_t tagLen, const char *fmt, uint16_t fmtLen)
 {
@@ -435,6 +511,15 @@ int HiLogPrintArgs(const LogType type, const LogLevel level, const unsigned int
     int traceBufLen = PrintTraceId(logBuf, MAX_LOG_LEN);
     logBuf += traceBufLen;
 
+    int binaryLen = -1;
+    LogCallback logCallbackFunc = g_logCallback;
+#if not (defined( __WINDOWS__ ) || defined( __MAC__ ) || defined( __LINUX__ ))
+    /* leave formatting to the readers of hilogd, the callback and the fatal message need the text */
+    if (logCallbackFunc == nullptr && level != LOG_FATAL && IsBinaryFormatOn()) {
+        binaryLen = EncodeBinaryLog(buf, MAX_LOG_LEN, traceBufLen, HiLogIsPrivacyOn(), fmt, ap);
+    }
+#endif
+    if (binaryLen < 0) {
 /* format log string */
 #ifdef __clang__
 /* code specific to clang compiler */
@@ -445,20 +530,21 @@ int HiLogPrintArgs(const LogType type, const LogLevel level, const unsigned int
 #pragma GCC diagnostic push
 #pragma GCC diagnostic ignored "-Wformat-nonliteral"
 #endif
-    vsnprintfp_s(logBuf, MAX_LOG_LEN - traceBufLen, MAX_LOG_LEN - traceBufLen - 1, HiLogIsPrivacyOn(), fmt, ap);
-    LogCallback logCallbackFunc = g_logCallback;
-    if (logCallbackFunc != nullptr) {
-        logCallbackFunc(type, level, domain, tag, logBuf);
-    }
+        vsnprintfp_s(logBuf, MAX_LOG_LEN - traceBufLen, MAX_LOG_LEN - traceBufLen - 1, HiLogIsPrivacyOn(), fmt, ap);
+        if (logCallbackFunc != nullptr) {
+            logCallbackFunc(type, level, domain, tag, logBuf);
+        }
 #ifdef __clang__
 #pragma clang diagnostic pop
 #elif __GNUC__
 #pragma GCC diagnostic pop
 #endif
+    }
 
     /* fill header info */
     auto tagLen = strnlen(tag, MAX_TAG_LEN - 1);
-    auto logLen = strnlen(buf, MAX_LOG_LEN - 1);
+    size_t logLen = (binaryLen < 0) ? strnlen(buf, MAX_LOG_LEN - 1) : static_cast<size_t>(binaryLen - 1);
+    header.version = (binaryLen < 0) ? HILOG_MSG_VERSION_TEXT : HILOG_MSG_VERSION_BINARY;
     header.type = type;
     header.level = level;
 #ifndef __RECV_MSG_WITH_UCRED_
@@ -498,17 +584,20 @@ int HiLogPrintArgs(const LogType type, const LogLevel level, const unsigned int
         } else if (ret > 0) {
             static const char P_LIMIT_TAG[] = "LOGLIMIT";
             uint16_t level = header.level;
+            uint16_t version = header.version;
             header.level = LOG_WARN;
+            header.version = HILOG_MSG_VERSION_TEXT;
             char dropLogBuf[MAX_LOG_LEN] = {0};
             if (snprintf_s(dropLogBuf, MAX_LOG_LEN, MAX_LOG_LEN - 1,
                 "==LOGS OVER PROC QUOTA, %d DROPPED==", ret) > 0) {
-                HilogWriteLogMessage(&header, P_LIMIT_TAG, strlen(P_LIMIT_TAG) + 1, dropLogBuf,
+                WriteLogMessage(&header, P_LIMIT_TAG, strlen(P_LIMIT_TAG) + 1, dropLogBuf,
                     strnlen(dropLogBuf, MAX_LOG_LEN - 1) + 1);
             }
             header.level = level;
+            header.version = version;
         }
     }
-    return HilogWriteLogMessage(&header, tag, tagLen + 1, buf, logLen + 1);
+    return WriteLogMessage(&header, tag, tagLen + 1, buf, logLen + 1);
 #else
     return PrintLog(header, tag, tagLen + 1, buf, logLen + 1);
 #endif
@@ -527,6 +616,7 @@ int HiLogPrint(LogType type, LogLevel level, unsigned int domain, const char *ta
 
 bool HiLogIsLoggable(unsigned int domain, const char *tag, LogLevel level)
 {
+    RefreshLevelGeneration();
     if (IsAppDomain(domain) && g_preferStrategy != UNSET_LOGLEVEL) {
         if (g_preferStrategy == PREFER_CLOSE_LOG && level < g_logLevel) {
             return false;
@@ -20,12 +20,20 @@
 #include "hilog/log.h"
 
 #define MSG_VER (0)
+/* OUTPUT_RQST/OUTPUT_RSP only: many OutputRsp per frame, the client acks the end of stream */
+#define MSG_VER_OUTPUT_BATCH (1)
+#define OUTPUT_FRAME_MAX_LEN (32 * 1024)
+/* STATS_QUERY_RQST/STATS_QUERY_RSP only: all tables in one StatsSnapshotHeader buffer */
+#define MSG_VER_STATS_SNAPSHOT (1)
+#define STATS_SNAPSHOT_VERSION (3)
+#define STATS_SNAPSHOT_MAX_LEN (64 * 1024 * 1024)
 #define MAX_DOMAINS (5)
 #define MAX_TAGS (10)
 #define MAX_PIDS (5)
 #define MAX_FILE_NAME_LEN (64)
 #define MAX_STREAM_NAME_LEN (16)
 #define MAX_PROC_NAME_LEN (32)
+#define MAX_SERIES_BUCKETS (60)
 
 constexpr int LevelBase = static_cast<int>(LOG_DEBUG);
 constexpr int LevelNum = static_cast<int>(LOG_LEVEL_MAX) - LevelBase;
@@ -61,6 +69,10 @@ enum class IoctlCmd {
     KMSG_ENABLE_RSP,
     // Process error response with same logic
     RSP_ERROR,
+    // Client received the whole OUTPUT_RSP stream, MSG_VER_OUTPUT_BATCH only
+    OUTPUT_END_ACK,
+    STATS_SERIES_RQST,
+    STATS_SERIES_RSP,
     CMD_COUNT
 };
 
@@ -248,6 +260,71 @@ struct StatsQueryRsp {
     ProcStatsRsp *pStats;
 } __attribute__((__packed__));
 
+/*
+ * MSG_VER_STATS_SNAPSHOT response, sent in frames of up to OUTPUT_FRAME_MAX_LEN after the
+ * STATS_QUERY_RSP header. The header is followed by the StatsQueryRsp and the arrays below, in the
+ * order MSG_VER sends them as separate messages. Pointers in the entries are not meaningful.
+ *   LogTypeDomainStatsRsp[typeNum]
+ *   DomainStatsRsp[domainNum] of every type
+ *   TagStatsRsp[tagNum] of every domain
+ *   ProcStatsRsp[procNum]
+ *   LogTypeStatsRsp[typeNum] of every proc
+ *   TagStatsRsp[tagNum] of every proc
+ *   StatsSnapshotExtra
+ *   uint32_t errLines[entryNum], of every StatsRsp above in the order they come
+ * The tables are the messages MSG_VER sends, what only the snapshot carries comes after them.
+ */
+struct StatsSnapshotHeader {
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t len; // whole snapshot, header included
+} __attribute__((__packed__));
+
+struct StatsInputCounters {
+    uint64_t packets; // datagrams handed to the log collector
+    uint64_t bytes;
+    uint64_t recvCalls;
+    uint64_t dropped; // truncated, malformed or without credentials
+    uint64_t queueFull; // times receiving waited for an ingest worker
+} __attribute__((__packed__));
+
+struct StatsSnapshotExtra {
+    uint32_t topK; // entries kept per table and per hilogd thread, 0 if all are kept
+    StatsInputCounters input; // of the input socket since hilogd started
+    uint32_t entryNum;
+} __attribute__((__packed__));
+
+enum class StatsSeriesUnit : uint8_t {
+    SECOND = 0,
+    MINUTE,
+};
+
+enum class StatsSeriesScope : uint8_t {
+    TOTAL = 0,
+    BY_DOMAIN,
+    BY_PID,
+};
+
+struct StatsSeriesRqst {
+    uint8_t count; // buckets ending with the current one, at most MAX_SERIES_BUCKETS
+    StatsSeriesUnit unit;
+    StatsSeriesScope scope;
+    uint32_t id; // domain or pid
+} __attribute__((__packed__));
+
+struct StatsSeriesBucket {
+    uint32_t lines;
+    uint64_t len;
+    uint32_t dropped;
+} __attribute__((__packed__));
+
+struct StatsSeriesRsp {
+    uint32_t endSec; // realtime at which the current bucket started, it is still being filled
+    uint8_t count;
+    StatsSeriesUnit unit;
+    StatsSeriesBucket buckets[MAX_SERIES_BUCKETS]; // oldest first
+} __attribute__((__packed__));
+
 struct StatsClearRqst {
     char placeholder;
 } __attribute__((__packed__));
@@ -56,6 +56,10 @@ using OptCRef = std::optional<std::reference_wrapper<const T>>;
 #define CONTENT_LEN(pMsg) ((pMsg)->len - sizeof(HilogMsg) - (pMsg)->tagLen) /* include '\0' */
 #define CONTENT_PTR(pMsg) ((pMsg)->tag + (pMsg)->tagLen)
 
+/* values of HilogMsg::version */
+constexpr uint16_t HILOG_MSG_VERSION_TEXT = 0; /* content is the formatted log */
+constexpr uint16_t HILOG_MSG_VERSION_BINARY = 1; /* content is the format and its arguments, see log_binary.h */
+
 #define likely(x)      __builtin_expect(!!(x), 1)
 #define unlikely(x)    __builtin_expect(!!(x), 0)
 
@@ -108,6 +112,8 @@ typedef enum {
     ERR_STATS_NOT_ENABLE = -62,
     ERR_NO_RUNNING_TASK = -63,
     ERR_NO_PID_PERMISSION = -64,
+    ERR_PERSIST_FILE_FORMAT_INVALID = -65,
+    ERR_LOG_PERSIST_STREAM_INVALID = -66,
 } ErrorCode;
 
 #endif /* HILOG_COMMON_H */
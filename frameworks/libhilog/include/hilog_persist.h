@@ -0,0 +1,72 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HILOG_PERSIST_H
+#define HILOG_PERSIST_H
+
+#include <cstdint>
+
+/*
+ * Files of a persist job started with "-m <compress algorithm>+bin" hold the logs as records instead of
+ * text. Once decompressed, such a file is a sequence of blocks, a PersistBlockHeader followed by count
+ * HilogMsg records with text content. Logs are rendered by hilog -I when the file is read, so any -v
+ * format and filter can be chosen then, blocks without a wanted type or level are skipped as a whole.
+ */
+#define PERSIST_BINARY_STREAM_SUFFIX "+bin"
+#define PERSIST_BLOCK_MAGIC (0x4B424C48) /* "HLBK" */
+#define PERSIST_BLOCK_VERSION (1)
+
+struct PersistBlockHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t types; /* 1 << type of every record */
+    uint16_t levels; /* 1 << level of every record */
+    uint32_t len; /* header included */
+    uint32_t count;
+    uint32_t minSec; /* realtime of the oldest and the newest record */
+    uint32_t minNsec;
+    uint32_t maxSec;
+    uint32_t maxNsec;
+} __attribute__((__packed__));
+
+/*
+ * Logs are compressed in frames of about 1MB of logs, gzip members or zstd frames, the chunks of a frame
+ * are flushed as hilogd writes them. A finished file ends with an index of its frames, so a time range
+ * is read without inflating the whole file. The index, PersistIndexEntry[count] followed by PersistIndexTrailer, is carried where
+ * decompressors skip it: in subfield "HI" of the extra field of an empty gzip member, or in a zstd
+ * skippable frame. Files still being written or cut by a crash have no index.
+ */
+#define PERSIST_INDEX_MAGIC (0x58444948) /* "HIDX" */
+#define PERSIST_INDEX_VERSION (1)
+#define PERSIST_INDEX_SUBFIELD_ID1 'H'
+#define PERSIST_INDEX_SUBFIELD_ID2 'I'
+
+struct PersistIndexEntry {
+    uint32_t offset; /* of the frame in the file */
+    uint32_t len; /* compressed length, neighbouring frames share an entry in very large files */
+    uint32_t count; /* lines */
+    uint32_t minSec; /* realtime of the oldest and the newest line */
+    uint32_t minNsec;
+    uint32_t maxSec;
+    uint32_t maxNsec;
+} __attribute__((__packed__));
+
+struct PersistIndexTrailer {
+    uint32_t count;
+    uint16_t version;
+    uint32_t magic;
+} __attribute__((__packed__));
+
+#endif /* HILOG_PERSIST_H */
@@ -18,6 +18,7 @@
 
 #include <vector>
 #include <functional>
+#include <unordered_map>
 #include <securec.h>
 
 #include "hilog_common.h"
@@ -29,6 +30,14 @@ namespace OHOS {
 namespace HiviewDFX {
 using namespace std;
 
+// What a statistics snapshot carries besides the StatsQueryRsp, left empty by older hilogd
+struct StatsQueryExtra {
+    uint32_t topK = 0;
+    StatsInputCounters input = {0};
+    unordered_map<const StatsRsp*, uint32_t> errLines; // of the entries in the StatsQueryRsp, if not 0
+};
+using StatsQueryHandler = std::function<int(const StatsQueryRsp& rsp, const StatsQueryExtra& extra)>;
+
 class LogIoctl {
 public:
     LogIoctl(IoctlCmd rqst, IoctlCmd rsp);
@@ -37,37 +46,36 @@ public:
     template<typename T1, typename T2>
     int Request(const T1& rqst,  std::function<int(const T2& rsp)> handle);
     int RequestOutput(const OutputRqst& rqst, std::function<int(const OutputRsp& rsp)> handle);
-    int RequestStatsQuery(const StatsQueryRqst& rqst, std::function<int(const StatsQueryRsp& rsp)> handle);
+    int RequestStatsQuery(const StatsQueryRqst& rqst, StatsQueryHandler handle);
 
 private:
     SeqPacketSocketClient socket;
     int socketInit = -1;
     IoctlCmd rqstCmd;
     IoctlCmd rspCmd;
+    uint8_t rqstVer = MSG_VER;
+    uint8_t rspVer = MSG_VER;
     static constexpr int DEFAULT_RECV_BUF_LEN = MAX_LOG_LEN * 2;
 
-    int SendMsgHeader(IoctlCmd cmd, size_t len);
+    int SendMsgHeader(IoctlCmd cmd, size_t len, uint8_t ver = MSG_VER);
     int ReceiveMsgHeaer(MsgHeader& hdr);
     int GetRsp(char* rsp, int len);
     template<typename T1, typename T2>
     int RequestMsgHead(const T1& rqst);
 
     int ReceiveAndProcessOutputRsp(std::function<int(const OutputRsp& rsp)> handle);
-    int ReceiveAndProcessStatsQueryRsp(std::function<int(const StatsQueryRsp& rsp)> handle);
-    int ReceiveProcTagStats(StatsQueryRsp &rsp);
-    int ReceiveProcLogTypeStats(StatsQueryRsp &rsp);
-    int ReceiveProcStats(StatsQueryRsp &rsp);
-    int ReceiveDomainTagStats(StatsQueryRsp &rsp);
-    int ReceiveDomainStats(StatsQueryRsp &rsp);
-    int ReceiveLogTypeDomainStats(StatsQueryRsp &rsp);
-    void DeleteLogStatsInfo(StatsQueryRsp &rsp);
+    int ReceiveAndProcessOutputFrames(std::function<int(const OutputRsp& rsp)> handle);
+    int ReceiveAndProcessStatsQueryRsp(StatsQueryHandler handle);
+    int ReceiveStatsSnapshot(vector<char>& snapshot);
+    int ReceiveStatsMessages(vector<char>& snapshot);
+    int ReceiveStatsMsg(vector<char>& snapshot, size_t len);
 };
 
 template<typename T1, typename T2>
 int LogIoctl::RequestMsgHead(const T1& rqst)
 {
     // 0. Send reqeust message and process the response header
-    int ret = SendMsgHeader(rqstCmd, sizeof(T1));
+    int ret = SendMsgHeader(rqstCmd, sizeof(T1), rqstVer);
     if (ret != RET_SUCCESS) {
         return ret;
     }
@@ -90,6 +98,7 @@ int LogIoctl::RequestMsgHead(const T1& rqst)
     if (hdr.len != sizeof(T2)) {
         return ERR_MSG_LEN_INVALID;
     }
+    rspVer = hdr.ver;
     return RET_SUCCESS;
 }
 
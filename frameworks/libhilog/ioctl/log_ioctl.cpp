@@ -13,6 +13,9 @@
  * limitations under the License.
  */
 
+#include <algorithm>
+#include <cstdint>
+
 #include "log_ioctl.h"
 
 namespace OHOS {
@@ -36,11 +39,19 @@ LogIoctl::LogIoctl(IoctlCmd rqst, IoctlCmd rsp) : socket(GetSocketName(rqst), 0)
     }
     rqstCmd = rqst;
     rspCmd = rsp;
+    // Ask for multi-record frames, a hilogd which doesn't support them answers with MSG_VER
+    if (rqst == IoctlCmd::OUTPUT_RQST) {
+        rqstVer = MSG_VER_OUTPUT_BATCH;
+    }
+    // Ask for the statistics in one snapshot, same fallback
+    if (rqst == IoctlCmd::STATS_QUERY_RQST) {
+        rqstVer = MSG_VER_STATS_SNAPSHOT;
+    }
 }
 
-int LogIoctl::SendMsgHeader(IoctlCmd cmd, size_t len)
+int LogIoctl::SendMsgHeader(IoctlCmd cmd, size_t len, uint8_t ver)
 {
-    MsgHeader header = {MSG_VER, static_cast<uint8_t>(cmd), 0, static_cast<uint16_t>(len)};
+    MsgHeader header = {ver, static_cast<uint8_t>(cmd), 0, static_cast<uint16_t>(len)};
     if (socketInit != SeqPacketSocketResult::CREATE_AND_CONNECTED) {
         return ERR_SOCKET_CLIENT_INIT_FAIL;
     }
@@ -70,232 +81,192 @@ int LogIoctl::GetRsp(char* rsp, int len)
     return RET_SUCCESS;
 }
 
-int LogIoctl::ReceiveProcTagStats(StatsQueryRsp &rsp)
+// Takes the next num entries of the snapshot, offset goes past its end if they aren't all there
+template<typename T>
+static T* TakeStats(vector<char>& snapshot, size_t& offset, size_t num)
 {
-    int i = 0;
-    for (i = 0; i < rsp.procNum; i++) {
-        ProcStatsRsp &pStats = rsp.pStats[i];
-        int msgSize = pStats.tagNum * sizeof(TagStatsRsp);
-        if (msgSize == 0) {
-            pStats.tStats = nullptr;
-            continue;
-        }
-        char* tmp = new (std::nothrow) char[msgSize];
-        if (tmp == nullptr) {
-            pStats.tStats = nullptr;
-            return RET_FAIL;
-        }
-        if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-            delete []tmp;
-            tmp = nullptr;
-            return RET_FAIL;
-        }
-        if (GetRsp(tmp, msgSize) != RET_SUCCESS) {
-            pStats.tStats = nullptr;
-            delete []tmp;
-            tmp = nullptr;
-            return RET_FAIL;
-        }
-        pStats.tStats = reinterpret_cast<TagStatsRsp*>(tmp);
+    if (offset > snapshot.size() || num > (snapshot.size() - offset) / sizeof(T)) {
+        offset = SIZE_MAX;
+        return nullptr;
     }
-    return RET_SUCCESS;
+    T *entries = (num == 0) ? nullptr : reinterpret_cast<T*>(snapshot.data() + offset);
+    offset += num * sizeof(T);
+    return entries;
 }
 
-int LogIoctl::ReceiveProcLogTypeStats(StatsQueryRsp &rsp)
+// Every StatsRsp of the tables in the order they come, the errLines of a snapshot are in this order
+static vector<const StatsRsp*> ListStatsEntries(const StatsQueryRsp& rsp)
 {
-    int i = 0;
-    for (i = 0; i < rsp.procNum; i++) {
-        ProcStatsRsp &pStats = rsp.pStats[i];
-        int msgSize = pStats.typeNum * sizeof(LogTypeStatsRsp);
-        if (msgSize == 0) {
-            continue;
+    vector<const StatsRsp*> entries;
+    for (uint16_t i = 0; i < rsp.typeNum; i++) {
+        for (uint16_t j = 0; j < rsp.ldStats[i].domainNum; j++) {
+            entries.push_back(&rsp.ldStats[i].dStats[j].stats);
         }
-        char* tmp = new (std::nothrow) char[msgSize];
-        if (tmp == nullptr) {
-            pStats.lStats = nullptr;
-            return RET_FAIL;
+    }
+    for (uint16_t i = 0; i < rsp.typeNum; i++) {
+        for (uint16_t j = 0; j < rsp.ldStats[i].domainNum; j++) {
+            const DomainStatsRsp &dStats = rsp.ldStats[i].dStats[j];
+            for (uint16_t k = 0; k < dStats.tagNum; k++) {
+                entries.push_back(&dStats.tStats[k].stats);
+            }
         }
-        if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-            delete []tmp;
-            tmp = nullptr;
-            return RET_FAIL;
+    }
+    for (uint16_t i = 0; i < rsp.procNum; i++) {
+        entries.push_back(&rsp.pStats[i].stats);
+    }
+    for (uint16_t i = 0; i < rsp.procNum; i++) {
+        for (uint16_t j = 0; j < rsp.pStats[i].typeNum; j++) {
+            entries.push_back(&rsp.pStats[i].lStats[j].stats);
         }
-        if (GetRsp(tmp, msgSize) != RET_SUCCESS) {
-            pStats.lStats = nullptr;
-            delete []tmp;
-            tmp = nullptr;
-            return RET_FAIL;
+    }
+    for (uint16_t i = 0; i < rsp.procNum; i++) {
+        for (uint16_t j = 0; j < rsp.pStats[i].tagNum; j++) {
+            entries.push_back(&rsp.pStats[i].tStats[j].stats);
         }
-        pStats.lStats = reinterpret_cast<LogTypeStatsRsp*>(tmp);
     }
-    return RET_SUCCESS;
+    return entries;
 }
 
-int LogIoctl::ReceiveProcStats(StatsQueryRsp &rsp)
+// The part after the tables, false if it doesn't match the entries
+static bool ParseStatsExtra(vector<char>& snapshot, size_t& offset, const StatsQueryRsp& rsp, StatsQueryExtra& extra)
 {
-    if (rsp.procNum == 0) {
-        return RET_FAIL;
+    const StatsSnapshotExtra *head = TakeStats<StatsSnapshotExtra>(snapshot, offset, 1);
+    if (head == nullptr) {
+        return false;
     }
-    int msgSize = rsp.procNum * sizeof(ProcStatsRsp);
-    if (msgSize == 0) {
-        return RET_SUCCESS;
-    }
-    char* tmp = new (std::nothrow) char[msgSize];
-    if (tmp == nullptr) {
-        rsp.pStats = nullptr;
-        return RET_FAIL;
-    }
-    if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-        delete []tmp;
-        tmp = nullptr;
-        return RET_FAIL;
+    extra.topK = head->topK;
+    extra.input = head->input;
+    vector<const StatsRsp*> entries = ListStatsEntries(rsp);
+    const uint32_t *errLines = TakeStats<uint32_t>(snapshot, offset, head->entryNum);
+    if (offset == SIZE_MAX || head->entryNum != entries.size()) {
+        return false;
     }
-    if (GetRsp(tmp, msgSize) != RET_SUCCESS) {
-        rsp.pStats = nullptr;
-        delete []tmp;
-        tmp = nullptr;
-        return RET_FAIL;
+    for (size_t i = 0; i < entries.size(); i++) {
+        uint32_t lines = 0; // packed, may be unaligned
+        (void)memcpy_s(&lines, sizeof(lines), errLines + i, sizeof(lines));
+        if (lines != 0) {
+            extra.errLines[entries[i]] = lines;
+        }
     }
-    rsp.pStats = reinterpret_cast<ProcStatsRsp*>(tmp);
-    return RET_SUCCESS;
+    return true;
 }
 
-int LogIoctl::ReceiveDomainTagStats(StatsQueryRsp &rsp)
+// Points every entry at its arrays in the snapshot, nullptr if the counts don't match its length
+static StatsQueryRsp* ParseStatsSnapshot(vector<char>& snapshot, size_t offset, StatsQueryExtra *extra)
 {
-    int i = 0;
-    for (i = 0; i < rsp.typeNum; i++) {
-        LogTypeDomainStatsRsp &ldStats = rsp.ldStats[i];
-        int j = 0;
-        for (j = 0; j < ldStats.domainNum; j++) {
+    StatsQueryRsp *rsp = TakeStats<StatsQueryRsp>(snapshot, offset, 1);
+    if (rsp == nullptr) {
+        return nullptr;
+    }
+    rsp->ldStats = TakeStats<LogTypeDomainStatsRsp>(snapshot, offset, rsp->typeNum);
+    if (offset == SIZE_MAX) {
+        return nullptr;
+    }
+    for (uint16_t i = 0; i < rsp->typeNum; i++) {
+        LogTypeDomainStatsRsp &ldStats = rsp->ldStats[i];
+        ldStats.dStats = TakeStats<DomainStatsRsp>(snapshot, offset, ldStats.domainNum);
+        if (offset == SIZE_MAX) {
+            return nullptr;
+        }
+    }
+    for (uint16_t i = 0; i < rsp->typeNum; i++) {
+        LogTypeDomainStatsRsp &ldStats = rsp->ldStats[i];
+        for (uint16_t j = 0; j < ldStats.domainNum; j++) {
             DomainStatsRsp &dStats = ldStats.dStats[j];
-            int msgSize = dStats.tagNum * sizeof(TagStatsRsp);
-            if (msgSize == 0) {
-                dStats.tStats = nullptr;
-                continue;
-            }
-            char* tmp = new (std::nothrow) char[msgSize];
-            if (tmp == nullptr) {
-                dStats.tStats = nullptr;
-                return RET_FAIL;
-            }
-            if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-                delete []tmp;
-                tmp = nullptr;
-                return RET_FAIL;
-            }
-            if (GetRsp(tmp, msgSize) != RET_SUCCESS) {
-                dStats.tStats = nullptr;
-                delete []tmp;
-                tmp = nullptr;
-                return RET_FAIL;
-            }
-            dStats.tStats = reinterpret_cast<TagStatsRsp*>(tmp);
+            dStats.tStats = TakeStats<TagStatsRsp>(snapshot, offset, dStats.tagNum);
         }
     }
-    return RET_SUCCESS;
+    rsp->pStats = TakeStats<ProcStatsRsp>(snapshot, offset, rsp->procNum);
+    if (offset == SIZE_MAX) {
+        return nullptr;
+    }
+    for (uint16_t i = 0; i < rsp->procNum; i++) {
+        ProcStatsRsp &pStats = rsp->pStats[i];
+        pStats.lStats = TakeStats<LogTypeStatsRsp>(snapshot, offset, pStats.typeNum);
+    }
+    for (uint16_t i = 0; i < rsp->procNum; i++) {
+        ProcStatsRsp &pStats = rsp->pStats[i];
+        pStats.tStats = TakeStats<TagStatsRsp>(snapshot, offset, pStats.tagNum);
+    }
+    if (offset == SIZE_MAX || (extra != nullptr && !ParseStatsExtra(snapshot, offset, *rsp, *extra))) {
+        return nullptr;
+    }
+    return (offset == snapshot.size()) ? rsp : nullptr;
 }
 
-int LogIoctl::ReceiveDomainStats(StatsQueryRsp &rsp)
+int LogIoctl::ReceiveStatsSnapshot(vector<char>& snapshot)
 {
-    int i = 0;
-    for (i = 0; i < rsp.typeNum; i++) {
-        LogTypeDomainStatsRsp &ldStats = rsp.ldStats[i];
-        int msgSize = ldStats.domainNum * sizeof(DomainStatsRsp);
-        if (msgSize == 0) {
-            continue;
-        }
-        char* tmp = new (std::nothrow) char[msgSize];
-        if (tmp == nullptr) {
-            ldStats.dStats = nullptr;
-            return RET_FAIL;
-        }
-        if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-            delete []tmp;
-            tmp = nullptr;
-            return RET_FAIL;
-        }
-        if (GetRsp(tmp, msgSize) != RET_SUCCESS) {
-            ldStats.dStats = nullptr;
-            delete []tmp;
-            tmp = nullptr;
-            return RET_FAIL;
+    snapshot.resize(OUTPUT_FRAME_MAX_LEN);
+    int len = socket.RecvMsg(snapshot.data(), OUTPUT_FRAME_MAX_LEN);
+    if (len <= 0) {
+        return ERR_SOCKET_RECEIVE_RSP;
+    }
+    size_t used = static_cast<size_t>(len);
+    const StatsSnapshotHeader *header = reinterpret_cast<const StatsSnapshotHeader *>(snapshot.data());
+    if (used < sizeof(StatsSnapshotHeader) || header->version != STATS_SNAPSHOT_VERSION ||
+        header->len < used || header->len > STATS_SNAPSHOT_MAX_LEN) {
+        return ERR_MSG_LEN_INVALID;
+    }
+    size_t total = header->len;
+    snapshot.resize(total);
+    while (used < total) {
+        len = socket.RecvMsg(snapshot.data() + used, std::min<size_t>(total - used, OUTPUT_FRAME_MAX_LEN));
+        if (len <= 0) {
+            return ERR_SOCKET_RECEIVE_RSP;
         }
-        ldStats.dStats = reinterpret_cast<DomainStatsRsp*>(tmp);
+        used += static_cast<size_t>(len);
     }
     return RET_SUCCESS;
 }
 
-int LogIoctl::ReceiveLogTypeDomainStats(StatsQueryRsp &rsp)
+int LogIoctl::ReceiveStatsMsg(vector<char>& snapshot, size_t len)
 {
-    if (rsp.typeNum == 0) {
-        return RET_FAIL;
-    }
-    int msgSize = rsp.typeNum * sizeof(LogTypeDomainStatsRsp);
-    if (msgSize == 0) {
+    if (len == 0) {
         return RET_SUCCESS;
     }
-    char* tmp = new (std::nothrow) char[msgSize];
-    if (tmp == nullptr) {
-        rsp.ldStats = nullptr;
-        return RET_FAIL;
-    }
-    if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-        delete []tmp;
-        tmp = nullptr;
-        return RET_FAIL;
-    }
-    if (GetRsp(tmp, msgSize) != RET_SUCCESS) {
-        rsp.ldStats = nullptr;
-        delete []tmp;
-        tmp = nullptr;
-        return RET_FAIL;
-    }
-    rsp.ldStats = reinterpret_cast<LogTypeDomainStatsRsp*>(tmp);
-    return RET_SUCCESS;
+    size_t offset = snapshot.size();
+    snapshot.resize(offset + len, 0);
+    return GetRsp(snapshot.data() + offset, len);
 }
 
-void LogIoctl::DeleteLogStatsInfo(StatsQueryRsp &rsp)
+int LogIoctl::ReceiveStatsMessages(vector<char>& snapshot)
 {
-    if (rsp.ldStats == nullptr) {
-        return;
-    }
-    int i = 0;
-    for (i = 0; i < rsp.typeNum; i++) {
-        LogTypeDomainStatsRsp &ldStats = rsp.ldStats[i];
-        if (ldStats.dStats == nullptr) {
-            break;
-        }
-        int j = 0;
-        for (j = 0; j < ldStats.domainNum; j++) {
-            DomainStatsRsp &dStats = ldStats.dStats[j];
-            if (dStats.tStats == nullptr) {
-                break;
-            }
-            delete []dStats.tStats;
-            dStats.tStats = nullptr;
-        }
-        delete []ldStats.dStats;
-        ldStats.dStats = nullptr;
+    // A MSG_VER hilogd sends every array of the snapshot layout as its own message
+    int ret = ReceiveStatsMsg(snapshot, sizeof(StatsQueryRsp));
+    if (ret != RET_SUCCESS) {
+        return ret;
     }
-    delete []rsp.ldStats;
-    rsp.ldStats = nullptr;
-
-    if (rsp.pStats == nullptr) {
-        return;
+    const StatsQueryRsp rsp = *reinterpret_cast<const StatsQueryRsp *>(snapshot.data());
+    size_t ldOffset = snapshot.size();
+    ret = ReceiveStatsMsg(snapshot, rsp.typeNum * sizeof(LogTypeDomainStatsRsp));
+    vector<size_t> dOffsets;
+    for (uint16_t i = 0; i < rsp.typeNum && ret == RET_SUCCESS; i++) {
+        auto ldStats = reinterpret_cast<const LogTypeDomainStatsRsp *>(snapshot.data() + ldOffset);
+        dOffsets.push_back(snapshot.size());
+        ret = ReceiveStatsMsg(snapshot, ldStats[i].domainNum * sizeof(DomainStatsRsp));
     }
-    for (i = 0; i < rsp.procNum; i++) {
-        ProcStatsRsp &pStats = rsp.pStats[i];
-        if (pStats.lStats == nullptr) {
-            return;
-        }
-        delete []pStats.lStats;
-        pStats.lStats = nullptr;
-        if (pStats.tStats == nullptr) {
-            return;
+    // Receiving grows the snapshot, entries are read again through their offsets each time
+    for (uint16_t i = 0; i < rsp.typeNum && ret == RET_SUCCESS; i++) {
+        auto ldStats = reinterpret_cast<const LogTypeDomainStatsRsp *>(snapshot.data() + ldOffset);
+        uint16_t domainNum = ldStats[i].domainNum;
+        for (uint16_t j = 0; j < domainNum && ret == RET_SUCCESS; j++) {
+            auto dStats = reinterpret_cast<const DomainStatsRsp *>(snapshot.data() + dOffsets[i]);
+            ret = ReceiveStatsMsg(snapshot, dStats[j].tagNum * sizeof(TagStatsRsp));
         }
-        delete []pStats.tStats;
-        pStats.tStats = nullptr;
     }
+    size_t pOffset = snapshot.size();
+    if (ret == RET_SUCCESS) {
+        ret = ReceiveStatsMsg(snapshot, rsp.procNum * sizeof(ProcStatsRsp));
+    }
+    for (uint16_t i = 0; i < rsp.procNum && ret == RET_SUCCESS; i++) {
+        auto pStats = reinterpret_cast<const ProcStatsRsp *>(snapshot.data() + pOffset);
+        ret = ReceiveStatsMsg(snapshot, pStats[i].typeNum * sizeof(LogTypeStatsRsp));
+    }
+    for (uint16_t i = 0; i < rsp.procNum && ret == RET_SUCCESS; i++) {
+        auto pStats = reinterpret_cast<const ProcStatsRsp *>(snapshot.data() + pOffset);
+        ret = ReceiveStatsMsg(snapshot, pStats[i].tagNum * sizeof(TagStatsRsp));
+    }
+    return ret;
 }
 
 int LogIoctl::RequestOutput(const OutputRqst& rqst, std::function<int(const OutputRsp& rsp)> handle)
@@ -306,6 +277,9 @@ int LogIoctl::RequestOutput(const OutputRqst& rqst, std::function<int(const Outp
         return ret;
     }
     // 1. process the response message
+    if (rspVer >= MSG_VER_OUTPUT_BATCH) {
+        return ReceiveAndProcessOutputFrames(handle);
+    }
     return ReceiveAndProcessOutputRsp(handle);
 }
 
@@ -326,7 +300,36 @@ int LogIoctl::ReceiveAndProcessOutputRsp(std::function<int(const OutputRsp& rsp)
     }
 }
 
-int LogIoctl::RequestStatsQuery(const StatsQueryRqst& rqst, std::function<int(const StatsQueryRsp& rsp)> handle)
+int LogIoctl::ReceiveAndProcessOutputFrames(std::function<int(const OutputRsp& rsp)> handle)
+{
+    vector<char> buffer(OUTPUT_FRAME_MAX_LEN, 0);
+    while (true) {
+        int len = socket.RecvMsg(buffer.data(), OUTPUT_FRAME_MAX_LEN);
+        if (len <= 0) {
+            return ERR_SOCKET_RECEIVE_RSP;
+        }
+        size_t frameLen = static_cast<size_t>(len);
+        size_t offset = 0;
+        while (offset + sizeof(OutputRsp) <= frameLen) {
+            const OutputRsp *rsp = reinterpret_cast<const OutputRsp *>(buffer.data() + offset);
+            size_t recordLen = sizeof(OutputRsp) + (rsp->end ? 0 : rsp->len);
+            if (offset + recordLen > frameLen) {
+                return ERR_MSG_LEN_INVALID;
+            }
+            if (rsp->end) {
+                // let hilogd close the connection right away
+                (void)SendMsgHeader(IoctlCmd::OUTPUT_END_ACK, 0, rqstVer);
+            }
+            int ret = handle(*rsp);
+            if (unlikely(ret != static_cast<int>(SUCCESS_CONTINUE))) {
+                return ret;
+            }
+            offset += recordLen;
+        }
+    }
+}
+
+int LogIoctl::RequestStatsQuery(const StatsQueryRqst& rqst, StatsQueryHandler handle)
 {
     // 0. Send reqeust message and process the response header
     int ret = RequestMsgHead<StatsQueryRqst, StatsQueryRsp>(rqst);
@@ -337,47 +340,27 @@ int LogIoctl::RequestStatsQuery(const StatsQueryRqst& rqst, std::function<int(co
     return ReceiveAndProcessStatsQueryRsp(handle);
 }
 
-int LogIoctl::ReceiveAndProcessStatsQueryRsp(std::function<int(const StatsQueryRsp& rsp)> handle)
+int LogIoctl::ReceiveAndProcessStatsQueryRsp(StatsQueryHandler handle)
 {
+    vector<char> snapshot;
+    size_t offset = 0;
     int ret;
-    StatsQueryRsp rsp = { 0 };
-    do {
-        ret = GetRsp(reinterpret_cast<char*>(&rsp), sizeof(rsp));
-        if (RET_SUCCESS != ret) {
-            break;
-        }
-        rsp.ldStats = nullptr;
-        rsp.pStats = nullptr;
-        ret = ReceiveLogTypeDomainStats(rsp);
-        if (RET_SUCCESS != ret) {
-            break;
-        }
-        ret = ReceiveDomainStats(rsp);
-        if (RET_SUCCESS != ret) {
-            break;
-        }
-        ret = ReceiveDomainTagStats(rsp);
-        if (RET_SUCCESS != ret) {
-            break;
-        }
-        ret = ReceiveProcStats(rsp);
-        if (RET_SUCCESS != ret) {
-            break;
-        }
-        ret = ReceiveProcLogTypeStats(rsp);
-        if (RET_SUCCESS != ret) {
-            break;
-        }
-        ret = ReceiveProcTagStats(rsp);
-        if (RET_SUCCESS != ret) {
-            break;
-        }
-    } while (0);
-    if (ret ==  RET_SUCCESS) {
-        ret = handle(rsp);
+    bool isSnapshot = (rspVer >= MSG_VER_STATS_SNAPSHOT);
+    if (isSnapshot) {
+        ret = ReceiveStatsSnapshot(snapshot);
+        offset = sizeof(StatsSnapshotHeader);
+    } else {
+        ret = ReceiveStatsMessages(snapshot);
     }
-    DeleteLogStatsInfo(rsp);
-    return ret;
+    if (ret != RET_SUCCESS) {
+        return ret;
+    }
+    StatsQueryExtra extra;
+    StatsQueryRsp *rsp = ParseStatsSnapshot(snapshot, offset, isSnapshot ? &extra : nullptr);
+    if (rsp == nullptr) {
+        return ERR_MSG_LEN_INVALID;
+    }
+    return handle(*rsp, extra);
 }
 } // namespace HiviewDFX
 } // namespace OHOS
\ No newline at end of file
@@ -18,6 +18,7 @@
 
 #include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace OHOS {
 namespace HiviewDFX {
@@ -36,21 +37,28 @@ bool IsPrivateSwitchOn();
 }
 #endif
 bool IsDebuggableHap();
+long long GetPropertiesCommitId();
 uint16_t GetGlobalLogLevel();
 uint16_t GetGlobalLevel();
 uint16_t GetPersistGlobalLevel();
 uint16_t GetDomainLevel(uint32_t domain);
 uint16_t GetPersistDomainLevel(uint32_t domain);
-uint16_t GetTagLevel(const std::string& tag);
-uint16_t GetPersistTagLevel(const std::string& tag);
+uint16_t GetTagLevel(std::string_view tag);
+uint16_t GetPersistTagLevel(std::string_view tag);
 bool IsProcessSwitchOn();
 bool IsDomainSwitchOn();
 bool IsKmsgSwitchOn();
 size_t GetBufferSize(uint16_t type, bool persist);
 int GetProcessQuota(const std::string& proc);
 int GetDomainQuota(uint32_t domain);
+bool IsProcessBatchOn(const std::string& proc);
+bool IsProcessShmOn(const std::string& proc);
+bool IsProcessBinaryOn(const std::string& proc);
 bool IsStatsEnable();
 bool IsTagStatsEnable();
+size_t GetStatsTopK();
+size_t GetInputBatchSize();
+size_t GetInputWorkerNum();
 
 int SetPrivateSwitchOn(bool on);
 int SetOnceDebugOn(bool on);
@@ -22,12 +22,12 @@
 #include <fstream>
 #include <functional>
 #include <iostream>
+#include <mutex>
 #include <pthread.h>
-#include <shared_mutex>
 #include <string>
+#include <string_view>
 #include <sys/uio.h>
 #include <unistd.h>
-#include <unordered_map>
 
 #include <parameter.h>
 #include <sysparam_errno.h>
@@ -62,14 +62,19 @@ enum class PropType {
     PROP_STATS_ENABLE,
     PROP_STATS_TAG_ENABLE,
     PROP_DOMAIN_QUOTA,
+    PROP_INPUT_BATCH,
+    PROP_INPUT_WORKERS,
+    PROP_PROC_BATCH,
+    PROP_PROC_SHM,
+    PROP_PROC_BINARY,
+    PROP_STATS_TOPK,
 
     PROP_MAX,
 };
-using ReadLock = shared_lock<shared_timed_mutex>;
-using InsertLock = unique_lock<shared_timed_mutex>;
 
 static constexpr int HILOG_PROP_VALUE_MAX = 92;
 static constexpr int DEFAULT_QUOTA = 51200;
+static constexpr size_t DEFAULT_INPUT_BATCH = 16;
 static int LockByProp(PropType propType);
 static void UnlockByProp(PropType propType);
 
@@ -115,6 +120,12 @@ static __attribute__((constructor)) void InitProps()
         {"persist.sys.hilog.stats", nullptr}, // PROP_STATS_ENABLE,
         {"persist.sys.hilog.stats.tag", nullptr}, // PROP_STATS_TAG_ENABLE,
         {"hilog.quota.domain.", nullptr}, // DOMAIN_QUOTA
+        {"persist.sys.hilog.input.batch", nullptr}, // PROP_INPUT_BATCH
+        {"persist.sys.hilog.input.workers", nullptr}, // PROP_INPUT_WORKERS
+        {"hilog.batch.proc.", nullptr}, // PROP_PROC_BATCH
+        {"hilog.shm.proc.", nullptr}, // PROP_PROC_SHM
+        {"hilog.binary.proc.", nullptr}, // PROP_PROC_BINARY
+        {"persist.sys.hilog.stats.topk", nullptr}, // PROP_STATS_TOPK
     };
 }
 
@@ -352,6 +363,12 @@ bool IsPrivateModeEnable()
     return !IsDebugOn() && !IsDebuggableHap() && IsPrivateSwitchOn();
 }
 
+// Changes whenever any system parameter is set, log level properties included
+long long GetPropertiesCommitId()
+{
+    return GetSystemCommitId();
+}
+
 uint16_t GetGlobalLogLevel()
 {
     uint16_t globalLevel = GetGlobalLevel();
@@ -374,82 +391,137 @@ uint16_t GetPersistGlobalLevel()
     return logLevelCache->getValue();
 }
 
-uint16_t GetLevel(std::unordered_map<uint32_t, LogLevelCache*>* map, uint32_t key, PropType propType)
+static std::string LevelKeySuffix(uint32_t domain)
+{
+    return Uint2HexStr(domain);
+}
+
+static std::string LevelKeySuffix(std::string_view tag)
 {
-    static shared_timed_mutex* levelMtx = new shared_timed_mutex;
-    std::decay<decltype(*map)>::type::iterator it;
+    return std::string(tag);
+}
+
+/*
+ * Level caches of the domains or tags a process logs with, looked up on every log by every thread.
+ * Readers never lock: a slot is filled once and never changed, and a table which gets too full is
+ * replaced by a bigger copy. Replaced tables are never freed since readers may still probe them,
+ * they add up to less than the current one.
+ */
+template<typename Key, typename StoredKey>
+class LevelCacheTable {
+public:
+    explicit LevelCacheTable(PropType propType) : m_propType(propType), m_table(NewTable(INIT_CAPACITY)) {}
+
+    uint16_t GetLevel(Key key)
     {
-        ReadLock lock(*levelMtx);
-        it = map->find(key);
-        if (it != map->end()) {
-            LogLevelCache* levelCache = it->second;
-            return levelCache->getValue();
+        size_t hash = std::hash<Key>()(key);
+        LogLevelCache *cache = Find(*m_table.load(std::memory_order_acquire), key, hash);
+        if (cache == nullptr) {
+            cache = Insert(key, hash);
         }
+        return cache->getValue();
     }
-    InsertLock lock(*levelMtx);
-    it = map->find(key); // secured for two thread went across above condition
-    if (it == map->end()) {
-        LogLevelCache* levelCache = new LogLevelCache(TextToLogLevel, LOG_LEVEL_MIN, propType, Uint2HexStr(key));
-        auto result = map->insert({ key, levelCache });
-        if (!result.second) {
-            delete levelCache;
-            return LOG_LEVEL_MIN;
+
+private:
+    static constexpr size_t INIT_CAPACITY = 64;
+
+    struct Entry {
+        Entry(Key key, size_t hash, PropType propType)
+            : key(key), hash(hash), cache(TextToLogLevel, LOG_LEVEL_MIN, propType, LevelKeySuffix(key)) {}
+        const StoredKey key;
+        const size_t hash;
+        LogLevelCache cache;
+    };
+
+    struct Table {
+        size_t mask;
+        std::atomic<Entry*> *slots;
+    };
+
+    static Table *NewTable(size_t capacity)
+    {
+        return new Table{capacity - 1, new std::atomic<Entry*>[capacity]()};
+    }
+
+    static LogLevelCache *Find(const Table& table, Key key, size_t hash)
+    {
+        for (size_t i = hash & table.mask;; i = (i + 1) & table.mask) {
+            Entry *entry = table.slots[i].load(std::memory_order_acquire);
+            if (entry == nullptr) {
+                return nullptr;
+            }
+            if (entry->hash == hash && Key(entry->key) == key) {
+                return &entry->cache;
+            }
         }
-        it = result.first;
     }
-    LogLevelCache* levelCache = it->second;
-    return levelCache->getValue();
-}
 
-uint16_t GetLevel(std::unordered_map<std::string, LogLevelCache*>* map, const string& key, PropType propType)
-{
-    static shared_timed_mutex* levelMtx = new shared_timed_mutex;
-    std::decay<decltype(*map)>::type::iterator it;
+    static void Place(Table& table, Entry *entry)
     {
-        ReadLock lock(*levelMtx);
-        it = map->find(key);
-        if (it != map->end()) {
-            LogLevelCache* levelCache = it->second;
-            return levelCache->getValue();
+        size_t i = entry->hash & table.mask;
+        while (table.slots[i].load(std::memory_order_relaxed) != nullptr) {
+            i = (i + 1) & table.mask;
         }
+        table.slots[i].store(entry, std::memory_order_release);
     }
-    InsertLock lock(*levelMtx);
-    it = map->find(key); // secured for two thread went across above condition
-    if (it == map->end()) {
-        LogLevelCache* levelCache = new LogLevelCache(TextToLogLevel, LOG_LEVEL_MIN, propType, key);
-        auto result = map->insert({ key, levelCache });
-        if (!result.second) {
-            delete levelCache;
-            return LOG_LEVEL_MIN;
+
+    LogLevelCache *Insert(Key key, size_t hash)
+    {
+        std::lock_guard<std::mutex> lock(m_insertMtx);
+        Table *table = m_table.load(std::memory_order_relaxed);
+        LogLevelCache *cache = Find(*table, key, hash); // another thread may have inserted it meanwhile
+        if (cache != nullptr) {
+            return cache;
         }
-        it = result.first;
+        // Keep the load under 3/4 so that probes stay short and always end on an empty slot
+        if ((m_count + 1) * 4 > (table->mask + 1) * 3) {
+            Table *bigger = NewTable((table->mask + 1) * 2);
+            for (size_t i = 0; i <= table->mask; i++) {
+                Entry *entry = table->slots[i].load(std::memory_order_relaxed);
+                if (entry != nullptr) {
+                    Place(*bigger, entry);
+                }
+            }
+            m_table.store(bigger, std::memory_order_release);
+            table = bigger;
+        }
+        auto *entry = new Entry(key, hash, m_propType);
+        Place(*table, entry);
+        m_count++;
+        return &entry->cache;
     }
-    LogLevelCache* levelCache = it->second;
-    return levelCache->getValue();
-}
+
+    const PropType m_propType;
+    std::atomic<Table*> m_table;
+    std::mutex m_insertMtx;
+    size_t m_count = 0;
+};
+
+using DomainLevelTable = LevelCacheTable<uint32_t, uint32_t>;
+using TagLevelTable = LevelCacheTable<std::string_view, std::string>;
 
 uint16_t GetDomainLevel(uint32_t domain)
 {
-    static auto *domainMap = new std::unordered_map<uint32_t, LogLevelCache*>();
-    return GetLevel(domainMap, domain, PropType::PROP_DOMAIN_LOG_LEVEL);
+    static auto *domainTable = new DomainLevelTable(PropType::PROP_DOMAIN_LOG_LEVEL);
+    return domainTable->GetLevel(domain);
 }
 
 uint16_t GetPersistDomainLevel(uint32_t domain)
 {
-    static auto *persistDomainMap = new std::unordered_map<uint32_t, LogLevelCache*>();
-    return GetLevel(persistDomainMap, domain, PropType::PROP_PERSIST_DOMAIN_LOG_LEVEL);
+    static auto *persistDomainTable = new DomainLevelTable(PropType::PROP_PERSIST_DOMAIN_LOG_LEVEL);
+    return persistDomainTable->GetLevel(domain);
 }
 
-uint16_t GetTagLevel(const std::string& tag)
+uint16_t GetTagLevel(std::string_view tag)
 {
-    static auto *tagMap = new std::unordered_map<std::string, LogLevelCache*>();
-    return GetLevel(tagMap, tag, PropType::PROP_TAG_LOG_LEVEL);
+    static auto *tagTable = new TagLevelTable(PropType::PROP_TAG_LOG_LEVEL);
+    return tagTable->GetLevel(tag);
 }
 
-uint16_t GetPersistTagLevel(const std::string& tag)
+uint16_t GetPersistTagLevel(std::string_view tag)
 {
-    static auto *persistTagMap = new std::unordered_map<std::string, LogLevelCache*>();
-    return GetLevel(persistTagMap, tag, PropType::PROP_PERSIST_TAG_LOG_LEVEL);
+    static auto *persistTagTable = new TagLevelTable(PropType::PROP_PERSIST_TAG_LOG_LEVEL);
+    return persistTagTable->GetLevel(tag);
 }
 
 
@@ -531,6 +603,17 @@ bool IsTagStatsEnable()
     return TextToBool(rawData, false);
 }
 
+size_t GetStatsTopK()
+{
+    char value[HILOG_PROP_VALUE_MAX] = {0};
+
+    int ret = PropertyGet(GetPropertyName(PropType::PROP_STATS_TOPK), value, HILOG_PROP_VALUE_MAX);
+    if (ret == RET_FAIL || value[0] == 0) {
+        return 0;
+    }
+    return std::stoi(value);
+}
+
 int GetProcessQuota(const string& proc)
 {
     char value[HILOG_PROP_VALUE_MAX] = {0};
@@ -555,6 +638,61 @@ int GetDomainQuota(uint32_t domain)
     return std::stoi(value);
 }
 
+bool IsProcessBatchOn(const string& proc)
+{
+    RawPropertyData rawData;
+    string prop = GetPropertyName(PropType::PROP_PROC_BATCH) + proc;
+    int ret = PropertyGet(prop, rawData.data(), HILOG_PROP_VALUE_MAX);
+    if (ret == RET_FAIL) {
+        return false;
+    }
+    return TextToBool(rawData, false);
+}
+
+bool IsProcessShmOn(const string& proc)
+{
+    RawPropertyData rawData;
+    string prop = GetPropertyName(PropType::PROP_PROC_SHM) + proc;
+    int ret = PropertyGet(prop, rawData.data(), HILOG_PROP_VALUE_MAX);
+    if (ret == RET_FAIL) {
+        return false;
+    }
+    return TextToBool(rawData, false);
+}
+
+bool IsProcessBinaryOn(const string& proc)
+{
+    RawPropertyData rawData;
+    string prop = GetPropertyName(PropType::PROP_PROC_BINARY) + proc;
+    int ret = PropertyGet(prop, rawData.data(), HILOG_PROP_VALUE_MAX);
+    if (ret == RET_FAIL) {
+        return false;
+    }
+    return TextToBool(rawData, false);
+}
+
+size_t GetInputBatchSize()
+{
+    char value[HILOG_PROP_VALUE_MAX] = {0};
+
+    int ret = PropertyGet(GetPropertyName(PropType::PROP_INPUT_BATCH), value, HILOG_PROP_VALUE_MAX);
+    if (ret == RET_FAIL || value[0] == 0) {
+        return DEFAULT_INPUT_BATCH;
+    }
+    return std::stoi(value);
+}
+
+size_t GetInputWorkerNum()
+{
+    char value[HILOG_PROP_VALUE_MAX] = {0};
+
+    int ret = PropertyGet(GetPropertyName(PropType::PROP_INPUT_WORKERS), value, HILOG_PROP_VALUE_MAX);
+    if (ret == RET_FAIL || value[0] == 0) {
+        return 0;
+    }
+    return std::stoi(value);
+}
+
 static int SetBoolValue(PropType type, bool val)
 {
     string key = GetPropertyName(type);
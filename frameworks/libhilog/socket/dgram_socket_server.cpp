@@ -14,12 +14,42 @@
  */
 
 #include <array>
+#include <unistd.h>
 
 #include "dgram_socket_server.h"
 
 namespace OHOS {
 namespace HiviewDFX {
-int DgramSocketServer::RecvPacket(std::vector<char>& buffer, struct ucred *cred)
+bool DgramSocketServer::ParseControl(const struct msghdr& msgh, struct ucred *cred, std::vector<int> *fds)
+{
+    bool credFound = false;
+    for (struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgh); cmsg != nullptr;
+        cmsg = CMSG_NXTHDR(const_cast<struct msghdr *>(&msgh), cmsg)) {
+        if (cmsg->cmsg_level != SOL_SOCKET) {
+            continue;
+        }
+        if (cmsg->cmsg_type == SCM_CREDENTIALS && cmsg->cmsg_len >= CMSG_LEN(sizeof(struct ucred))) {
+            if (cred != nullptr) {
+                *cred = *reinterpret_cast<struct ucred *>(CMSG_DATA(cmsg));
+            }
+            credFound = true;
+        } else if (cmsg->cmsg_type == SCM_RIGHTS) {
+            // Any fd sent to us is ours now, close what nobody asked for so a client can't exhaust hilogd's fds
+            size_t count = (cmsg->cmsg_len - CMSG_LEN(0)) / sizeof(int);
+            int *received = reinterpret_cast<int *>(CMSG_DATA(cmsg));
+            for (size_t i = 0; i < count; i++) {
+                if (fds != nullptr) {
+                    fds->push_back(received[i]);
+                } else {
+                    close(received[i]);
+                }
+            }
+        }
+    }
+    return credFound;
+}
+
+int DgramSocketServer::RecvPacket(std::vector<char>& buffer, struct ucred *cred, std::vector<int> *fds)
 {
     uint16_t packetLen = 0;
     if (auto status = Recv(&packetLen, sizeof(packetLen)); status < 0) {
@@ -30,7 +60,7 @@ int DgramSocketServer::RecvPacket(std::vector<char>& buffer, struct ucred *cred)
         return 0;
     }
 
-    std::array<char, CMSG_SPACE(sizeof(struct ucred))> control = {0};
+    std::array<char, CONTROL_LEN> control = {0};
 
     struct msghdr msgh = {0};
     int ret = 0;
@@ -56,12 +86,9 @@ int DgramSocketServer::RecvPacket(std::vector<char>& buffer, struct ucred *cred)
     if (ret <= 0) {
         return ret;
     } else if (cred != nullptr) {
-        struct cmsghdr *cmsg = CMSG_FIRSTHDR(&msgh);
-        struct ucred *receivedUcred = (struct ucred*)CMSG_DATA(cmsg);
-        if (receivedUcred == nullptr) {
+        if (!ParseControl(msgh, cred, fds)) {
             return 0;
         }
-        *cred = *receivedUcred;
     }
     buffer[ret - 1] = 0;
 
@@ -15,9 +15,21 @@
 
 #include "hilog_input_socket_client.h"
 
+#include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <cstdint>
+#include <cstdlib>
+#include <list>
+#include <mutex>
+#include <pthread.h>
+#include <securec.h>
+#include <sys/prctl.h>
+#include <thread>
 
+#include "hilog/log_c.h"
 #include "hilog_common.h"
+#include "hilog_shm_ring.h"
 
 namespace OHOS {
 namespace HiviewDFX {
@@ -28,6 +40,191 @@ extern "C" int HilogWriteLogMessage(HilogMsg *header, const char *tag, uint16_t
     return g_hilogInputSocketClient.WriteLogMessage(header, tag, tagLen, fmt, fmtLen);
 }
 
+static constexpr size_t STAGING_SIZE = 16 * 1024;
+static constexpr unsigned int STAGING_MAX_COUNT = 32;
+static constexpr std::chrono::milliseconds STAGING_FLUSH_INTERVAL(50);
+
+struct StagingBuffer {
+    std::mutex mtx; /* contended only by the flusher thread */
+    char data[STAGING_SIZE];
+    size_t used = 0;
+    size_t offsets[STAGING_MAX_COUNT];
+    unsigned int count = 0;
+    std::chrono::steady_clock::time_point first;
+};
+
+struct StagingRegistry {
+    std::mutex mtx;
+    std::list<StagingBuffer*> buffers;
+    std::atomic_bool flusherStarted = false;
+};
+
+// Never destroyed, threads may still log while static objects are destructed at exit
+static StagingRegistry& GetStagingRegistry()
+{
+    static auto *registry = new StagingRegistry();
+    return *registry;
+}
+
+// Call with buffer.mtx locked
+static void FlushStagingBuffer(StagingBuffer& buffer)
+{
+    if (buffer.count == 0) {
+        return;
+    }
+    iovec vecs[STAGING_MAX_COUNT];
+    struct mmsghdr msgs[STAGING_MAX_COUNT] = {};
+    for (unsigned int i = 0; i < buffer.count; i++) {
+        char *record = buffer.data + buffer.offsets[i];
+        vecs[i].iov_base = record;
+        vecs[i].iov_len = reinterpret_cast<HilogMsg *>(record)->len;
+        msgs[i].msg_hdr.msg_iov = &vecs[i];
+        msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    (void)g_hilogInputSocketClient.WriteLogMessages(msgs, buffer.count);
+    buffer.count = 0;
+    buffer.used = 0;
+}
+
+static void StagingFlusherLoop()
+{
+    prctl(PR_SET_NAME, "hilog.flush");
+    StagingRegistry& registry = GetStagingRegistry();
+    for (;;) {
+        std::this_thread::sleep_for(STAGING_FLUSH_INTERVAL);
+        auto now = std::chrono::steady_clock::now();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        for (StagingBuffer *buffer : registry.buffers) {
+            std::unique_lock<std::mutex> bufferLock(buffer->mtx, std::try_to_lock);
+            if (bufferLock.owns_lock() && buffer->count > 0 && now - buffer->first >= STAGING_FLUSH_INTERVAL) {
+                FlushStagingBuffer(*buffer);
+            }
+        }
+    }
+}
+
+static void StagingAtForkPrepare()
+{
+    GetStagingRegistry().mtx.lock();
+}
+
+static void StagingAtForkParent()
+{
+    GetStagingRegistry().mtx.unlock();
+}
+
+// The child has no flusher thread and must not send the logs staged by its parent
+static void StagingAtForkChild()
+{
+    StagingRegistry& registry = GetStagingRegistry();
+    for (StagingBuffer *buffer : registry.buffers) {
+        std::unique_lock<std::mutex> bufferLock(buffer->mtx, std::try_to_lock);
+        if (bufferLock.owns_lock()) {
+            buffer->count = 0;
+            buffer->used = 0;
+        }
+    }
+    registry.flusherStarted.store(false);
+    registry.mtx.unlock();
+}
+
+static void StartStagingFlusher()
+{
+    StagingRegistry& registry = GetStagingRegistry();
+    static std::once_flag atForkFlag;
+    std::call_once(atForkFlag, []() {
+        (void)pthread_atfork(StagingAtForkPrepare, StagingAtForkParent, StagingAtForkChild);
+        // Registered after the socket client was constructed, so it runs before the client is destroyed
+        (void)atexit(HilogFlushLogMessages);
+    });
+    bool expected = false;
+    if (registry.flusherStarted.compare_exchange_strong(expected, true)) {
+        std::thread(StagingFlusherLoop).detach();
+    }
+}
+
+class StagingHolder {
+public:
+    StagingHolder() : m_buffer(new (std::nothrow) StagingBuffer())
+    {
+        if (m_buffer == nullptr) {
+            return;
+        }
+        StagingRegistry& registry = GetStagingRegistry();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        registry.buffers.push_back(m_buffer);
+    }
+
+    ~StagingHolder()
+    {
+        if (m_buffer == nullptr) {
+            return;
+        }
+        StagingRegistry& registry = GetStagingRegistry();
+        std::lock_guard<std::mutex> lock(registry.mtx);
+        registry.buffers.remove(m_buffer);
+        {
+            std::lock_guard<std::mutex> bufferLock(m_buffer->mtx);
+            FlushStagingBuffer(*m_buffer);
+        }
+        delete m_buffer;
+        m_buffer = nullptr;
+    }
+
+    StagingBuffer *Get() const { return m_buffer; }
+
+private:
+    StagingBuffer *m_buffer;
+};
+
+extern "C" int HilogStageLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
+    uint16_t fmtLen)
+{
+    static thread_local StagingHolder holder;
+    StagingBuffer *buffer = holder.Get();
+    if (buffer == nullptr) {
+        return HilogWriteLogMessage(header, tag, tagLen, fmt, fmtLen);
+    }
+    if (!GetStagingRegistry().flusherStarted.load(std::memory_order_relaxed)) {
+        StartStagingFlusher();
+    }
+
+    size_t len = sizeof(HilogMsg) + tagLen + fmtLen;
+    header->len = len;
+    header->tagLen = tagLen;
+    std::lock_guard<std::mutex> lock(buffer->mtx);
+    if (buffer->count == STAGING_MAX_COUNT || buffer->used + len > STAGING_SIZE) {
+        FlushStagingBuffer(*buffer);
+    }
+    char *record = buffer->data + buffer->used;
+    size_t remain = STAGING_SIZE - buffer->used;
+    if (memcpy_s(record, remain, header, sizeof(HilogMsg)) != EOK ||
+        memcpy_s(record + sizeof(HilogMsg), remain - sizeof(HilogMsg), tag, tagLen) != EOK ||
+        memcpy_s(record + sizeof(HilogMsg) + tagLen, remain - sizeof(HilogMsg) - tagLen, fmt, fmtLen) != EOK) {
+        return -1;
+    }
+    if (buffer->count == 0) {
+        buffer->first = std::chrono::steady_clock::now();
+    }
+    buffer->offsets[buffer->count++] = buffer->used;
+    buffer->used += len;
+    // Don't keep errors in memory, the process may be about to crash
+    if (header->level >= LOG_ERROR || buffer->count == STAGING_MAX_COUNT) {
+        FlushStagingBuffer(*buffer);
+    }
+    return static_cast<int>(len);
+}
+
+extern "C" void HilogFlushLogMessages()
+{
+    StagingRegistry& registry = GetStagingRegistry();
+    std::lock_guard<std::mutex> lock(registry.mtx);
+    for (StagingBuffer *buffer : registry.buffers) {
+        std::lock_guard<std::mutex> bufferLock(buffer->mtx);
+        FlushStagingBuffer(*buffer);
+    }
+}
+
 extern "C" int GetHilogSocketFd()
 {
     return g_hilogInputSocketClient.GetSocketFd();
@@ -65,6 +262,74 @@ int HilogInputSocketClient::WriteLogMessage(HilogMsg *header, const char *tag, u
     return ret;
 }
 
+int HilogInputSocketClient::WriteLogMessages(struct mmsghdr *msgs, unsigned int count)
+{
+    int ret = CheckSocket();
+    if (ret < 0) {
+        return ret;
+    }
+
+    unsigned int pos = 0;
+    unsigned int sent = 0;
+    bool reconnected = false;
+    while (pos < count) {
+        ret = SendMMsg(msgs + pos, count - pos);
+        if (ret > 0) {
+            pos += static_cast<unsigned int>(ret);
+            sent += static_cast<unsigned int>(ret);
+            continue;
+        }
+        // As WriteLogMessage does for one log: reconnect and retry once, drop the log if it still fails
+        if (!reconnected && errno != EAGAIN) {
+            Connect();
+            reconnected = true;
+            continue;
+        }
+        pos++;
+    }
+    return static_cast<int>(sent);
+}
+
+int HilogInputSocketClient::SendShmSetup(int memFd, int eventFd)
+{
+    int ret = CheckSocket();
+    if (ret < 0) {
+        return ret;
+    }
+
+    HilogShmSetupMsg msg = {
+        .len = sizeof(HilogShmSetupMsg),
+        .version = HILOG_SHM_VERSION,
+        .magic = HILOG_SHM_MAGIC,
+    };
+    iovec vec;
+    vec.iov_base = &msg;
+    vec.iov_len = sizeof(msg);
+    int fds[] = {memFd, eventFd};
+    union {
+        char buf[CMSG_SPACE(sizeof(fds))];
+        struct cmsghdr align;
+    } control = {};
+    struct msghdr hdr = {};
+    hdr.msg_iov = &vec;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control.buf;
+    hdr.msg_controllen = sizeof(control.buf);
+    struct cmsghdr *cmsg = CMSG_FIRSTHDR(&hdr);
+    cmsg->cmsg_level = SOL_SOCKET;
+    cmsg->cmsg_type = SCM_RIGHTS;
+    cmsg->cmsg_len = CMSG_LEN(sizeof(fds));
+    if (memcpy_s(CMSG_DATA(cmsg), sizeof(fds), fds, sizeof(fds)) != EOK) {
+        return -1;
+    }
+    ret = SendMsg(&hdr);
+    if (ret < 0) {
+        Connect();
+        ret = SendMsg(&hdr);
+    }
+    return ret;
+}
+
 int HilogInputSocketClient::GetSocketFd()
 {
     return GetFd();
@@ -16,32 +16,64 @@
 #include "hilog_input_socket_server.h"
 
 #include <__threading_support>
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <cerrno>
+#include <chrono>
 #include <functional>
 #include <sys/prctl.h>
 #include <sys/socket.h>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
+#include "hilog_common.h"
+#include "hilog_shm_ring.h"
+
 namespace OHOS {
 namespace HiviewDFX {
+static constexpr std::chrono::milliseconds WORKER_IDLE_WAIT(100);
+
+HilogInputSocketServer::HilogInputSocketServer(HandlingFunc _packetHandler, size_t batchSize, size_t workerNum,
+    const std::string& socketName)
+    : DgramSocketServer(socketName, MAX_SOCKET_PACKET_LEN),
+    m_packetHandler(_packetHandler), m_stopServer(false),
+    m_batchSize(std::clamp<size_t>(batchSize, 1, MAX_BATCH_SIZE)),
+    m_workerNum(std::min(workerNum, MAX_WORKER_NUM))
+{
+}
+
 HilogInputSocketServer::~HilogInputSocketServer()
 {
     StopServingThread();
 }
 
+#ifdef __RECV_MSG_WITH_UCRED_
+void HilogInputSocketServer::SetShmSetupHandler(ShmSetupFunc handler)
+{
+    m_shmSetupHandler = handler;
+}
+#endif
+
 HilogInputSocketServer::ServerThreadState HilogInputSocketServer::RunServingThread()
 {
     if (m_serverThread.get_id() != std::thread().get_id()) {
         return ServerThreadState::ALREADY_STARTED;
     }
     m_stopServer.store(false);
+    StartWorkers();
     m_serverThread = std::thread([this]() {
-        ServingThread();
+        if (m_batchSize > 1 || !m_workers.empty()) {
+            BatchServingThread();
+        } else {
+            ServingThread();
+        }
     });
     if (m_serverThread.get_id() != std::thread().get_id()) {
         return ServerThreadState::JUST_STARTED;
     }
+    StopWorkers();
     return ServerThreadState::CAN_NOT_START;
 }
 
@@ -54,8 +86,21 @@ void HilogInputSocketServer::StopServingThread()
     std::swap(m_serverThread, tmp);
     if (tmp.joinable()) {
         m_stopServer.store(true);
+        (void)Shutdown(); // the serving thread waits for packets without a timeout
         tmp.join();
     }
+    StopWorkers();
+}
+
+HilogInputSocketServer::InputStats HilogInputSocketServer::GetStats() const
+{
+    return InputStats {
+        .packets = m_packets.load(std::memory_order_relaxed),
+        .bytes = m_bytes.load(std::memory_order_relaxed),
+        .recvCalls = m_recvCalls.load(std::memory_order_relaxed),
+        .dropped = m_dropped.load(std::memory_order_relaxed),
+        .queueFull = m_queueFull.load(std::memory_order_relaxed),
+    };
 }
 
 void HilogInputSocketServer::ServingThread()
@@ -65,7 +110,10 @@ void HilogInputSocketServer::ServingThread()
     std::vector<char> data(maxPacketLength);
 #ifndef __RECV_MSG_WITH_UCRED_
     while ((ret = RecvPacket(data)) >= 0) {
+        m_recvCalls.fetch_add(1, std::memory_order_relaxed);
         if (ret > 0) {
+            m_packets.fetch_add(1, std::memory_order_relaxed);
+            m_bytes.fetch_add(ret, std::memory_order_relaxed);
             m_packetHandler(data, ret);
         }
         if (m_stopServer.load()) {
@@ -74,8 +122,14 @@ void HilogInputSocketServer::ServingThread()
     }
 #else
     ucred cred;
-    while ((ret = RecvPacket(data, &cred)) >= 0) {
-        if (ret > 0) {
+    std::vector<int> fds;
+    while ((ret = RecvPacket(data, &cred, &fds)) >= 0) {
+        m_recvCalls.fetch_add(1, std::memory_order_relaxed);
+        if (!fds.empty()) {
+            HandleFds(cred, data, ret, fds);
+        } else if (ret > 0) {
+            m_packets.fetch_add(1, std::memory_order_relaxed);
+            m_bytes.fetch_add(ret, std::memory_order_relaxed);
             m_packetHandler(cred, data, ret);
         }
         if (m_stopServer.load()) {
@@ -84,5 +138,181 @@ void HilogInputSocketServer::ServingThread()
     }
 #endif
 }
+
+void HilogInputSocketServer::BatchServingThread()
+{
+    prctl(PR_SET_NAME, "hilogd.server");
+    using Control = std::array<char, CONTROL_LEN>;
+    std::vector<Packet> packets(m_batchSize);
+    std::vector<mmsghdr> hdrs(m_batchSize);
+    std::vector<iovec> iovs(m_batchSize);
+    std::vector<Control> controls(m_batchSize);
+    for (auto& packet : packets) {
+        packet.data.resize(maxPacketLength);
+    }
+    std::vector<int> fds;
+    while (!m_stopServer.load()) {
+        for (size_t i = 0; i < m_batchSize; i++) {
+            // A packet buffer may have been swapped into a worker queue, so point at the current one
+            iovs[i].iov_base = packets[i].data.data();
+            iovs[i].iov_len = maxPacketLength;
+            hdrs[i] = {};
+            hdrs[i].msg_hdr.msg_iov = &iovs[i];
+            hdrs[i].msg_hdr.msg_iovlen = 1;
+            hdrs[i].msg_hdr.msg_control = controls[i].data();
+            hdrs[i].msg_hdr.msg_controllen = controls[i].size();
+        }
+        int count = RecvMMsg(hdrs.data(), m_batchSize, MSG_WAITFORONE);
+        if (count < 0) {
+            if (errno == EINTR || errno == EAGAIN) {
+                continue;
+            }
+            break;
+        }
+        m_recvCalls.fetch_add(1, std::memory_order_relaxed);
+        for (int i = 0; i < count; i++) {
+            Packet& packet = packets[i];
+            const msghdr& msgh = hdrs[i].msg_hdr;
+            packet.len = static_cast<int>(hdrs[i].msg_len);
+            packet.cred = {0};
+            bool credFound = ParseControl(msgh, &packet.cred, &fds);
+#ifndef __RECV_MSG_WITH_UCRED_
+            credFound = true; // credentials are only passed along with the ucred handler
+#endif
+            // Like RecvPacket(), a packet without the sender's credentials is dropped
+            if (!credFound || packet.len <= 0 || (msgh.msg_flags & (MSG_TRUNC | MSG_CTRUNC)) != 0) {
+                HandleFds(packet.cred, packet.data, 0, fds);
+                m_dropped.fetch_add(1, std::memory_order_relaxed);
+                continue;
+            }
+            if (!fds.empty()) {
+                HandleFds(packet.cred, packet.data, packet.len, fds);
+                continue;
+            }
+            packet.data[packet.len - 1] = 0;
+            m_packets.fetch_add(1, std::memory_order_relaxed);
+            m_bytes.fetch_add(packet.len, std::memory_order_relaxed);
+            Dispatch(packet);
+        }
+    }
+}
+
+void HilogInputSocketServer::HandlePacket(Packet& packet)
+{
+#ifndef __RECV_MSG_WITH_UCRED_
+    m_packetHandler(packet.data, packet.len);
+#else
+    m_packetHandler(packet.cred, packet.data, packet.len);
+#endif
+}
+
+void HilogInputSocketServer::HandleFds(const ucred& cred, const std::vector<char>& data, int len,
+    std::vector<int>& fds)
+{
+#ifdef __RECV_MSG_WITH_UCRED_
+    const HilogShmSetupMsg *msg = reinterpret_cast<const HilogShmSetupMsg *>(data.data());
+    if (m_shmSetupHandler != nullptr && fds.size() == MAX_PACKET_FDS && cred.pid > 0 &&
+        len == static_cast<int>(sizeof(HilogShmSetupMsg)) && msg->len == sizeof(HilogShmSetupMsg) &&
+        msg->magic == HILOG_SHM_MAGIC && msg->version == HILOG_SHM_VERSION) {
+        m_shmSetupHandler(cred, fds[0], fds[1]);
+        fds.clear();
+        return;
+    }
+#endif
+    for (int fd : fds) {
+        close(fd);
+    }
+    fds.clear();
+}
+
+void HilogInputSocketServer::Dispatch(Packet& packet)
+{
+    if (m_workers.empty()) {
+        HandlePacket(packet);
+        return;
+    }
+#ifndef __RECV_MSG_WITH_UCRED_
+    uint32_t pid = (packet.len >= static_cast<int>(sizeof(HilogMsg))) ?
+        reinterpret_cast<const HilogMsg *>(packet.data.data())->pid : 0;
+#else
+    uint32_t pid = static_cast<uint32_t>(packet.cred.pid);
+#endif
+    Worker& worker = *m_workers[pid % m_workers.size()];
+    size_t tail = worker.tail.load(std::memory_order_relaxed);
+    if (tail - worker.head.load(std::memory_order_acquire) >= WORKER_QUEUE_LEN) {
+        m_queueFull.fetch_add(1, std::memory_order_relaxed);
+        // Stop reading the socket until the worker catches up, the kernel queue absorbs the burst meanwhile
+        std::unique_lock<std::mutex> lock(worker.mtx);
+        worker.producerWaiting.store(true);
+        worker.spaceCv.wait(lock, [&worker, tail]() { return tail - worker.head.load() < WORKER_QUEUE_LEN; });
+        worker.producerWaiting.store(false);
+    }
+    Packet& slot = worker.queue[tail % WORKER_QUEUE_LEN];
+    std::swap(slot.data, packet.data);
+    slot.len = packet.len;
+    slot.cred = packet.cred;
+    worker.tail.store(tail + 1);
+    if (worker.sleeping.load()) {
+        std::lock_guard<std::mutex> lock(worker.mtx);
+        worker.cv.notify_one();
+    }
+}
+
+void HilogInputSocketServer::WorkerThread(Worker& worker)
+{
+    prctl(PR_SET_NAME, "hilogd.input");
+    for (;;) {
+        size_t head = worker.head.load(std::memory_order_relaxed);
+        if (head == worker.tail.load(std::memory_order_acquire)) {
+            if (m_stopServer.load()) {
+                break;
+            }
+            std::unique_lock<std::mutex> lock(worker.mtx);
+            worker.sleeping.store(true);
+            if (head == worker.tail.load()) {
+                worker.cv.wait_for(lock, WORKER_IDLE_WAIT);
+            }
+            worker.sleeping.store(false);
+            continue;
+        }
+        HandlePacket(worker.queue[head % WORKER_QUEUE_LEN]);
+        worker.head.store(head + 1);
+        if (worker.producerWaiting.load()) {
+            std::lock_guard<std::mutex> lock(worker.mtx);
+            worker.spaceCv.notify_one();
+        }
+    }
+}
+
+void HilogInputSocketServer::StartWorkers()
+{
+    for (size_t i = 0; i < m_workerNum; i++) {
+        auto worker = std::make_unique<Worker>();
+        worker->queue.resize(WORKER_QUEUE_LEN);
+        for (auto& packet : worker->queue) {
+            packet.data.resize(maxPacketLength);
+        }
+        Worker& ref = *worker;
+        worker->thread = std::thread([this, &ref]() {
+            WorkerThread(ref);
+        });
+        m_workers.push_back(std::move(worker));
+    }
+}
+
+void HilogInputSocketServer::StopWorkers()
+{
+    m_stopServer.store(true);
+    for (auto& worker : m_workers) {
+        {
+            std::lock_guard<std::mutex> lock(worker->mtx);
+            worker->cv.notify_one();
+        }
+        if (worker->thread.joinable()) {
+            worker->thread.join();
+        }
+    }
+    m_workers.clear();
+}
 } // namespace HiviewDFX
 } // namespace OHOS
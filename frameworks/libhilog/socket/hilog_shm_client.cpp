@@ -0,0 +1,204 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <cstdint>
+#include <fcntl.h>
+#include <mutex>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include "hilog_common.h"
+#include "hilog_input_socket_client.h"
+#include "hilog_shm_ring.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+static constexpr uint32_t SHM_SETUP_RETRY_INTERVAL = 30; /* seconds */
+
+enum ShmClientState : int {
+    SHM_CLIENT_NONE = 0, /* logs go to the socket, setup is sent again after nextSetupTime */
+    SHM_CLIENT_PENDING, /* setup sent, waiting for hilogd to attach the ring */
+    SHM_CLIENT_ATTACHED,
+    SHM_CLIENT_DISABLED, /* the ring can't be created or hilogd refused it, socket only */
+};
+
+struct ShmClient {
+    std::mutex mtx; /* taken only to change state, writers never wait for it */
+    std::atomic<int> state = SHM_CLIENT_NONE;
+    HilogShmRing ring;
+    void *mem = nullptr;
+    size_t memSize = 0;
+    int memFd = -1;
+    int eventFd = -1;
+    uint32_t setupTime = 0;
+    uint32_t nextSetupTime = 0;
+};
+
+static HilogInputSocketClient g_shmSetupSocket;
+
+// Never destroyed and never unmapped while the process runs, other threads may be writing the ring
+static ShmClient& GetShmClient()
+{
+    static auto *client = new ShmClient();
+    return *client;
+}
+
+static void ShmAtForkPrepare()
+{
+    GetShmClient().mtx.lock();
+}
+
+static void ShmAtForkParent()
+{
+    GetShmClient().mtx.unlock();
+}
+
+// The child is single threaded here, it drops the parent's ring and creates its own if it logs
+static void ShmAtForkChild()
+{
+    ShmClient& client = GetShmClient();
+    if (client.mem != nullptr) {
+        munmap(client.mem, client.memSize);
+        client.mem = nullptr;
+    }
+    if (client.memFd >= 0) {
+        close(client.memFd);
+        client.memFd = -1;
+    }
+    if (client.eventFd >= 0) {
+        close(client.eventFd);
+        client.eventFd = -1;
+    }
+    client.state.store(SHM_CLIENT_NONE);
+    client.nextSetupTime = 0;
+    client.mtx.unlock();
+}
+
+static bool CreateShmRing(ShmClient& client)
+{
+    size_t memSize = HILOG_SHM_HEADER_SIZE + HILOG_SHM_RING_SIZE;
+    int memFd = memfd_create("hilog_ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (memFd < 0) {
+        return false;
+    }
+    // hilogd refuses rings which could shrink under its mapping
+    if (ftruncate(memFd, memSize) < 0 || fcntl(memFd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL) < 0) {
+        close(memFd);
+        return false;
+    }
+    void *mem = mmap(nullptr, memSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    if (mem == MAP_FAILED) {
+        close(memFd);
+        return false;
+    }
+    int eventFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (eventFd < 0) {
+        munmap(mem, memSize);
+        close(memFd);
+        return false;
+    }
+    static std::once_flag atForkFlag;
+    std::call_once(atForkFlag, []() {
+        (void)pthread_atfork(ShmAtForkPrepare, ShmAtForkParent, ShmAtForkChild);
+    });
+    client.ring.Init(mem, HILOG_SHM_RING_SIZE);
+    client.mem = mem;
+    client.memSize = memSize;
+    client.memFd = memFd;
+    client.eventFd = eventFd;
+    return true;
+}
+
+// Call with client.mtx locked
+static int SendShmSetup(ShmClient& client, uint32_t now)
+{
+    if (client.mem == nullptr && !CreateShmRing(client)) {
+        return SHM_CLIENT_DISABLED;
+    }
+    // The same ring is sent again after hilogd restarted, hilogd resumes it from its tail
+    client.ring.SetState(SHM_PENDING);
+    if (g_shmSetupSocket.SendShmSetup(client.memFd, client.eventFd) < 0) {
+        client.nextSetupTime = now + SHM_SETUP_RETRY_INTERVAL;
+        return SHM_CLIENT_NONE;
+    }
+    client.setupTime = now;
+    return SHM_CLIENT_PENDING;
+}
+
+static bool IsShmReaderAlive(const ShmClient& client, uint32_t now)
+{
+    return client.ring.GetState() == SHM_ATTACHED && now <= client.ring.GetBeat() + HILOG_SHM_BEAT_TIMEOUT;
+}
+
+static int UpdateShmState(ShmClient& client, uint32_t now)
+{
+    std::unique_lock<std::mutex> lock(client.mtx, std::try_to_lock);
+    if (!lock.owns_lock()) {
+        return client.state.load();
+    }
+    int state = client.state.load();
+    switch (state) {
+        case SHM_CLIENT_NONE:
+            if (now >= client.nextSetupTime) {
+                state = SendShmSetup(client, now);
+            }
+            break;
+        case SHM_CLIENT_PENDING:
+            if (client.ring.GetState() == SHM_ATTACHED) {
+                state = SHM_CLIENT_ATTACHED;
+            } else if (now > client.setupTime + HILOG_SHM_BEAT_TIMEOUT) {
+                // Not accepted, hilogd may not be up yet or already serves too many rings
+                state = SHM_CLIENT_NONE;
+                client.nextSetupTime = now + SHM_SETUP_RETRY_INTERVAL;
+            }
+            break;
+        case SHM_CLIENT_ATTACHED:
+            if (client.ring.GetState() == SHM_DETACHED) {
+                // hilogd found the ring corrupted
+                state = SHM_CLIENT_DISABLED;
+            } else if (!IsShmReaderAlive(client, now)) {
+                // hilogd is gone, try to hand the ring to the next one right away
+                state = SendShmSetup(client, now);
+            }
+            break;
+        default:
+            break;
+    }
+    client.state.store(state);
+    return state;
+}
+
+extern "C" int HilogShmWriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
+    uint16_t fmtLen)
+{
+    ShmClient& client = GetShmClient();
+    uint32_t now = header->mono_sec;
+    int state = client.state.load(std::memory_order_acquire);
+    if (state != SHM_CLIENT_DISABLED && (state != SHM_CLIENT_ATTACHED || !IsShmReaderAlive(client, now))) {
+        state = UpdateShmState(client, now);
+    }
+    if (state == SHM_CLIENT_ATTACHED && client.ring.Write(*header, tag, tagLen, fmt, fmtLen)) {
+        if (client.ring.ShouldWake()) {
+            (void)eventfd_write(client.eventFd, 1);
+        }
+        return sizeof(HilogMsg) + tagLen + fmtLen;
+    }
+    return HilogWriteLogMessage(header, tag, tagLen, fmt, fmtLen);
+}
+} // namespace HiviewDFX
+} // namespace OHOS
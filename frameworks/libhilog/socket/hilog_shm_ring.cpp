@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "hilog_shm_ring.h"
+
+#include <securec.h>
+
+namespace OHOS {
+namespace HiviewDFX {
+static constexpr uint32_t RECORD_WORD_LEN = sizeof(uint32_t);
+static constexpr uint32_t RECORD_ALIGN = 8;
+static constexpr uint32_t PADDING_FLAG = 0x80000000;
+
+static inline uint64_t AlignRecord(uint64_t len)
+{
+    return (len + RECORD_ALIGN - 1) & ~static_cast<uint64_t>(RECORD_ALIGN - 1);
+}
+
+void HilogShmRing::Init(void *mem, uint32_t size)
+{
+    m_header = static_cast<HilogShmRingHeader *>(mem);
+    m_data = static_cast<char *>(mem) + HILOG_SHM_HEADER_SIZE;
+    m_size = size;
+    (void)memset_s(mem, HILOG_SHM_HEADER_SIZE, 0, HILOG_SHM_HEADER_SIZE);
+    m_header->magic = HILOG_SHM_MAGIC;
+    m_header->version = HILOG_SHM_VERSION;
+    m_header->size = size;
+    m_header->state = SHM_PENDING;
+}
+
+void HilogShmRing::Attach(void *mem, uint32_t size)
+{
+    m_header = static_cast<HilogShmRingHeader *>(mem);
+    m_data = static_cast<char *>(mem) + HILOG_SHM_HEADER_SIZE;
+    m_size = size;
+    // A ring sent again after hilogd restarted is resumed where the previous reader stopped
+    m_tail = __atomic_load_n(&m_header->tail, __ATOMIC_ACQUIRE);
+}
+
+bool HilogShmRing::Write(const HilogMsg& header, const char *tag, uint16_t tagLen, const char *fmt,
+    uint16_t fmtLen)
+{
+    uint32_t len = sizeof(HilogMsg) + tagLen + fmtLen;
+    uint64_t need = AlignRecord(RECORD_WORD_LEN + len);
+    uint64_t pos = __atomic_load_n(&m_header->reserve, __ATOMIC_RELAXED);
+    uint64_t pad;
+    do {
+        uint64_t offset = pos & (m_size - 1);
+        // A record never wraps, the end of the ring is skipped with a padding record instead
+        pad = (m_size - offset < need) ? (m_size - offset) : 0;
+        uint64_t tail = __atomic_load_n(&m_header->tail, __ATOMIC_ACQUIRE);
+        if (pos + pad + need - tail > m_size) {
+            __atomic_fetch_add(&m_header->dropped, 1, __ATOMIC_RELAXED);
+            return false;
+        }
+    } while (!__atomic_compare_exchange_n(&m_header->reserve, &pos, pos + pad + need, true,
+        __ATOMIC_RELAXED, __ATOMIC_RELAXED));
+
+    if (pad != 0) {
+        uint32_t *padWord = reinterpret_cast<uint32_t *>(m_data + (pos & (m_size - 1)));
+        __atomic_store_n(padWord, PADDING_FLAG | static_cast<uint32_t>(pad), __ATOMIC_RELEASE);
+        pos += pad;
+    }
+    char *record = m_data + (pos & (m_size - 1));
+    char *msg = record + RECORD_WORD_LEN;
+    size_t room = need - RECORD_WORD_LEN;
+    HilogMsg fixed = header;
+    fixed.len = len;
+    fixed.tagLen = tagLen;
+    (void)memcpy_s(msg, room, &fixed, sizeof(HilogMsg));
+    (void)memcpy_s(msg + sizeof(HilogMsg), room - sizeof(HilogMsg), tag, tagLen);
+    (void)memcpy_s(msg + sizeof(HilogMsg) + tagLen, room - sizeof(HilogMsg) - tagLen, fmt, fmtLen);
+    // Pairs with PrepareIdle(): either the reader sees this record or the writer sees readerIdle
+    __atomic_store_n(reinterpret_cast<uint32_t *>(record), len, __ATOMIC_SEQ_CST);
+    return true;
+}
+
+bool HilogShmRing::ShouldWake()
+{
+    if (__atomic_load_n(&m_header->readerIdle, __ATOMIC_SEQ_CST) == 0) {
+        return false;
+    }
+    return __atomic_exchange_n(&m_header->readerIdle, 0, __ATOMIC_SEQ_CST) != 0;
+}
+
+HilogShmRing::ReadResult HilogShmRing::Read(char *buffer, size_t bufferLen, size_t& len)
+{
+    for (;;) {
+        uint64_t offset = m_tail & (m_size - 1);
+        uint32_t *word = reinterpret_cast<uint32_t *>(m_data + offset);
+        uint32_t value = __atomic_load_n(word, __ATOMIC_ACQUIRE);
+        if (value == 0) {
+            return ReadResult::EMPTY;
+        }
+        if ((value & PADDING_FLAG) != 0) {
+            uint32_t pad = value & ~PADDING_FLAG;
+            if (pad != m_size - offset) {
+                return ReadResult::CORRUPTED;
+            }
+            (void)memset_s(m_data + offset, pad, 0, pad);
+            m_tail += pad;
+            continue;
+        }
+        uint64_t need = AlignRecord(RECORD_WORD_LEN + value);
+        if (value < sizeof(HilogMsg) || value > bufferLen || need > m_size - offset) {
+            return ReadResult::CORRUPTED;
+        }
+        // The writer process may still scribble on the ring, only the copy is trusted
+        if (memcpy_s(buffer, bufferLen, m_data + offset + RECORD_WORD_LEN, value) != EOK) {
+            return ReadResult::CORRUPTED;
+        }
+        (void)memset_s(m_data + offset, need, 0, need);
+        m_tail += need;
+        len = value;
+        return ReadResult::OK;
+    }
+}
+
+void HilogShmRing::Commit()
+{
+    __atomic_store_n(&m_header->tail, m_tail, __ATOMIC_RELEASE);
+}
+
+bool HilogShmRing::PrepareIdle()
+{
+    __atomic_store_n(&m_header->readerIdle, 1, __ATOMIC_SEQ_CST);
+    uint32_t *word = reinterpret_cast<uint32_t *>(m_data + (m_tail & (m_size - 1)));
+    if (__atomic_load_n(word, __ATOMIC_SEQ_CST) != 0) {
+        __atomic_store_n(&m_header->readerIdle, 0, __ATOMIC_RELAXED);
+        return false;
+    }
+    return true;
+}
+
+void HilogShmRing::SetState(HilogShmState state)
+{
+    __atomic_store_n(&m_header->state, static_cast<uint32_t>(state), __ATOMIC_RELEASE);
+}
+
+HilogShmState HilogShmRing::GetState() const
+{
+    return static_cast<HilogShmState>(__atomic_load_n(&m_header->state, __ATOMIC_ACQUIRE));
+}
+
+void HilogShmRing::Beat(uint32_t now)
+{
+    __atomic_store_n(&m_header->readerBeat, now, __ATOMIC_RELAXED);
+}
+
+uint32_t HilogShmRing::GetBeat() const
+{
+    return __atomic_load_n(&m_header->readerBeat, __ATOMIC_RELAXED);
+}
+} // namespace HiviewDFX
+} // namespace OHOS
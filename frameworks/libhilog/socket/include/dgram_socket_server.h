@@ -29,8 +29,13 @@ class DgramSocketServer : public SocketServer {
 public:
     DgramSocketServer(const std::string& socketName, uint16_t maxLength)
         : SocketServer(socketName, SOCK_DGRAM), maxPacketLength(maxLength) {}
-    int RecvPacket(std::vector<char>& buffer, struct ucred *cred = nullptr);
+    // Passed fds are returned in fds if it's not null, otherwise they are closed
+    int RecvPacket(std::vector<char>& buffer, struct ucred *cred = nullptr, std::vector<int> *fds = nullptr);
 protected:
+    static constexpr size_t MAX_PACKET_FDS = 2;
+    static constexpr size_t CONTROL_LEN = CMSG_SPACE(sizeof(struct ucred)) + CMSG_SPACE(sizeof(int) * MAX_PACKET_FDS);
+    static bool ParseControl(const struct msghdr& msgh, struct ucred *cred, std::vector<int> *fds);
+
     uint16_t maxPacketLength;
 };
 } // namespace HiviewDFX
@@ -25,6 +25,8 @@ class HilogInputSocketClient : DgramSocketClient {
 public:
     HilogInputSocketClient() : DgramSocketClient(INPUT_SOCKET_NAME, SOCK_NONBLOCK | SOCK_CLOEXEC) {}
     int WriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt, uint16_t fmtLen);
+    int WriteLogMessages(struct mmsghdr *msgs, unsigned int count);
+    int SendShmSetup(int memFd, int eventFd);
     int GetSocketFd();
     void CloseSocketFd();
     ~HilogInputSocketClient() = default;
@@ -34,6 +36,21 @@ public:
 
 extern "C" int HilogWriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
     uint16_t fmtLen);
+/*
+ * Batch mode: the log is appended to a per thread staging buffer which is sent with one sendmmsg
+ * when it's full, when an ERROR/FATAL log arrives or by a background flusher after a short delay.
+ * Every log is still one datagram with the same layout as HilogWriteLogMessage sends.
+ */
+extern "C" int HilogStageLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
+    uint16_t fmtLen);
+// Sends what all threads staged, also run at exit so the last logs of the process aren't lost
+extern "C" void HilogFlushLogMessages();
+/*
+ * Shared memory mode: the log is appended to a ring shared with hilogd, see hilog_shm_ring.h.
+ * Falls back to HilogWriteLogMessage while the ring isn't attached or is full.
+ */
+extern "C" int HilogShmWriteLogMessage(HilogMsg *header, const char *tag, uint16_t tagLen, const char *fmt,
+    uint16_t fmtLen);
 extern "C" int GetHilogSocketFd();
 extern "C" void CloseHilogSocketFd();
 #endif /* HILOG_INPUT_SOCKET_CLIENT_H */
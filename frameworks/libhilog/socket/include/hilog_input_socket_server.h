@@ -16,6 +16,11 @@
 #ifndef HILOG_INPUT_SOCKET_SERVER_H
 #define HILOG_INPUT_SOCKET_SERVER_H
 
+#include <atomic>
+#include <condition_variable>
+#include <memory>
+#include <mutex>
+#include <string>
 #include <vector>
 #include <thread>
 
@@ -32,29 +37,87 @@ public:
     using HandlingFunc = std::function<void(std::vector<char>& data, int dataLen)>;
 #else
     using HandlingFunc = std::function<void(const ucred& credential, std::vector<char>& data, int dataLen)>;
+    // Called for a valid HilogShmSetupMsg, the handler owns both fds
+    using ShmSetupFunc = std::function<void(const ucred& credential, int memFd, int eventFd)>;
 #endif
     enum class ServerThreadState {
         JUST_STARTED,
         ALREADY_STARTED,
         CAN_NOT_START
     };
+    struct InputStats {
+        uint64_t packets;
+        uint64_t bytes;
+        uint64_t recvCalls;
+        uint64_t dropped; /* truncated or malformed packets */
+        uint64_t queueFull; /* times the receiving thread had to wait for a worker */
+    };
+    static constexpr size_t MAX_BATCH_SIZE = 64;
+    static constexpr size_t MAX_WORKER_NUM = 8;
 
-    explicit HilogInputSocketServer(HandlingFunc _packetHandler)
-        : DgramSocketServer(INPUT_SOCKET_NAME, MAX_SOCKET_PACKET_LEN),
-        m_packetHandler(_packetHandler), m_stopServer(false)
-        {}
+    /*
+     * batchSize > 1: receive up to batchSize packets per recvmmsg call.
+     * workerNum > 0: hand packets to workerNum threads which call the handler. Packets are
+     * sharded by sender pid, so logs of one process are still handled in arrival order.
+     */
+    explicit HilogInputSocketServer(HandlingFunc _packetHandler, size_t batchSize = 1, size_t workerNum = 0,
+        const std::string& socketName = INPUT_SOCKET_NAME);
 
     ~HilogInputSocketServer();
 
+#ifdef __RECV_MSG_WITH_UCRED_
+    // Must be set before RunServingThread(), without it shared memory setups are refused
+    void SetShmSetupHandler(ShmSetupFunc handler);
+#endif
     ServerThreadState RunServingThread();
+    // The socket is shut down, the server can't run again
     void StopServingThread();
+    InputStats GetStats() const;
 
 private:
+    static constexpr size_t WORKER_QUEUE_LEN = 256;
+    struct Packet {
+        std::vector<char> data;
+        int len = 0;
+        ucred cred = {0};
+    };
+    // Single producer (serving thread), single consumer (worker thread) ring of packets
+    struct Worker {
+        std::vector<Packet> queue;
+        alignas(64) std::atomic<size_t> head = 0;
+        alignas(64) std::atomic<size_t> tail = 0;
+        std::atomic_bool sleeping = false;
+        std::atomic_bool producerWaiting = false; /* the serving thread waits for room in the queue */
+        std::mutex mtx;
+        std::condition_variable cv;
+        std::condition_variable spaceCv;
+        std::thread thread;
+    };
+
     void ServingThread();
+    void BatchServingThread();
+    void WorkerThread(Worker& worker);
+    void HandlePacket(Packet& packet);
+    void HandleFds(const ucred& cred, const std::vector<char>& data, int len, std::vector<int>& fds);
+    void Dispatch(Packet& packet);
+    void StartWorkers();
+    void StopWorkers();
 
     HandlingFunc m_packetHandler = nullptr;
+#ifdef __RECV_MSG_WITH_UCRED_
+    ShmSetupFunc m_shmSetupHandler = nullptr;
+#endif
     std::thread m_serverThread;
     std::atomic_bool m_stopServer;
+    size_t m_batchSize;
+    size_t m_workerNum;
+    std::vector<std::unique_ptr<Worker>> m_workers;
+
+    std::atomic<uint64_t> m_packets = 0;
+    std::atomic<uint64_t> m_bytes = 0;
+    std::atomic<uint64_t> m_recvCalls = 0;
+    std::atomic<uint64_t> m_dropped = 0;
+    std::atomic<uint64_t> m_queueFull = 0;
 };
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef HILOG_SHM_RING_H
+#define HILOG_SHM_RING_H
+
+#include <cstddef>
+#include <cstdint>
+
+#include "hilog_common.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Shared memory ring between one process (any number of writer threads) and hilogd (one reader).
+ * The process creates a sealed memfd and an eventfd and sends both to hilogd with a
+ * HilogShmSetupMsg over the hilogInput socket, the sender credentials of that datagram decide
+ * the pid of every log later read from the ring. Until hilogd marks the ring ATTACHED, and
+ * whenever the ring is full or hilogd stopped beating, the process keeps using the socket.
+ *
+ * Records are HilogMsg packets prefixed by a 32 bits commit word and padded to 8 bytes. A writer
+ * reserves space with a CAS on reserve, copies the packet and then publishes its length in the
+ * commit word. The reader consumes committed records in order, zeroes them and moves tail.
+ */
+constexpr uint32_t HILOG_SHM_MAGIC = 0x484c5348; /* "HSLH" */
+constexpr uint16_t HILOG_SHM_VERSION = 1;
+constexpr uint32_t HILOG_SHM_RING_SIZE = 64 * 1024;
+constexpr uint32_t HILOG_SHM_MIN_RING_SIZE = 16 * 1024;
+constexpr uint32_t HILOG_SHM_MAX_RING_SIZE = 256 * 1024;
+constexpr uint32_t HILOG_SHM_BEAT_TIMEOUT = 3; /* seconds without reader beat before the ring is given up */
+
+enum HilogShmState : uint32_t {
+    SHM_PENDING = 0,
+    SHM_ATTACHED,
+    SHM_DETACHED,
+};
+
+struct HilogShmRingHeader {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t size; /* bytes of the data area, a power of 2 */
+    uint32_t state; /* HilogShmState, set by hilogd */
+    uint32_t readerIdle; /* hilogd is waiting on the eventfd */
+    uint32_t readerBeat; /* CLOCK_MONOTONIC seconds of the last hilogd visit */
+    uint64_t dropped; /* logs which didn't fit, sent by socket instead */
+    alignas(64) uint64_t reserve; /* written by writers */
+    alignas(64) uint64_t tail; /* written by the reader */
+};
+
+constexpr size_t HILOG_SHM_HEADER_SIZE = 256;
+static_assert(sizeof(HilogShmRingHeader) <= HILOG_SHM_HEADER_SIZE, "ring header too large");
+
+struct HilogShmSetupMsg {
+    uint16_t len; /* sizeof(HilogShmSetupMsg), at the place of HilogMsg::len */
+    uint16_t version;
+    uint32_t magic;
+} __attribute__((__packed__));
+
+class HilogShmRing {
+public:
+    HilogShmRing() = default;
+    ~HilogShmRing() = default;
+
+    // mem points to HILOG_SHM_HEADER_SIZE + size bytes, the header is initialized by the writer side
+    void Init(void *mem, uint32_t size);
+    // Reader side: size was checked against the mapping, the header may be modified by the writer any time
+    void Attach(void *mem, uint32_t size);
+
+    HilogShmRingHeader *Header() const { return m_header; }
+    uint32_t Size() const { return m_size; }
+
+    // Writer side, returns false if the ring doesn't have room for the log
+    bool Write(const HilogMsg& header, const char *tag, uint16_t tagLen, const char *fmt, uint16_t fmtLen);
+    // Must be called after Write() succeeds, true means the reader is idle and the eventfd should be signaled
+    bool ShouldWake();
+
+    enum class ReadResult {
+        OK,
+        EMPTY,
+        CORRUPTED,
+    };
+    // Reader side, copies the next log into buffer and sets len
+    ReadResult Read(char *buffer, size_t bufferLen, size_t& len);
+    // Reader side, publishes the consumed space to writers
+    void Commit();
+    // Reader side, marks the reader idle and returns true if it may sleep
+    bool PrepareIdle();
+    void SetState(HilogShmState state);
+    HilogShmState GetState() const;
+    void Beat(uint32_t now);
+    uint32_t GetBeat() const;
+
+private:
+    HilogShmRingHeader *m_header = nullptr;
+    char *m_data = nullptr;
+    uint32_t m_size = 0;
+    uint64_t m_tail = 0; /* reader owned copy, tail in shared memory is never read back */
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif /* HILOG_SHM_RING_H */
@@ -16,6 +16,7 @@
 #ifndef SOCKET_H
 #define SOCKET_H
 
+#include <chrono>
 #include <cstdint>
 #include <sys/socket.h>
 #include <sys/uio.h>
@@ -32,12 +33,15 @@ public:
     void SetCredential(struct ucred& cred);
     uid_t GetUid();
     pid_t GetPid();
+    int GetHandler();
     int GenerateFD();
     int Create();
-    int Poll();
+    int Poll(short inEvent, short& outEvent, const std::chrono::milliseconds& timeout);
     int Write(const char *data, unsigned int len);
     int WriteAll(const char *data, unsigned int len);
     int WriteV(const iovec *vec, unsigned int len);
+    int SendMMsg(struct mmsghdr *msgs, unsigned int len, int flags = 0);
+    int SendMsg(const struct msghdr *msg, int flags = 0);
     int Read(char *buffer, unsigned int len);
     int Recv(void *buffer, unsigned int bufferLen, int flags = MSG_PEEK);
 protected:
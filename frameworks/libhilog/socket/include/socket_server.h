@@ -35,9 +35,12 @@ public:
     int Init();
     int Recv(void *buffer, unsigned int bufferLen, int flags = MSG_PEEK);
     int RecvMsg(struct msghdr *hdr, int flags = 0);
+    int RecvMMsg(struct mmsghdr *hdrs, unsigned int len, int flags = 0);
     int Listen(unsigned int backlog);
     int Poll(short inEvent, short& outEvent, const std::chrono::milliseconds& timeout);
     int Accept();
+    // Wakes up the threads blocked receiving, the socket isn't read again
+    int Shutdown();
 private:
     int socketHandler;
     uint32_t socketType;
@@ -17,6 +17,7 @@
 
 #include <cerrno>
 #include <cstdint>
+#include <poll.h>
 #include <sys/socket.h>
 #include <sys/uio.h>
 #include <unistd.h>
@@ -45,6 +46,11 @@ pid_t Socket::GetPid()
     return socketCred.pid;
 }
 
+int Socket::GetHandler()
+{
+    return socketHandler;
+}
+
 int Socket::GenerateFD()
 {
     int tmpFd = TEMP_FAILURE_RETRY(socket(AF_UNIX, socketType, 0));
@@ -74,9 +80,12 @@ int Socket::Create()
     return socketHandler;
 }
 
-int Socket::Poll()
+int Socket::Poll(short inEvent, short& outEvent, const std::chrono::milliseconds& timeout)
 {
-    return -1;
+    pollfd info {socketHandler, inEvent, outEvent};
+    int result = TEMP_FAILURE_RETRY(poll(&info, 1, timeout.count()));
+    outEvent = info.revents;
+    return result;
 }
 
 int Socket::Write(const char *data, unsigned int len)
@@ -116,6 +125,16 @@ int Socket::WriteV(const iovec *vec, unsigned int len)
     return TEMP_FAILURE_RETRY(writev(socketHandler, vec, len));
 }
 
+int Socket::SendMMsg(struct mmsghdr *msgs, unsigned int len, int flags)
+{
+    return TEMP_FAILURE_RETRY(sendmmsg(socketHandler, msgs, len, flags));
+}
+
+int Socket::SendMsg(const struct msghdr *msg, int flags)
+{
+    return TEMP_FAILURE_RETRY(sendmsg(socketHandler, msg, flags));
+}
+
 int Socket::Read(char *buffer, unsigned int len)
 {
     return TEMP_FAILURE_RETRY(read(socketHandler, buffer, len));
@@ -80,6 +80,11 @@ int SocketServer::RecvMsg(struct msghdr *hdr, int flags)
     return TEMP_FAILURE_RETRY(recvmsg(socketHandler, hdr, flags));
 }
 
+int SocketServer::RecvMMsg(struct mmsghdr *hdrs, unsigned int len, int flags)
+{
+    return TEMP_FAILURE_RETRY(recvmmsg(socketHandler, hdrs, len, flags, nullptr));
+}
+
 int SocketServer::Listen(unsigned int backlog)
 {
     return TEMP_FAILURE_RETRY(listen(socketHandler, backlog));
@@ -99,6 +104,11 @@ int SocketServer::Accept()
     return TEMP_FAILURE_RETRY(accept(socketHandler, (struct sockaddr*)&serverAddr, &addressSize));
 }
 
+int SocketServer::Shutdown()
+{
+    return shutdown(socketHandler, SHUT_RD);
+}
+
 SocketServer::~SocketServer()
 {
     close(socketHandler);
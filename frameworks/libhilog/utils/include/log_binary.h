@@ -0,0 +1,47 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_BINARY_H
+#define LOG_BINARY_H
+
+#include <cstdarg>
+#include <cstddef>
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Content of a HILOG_MSG_VERSION_BINARY log: the process stores the format string and the raw
+ * arguments, the text is only built when a reader takes the log out of hilogd.
+ *
+ *   prefix '\0' | format '\0' | arguments | '\0'
+ *
+ * The prefix is the trace id text put in front of every log. Privacy is resolved by the writer
+ * with the rules of vsnprintfp_s, a private argument is stored as a marker without its value.
+ * Every other argument is a type byte followed by its value, the '*' width and precision of a
+ * conversion are stored as ints before it.
+ */
+
+// buf starts with prefixLen bytes of prefix. Returns the length of the content including the
+// final '\0', or -1 if the log must be formatted as text: a conversion the encoding doesn't
+// support (wide chars, long double, %n...) or arguments which don't fit in bufLen. ap is left
+// untouched so the caller can still format the text with it.
+int EncodeBinaryLog(char *buf, size_t bufLen, size_t prefixLen, int priv, const char *fmt, va_list ap);
+
+// Formats the content into text exactly as vsnprintfp_s would have done it in the process, text
+// is always terminated. Returns the length of the text, malformed content ends it early.
+int DecodeBinaryLog(const char *content, size_t contentLen, char *text, size_t textLen);
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif // LOG_BINARY_H
@@ -0,0 +1,611 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_binary.h"
+
+#include <cstdint>
+#include <cstring>
+#include <securec.h>
+
+#include "vsnprintf_s_p.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+namespace {
+constexpr char PUBLIC_FLAG[] = "{public}";
+constexpr char PRIVATE_FLAG[] = "{private}";
+constexpr char PRIVATE_TEXT[] = "<private>";
+constexpr char SPEC_FLAGS[] = " +-0#";
+constexpr size_t MAX_SPEC_FLAGS = sizeof(SPEC_FLAGS) - 1; /* a longer run repeats a flag */
+constexpr int MAX_SPEC_NUMBER = 9999; /* larger width or precision is left to vsnprintfp_s */
+constexpr size_t MAX_SPEC_LEN = 32;
+constexpr size_t MAX_POINTER_TEXT_LEN = 64;
+
+enum BinaryArgType : uint8_t {
+    ARG_PRIVATE = 1,
+    ARG_INT, /* int, also the value of '*' */
+    ARG_INT64, /* long and long long, extended to 64 bits according to the conversion */
+    ARG_DOUBLE,
+    ARG_STRING, /* uint16_t length and the bytes, without '\0' */
+    ARG_NULL_STRING,
+    ARG_TEXT, /* uint16_t length and text formatted by the writer */
+};
+
+enum class Privacy {
+    DEFAULT,
+    PUBLIC,
+    PRIVATE,
+};
+
+struct FormatSpec {
+    Privacy privacy = Privacy::DEFAULT;
+    const char *flags = nullptr;
+    size_t flagsLen = 0;
+    bool widthStar = false;
+    int width = 0;
+    bool precisionStar = false;
+    int precision = -1;
+    const char *length = "";
+    char conv = '\0';
+};
+
+bool IsIntConv(char conv)
+{
+    return conv != '\0' && strchr("diuoxX", conv) != nullptr;
+}
+
+bool IsFloatConv(char conv)
+{
+    return conv != '\0' && strchr("efgEFG", conv) != nullptr;
+}
+
+bool IsLongLength(const char *length)
+{
+    return length[0] == 'l';
+}
+
+bool ParseSpecNumber(const char *&p, int& value)
+{
+    value = 0;
+    while (*p >= '0' && *p <= '9') {
+        value = value * 10 + (*p - '0'); // 10: decimal
+        if (value > MAX_SPEC_NUMBER) {
+            return false;
+        }
+        p++;
+    }
+    return true;
+}
+
+// p points after '%' and is moved after the conversion. Only the subset of vsnprintfp_s which can be
+// reproduced from the stored arguments is accepted, anything else makes the log formatted as text.
+bool ParseSpec(const char *&p, FormatSpec& spec)
+{
+    if (*p == '{') {
+        if (strncmp(p, PUBLIC_FLAG, sizeof(PUBLIC_FLAG) - 1) == 0) {
+            spec.privacy = Privacy::PUBLIC;
+            p += sizeof(PUBLIC_FLAG) - 1;
+        } else if (strncmp(p, PRIVATE_FLAG, sizeof(PRIVATE_FLAG) - 1) == 0) {
+            spec.privacy = Privacy::PRIVATE;
+            p += sizeof(PRIVATE_FLAG) - 1;
+        } else {
+            return false;
+        }
+    }
+    spec.flags = p;
+    while (*p != '\0' && strchr(SPEC_FLAGS, *p) != nullptr) {
+        p++;
+    }
+    spec.flagsLen = static_cast<size_t>(p - spec.flags);
+    if (spec.flagsLen > MAX_SPEC_FLAGS) {
+        return false;
+    }
+    if (*p == '*') {
+        spec.widthStar = true;
+        p++;
+    } else if (!ParseSpecNumber(p, spec.width)) {
+        return false;
+    }
+    if (*p == '.') {
+        p++;
+        if (*p == '*') {
+            spec.precisionStar = true;
+            p++;
+        } else if (!ParseSpecNumber(p, spec.precision)) {
+            return false;
+        }
+    }
+    if (p[0] == 'h' || p[0] == 'l') {
+        bool twice = (p[1] == p[0]);
+        spec.length = (p[0] == 'h') ? (twice ? "hh" : "h") : (twice ? "ll" : "l");
+        p += twice ? 2 : 1; // 2: "hh" or "ll"
+    }
+    spec.conv = *p;
+    if (spec.conv == '\0') {
+        return false;
+    }
+    p++;
+    if (IsIntConv(spec.conv)) {
+        return true;
+    }
+    if (IsFloatConv(spec.conv)) {
+        return spec.length[0] == '\0' || strcmp(spec.length, "l") == 0;
+    }
+    return spec.length[0] == '\0' && strchr("csp", spec.conv) != nullptr;
+}
+
+// Builds the single conversion given to vsnprintfp_s, with the '*' values resolved.
+// width must lie within +-MAX_SPEC_NUMBER, false is returned if the conversion doesn't fit.
+bool BuildSpec(const FormatSpec& spec, int width, int precision, const char *length, char (&out)[MAX_SPEC_LEN])
+{
+    size_t pos = 0;
+    out[pos++] = '%';
+    for (size_t i = 0; i < spec.flagsLen; i++) {
+        if (pos >= MAX_SPEC_LEN - 1) {
+            return false;
+        }
+        out[pos++] = spec.flags[i];
+    }
+    if (width < 0) {
+        if (pos >= MAX_SPEC_LEN - 1) {
+            return false;
+        }
+        out[pos++] = '-';
+        width = -width;
+    }
+    int ret = 0;
+    if (width > 0) {
+        ret = snprintf_s(out + pos, MAX_SPEC_LEN - pos, MAX_SPEC_LEN - pos - 1, "%d", width);
+        if (ret <= 0) {
+            return false;
+        }
+        pos += static_cast<size_t>(ret);
+    }
+    if (precision >= 0) {
+        ret = snprintf_s(out + pos, MAX_SPEC_LEN - pos, MAX_SPEC_LEN - pos - 1, ".%d", precision);
+        if (ret <= 0) {
+            return false;
+        }
+        pos += static_cast<size_t>(ret);
+    }
+    for (; *length != '\0'; length++) {
+        if (pos >= MAX_SPEC_LEN - 1) {
+            return false;
+        }
+        out[pos++] = *length;
+    }
+    if (pos >= MAX_SPEC_LEN - 1) {
+        return false;
+    }
+    out[pos++] = spec.conv;
+    out[pos] = '\0';
+    return true;
+}
+
+class BinaryWriter {
+public:
+    BinaryWriter(char *buf, size_t bufLen, size_t pos) : m_buf(buf), m_bufLen(bufLen), m_pos(pos) {}
+
+    // Room left for arguments, the final '\0' is kept aside
+    size_t Room() const { return m_bufLen - m_pos - 1; }
+    size_t Pos() const { return m_pos; }
+
+    bool Put(const void *data, size_t len)
+    {
+        if (len > Room() || memcpy_s(m_buf + m_pos, m_bufLen - m_pos, data, len) != EOK) {
+            return false;
+        }
+        m_pos += len;
+        return true;
+    }
+
+    template<typename T>
+    bool PutArg(BinaryArgType type, T value)
+    {
+        return PutType(type) && Put(&value, sizeof(value));
+    }
+
+    bool PutBytes(BinaryArgType type, const char *data, size_t len)
+    {
+        uint16_t len16 = static_cast<uint16_t>(len);
+        return len <= UINT16_MAX && PutType(type) && Put(&len16, sizeof(len16)) && Put(data, len);
+    }
+
+    bool PutType(BinaryArgType type)
+    {
+        uint8_t typeByte = type;
+        return Put(&typeByte, sizeof(typeByte));
+    }
+
+    bool Finish()
+    {
+        if (m_pos >= m_bufLen) {
+            return false;
+        }
+        m_buf[m_pos++] = '\0';
+        return true;
+    }
+
+private:
+    char *m_buf;
+    size_t m_bufLen;
+    size_t m_pos;
+};
+
+struct ArgValue {
+    BinaryArgType type = ARG_INT;
+    int intValue = 0;
+    int64_t int64Value = 0;
+    double doubleValue = 0;
+    const char *str = nullptr;
+    void *ptr = nullptr;
+};
+
+// Consumes the argument the same way vsnprintfp_s does, whether it is private or not
+ArgValue ReadArg(const FormatSpec& spec, va_list& ap)
+{
+    ArgValue arg;
+    bool isSigned = (spec.conv == 'd' || spec.conv == 'i');
+    if (IsIntConv(spec.conv) && IsLongLength(spec.length)) {
+        arg.type = ARG_INT64;
+        if (strcmp(spec.length, "ll") == 0) {
+            arg.int64Value = isSigned ? static_cast<int64_t>(va_arg(ap, long long)) :
+                static_cast<int64_t>(va_arg(ap, unsigned long long));
+        } else {
+            arg.int64Value = isSigned ? static_cast<int64_t>(va_arg(ap, long)) :
+                static_cast<int64_t>(va_arg(ap, unsigned long));
+        }
+    } else if (IsIntConv(spec.conv) || spec.conv == 'c') {
+        arg.type = ARG_INT;
+        arg.intValue = va_arg(ap, int);
+    } else if (IsFloatConv(spec.conv)) {
+        arg.type = ARG_DOUBLE;
+        arg.doubleValue = va_arg(ap, double);
+    } else if (spec.conv == 's') {
+        arg.str = va_arg(ap, const char *);
+        arg.type = (arg.str == nullptr) ? ARG_NULL_STRING : ARG_STRING;
+    } else {
+        arg.type = ARG_TEXT;
+        arg.ptr = va_arg(ap, void *);
+    }
+    return arg;
+}
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+#elif __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+bool WriteArg(BinaryWriter& writer, const FormatSpec& spec, int width, int precision, const ArgValue& arg)
+{
+    switch (arg.type) {
+        case ARG_INT:
+            return writer.PutArg(ARG_INT, arg.intValue);
+        case ARG_INT64:
+            return writer.PutArg(ARG_INT64, arg.int64Value);
+        case ARG_DOUBLE:
+            return writer.PutArg(ARG_DOUBLE, arg.doubleValue);
+        case ARG_NULL_STRING:
+            return writer.PutType(ARG_NULL_STRING);
+        case ARG_STRING: {
+            // Only the bytes the precision lets through are stored, they must all fit
+            size_t room = writer.Room();
+            size_t limit = (precision >= 0 && static_cast<size_t>(precision) <= room) ?
+                static_cast<size_t>(precision) : room + 1;
+            size_t len = strnlen(arg.str, limit);
+            return len <= room && writer.PutBytes(ARG_STRING, arg.str, len);
+        }
+        case ARG_TEXT: {
+            // How a pointer is printed depends on the pointer size of the process, format it here
+            char specText[MAX_SPEC_LEN];
+            if (!BuildSpec(spec, width, precision, spec.length, specText)) {
+                return false;
+            }
+            char text[MAX_POINTER_TEXT_LEN];
+            int len = snprintfp_s(text, sizeof(text), sizeof(text) - 1, 0, specText, arg.ptr);
+            return len >= 0 && writer.PutBytes(ARG_TEXT, text, static_cast<size_t>(len));
+        }
+        default:
+            return false;
+    }
+}
+#ifdef __clang__
+#pragma clang diagnostic pop
+#elif __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+bool EncodeArgs(BinaryWriter& writer, int priv, const char *fmt, va_list& ap)
+{
+    for (const char *p = fmt; *p != '\0';) {
+        if (*p != '%') {
+            p++;
+            continue;
+        }
+        if (p[1] == '%') {
+            p += 2; // 2: "%%"
+            continue;
+        }
+        p++;
+        FormatSpec spec;
+        if (!ParseSpec(p, spec)) {
+            return false;
+        }
+        int width = spec.widthStar ? va_arg(ap, int) : spec.width;
+        int precision = spec.precisionStar ? va_arg(ap, int) : spec.precision;
+        ArgValue arg = ReadArg(spec, ap);
+        if (priv != 0 && spec.privacy != Privacy::PUBLIC) {
+            if (!writer.PutType(ARG_PRIVATE)) {
+                return false;
+            }
+            continue;
+        }
+        if (width < -MAX_SPEC_NUMBER || width > MAX_SPEC_NUMBER || precision > MAX_SPEC_NUMBER) {
+            return false;
+        }
+        if ((spec.widthStar && !writer.PutArg(ARG_INT, width)) ||
+            (spec.precisionStar && !writer.PutArg(ARG_INT, precision))) {
+            return false;
+        }
+        if (!WriteArg(writer, spec, width, (precision < 0) ? -1 : precision, arg)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+class BinaryReader {
+public:
+    BinaryReader(const char *data, size_t len) : m_data(data), m_left(len) {}
+
+    bool Get(void *value, size_t len)
+    {
+        if (len > m_left || memcpy_s(value, len, m_data, len) != EOK) {
+            return false;
+        }
+        m_data += len;
+        m_left -= len;
+        return true;
+    }
+
+    bool GetBytes(const char *&data, size_t& len)
+    {
+        uint16_t len16 = 0;
+        if (!Get(&len16, sizeof(len16)) || len16 > m_left) {
+            return false;
+        }
+        data = m_data;
+        len = len16;
+        m_data += len16;
+        m_left -= len16;
+        return true;
+    }
+
+private:
+    const char *m_data;
+    size_t m_left;
+};
+
+class TextWriter {
+public:
+    TextWriter(char *text, size_t textLen) : m_text(text), m_textLen(textLen)
+    {
+        m_text[0] = '\0';
+    }
+
+    bool Full() const { return m_pos + 1 >= m_textLen; }
+    size_t Len() const { return m_pos; }
+
+    void Append(const char *data, size_t len)
+    {
+        size_t room = m_textLen - 1 - m_pos;
+        len = (len > room) ? room : len;
+        if (len > 0 && memcpy_s(m_text + m_pos, m_textLen - m_pos, data, len) == EOK) {
+            m_pos += len;
+        }
+        m_text[m_pos] = '\0';
+    }
+
+#ifdef __clang__
+#pragma clang diagnostic push
+#pragma clang diagnostic ignored "-Wformat-nonliteral"
+#elif __GNUC__
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wformat-nonliteral"
+#endif
+    template<typename T>
+    void Format(const char *spec, T value)
+    {
+        if (Full()) {
+            return;
+        }
+        size_t room = m_textLen - m_pos;
+        int ret = snprintfp_s(m_text + m_pos, room, room - 1, 0, spec, value);
+        // -1 means truncated, what was written is kept like vsnprintfp_s does for a whole log
+        m_pos += (ret >= 0) ? static_cast<size_t>(ret) : strnlen(m_text + m_pos, room - 1);
+        m_text[m_pos] = '\0';
+    }
+#ifdef __clang__
+#pragma clang diagnostic pop
+#elif __GNUC__
+#pragma GCC diagnostic pop
+#endif
+
+private:
+    char *m_text;
+    size_t m_textLen;
+    size_t m_pos = 0;
+};
+
+bool DecodeArg(BinaryReader& reader, const FormatSpec& spec, TextWriter& text)
+{
+    uint8_t type = 0;
+    if (!reader.Get(&type, sizeof(type))) {
+        return false;
+    }
+    if (type == ARG_PRIVATE) {
+        text.Append(PRIVATE_TEXT, sizeof(PRIVATE_TEXT) - 1);
+        return true;
+    }
+    int width = spec.width;
+    int precision = spec.precision;
+    if (spec.widthStar) {
+        if (type != ARG_INT || !reader.Get(&width, sizeof(width)) || !reader.Get(&type, sizeof(type))) {
+            return false;
+        }
+    }
+    if (spec.precisionStar) {
+        if (type != ARG_INT || !reader.Get(&precision, sizeof(precision)) || !reader.Get(&type, sizeof(type))) {
+            return false;
+        }
+        precision = (precision < 0) ? -1 : precision;
+    }
+    // The record may be damaged, only values the writer could have stored are turned into a conversion
+    if (width < -MAX_SPEC_NUMBER || width > MAX_SPEC_NUMBER || precision > MAX_SPEC_NUMBER) {
+        return false;
+    }
+    // The stored type must be what the conversion reads, vsnprintfp_s trusts its arguments
+    char specText[MAX_SPEC_LEN];
+    const char *data = nullptr;
+    size_t len = 0;
+    switch (type) {
+        case ARG_INT: {
+            int value = 0;
+            if (!((IsIntConv(spec.conv) && !IsLongLength(spec.length)) || spec.conv == 'c') ||
+                !reader.Get(&value, sizeof(value))) {
+                return false;
+            }
+            if (!BuildSpec(spec, width, precision, spec.length, specText)) {
+                return false;
+            }
+            text.Format(specText, value);
+            return true;
+        }
+        case ARG_INT64: {
+            int64_t value = 0;
+            if (!IsIntConv(spec.conv) || !IsLongLength(spec.length) || !reader.Get(&value, sizeof(value))) {
+                return false;
+            }
+            if (!BuildSpec(spec, width, precision, "ll", specText)) {
+                return false;
+            }
+            text.Format(specText, static_cast<long long>(value));
+            return true;
+        }
+        case ARG_DOUBLE: {
+            double value = 0;
+            if (!IsFloatConv(spec.conv) || !reader.Get(&value, sizeof(value))) {
+                return false;
+            }
+            if (!BuildSpec(spec, width, precision, spec.length, specText)) {
+                return false;
+            }
+            text.Format(specText, value);
+            return true;
+        }
+        case ARG_STRING:
+            if (spec.conv != 's' || !reader.GetBytes(data, len)) {
+                return false;
+            }
+            // The bytes aren't terminated, the precision stops vsnprintfp_s at their end
+            if (!BuildSpec(spec, width, static_cast<int>(len), spec.length, specText)) {
+                return false;
+            }
+            text.Format(specText, data);
+            return true;
+        case ARG_NULL_STRING:
+            if (spec.conv != 's') {
+                return false;
+            }
+            if (!BuildSpec(spec, width, precision, spec.length, specText)) {
+                return false;
+            }
+            text.Format(specText, static_cast<const char *>(nullptr));
+            return true;
+        case ARG_TEXT:
+            if (spec.conv != 'p' || !reader.GetBytes(data, len)) {
+                return false;
+            }
+            text.Append(data, len);
+            return true;
+        default:
+            return false;
+    }
+}
+} // namespace
+
+int EncodeBinaryLog(char *buf, size_t bufLen, size_t prefixLen, int priv, const char *fmt, va_list ap)
+{
+    if (buf == nullptr || fmt == nullptr || prefixLen >= bufLen) {
+        return -1;
+    }
+    buf[prefixLen] = '\0';
+    BinaryWriter writer(buf, bufLen, prefixLen + 1);
+    size_t fmtLen = strnlen(fmt, writer.Room());
+    if (fmtLen == writer.Room() || !writer.Put(fmt, fmtLen + 1)) {
+        return -1;
+    }
+    // The caller formats the text with ap if the encoding fails
+    va_list args;
+    va_copy(args, ap);
+    bool encoded = EncodeArgs(writer, priv, fmt, args);
+    va_end(args);
+    if (!encoded || !writer.Finish()) {
+        return -1;
+    }
+    return static_cast<int>(writer.Pos());
+}
+
+int DecodeBinaryLog(const char *content, size_t contentLen, char *text, size_t textLen)
+{
+    if (text == nullptr || textLen == 0) {
+        return 0;
+    }
+    TextWriter writer(text, textLen);
+    size_t prefixLen = strnlen(content, contentLen);
+    if (prefixLen == contentLen) {
+        return 0;
+    }
+    writer.Append(content, prefixLen);
+    const char *fmt = content + prefixLen + 1;
+    size_t fmtLen = strnlen(fmt, contentLen - prefixLen - 1);
+    if (prefixLen + 1 + fmtLen == contentLen) {
+        return static_cast<int>(writer.Len());
+    }
+    BinaryReader reader(fmt + fmtLen + 1, contentLen - prefixLen - fmtLen - 2); // 2: '\0' of prefix and fmt
+    for (const char *p = fmt; *p != '\0' && !writer.Full();) {
+        const char *percent = strchr(p, '%');
+        if (percent == nullptr) {
+            writer.Append(p, strlen(p));
+            break;
+        }
+        writer.Append(p, static_cast<size_t>(percent - p));
+        if (percent[1] == '%') {
+            writer.Append(percent, 1);
+            p = percent + 2; // 2: "%%"
+            continue;
+        }
+        p = percent + 1;
+        FormatSpec spec;
+        if (!ParseSpec(p, spec) || !DecodeArg(reader, spec, writer)) {
+            break;
+        }
+    }
+    return static_cast<int>(writer.Len());
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -141,6 +141,8 @@ static const KVMap<int16_t, string> g_ErrorMsgs({
      "further more, you can set persist.sys.hilog.stats.tag true to enable counting log by tags"},
     {ERR_NO_RUNNING_TASK, "No running persistent task"},
     {ERR_NO_PID_PERMISSION, "Permission denied, only shell and root can filter logs by pid"},
+    {ERR_PERSIST_FILE_FORMAT_INVALID, "Not a file of a binary persist task, or compressed with zstd"},
+    {ERR_LOG_PERSIST_STREAM_INVALID, "Binary persist tasks only support none+bin and zlib+bin"},
 }, RET_FAIL, "Unknown error code");
 
 string ErrorCode2Str(int16_t errorCode)
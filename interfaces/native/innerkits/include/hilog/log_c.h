@@ -107,6 +107,65 @@ const char* GetLastFatalMessage(void);
 int HiLogPrint(LogType type, LogLevel level, unsigned int domain, const char *tag, const char *fmt, ...)
     __attribute__((__format__(os_log, 5, 6)));
 
+/**
+ * @brief Loggability cached by every HILOG_* call site with a constant tag, so a disabled log costs a few loads
+ * and compares and its arguments are not evaluated. The cached min level is valid while its generation matches
+ * g_hiLogLevelGeneration, which changes whenever the app log level is set or a changed parameter is seen.
+ * Fields are owned by libhilog.
+ */
+typedef struct {
+    unsigned int state; /* generation << HILOG_CALLSITE_LEVEL_BITS | min loggable level */
+    unsigned int domain; /* domain + 1 of the only key the site caches, other keys always call HiLogPrint */
+    const char *tag;
+} HiLogCallsite;
+
+#define HILOG_CALLSITE_LEVEL_BITS 8
+#define HILOG_CALLSITE_LEVEL_MASK ((1U << HILOG_CALLSITE_LEVEL_BITS) - 1)
+
+/**
+ * @brief Generation of the log levels, read by the call sites without a call. Parameters set by another
+ * process are noticed by the next log the process prints or checks, or by HiLogLevelGeneration().
+ */
+extern unsigned int g_hiLogLevelGeneration;
+
+/**
+ * @brief Compare the commit id of the parameters and return the generation of the log levels.
+ */
+unsigned int HiLogLevelGeneration(void);
+
+/**
+ * @brief Refresh the cache of a call site, returns its new state.
+ */
+unsigned int HiLogCallsiteUpdate(HiLogCallsite *callsite, unsigned int domain, const char *tag);
+
+#if defined(__GNUC__) || defined(__clang__)
+static inline bool HiLogCallsiteSkip(HiLogCallsite *callsite, unsigned int domain, const char *tag, LogLevel level)
+{
+    unsigned int state = __atomic_load_n(&callsite->state, __ATOMIC_ACQUIRE);
+    unsigned int generation = __atomic_load_n(&g_hiLogLevelGeneration, __ATOMIC_ACQUIRE);
+    if ((state & ~HILOG_CALLSITE_LEVEL_MASK) != (generation << HILOG_CALLSITE_LEVEL_BITS)) {
+        state = HiLogCallsiteUpdate(callsite, domain, tag);
+    } else if (__atomic_load_n(&callsite->tag, __ATOMIC_RELAXED) != tag ||
+        __atomic_load_n(&callsite->domain, __ATOMIC_RELAXED) != domain + 1) {
+        return false;
+    }
+    return (unsigned int)level < (state & HILOG_CALLSITE_LEVEL_MASK);
+}
+
+/* The site is keyed by the tag pointer, so only a constant tag is cached */
+#define HILOG_CALLSITE_PRINT(type, level, domain, tag, ...) __extension__({ \
+        static HiLogCallsite hiLogCallsite = { 0 }; \
+        __typeof__(domain) hiLogSiteDomain = (domain); \
+        const char *hiLogSiteTag = (tag); \
+        __typeof__(level) hiLogSiteLevel = (level); \
+        (__builtin_constant_p(tag) && \
+            HiLogCallsiteSkip(&hiLogCallsite, hiLogSiteDomain, hiLogSiteTag, hiLogSiteLevel)) ? -1 : \
+            HiLogPrint((type), hiLogSiteLevel, hiLogSiteDomain, hiLogSiteTag, ##__VA_ARGS__); \
+    })
+#else
+#define HILOG_CALLSITE_PRINT(type, level, domain, tag, ...) HiLogPrint(type, level, domain, tag, ##__VA_ARGS__)
+#endif
+
 /**
  * @brief Hilog C interface of different log level
  *
@@ -130,7 +189,7 @@ int HiLogPrint(LogType type, LogLevel level, unsigned int domain, const char *ta
  * @param domain macro:LOG_DOMAIN
  * @param tag macro:LOG_TAG
  */
-#define HILOG_IMPL(type, level, domain, tag, ...) HiLogPrint(type, level, domain, tag, ##__VA_ARGS__)
+#define HILOG_IMPL(type, level, domain, tag, ...) HILOG_CALLSITE_PRINT(type, level, domain, tag, ##__VA_ARGS__)
 
 /**
  * @brief Hilog C interface of different log level in release version
@@ -149,7 +208,7 @@ int HiLogPrint(LogType type, LogLevel level, unsigned int domain, const char *ta
  * @param domain macro:LOG_DOMAIN
  * @param tag macro:LOG_TAG
  */
-#define HILOG_COMM_IMPL(level, domain, tag, ...) HiLogPrint(LOG_CORE, level, domain, tag, ##__VA_ARGS__)
+#define HILOG_COMM_IMPL(level, domain, tag, ...) HILOG_CALLSITE_PRINT(LOG_CORE, level, domain, tag, ##__VA_ARGS__)
 
 /**
  * @brief Check whether log of a specified domain, tag and level can be printed.
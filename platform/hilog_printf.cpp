@@ -67,6 +67,19 @@ void HiLogSetAppLogLevel(LogLevel level, PreferStrategy prefer)
     g_preferStrategy = prefer;
 }
 
+unsigned int g_hiLogLevelGeneration = 1;
+
+unsigned int HiLogLevelGeneration()
+{
+    return 1;
+}
+
+// Call sites are not cached on the previewer, every log asks HiLogIsLoggable
+unsigned int HiLogCallsiteUpdate(HiLogCallsite *callsite, unsigned int domain, const char *tag)
+{
+    return 0;
+}
+
 bool HiLogIsLoggable(unsigned int domain, const char *tag, LogLevel level)
 {
     if (g_preferStrategy != UNSET_LOGLEVEL) {
@@ -13,13 +13,19 @@
  * limitations under the License.
  */
 #include <algorithm>
+#include <array>
+#include <cerrno>
 #include <cstring>
 #include <iostream>
 #include <memory>
 #include <mutex>
 #include <thread>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
 #include <sys/prctl.h>
+#include <sys/socket.h>
 #include <sys/stat.h>
+#include <sys/time.h>
 #include <unistd.h>
 
 #include <log_utils.h>
@@ -31,18 +37,48 @@
 namespace OHOS {
 namespace HiviewDFX {
 static const int MAX_CLIENT_CONNECTIONS = 100;
+static const int MAX_EPOLL_EVENTS = 32;
+static const uint64_t WAKE_ID = 0; /* epoll data of m_wakeFd, sessions count from 1 */
+static const time_t CLIENT_IO_TIMEOUT = 3; /* 3s, bounds blocking request reads and control responses */
+static const std::chrono::milliseconds OUTPUT_END_WAIT(1000);
 
 CmdExecutor::~CmdExecutor()
 {
-    std::lock_guard<std::mutex> lg(m_clientAccess);
-    for (auto& client : m_clients) {
-        client->m_stopThread.store(true);
+    Stop();
+}
+
+void CmdExecutor::Stop()
+{
+    m_stop.store(true);
+    Wake();
+    m_queueCv.notify_all();
+    if (m_eventThread.joinable()) {
+        m_eventThread.join();
     }
-    for (auto& client : m_clients) {
-        if (client->m_clientThread.joinable()) {
-            client->m_clientThread.join();
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
         }
     }
+    m_workers.clear();
+    std::map<uint64_t, SessionPtr> sessions;
+    {
+        std::lock_guard<std::mutex> lg(m_sessionMtx);
+        sessions.swap(m_sessions);
+        m_queue.clear();
+    }
+    // Controllers remove their buffer readers, so no callback reaches the sessions afterwards
+    for (auto& [id, session] : sessions) {
+        session->controller.reset();
+    }
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+        m_epollFd = -1;
+    }
 }
 
 void CmdExecutor::MainLoop(const std::string& socketName)
@@ -52,6 +88,23 @@ void CmdExecutor::MainLoop(const std::string& socketName)
         std::cerr << "Failed to init control socket ! \n";
         return;
     }
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_wakeFd < 0) {
+        std::cerr << "Failed to create executor events: " << strerror(errno) << "\n";
+        return;
+    }
+    struct epoll_event wakeEvent = { 0 };
+    wakeEvent.events = EPOLLIN;
+    wakeEvent.data.u64 = WAKE_ID;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &wakeEvent) < 0) {
+        std::cerr << "Failed to watch executor wake event: " << strerror(errno) << "\n";
+        return;
+    }
+    m_eventThread = std::thread([this]() { EventLoop(); });
+    for (size_t i = 0; i < std::max<size_t>(m_workerNum, 1); i++) {
+        m_workers.emplace_back([this]() { WorkerLoop(); });
+    }
     std::cout << "Server started to listen !\n";
     using namespace std::chrono_literals;
     cmdServer.StartAcceptingConnection(
@@ -59,70 +112,206 @@ void CmdExecutor::MainLoop(const std::string& socketName)
             OnAcceptedConnection(std::move(handler));
         },
         3000ms,
-        [this] () {
-            CleanFinishedClients();
-        });
+        [] () {});
 }
 
 void CmdExecutor::OnAcceptedConnection(std::unique_ptr<Socket> handler)
 {
-    std::lock_guard<std::mutex> lg(m_clientAccess);
-    auto newVal = std::make_unique<ClientThread>();
-    if (newVal != nullptr) {
-        newVal->m_stopThread.store(false);
-        newVal->m_clientThread = std::thread([this](std::unique_ptr<Socket> handler) {
-            ClientEventLoop(std::move(handler));
-        }, std::move(handler));
-        m_clients.push_back(std::move(newVal));
+    int fd = handler->GetHandler();
+    struct timeval timeout = {CLIENT_IO_TIMEOUT, 0};
+    (void)setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    (void)setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+
+    auto session = std::make_shared<ClientSession>();
+    session->fd = fd;
+    std::weak_ptr<ClientSession> weakSession = session;
+    session->controller = std::make_unique<ServiceController>(std::move(handler), m_logCollector, m_hilogBuffer,
+        m_kmsgBuffer, [this, weakSession]() {
+            if (auto readySession = weakSession.lock(); readySession != nullptr) {
+                Schedule(readySession, 0);
+            }
+        });
+    {
+        std::lock_guard<std::mutex> lg(m_sessionMtx);
+        session->id = ++m_nextSessionId;
+        m_sessions.emplace(session->id, session);
+    }
+    // Each event disarms the socket until the session ran, so only one worker sees a client at a time
+    struct epoll_event event = { 0 };
+    event.events = EPOLLIN | EPOLLRDHUP | EPOLLONESHOT;
+    event.data.u64 = session->id;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0) {
+        std::cerr << "Failed to watch client: " << strerror(errno) << "\n";
+        CloseSession(*session);
     }
 }
 
-void CmdExecutor::ClientEventLoop(std::unique_ptr<Socket> handler)
+void CmdExecutor::EventLoop()
 {
-    decltype(m_clients)::iterator clientInfoIt;
-    {
-        std::lock_guard<std::mutex> lg(m_clientAccess);
-        clientInfoIt = std::find_if(m_clients.begin(), m_clients.end(),
-            [](const std::unique_ptr<ClientThread>& ct) {
-                return ct->m_clientThread.get_id() == std::this_thread::get_id();
-            });
-    }
-    if (clientInfoIt == m_clients.end()) {
-        std::cerr << "Failed to find client\n";
-        return;
+    prctl(PR_SET_NAME, m_name.c_str());
+    std::array<struct epoll_event, MAX_EPOLL_EVENTS> events;
+    int timeout = -1;
+    while (!m_stop.load()) {
+        int num = epoll_wait(m_epollFd, events.data(), MAX_EPOLL_EVENTS, timeout);
+        if (num < 0 && errno != EINTR) {
+            std::cerr << "Executor epoll failed: " << strerror(errno) << "\n";
+            break;
+        }
+        for (int i = 0; i < num; i++) {
+            if (events[i].data.u64 == WAKE_ID) {
+                eventfd_t value = 0;
+                (void)eventfd_read(m_wakeFd, &value);
+                continue;
+            }
+            std::lock_guard<std::mutex> lg(m_sessionMtx);
+            auto it = m_sessions.find(events[i].data.u64);
+            if (it != m_sessions.end()) {
+                ScheduleLocked(it->second, events[i].events);
+            }
+        }
+        timeout = ScheduleExpired();
     }
+}
 
-    prctl(PR_SET_NAME, m_name.c_str());
-    ServiceController serviceCtrl(std::move(handler), m_logCollector, m_hilogBuffer, m_kmsgBuffer);
-    serviceCtrl.CommunicationLoop((*clientInfoIt)->m_stopThread, m_cmdList);
+// Schedules the sessions whose wait ended, returns the epoll timeout until the next one ends
+int CmdExecutor::ScheduleExpired()
+{
+    auto now = std::chrono::steady_clock::now();
+    std::chrono::steady_clock::duration next = std::chrono::steady_clock::duration::max();
+    std::lock_guard<std::mutex> lg(m_sessionMtx);
+    for (auto& [id, session] : m_sessions) {
+        if (!session->hasDeadline) {
+            continue;
+        }
+        if (session->deadline <= now) {
+            session->hasDeadline = false;
+            ScheduleLocked(session, 0);
+        } else {
+            next = std::min(next, session->deadline - now);
+        }
+    }
+    if (next == std::chrono::steady_clock::duration::max()) {
+        return -1;
+    }
+    return static_cast<int>(std::chrono::ceil<std::chrono::milliseconds>(next).count());
+}
+
+void CmdExecutor::Wake()
+{
+    if (m_wakeFd >= 0) {
+        (void)eventfd_write(m_wakeFd, 1);
+    }
+}
 
-    std::lock_guard<std::mutex> ul(m_finishedClientAccess);
-    m_finishedClients.push_back(std::this_thread::get_id());
+void CmdExecutor::Schedule(const SessionPtr& session, uint32_t events)
+{
+    std::lock_guard<std::mutex> lg(m_sessionMtx);
+    ScheduleLocked(session, events);
 }
 
-void CmdExecutor::CleanFinishedClients()
+void CmdExecutor::ScheduleLocked(const SessionPtr& session, uint32_t events)
 {
-    std::list<std::thread> threadsToJoin;
-    {
-        // select clients to clean up - pick threads that we have to be sure are ended
-        std::scoped_lock sl(m_finishedClientAccess, m_clientAccess);
-        for (auto threadId : m_finishedClients) {
-            auto clientInfoIt = std::find_if(m_clients.begin(), m_clients.end(),
-                [&threadId](const std::unique_ptr<ClientThread>& ct) {
-                    return ct->m_clientThread.get_id() == threadId;
-                });
-            if (clientInfoIt != m_clients.end()) {
-                threadsToJoin.push_back(std::move((*clientInfoIt)->m_clientThread));
-                m_clients.erase(clientInfoIt);
+    if (session->closed) {
+        return;
+    }
+    session->events |= events;
+    if (session->scheduled) {
+        session->rerun = true;
+        return;
+    }
+    session->scheduled = true;
+    m_queue.push_back(session);
+    m_queueCv.notify_one();
+}
+
+void CmdExecutor::WorkerLoop()
+{
+    prctl(PR_SET_NAME, m_name.c_str());
+    for (;;) {
+        SessionPtr session;
+        uint32_t events = 0;
+        {
+            std::unique_lock<std::mutex> lock(m_sessionMtx);
+            m_queueCv.wait(lock, [this]() { return m_stop.load() || !m_queue.empty(); });
+            if (m_stop.load()) {
+                return;
             }
+            session = std::move(m_queue.front());
+            m_queue.pop_front();
+            events = session->events;
+            session->events = 0;
+        }
+        RunSession(*session, events);
+        std::lock_guard<std::mutex> lg(m_sessionMtx);
+        if (session->rerun && !session->closed) {
+            session->rerun = false;
+            m_queue.push_back(session);
+            m_queueCv.notify_one();
+        } else {
+            session->scheduled = false;
+            session->rerun = false;
         }
-        m_finishedClients.clear();
     }
-    for (auto& thread : threadsToJoin) {
-        if (thread.joinable()) {
-            thread.join();
+}
+
+void CmdExecutor::RunSession(ClientSession& session, uint32_t events)
+{
+    using State = ServiceController::State;
+    ServiceController& controller = *session.controller;
+    State state = State::DONE;
+    if (!session.started) {
+        session.started = true;
+        state = controller.HandleRequest(m_cmdList);
+    } else if (session.state == State::WAIT_DATA) {
+        // An output client sends nothing but the end ack, anything else is it going away
+        state = (events != 0) ? State::DONE : controller.ContinueOutput();
+    } else if (session.state == State::WAIT_WRITABLE) {
+        state = (events & (EPOLLERR | EPOLLHUP)) ? State::DONE : controller.ContinueOutput();
+    } else if (session.state == State::WAIT_CLOSE) {
+        bool expired = false;
+        {
+            std::lock_guard<std::mutex> lg(m_sessionMtx);
+            expired = !session.hasDeadline;
         }
+        state = State::WAIT_CLOSE;
+        if (events != 0 || expired) {
+            controller.FinishOutput();
+            state = State::DONE;
+        }
+    }
+    State last = session.state;
+    session.state = state;
+    if (state == State::DONE) {
+        CloseSession(session);
+        return;
+    }
+    if (state == State::WAIT_CLOSE && last != State::WAIT_CLOSE) {
+        {
+            std::lock_guard<std::mutex> lg(m_sessionMtx);
+            session.hasDeadline = true;
+            session.deadline = std::chrono::steady_clock::now() + OUTPUT_END_WAIT;
+        }
+        Wake();
+    }
+    struct epoll_event event = { 0 };
+    event.events = EPOLLRDHUP | EPOLLONESHOT | ((state == State::WAIT_WRITABLE) ? EPOLLOUT : EPOLLIN);
+    event.data.u64 = session.id;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, session.fd, &event) < 0) {
+        std::cerr << "Failed to watch client: " << strerror(errno) << "\n";
+        CloseSession(session);
+    }
+}
+
+void CmdExecutor::CloseSession(ClientSession& session)
+{
+    {
+        std::lock_guard<std::mutex> lg(m_sessionMtx);
+        session.closed = true;
+        m_sessions.erase(session.id);
     }
+    (void)epoll_ctl(m_epollFd, EPOLL_CTL_DEL, session.fd, nullptr);
+    // Removes the buffer readers and closes the socket
+    session.controller.reset();
 }
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -20,6 +20,7 @@
 #include <string>
 #include <ctime>
 #include <atomic>
+#include <mutex>
 #include <unordered_map>
 #include <unistd.h>
 #include <hilog/log.h>
@@ -39,6 +40,7 @@ using DomainInfo = struct {
     LogTimeStamp startTime;
 };
 static std::unordered_map<uint32_t, DomainInfo> g_domainMap;
+static std::mutex g_domainMapMtx; /* input workers may run flow control concurrently */
 
 int FlowCtrlDomain(const HilogMsg& hilogMsg)
 {
@@ -50,6 +52,7 @@ int FlowCtrlDomain(const HilogMsg& hilogMsg)
     uint32_t domainId = hilogMsg.domain;
     auto logLen = hilogMsg.len - sizeof(HilogMsg) - 1 - 1; /* quota length exclude '\0' of tag and log content */
     LogTimeStamp tsNow(hilogMsg.mono_sec, hilogMsg.tv_nsec);
+    std::lock_guard<std::mutex> lock(g_domainMapMtx);
     auto it = g_domainMap.find(domainId);
     if (it != g_domainMap.end()) {
         LogTimeStamp start = it->second.startTime;
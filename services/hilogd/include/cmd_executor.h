@@ -16,10 +16,16 @@
 #ifndef CMD_EXECUTOR_H
 #define CMD_EXECUTOR_H
 
-#include <list>
-#include <memory>
 #include <atomic>
+#include <condition_variable>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <map>
+#include <memory>
+#include <mutex>
 #include <thread>
+#include <vector>
 
 #include <socket.h>
 #include "log_buffer.h"
@@ -28,32 +34,66 @@
 
 namespace OHOS {
 namespace HiviewDFX {
-struct ClientThread {
-    std::thread m_clientThread;
-    std::atomic<bool> m_stopThread;
-};
-
+/*
+ * Serves the clients of one socket with a fixed set of threads. An epoll thread watches the
+ * connections, a worker of the pool runs a client once its request is readable, its socket is
+ * writable again, the output it follows got new logs or its end wait timed out. A client waiting
+ * for any of these holds no thread, so the number of clients doesn't change the number of threads.
+ */
 class CmdExecutor {
 public:
+    static constexpr size_t DEFAULT_WORKER_NUM = 2;
+
     explicit CmdExecutor(LogCollector& collector, HilogBuffer& hilogBuffer, HilogBuffer& kmsgBuffer,
-        const CmdList& list, const std::string& name) : m_logCollector(collector), m_hilogBuffer(hilogBuffer),
-        m_kmsgBuffer(kmsgBuffer), m_cmdList(list), m_name(name) {}
+        const CmdList& list, const std::string& name, size_t workerNum = DEFAULT_WORKER_NUM)
+        : m_logCollector(collector), m_hilogBuffer(hilogBuffer), m_kmsgBuffer(kmsgBuffer), m_cmdList(list),
+        m_name(name), m_workerNum(workerNum) {}
     ~CmdExecutor();
     void MainLoop(const std::string& sockName);
 private:
+    struct ClientSession {
+        uint64_t id = 0;
+        int fd = -1;
+        std::unique_ptr<ServiceController> controller;
+        bool started = false; /* request read */
+        ServiceController::State state = ServiceController::State::DONE;
+        /* guarded by m_sessionMtx */
+        bool scheduled = false; /* queued or running, a session is run by one worker at a time */
+        bool rerun = false; /* scheduled again while running */
+        bool closed = false;
+        uint32_t events = 0; /* epoll events since the last run */
+        bool hasDeadline = false;
+        std::chrono::steady_clock::time_point deadline;
+    };
+    using SessionPtr = std::shared_ptr<ClientSession>;
+
     void OnAcceptedConnection(std::unique_ptr<Socket> handler);
-    void ClientEventLoop(std::unique_ptr<Socket> handler);
-    void CleanFinishedClients();
+    void EventLoop();
+    void WorkerLoop();
+    void RunSession(ClientSession& session, uint32_t events);
+    void CloseSession(ClientSession& session);
+    void Schedule(const SessionPtr& session, uint32_t events);
+    void ScheduleLocked(const SessionPtr& session, uint32_t events);
+    int ScheduleExpired();
+    void Wake();
+    void Stop();
 
     LogCollector& m_logCollector;
     HilogBuffer& m_hilogBuffer;
     HilogBuffer& m_kmsgBuffer;
     CmdList m_cmdList;
     std::string m_name;
-    std::list<std::unique_ptr<ClientThread>> m_clients;
-    std::mutex m_clientAccess;
-    std::vector<std::thread::id> m_finishedClients;
-    std::mutex m_finishedClientAccess;
+    size_t m_workerNum;
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    std::atomic<bool> m_stop = false;
+    std::thread m_eventThread;
+    std::vector<std::thread> m_workers;
+    std::mutex m_sessionMtx;
+    std::condition_variable m_queueCv;
+    std::map<uint64_t, SessionPtr> m_sessions;
+    std::deque<SessionPtr> m_queue;
+    uint64_t m_nextSessionId = 0;
 };
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -16,16 +16,52 @@
 #ifndef KMSG_PARSER_H
 #define KMSG_PARSER_H
 
-#include "log_collector.h"
-#include "log_msg_wrapper.h"
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include <hilog_common.h>
 
 namespace OHOS {
 namespace HiviewDFX {
+/*
+ * Turns kernel records into HilogMsg. Lines are tokenized in place, the only copy is the text
+ * going into the HilogMsg, which is built in a buffer reused by the next record. Understands the
+ * /dev/kmsg format "prio,seq,ts_usec,flags;text" followed by " KEY=value" dictionary lines, and
+ * the /proc/kmsg format "<prio>[ sec.usec] text". The kernel monotonic timestamp becomes the
+ * realtime of the log, the syslog priority its level.
+ *
+ * /dev/kmsg sequence numbers are followed: records up to the last seen one are dropped, so a
+ * reader resumed with SetLastSeq doesn't ingest the kernel ring twice, and records overwritten
+ * before they were read come out as one "N kernel lines lost" log.
+ */
 class KmsgParser {
 public:
-    using BootTp = std::chrono::time_point<std::chrono::system_clock, std::chrono::nanoseconds>;
-    static std::optional<HilogMsgWrapper> ParseKmsg(const std::vector<char>& kmsgBuffer);
-    static BootTp BootTime();
+    static constexpr uint64_t NO_SEQ = UINT64_MAX;
+
+    KmsgParser();
+
+    // Builds the first record of data and removes its lines from data. nullptr for a blank line
+    // or a record seen before, a line in neither format is kept as text. Ahead of a sequence gap
+    // the lost lines log is returned and data is left as it is. The result is valid until the
+    // next call.
+    const HilogMsg* ParseNext(std::string_view& data);
+
+    void SetLastSeq(uint64_t seq) { m_lastSeq = seq; }
+    uint64_t GetLastSeq() const { return m_lastSeq; }
+
+private:
+    const HilogMsg* ParseDevKmsg(std::string_view line, bool& keepLine);
+    const HilogMsg* ParseProcKmsg(std::string_view line);
+    const HilogMsg* BuildMsg(uint16_t level, uint64_t monoUsec, std::string_view text);
+    const HilogMsg* BuildLostMsg(uint64_t lost, uint64_t monoUsec);
+
+    std::vector<char> m_buffer;
+    uint16_t m_lastLevel;
+    uint64_t m_lastUsec = 0;
+    uint64_t m_lastSeq = NO_SEQ;
+    int64_t m_offsetNsec = 0; /* realtime - monotonic */
+    uint64_t m_offsetUsec = 0; /* kernel time it was taken at */
 };
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_BATCH_H
+#define LOG_BATCH_H
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+#include <hilog_common.h>
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Caller owned arena filled by HilogBuffer::Query, or by the kmsg reader before
+ * HilogBuffer::InsertBatch. Records are stored back to back as HilogMsg (header + tag +
+ * content), so a whole batch is copied out of or into the log buffer under one lock without
+ * any per log allocation. References returned by At() are valid until the
+ * batch is cleared or filled again.
+ */
+class LogBatch {
+public:
+    static constexpr size_t DEFAULT_BATCH_SIZE = 64 * 1024;
+    static constexpr size_t DEFAULT_BATCH_COUNT = 256;
+
+    explicit LogBatch(size_t size = DEFAULT_BATCH_SIZE, size_t maxCount = DEFAULT_BATCH_COUNT);
+    ~LogBatch() = default;
+
+    LogBatch(const LogBatch&) = delete;
+    LogBatch& operator=(const LogBatch&) = delete;
+
+    bool Append(const HilogMsg& msg);
+    void Clear();
+    bool CanHold(const HilogMsg& msg) const;
+    bool Full() const { return m_offsets.size() >= m_maxCount; }
+    size_t Count() const { return m_offsets.size(); }
+    bool Empty() const { return m_offsets.empty(); }
+    const HilogMsg& At(size_t index) const;
+
+private:
+    bool AppendBinary(const HilogMsg& msg);
+
+    std::unique_ptr<char[]> m_data;
+    size_t m_size = 0;
+    size_t m_used = 0;
+    size_t m_maxCount;
+    std::vector<uint32_t> m_offsets;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif // LOG_BATCH_H
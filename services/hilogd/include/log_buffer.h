@@ -16,34 +16,54 @@
 #ifndef LOG_BUFFER_H
 #define LOG_BUFFER_H
 
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
 #include <cstdint>
 #include <functional>
-#include <list>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <shared_mutex>
 
 #include <hilog_common.h>
 
-#include "log_data.h"
+#include "log_batch.h"
 #include "log_filter.h"
+#include "log_ring_buffer.h"
 #include "log_stats.h"
 
 namespace OHOS {
 namespace HiviewDFX {
 class HilogBuffer {
 public:
-    using LogMsgContainer = std::list<HilogData>;
     using ReaderId = uintptr_t;
 
     HilogBuffer(bool isSupportSkipLog);
     ~HilogBuffer();
 
     size_t Insert(const HilogMsg& msg, bool& isFull);
-    std::optional<HilogData> Query(const LogFilter& filter, const ReaderId& id, int tailCount = 0);
+    // Inserts the logs of batch from first on under one lock. Returns the index of the first log
+    // which is full like in Insert, batch.Count() if none was.
+    size_t InsertBatch(const LogBatch& batch, size_t first);
+    // Without skip log, a full buffer gets room when its readers move. Take the progress before
+    // inserting, then wait for it to change.
+    uint64_t GetReadProgress();
+    void WaitReadProgress(uint64_t progress, std::chrono::milliseconds timeout);
+    // Logs from endSeq on are left for later queries
+    size_t Query(const CompiledLogFilter& filter, const ReaderId& id, LogBatch& batch, int tailCount = 0,
+        uint64_t endSeq = UINT64_MAX);
+    // Sequence number of the next log a reader of all types gets, 0 before its first query. Another
+    // reader gets exactly the logs this one passed by querying up to it.
+    uint64_t GetReaderSeq(const ReaderId& id);
 
     ReaderId CreateBufReader(std::function<void()> onNewDataCallback);
     void RemoveBufReader(const ReaderId& id);
+    // The callback of a reader only runs while it is parked: once, when minCount logs of the types it
+    // reads came in since. A reader parks after a query came back short and queries again before
+    // waiting, or bounds its wait, to catch logs inserted just before. Waking after N logs or T
+    // milliseconds, whichever comes first, is ParkReader(id, N) and a wait of at most T.
+    void ParkReader(const ReaderId& id, size_t minCount = 1);
 
     int32_t Delete(uint16_t logType);
 
@@ -57,29 +77,43 @@ public:
     LogStats& GetStatsInfo();
 
 private:
+    using Offset = LogRingBuffer::Offset;
     struct BufferReader {
-        LogMsgContainer::iterator m_pos;
-        LogMsgContainer* m_msgList = nullptr;
+        Offset m_pos[LOG_TYPE_MAX] = {0};
+        uint16_t m_ringMask = 0; /* rings walked by the reader, valid after its first query */
+        bool m_started = false;
         uint32_t skipped;
         std::function<void()> m_onNewDataCallback;
+        std::atomic<bool> m_parked = false;
+        std::atomic<size_t> m_newCount = 0; /* logs inserted since parked */
+        std::atomic<size_t> m_wakeCount = 1;
     };
     enum class DeleteReason {
         BUFF_OVERFLOW,
         CMD_CLEAR
     };
-    bool IsItemUsed(LogMsgContainer::iterator itemPos);
-    void OnDeleteItem(LogMsgContainer::iterator itemPos, DeleteReason reason);
-    void OnPushBackedItem(LogMsgContainer& msgList);
-    void OnNewItem(LogMsgContainer& msgList);
+    size_t InsertLocked(const HilogMsg& msg, bool& isFull);
+    bool IsItemUsed(int ringType, Offset pos);
+    void OnDeleteItem(int ringType, Offset pos, DeleteReason reason);
+    void OnPushBackedItem(int ringType, Offset oldEnd, Offset pos);
+    void OnNewItem(int ringType, size_t count = 1);
+    void OnReadProgress();
+    void PositionReader(BufferReader& reader, const CompiledLogFilter& filter, int tailCount);
+    int NextRing(const Offset (&pos)[LOG_TYPE_MAX], uint16_t ringMask) const;
+    size_t RebuildRing(int ringType, size_t capacity, const std::function<bool(const HilogMsg&)>& keep,
+        DeleteReason reason);
     std::shared_ptr<BufferReader> GetReader(const ReaderId& id);
 
-    size_t sizeByType[LOG_TYPE_MAX];
-    LogMsgContainer hilogDataList;
+    LogRingBuffer m_rings[LOG_TYPE_MAX];
+    uint64_t m_seq = 0;
     std::shared_mutex hilogBufferMutex;
     std::map<ReaderId, std::shared_ptr<BufferReader>> m_logReaders;
     std::shared_mutex m_logReaderMtx;
     LogStats stats;
     bool m_isSupportSkipLog;
+    std::mutex m_progressMtx;
+    std::condition_variable m_progressCv;
+    uint64_t m_readProgress = 0;
 };
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -15,6 +15,7 @@
 
 #ifndef LOG_COLLECTOR_H
 #define LOG_COLLECTOR_H
+#include <functional>
 #include <list>
 
 #include <properties.h>
@@ -40,9 +41,13 @@ public:
 #endif
     void SetLogFlowControl(bool on);
     void SetDebuggable(bool on);
+    // Set once before requests are served, the counters of the input socket hilog -s shows
+    void SetInputStatsSource(std::function<HilogInputSocketServer::InputStats()> source);
+    bool GetInputStats(HilogInputSocketServer::InputStats& stats) const;
     ~LogCollector() = default;
 private:
     HilogBuffer& m_hilogBuffer;
+    std::function<HilogInputSocketServer::InputStats()> m_inputStatsSource;
     bool countEnable;
     bool flowControl;
     bool debug;
@@ -17,6 +17,7 @@
 #define HILOG_COMPRESS_H
 
 #include <iostream>
+#include <vector>
 #ifdef USING_ZSTD_COMPRESS
 #define ZSTD_STATIC_LINKING_ONLY
 #include "include/common.h"
@@ -34,6 +35,21 @@ using LogPersisterBuffer = struct {
     uint32_t offset;
 };
 
+// Output of a compressor, it grows to the bound of what is compressed into it
+struct LogCompressBuffer {
+    std::vector<char> content;
+    uint32_t offset = 0;
+
+    // Returns where len bytes can be written from offset on
+    char *Reserve(size_t len)
+    {
+        if (content.size() < offset + len) {
+            content.resize(offset + len);
+        }
+        return content.data() + offset;
+    }
+};
+
 using CompressAlg = enum {
     COMPRESS_TYPE_NONE = 0,
     COMPRESS_TYPE_ZSTD,
@@ -44,7 +60,19 @@ class LogCompress {
 public:
     LogCompress() = default;
     virtual ~LogCompress() = default;
-    virtual int Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressBuffer) = 0;
+    // Appends inBuffer to the current output stream and flushes it, so everything written so far
+    // can be decompressed even if the stream is never finished
+    virtual int Compress(const LogPersisterBuffer &inBuffer, LogCompressBuffer &compressBuffer) = 0;
+    // Ends the current stream, the next Compress() starts a new one
+    virtual int Finish(LogCompressBuffer &compressBuffer)
+    {
+        return 0;
+    }
+    // Appends the file index where decompressors skip it, see hilog_persist.h
+    virtual int AppendIndex(const char *index, uint32_t len, LogCompressBuffer &compressBuffer)
+    {
+        return 0;
+    }
     // Compress Types&Strings Map
     static std::string CompressType2Str(uint16_t compressType);
     static uint16_t Str2CompressType(const std::string& str);
@@ -54,29 +82,35 @@ private:
 
 class NoneCompress : public LogCompress {
 public:
-    int Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressBuffer) override;
+    int Compress(const LogPersisterBuffer &inBuffer, LogCompressBuffer &compressBuffer) override;
 };
 
 class ZlibCompress : public LogCompress {
 public:
-    int Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressBuffer) override;
+    ~ZlibCompress() override;
+    int Compress(const LogPersisterBuffer &inBuffer, LogCompressBuffer &compressBuffer) override;
+    int Finish(LogCompressBuffer &compressBuffer) override;
+    int AppendIndex(const char *index, uint32_t len, LogCompressBuffer &compressBuffer) override;
 private:
-    static const uint16_t CHUNK = 16384;
-    char buffIn[CHUNK] = {0};
-    char buffOut[CHUNK] = {0};
+    int Deflate(const char *in, uint32_t inLen, LogCompressBuffer &compressBuffer, int flush);
 
-    z_stream cStream;
+    z_stream cStream = {};
+    bool m_inited = false;
+    bool m_pending = false;
 };
 
 class ZstdCompress : public LogCompress {
 public:
-    int Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressBuffer) override;
+    ~ZstdCompress() override;
+    int Compress(const LogPersisterBuffer &inBuffer, LogCompressBuffer &compressBuffer) override;
+    int Finish(LogCompressBuffer &compressBuffer) override;
+    int AppendIndex(const char *index, uint32_t len, LogCompressBuffer &compressBuffer) override;
 private:
 #ifdef USING_ZSTD_COMPRESS
-    static const uint16_t CHUNK = 16384;
-    char buffIn[CHUNK] = {0};
-    char buffOut[CHUNK] = {0};
-    ZSTD_CCtx* cctx;
+    int CompressStream(const char *in, uint32_t inLen, LogCompressBuffer &compressBuffer, ZSTD_EndDirective mode);
+
+    ZSTD_CCtx* cctx = nullptr;
+    bool m_pending = false;
 #endif
 };
 } // namespace HiviewDFX
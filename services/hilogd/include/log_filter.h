@@ -17,7 +17,10 @@
 #define LOG_FILTER_H
 
 #include <cstdint>
+#include <optional>
+#include <regex>
 #include <string>
+#include <string_view>
 #include <vector>
 
 #include <hilog_cmd.h>
@@ -61,6 +64,43 @@ struct LogFilter {
         std::cout << "  regex: " << regex << std::endl;
     }
 } __attribute__((__packed__));
+
+/*
+ * LogFilter prepared once per reader: the wildcard pattern is compiled a single time and
+ * domains, tags and pids are kept in flat arrays of ready to compare terms, so checking a log
+ * is a short linear scan without any parsing or copying.
+ */
+class CompiledLogFilter {
+public:
+    explicit CompiledLogFilter(const LogFilter& filter);
+    ~CompiledLogFilter() = default;
+
+    CompiledLogFilter(const CompiledLogFilter&) = delete;
+    CompiledLogFilter& operator=(const CompiledLogFilter&) = delete;
+
+    bool Match(const HilogMsg& msg) const;
+    const LogFilter& GetFilter() const { return m_filter; }
+
+private:
+    bool MatchDomain(uint32_t domain) const;
+    bool MatchTag(std::string_view tag) const;
+    bool MatchPid(uint32_t pid) const;
+    bool MatchRegex(const HilogMsg& msg) const;
+
+    struct DomainTerm {
+        uint32_t value;
+        uint32_t mask;
+    };
+
+    LogFilter m_filter;
+    /* At most MAX_DOMAINS/MAX_TAGS/MAX_PIDS terms, flat arrays beat hashing here */
+    std::vector<DomainTerm> m_domains;
+    std::vector<std::string_view> m_tags; /* views of m_filter.tags */
+    std::vector<uint32_t> m_pids;
+    std::optional<std::regex> m_regex;
+};
+
+std::string WildcardToRegex(const std::string& wildcard);
 } // namespace HiviewDFX
 } // namespace OHOS
 #endif // LOG_FILTER_H
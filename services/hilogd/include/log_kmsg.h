@@ -16,15 +16,24 @@
 #ifndef LOG_KMSG_H
 #define LOG_KMSG_H
 
+#include <chrono>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "log_batch.h"
 #include "log_buffer.h"
 #include "kmsg_parser.h"
 
 namespace OHOS {
 namespace HiviewDFX {
+// Resume point of the /dev/kmsg reader, kept next to the persist jobs recovery info
+static constexpr const char* KMSG_RESUME_INFO = "kmsg.info";
+
 class LogKmsg {
 public:
     static LogKmsg& GetInstance(HilogBuffer& hilogBuffer);
-    ssize_t LinuxReadOneKmsg(KmsgParser& parser);
+    ssize_t LinuxReadKmsgBatch(KmsgParser& parser);
     int LinuxReadAllKmsg();
     void Start();
     void Stop();
@@ -39,12 +48,22 @@ private:
     };
 
 private:
-    explicit LogKmsg(HilogBuffer& hilogBuffer) : hilogBuffer(hilogBuffer)
+    explicit LogKmsg(HilogBuffer& hilogBuffer) : hilogBuffer(hilogBuffer), readBuffer(BUFSIZ, '\0')
     {
         threadStatus = NONEXIST;
     }
+    void FlushKmsgBatch();
+    void LoadKmsgSeq(KmsgParser& parser);
+    void SaveKmsgSeq(uint64_t seq, bool force);
     int kmsgCtl = -1;
     HilogBuffer& hilogBuffer;
+    std::vector<char> readBuffer;
+    LogBatch batch;
+    std::vector<uint64_t> batchSeqs; /* seq of each record of batch, the lost lines log has the one before the gap */
+    uint64_t insertedSeq = KmsgParser::NO_SEQ; /* of the last record in the log buffer */
+    std::string bootId;
+    uint64_t savedSeq = KmsgParser::NO_SEQ;
+    std::chrono::steady_clock::time_point lastSaveTime;
     std::thread logKmsgThread;
     ThreadStatus threadStatus;
     std::mutex startMtx;
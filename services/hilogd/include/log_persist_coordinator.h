@@ -0,0 +1,85 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_PERSIST_COORDINATOR_H
+#define LOG_PERSIST_COORDINATOR_H
+
+#include <chrono>
+#include <condition_variable>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+#include "log_batch.h"
+#include "log_buffer.h"
+#include "log_filter.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+class LogPersister;
+
+/*
+ * Reads the log buffer once for all persist jobs. Every log is matched against the filter of each
+ * job and formatted at most once, the text is shared by all text jobs it goes to. A job started
+ * while others run first gets the logs the shared reader already passed from a reader of its own.
+ * The shared reader never waits for a job: a job whose compression falls behind drops and counts
+ * the logs it has no room for, the other jobs go on.
+ */
+class LogPersistCoordinator {
+public:
+    // One for each buffer, the kmsg buffer has its own
+    static LogPersistCoordinator& GetInstance(HilogBuffer& buffer);
+
+    void Attach(const std::shared_ptr<LogPersister>& job);
+    // The job isn't handed any log once this returns
+    void Detach(const LogPersister* job);
+    // Hands the logs in the buffer over to the jobs, then writes what the job gathered
+    void Refresh(LogPersister& job);
+
+private:
+    struct PersistJob {
+        std::shared_ptr<LogPersister> persister;
+        std::chrono::steady_clock::time_point lastLogTime;
+        uint64_t droppedLines = 0; /* since the job last had room */
+    };
+
+    explicit LogPersistCoordinator(HilogBuffer& buffer);
+    ~LogPersistCoordinator() = default;
+
+    void NotifyNewLogAvailable();
+    void WaitNewLogs();
+    void ReadLoop();
+    size_t ReadOnce();
+    void DispatchBatch();
+    void FlushIdleJobs();
+
+    HilogBuffer& m_hilogBuffer;
+    CompiledLogFilter m_filter;
+    LogBatch m_batch;
+
+    /* held while logs are handed over, so a detached job is left alone */
+    std::mutex m_jobsMtx;
+    std::list<PersistJob> m_jobs;
+    HilogBuffer::ReaderId m_bufReader = 0;
+    std::thread m_readThread;
+
+    std::mutex m_wakeMtx;
+    std::condition_variable m_wakeCv;
+    bool m_wake = false;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif
@@ -28,11 +28,14 @@
 #include <string>
 #include <thread>
 #include <variant>
+#include <vector>
 
 #include "log_buffer.h"
+#include "log_data.h"
 #include "log_filter.h"
 #include "log_persister_rotator.h"
 #include "log_compress.h"
+#include "hilog_persist.h"
 
 namespace OHOS {
 namespace HiviewDFX {
@@ -46,6 +49,19 @@ using LogPersistQueryResult = struct {
     uint32_t fileNum;
 } __attribute__((__packed__));
 
+static constexpr uint32_t PERSIST_SLOT_NUM = 4;
+static constexpr uint32_t PERSIST_FRAME_SIZE = 1024 * 1024; /* logs compressed into a frame before it ends */
+
+/*
+ * The mapped auxiliary file. Formatted logs fill the slots round-robin, a full slot is kept until
+ * its compressed output is written, so logs still queued for compression survive a restart.
+ */
+using PersistPlainFile = struct {
+    uint32_t head; /* oldest slot not written yet */
+    LogPersisterBuffer slots[PERSIST_SLOT_NUM];
+    PersistIndexEntry frames[PERSIST_SLOT_NUM]; /* line count and time range of each slot */
+};
+
 class LogPersister : public std::enable_shared_from_this<LogPersister> {
 public:
     [[nodiscard]] static std::shared_ptr<LogPersister> CreateLogPersister(HilogBuffer &buffer);
@@ -66,39 +82,68 @@ public:
     void FillInfo(LogPersistQueryResult &response);
 
 private:
+    friend class LogPersistCoordinator;
+
     static bool CheckRegistered(uint32_t id, const std::string& logPath);
     static std::shared_ptr<LogPersister> GetLogPersisterById(uint32_t id);
     static void RegisterLogPersister(const std::shared_ptr<LogPersister>& obj);
     static void DeregisterLogPersister(const std::shared_ptr<LogPersister>& obj);
 
-    void NotifyNewLogAvailable();
-
-    int ReceiveLogLoop();
+    static void FormatLog(const HilogMsg& logData, std::string& formatedLog);
 
     int InitCompression();
     int InitFileRotator(const PersistRecoveryInfo& msg, bool restore);
-    int WriteLogData(const HilogData& logData);
-    bool WriteUncompressedLogs(std::string& logLine);
-    void WriteCompressedLogs();
+    // Without wait a log which needs a slot the pipeline still holds is dropped
+    int WriteLogData(const HilogMsg& logData, const std::string& formatedLog, bool wait = true);
+    void WriteLogBatch(const LogBatch& batch);
+    bool WriteUncompressedLogs(const std::string& logLine);
+    bool WriteRecord(const HilogMsg& logData);
+    void AddToFrameInfo(const HilogMsg& logData);
+    bool HandOffChunk(bool wait = true);
+    bool FlushPlainLogs(bool wait = true);
+    void WaitPipelineIdle();
+    void CompressLoop();
+    void WriteLoop();
+    void CompressChunk(uint32_t slot);
+    void WriteChunk(uint32_t slot);
+    void EndFrame();
+    void FinishOpenFrame();
+    void FinishCompressedFile();
+    void AppendFileIndex();
 
     int PrepareUncompressedFile(const std::string& parentPath, bool restore);
 
     std::string m_plainLogFilePath;
-    LogPersisterBuffer *m_mappedPlainLogFile;
+    PersistPlainFile *m_mappedPlainLogFile;
     uint32_t m_plainLogSize = 0;
+    bool m_binaryRecords = false;
     std::unique_ptr<LogCompress> m_compressor;
-    std::unique_ptr<LogPersisterBuffer> m_compressBuffer;
+    std::vector<LogCompressBuffer> m_compressBuffers;
+    bool m_rotateAfter[PERSIST_SLOT_NUM] = {false};
+    bool m_frameEnds[PERSIST_SLOT_NUM] = {false};
+    uint32_t m_framePlainSize = 0; /* logs compressed into the open frame, owned by the compress stage */
+    /* frames written to the current file, appended to it as its index */
+    std::vector<PersistIndexEntry> m_fileIndex;
+    PersistIndexEntry m_frame = {0}; /* the chunks of the open frame written so far */
+    uint32_t m_fileOffset = 0;
+    LogCompressBuffer m_tailBuffer; /* the end of the last frame and the index of a finished file */
     std::unique_ptr<LogPersisterRotator> m_fileRotator;
 
-    std::mutex m_receiveLogCvMtx;
-    std::condition_variable m_receiveLogCv;
+    /* chunk n lives in slot n % PERSIST_SLOT_NUM, format -> compress -> write stages */
+    std::mutex m_pipelineMtx;
+    std::condition_variable m_pipelineCv;
+    uint64_t m_filled = 0;
+    uint64_t m_compressed = 0;
+    uint64_t m_written = 0;
+    bool m_compressing = false;
+    bool m_writing = false;
 
-    volatile bool m_stopThread = false;
-    std::thread m_persisterThread;
+    /* logs are handed over by LogPersistCoordinator while attached */
+    bool m_attached = false;
 
     HilogBuffer &m_hilogBuffer;
-    HilogBuffer::ReaderId m_bufReader;
     LogPersistStartMsg m_startMsg;
+    std::unique_ptr<CompiledLogFilter> m_filter;
 
     std::mutex m_initMtx;
     volatile bool m_inited = false;
@@ -0,0 +1,53 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_PERSISTER_POOL_H
+#define LOG_PERSISTER_POOL_H
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Threads shared by all persist jobs to compress and write their chunks. A job queues at most one
+ * compress and one write task at a time, so the queue is bounded by the number of jobs.
+ */
+class LogPersisterPool {
+public:
+    static constexpr size_t DEFAULT_WORKER_NUM = 2;
+
+    static LogPersisterPool& GetInstance();
+    ~LogPersisterPool();
+
+    void Schedule(std::function<void()> task);
+
+private:
+    explicit LogPersisterPool(size_t workerNum = DEFAULT_WORKER_NUM);
+    void WorkerLoop();
+
+    std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::deque<std::function<void()>> m_tasks;
+    bool m_stop = false;
+    std::vector<std::thread> m_workers;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif
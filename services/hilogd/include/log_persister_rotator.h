@@ -27,6 +27,8 @@ namespace OHOS {
 namespace HiviewDFX {
 #define FILE_PATH_MAX_LEN 100
 static constexpr const char* AUXILLARY_PERSISTER_PREFIX = "persisterInfo_";
+/* Or'ed into LogPersistStartMsg::compressAlg by jobs which store records, see hilog_persist.h */
+static constexpr uint16_t PERSIST_BINARY_FLAG = 0x8000;
 
 using LogPersistStartMsg = struct {
     uint16_t compressAlg;
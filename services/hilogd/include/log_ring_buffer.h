@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_RING_BUFFER_H
+#define LOG_RING_BUFFER_H
+
+#include <cstdint>
+#include <memory>
+
+#include <hilog_common.h>
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Byte ring which keeps variable-size log records inline. Every record is an 8 bytes
+ * sequence number followed by the HilogMsg (header + tag + content) exactly as it was
+ * received, padded to 8 bytes. A record never wraps around the end of the storage; the
+ * unused tail is marked with a zero sequence number and skipped by Next().
+ * Positions are logical byte offsets which only grow, (offset % capacity) is the
+ * physical position, so a position stays valid until the record is popped.
+ */
+class LogRingBuffer {
+public:
+    using Offset = uint64_t;
+
+    LogRingBuffer() = default;
+    explicit LogRingBuffer(size_t capacity);
+    ~LogRingBuffer() = default;
+
+    LogRingBuffer(const LogRingBuffer&) = delete;
+    LogRingBuffer& operator=(const LogRingBuffer&) = delete;
+    LogRingBuffer(LogRingBuffer&&) = default;
+    LogRingBuffer& operator=(LogRingBuffer&&) = default;
+
+    static size_t RecordSize(const HilogMsg& msg);
+    // The capacity a ring asked for capacity bytes gets
+    static size_t AlignCapacity(size_t capacity) { return capacity - capacity % RECORD_ALIGN; }
+
+    bool IsAllocated() const { return m_data != nullptr; }
+    size_t Capacity() const { return m_capacity; }
+    size_t Size() const { return static_cast<size_t>(m_tail - m_head); }
+    size_t Count() const { return m_count; }
+    bool Empty() const { return m_head == m_tail; }
+    Offset Begin() const { return m_head; }
+    Offset End() const { return m_tail; }
+
+    bool HasRoom(size_t recordSize) const;
+    Offset Append(const HilogMsg& msg, uint64_t seq);
+    void PopFront();
+    void Clear();
+    Offset Next(Offset pos) const;
+    uint64_t SeqAt(Offset pos) const;
+    const HilogMsg& MsgAt(Offset pos) const;
+
+private:
+    static constexpr size_t RECORD_ALIGN = sizeof(uint64_t);
+    static constexpr uint64_t PADDING_SEQ = 0;
+
+    char* Phys(Offset pos) const { return m_data.get() + (pos % m_capacity); }
+    Offset SkipPadding(Offset pos) const;
+
+    std::unique_ptr<char[]> m_data;
+    size_t m_capacity = 0;
+    Offset m_head = 0;
+    Offset m_tail = 0;
+    size_t m_count = 0;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif // LOG_RING_BUFFER_H
@@ -0,0 +1,82 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_SHM_INGEST_H
+#define LOG_SHM_INGEST_H
+
+#include <atomic>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <sys/socket.h>
+#include <thread>
+#include <vector>
+
+#include "hilog_shm_ring.h"
+#include "log_collector.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Drains the shared memory rings of the processes which asked for one (see hilog_shm_ring.h).
+ * One thread serves all rings: it visits every ring, then sleeps on the rings' eventfds once all
+ * of them are empty. Logs go through LogCollector like the ones received from the socket, with
+ * the pid taken from the credentials of the setup datagram.
+ */
+class LogShmIngest {
+public:
+    static constexpr size_t MAX_RINGS = 64;
+
+    explicit LogShmIngest(LogCollector& collector);
+    ~LogShmIngest();
+
+    int Start();
+    void Stop();
+    // Takes ownership of both fds, called by the input socket thread
+    void AddRing(const ucred& cred, int memFd, int eventFd);
+
+private:
+    struct Ring {
+        HilogShmRing ring;
+        ucred cred = {0};
+        void *mem = nullptr;
+        size_t memSize = 0;
+        uint32_t size = 0;
+        int eventFd = -1;
+        bool corrupted = false;
+    };
+
+    void IngestThread();
+    bool Drain(Ring& ring);
+    bool PrepareIdle();
+    void Housekeeping(uint32_t now);
+    void AttachPending(uint32_t now);
+    void ReleaseRing(std::unique_ptr<Ring>& ring);
+
+    LogCollector& m_collector;
+    std::vector<char> m_buffer;
+    int m_epollFd = -1;
+    int m_wakeFd = -1;
+    std::thread m_thread;
+    std::atomic_bool m_stop = false;
+    std::atomic<size_t> m_ringCount = 0;
+
+    std::mutex m_pendingMtx;
+    std::vector<std::unique_ptr<Ring>> m_pending;
+    std::list<std::unique_ptr<Ring>> m_rings; /* owned by the ingest thread */
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif // LOG_SHM_INGEST_H
@@ -16,13 +16,18 @@
 #define LOG_STATS_H
 #include <unordered_map>
 #include <optional>
+#include <memory>
 #include <mutex>
+#include <string_view>
+#include <vector>
 
 #include <log_timestamp.h>
 #include <hilog_cmd.h>
 #include <hilog_common.h>
 #include <hilog/log.h>
 
+#include "proc_name_cache.h"
+
 namespace OHOS {
 namespace HiviewDFX {
 enum class StatsType {
@@ -42,13 +47,14 @@ struct StatsInfo {
     uint32_t tv_sec;
     uint32_t tv_nsec;
     uint32_t mono_sec;
-    std::string tag;
+    std::string_view tag;
 };
 
 struct StatsEntry {
     uint32_t lines[LevelNum];
     uint64_t len[LevelNum];
     uint32_t dropped;
+    uint32_t errLines; // lines it may have had before it was tracked, only in top-K mode
     uint32_t tmpLines;
     float freqMax; // lines per second, average value
     LogTimeStamp realTimeFreqMax;
@@ -144,6 +150,23 @@ struct PidStatsEntry {
 };
 using PidTable = std::unordered_map<uint32_t, PidStatsEntry>;
 
+class StatsShard;
+class StatsTagTable;
+
+/*
+ * Every thread calling Count() gets its own shard which it updates without locks. The tables
+ * above are only built when statistics are queried: Merge() sums the shards into them. Line and
+ * length counts are exact, the max frequency and throughput of an entry are the highest ones seen
+ * by a single shard. Shards also keep the last minute and hour of the total, each domain and each
+ * pid in per-second and per-minute buckets, MergeSeries() sums them. Pid names are resolved in the
+ * background by ProcNameCache and filled in by Merge().
+ *
+ * With a top-K limit (persist.sys.hilog.stats.topk) each shard keeps at most K domains, domain
+ * tags, pids and pid tags. A newcomer replaces the entry with the fewest lines, its counts then
+ * start at the newcomer's first log and errLines bounds what they may have missed. Entries which
+ * got more than 1/K of the lines are always kept. Totals stay exact. Tag names aren't limited,
+ * every distinct one is kept until the next reset.
+ */
 class LogStats {
 public:
     explicit LogStats();
@@ -152,6 +175,10 @@ public:
     void Count(const StatsInfo &info);
     void Reset();
     void Print();
+    // Call with GetLock() held, the tables and totals below stay as merged until the next call
+    void Merge();
+    // Call with GetLock() held, adds rqst.count buckets ending with the monotonic second now
+    void MergeSeries(const StatsSeriesRqst &rqst, uint32_t now, StatsSeriesBucket *buckets);
 
     const LogTypeDomainTable& GetDomainTable() const;
     const PidTable& GetPidTable() const;
@@ -161,6 +188,7 @@ public:
     void GetTotalLens(uint64_t (&in_lens)[LevelNum]) const;
     bool IsEnable() const;
     bool IsTagEnable() const;
+    size_t GetTopK() const;
 
     std::unique_lock<std::mutex> GetLock();
 
@@ -174,10 +202,14 @@ private:
     bool enable;
     bool tagEnable;
     std::mutex lock;
-
-    void UpdateTagTable(TagTable& tt, const StatsInfo &info);
-    void UpdateDomainTable(const StatsInfo &info);
-    void UpdatePidTable(const StatsInfo &info);
+    const uint64_t id;
+    const size_t topK;
+    std::mutex shardsLock;
+    std::vector<std::unique_ptr<StatsShard>> shards;
+    std::shared_ptr<StatsTagTable> tags;
+    ProcNameCache names;
+
+    StatsShard& GetShard();
 };
 } // namespace HiviewDFX
 } // namespace OHOS
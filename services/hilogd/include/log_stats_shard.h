@@ -0,0 +1,437 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_STATS_SHARD_H
+#define LOG_STATS_SHARD_H
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <utility>
+#include <vector>
+
+#include "log_stats.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Open addressing table filled by one thread at a time and read by others without locks. A slot
+ * is set once with a fully built entry, a table which gets 3/4 full is replaced by a copy twice
+ * its size.
+ *
+ * Get() never removes anything, replaced slot arrays are kept until the table is destroyed as
+ * readers may still probe them. Track() keeps at most limit entries with the Space-Saving
+ * algorithm: a new key replaces the entry of the lowest weight and inherits that weight as its
+ * error, a min-heap of the weights finds that entry. Values must provide Weight(), which never
+ * decreases, and Inherit(). Unlinked entries and slot arrays are freed as soon as no ForEach()
+ * runs, so other threads must only read such a table with ForEach().
+ */
+template<typename Key, typename Value>
+class StatsShardTable {
+public:
+    struct Entry {
+        template<typename LookupKey>
+        Entry(const LookupKey& k, size_t h) : key(k), hash(h) {}
+        const Key key;
+        const size_t hash;
+        Value value;
+    };
+
+    explicit StatsShardTable(size_t limit = 0) : m_slots(NewSlots(INIT_CAPACITY)), m_limit(limit) {}
+
+    ~StatsShardTable()
+    {
+        Slots *slots = m_slots.load(std::memory_order_relaxed);
+        for (size_t i = 0; i <= slots->mask; i++) {
+            Entry *entry = slots->slots[i].load(std::memory_order_relaxed);
+            if (entry != Removed()) {
+                delete entry;
+            }
+        }
+        m_retired.push_back(slots);
+        FreeUnlinked();
+    }
+
+    StatsShardTable(const StatsShardTable&) = delete;
+    StatsShardTable& operator=(const StatsShardTable&) = delete;
+
+    template<typename LookupKey>
+    Entry *Find(const LookupKey& key, size_t hash) const
+    {
+        const Slots *slots = m_slots.load(std::memory_order_acquire);
+        for (size_t i = hash & slots->mask;; i = (i + 1) & slots->mask) {
+            Entry *entry = slots->slots[i].load(std::memory_order_acquire);
+            if (entry == nullptr) {
+                return nullptr;
+            }
+            if (entry != Removed() && entry->hash == hash && entry->key == key) {
+                return entry;
+            }
+        }
+    }
+
+    // Only one thread may call it at a time, init sets up the value of a new entry before readers see it
+    template<typename LookupKey, typename Init>
+    Entry& Get(const LookupKey& key, size_t hash, Init init)
+    {
+        Entry *entry = Find(key, hash);
+        if (entry != nullptr) {
+            return *entry;
+        }
+        return Insert(key, hash, init);
+    }
+
+    // Same as Get(), but once limit entries are tracked the lightest one makes room for the key
+    template<typename LookupKey, typename Init>
+    Entry& Track(const LookupKey& key, size_t hash, Init init)
+    {
+        Entry *entry = Find(key, hash);
+        if (entry != nullptr) {
+            return *entry;
+        }
+        uint64_t error = (m_limit != 0 && m_count >= m_limit) ? Evict() : 0;
+        entry = &Insert(key, hash, [&init, error](Value &value) {
+            init(value);
+            if (error != 0) {
+                value.Inherit(error);
+            }
+        });
+        if (m_limit != 0) {
+            m_lightest.emplace_back(entry->value.Weight(), entry);
+            std::push_heap(m_lightest.begin(), m_lightest.end(), Heavier);
+        }
+        if (!m_retired.empty() || !m_removed.empty()) {
+            Reclaim();
+        }
+        return *entry;
+    }
+
+    template<typename Func>
+    void ForEach(Func func) const
+    {
+        // Pairs with the fence of Reclaim(): either the owner sees this reader, or it sees what was unlinked
+        m_readers.fetch_add(1);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        const Slots *slots = m_slots.load(std::memory_order_acquire);
+        for (size_t i = 0; i <= slots->mask; i++) {
+            const Entry *entry = slots->slots[i].load(std::memory_order_acquire);
+            if (entry != nullptr && entry != Removed()) {
+                func(*entry);
+            }
+        }
+        m_readers.fetch_sub(1, std::memory_order_release);
+    }
+
+private:
+    static constexpr size_t INIT_CAPACITY = 16;
+
+    using WeightedEntry = std::pair<uint64_t, Entry*>;
+
+    struct Slots {
+        size_t mask;
+        std::atomic<Entry*> *slots;
+    };
+
+    static Slots *NewSlots(size_t capacity)
+    {
+        return new Slots{capacity - 1, new std::atomic<Entry*>[capacity]()};
+    }
+
+    // Marks the slot of an evicted entry, probing goes on past it
+    static Entry *Removed()
+    {
+        static char removed;
+        return reinterpret_cast<Entry*>(&removed);
+    }
+
+    static void Place(Slots& slots, Entry *entry)
+    {
+        size_t i = entry->hash & slots.mask;
+        while (slots.slots[i].load(std::memory_order_relaxed) != nullptr) {
+            i = (i + 1) & slots.mask;
+        }
+        slots.slots[i].store(entry, std::memory_order_release);
+    }
+
+    template<typename LookupKey, typename Init>
+    Entry& Insert(const LookupKey& key, size_t hash, Init init)
+    {
+        Slots *slots = m_slots.load(std::memory_order_relaxed);
+        size_t capacity = slots->mask + 1;
+        if ((m_count + m_removedSlots + 1) * 4 > capacity * 3) {
+            // Dropping the removed slots makes enough room while live entries fill at most half of it
+            Slots *next = NewSlots((m_count + 1) * 2 > capacity ? capacity * 2 : capacity);
+            for (size_t i = 0; i <= slots->mask; i++) {
+                Entry *moved = slots->slots[i].load(std::memory_order_relaxed);
+                if (moved != nullptr && moved != Removed()) {
+                    Place(*next, moved);
+                }
+            }
+            m_slots.store(next, std::memory_order_release);
+            m_retired.push_back(slots);
+            m_removedSlots = 0;
+            slots = next;
+        }
+        Entry *entry = new Entry(key, hash);
+        init(entry->value);
+        Place(*slots, entry);
+        m_count++;
+        return *entry;
+    }
+
+    static bool Heavier(const WeightedEntry& a, const WeightedEntry& b)
+    {
+        return a.first > b.first;
+    }
+
+    // The heap holds the weights as they were when pushed. As weights only grow, an entry on top
+    // which got heavier since goes back with its current weight, the first one which didn't is the lightest.
+    uint64_t Evict()
+    {
+        while (!m_lightest.empty()) {
+            std::pop_heap(m_lightest.begin(), m_lightest.end(), Heavier);
+            WeightedEntry& top = m_lightest.back();
+            uint64_t weight = top.second->value.Weight();
+            if (weight != top.first) {
+                top.first = weight;
+                std::push_heap(m_lightest.begin(), m_lightest.end(), Heavier);
+                continue;
+            }
+            Entry *lightest = top.second;
+            m_lightest.pop_back();
+            Unlink(*lightest);
+            return weight;
+        }
+        return 0;
+    }
+
+    void Unlink(Entry& entry)
+    {
+        Slots *slots = m_slots.load(std::memory_order_relaxed);
+        for (size_t i = entry.hash & slots->mask;; i = (i + 1) & slots->mask) {
+            if (slots->slots[i].load(std::memory_order_relaxed) == &entry) {
+                slots->slots[i].store(Removed(), std::memory_order_release);
+                break;
+            }
+        }
+        m_removed.push_back(&entry);
+        m_removedSlots++;
+        m_count--;
+    }
+
+    void Reclaim()
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (m_readers.load(std::memory_order_acquire) != 0) {
+            return;
+        }
+        FreeUnlinked();
+    }
+
+    void FreeUnlinked()
+    {
+        for (Entry *entry : m_removed) {
+            delete entry;
+        }
+        m_removed.clear();
+        for (Slots *retired : m_retired) {
+            delete[] retired->slots;
+            delete retired;
+        }
+        m_retired.clear();
+    }
+
+    std::atomic<Slots*> m_slots;
+    std::vector<Slots*> m_retired;
+    std::vector<Entry*> m_removed;
+    std::vector<WeightedEntry> m_lightest; /* min-heap of the tracked entries, kept only with a limit */
+    mutable std::atomic<uint32_t> m_readers {0};
+    const size_t m_limit;
+    size_t m_count = 0;
+    size_t m_removedSlots = 0;
+};
+
+// Tags seen since the last reset, a tag is copied once and then referred to by its entry. Not bounded by
+// the top-K limit, a tag is kept until the next reset even once no tracked entry refers to it.
+class StatsTagTable {
+public:
+    using Tag = StatsShardTable<std::string, uint32_t>::Entry; /* value is the tag id */
+
+    const Tag& Intern(std::string_view tag);
+
+private:
+    StatsShardTable<std::string, uint32_t> m_tags;
+    std::mutex m_insertMtx;
+    uint32_t m_nextId = 0;
+};
+
+// A StatsEntry kept by the owner thread of a shard and the part of it readers need, published with relaxed stores
+class ShardStats {
+public:
+    void Update(const StatsInfo &info);
+    // The next Update() continues this empty entry instead of starting a new one
+    void Clear();
+    void MergeInto(StatsEntry &entry) const;
+    uint64_t Weight() const;
+    void Inherit(uint64_t error);
+
+private:
+    StatsEntry m_entry;
+    bool m_used = false;
+    uint32_t m_error = 0;
+    std::atomic<uint32_t> m_errLines {0};
+    std::atomic<uint32_t> m_lines[LevelNum] {};
+    std::atomic<uint64_t> m_len[LevelNum] {};
+    std::atomic<uint32_t> m_dropped {0};
+    std::atomic<float> m_freqMax {0};
+    std::atomic<uint32_t> m_freqMaxSec {0};
+    std::atomic<uint32_t> m_freqMaxNsec {0};
+    std::atomic<float> m_throughputMax {0};
+    std::atomic<uint32_t> m_tpMaxSec {0};
+    std::atomic<uint32_t> m_tpMaxNsec {0};
+};
+
+/*
+ * Lines, length and drops of the last MAX_SERIES_BUCKETS seconds and minutes of monotonic time,
+ * written by the owner thread of a shard. A log falls in the bucket of its own time, a bucket is
+ * recycled by the first log of a newer second or minute. Its stamp is cleared while it's zeroed,
+ * so a reader which sees the same stamp before and after reading the counters got this bucket's.
+ */
+class StatsSeries {
+public:
+    void Add(const StatsInfo &info);
+    // Adds the count buckets ending with the one of the monotonic time now into buckets
+    void MergeInto(StatsSeriesUnit unit, uint32_t now, uint32_t count, StatsSeriesBucket *buckets) const;
+
+private:
+    struct Bucket {
+        std::atomic<uint32_t> stamp {0}; /* second or minute + 1, 0 while unused */
+        std::atomic<uint32_t> lines {0};
+        std::atomic<uint32_t> len {0};
+        std::atomic<uint32_t> dropped {0};
+    };
+
+    static void AddTo(Bucket (&ring)[MAX_SERIES_BUCKETS], uint32_t stamp, const StatsInfo &info);
+
+    Bucket m_seconds[MAX_SERIES_BUCKETS];
+    Bucket m_minutes[MAX_SERIES_BUCKETS];
+};
+
+struct StatsDomainValue {
+    ShardStats stats;
+    StatsSeries series;
+
+    uint64_t Weight() const
+    {
+        return stats.Weight();
+    }
+
+    void Inherit(uint64_t error)
+    {
+        stats.Inherit(error);
+    }
+};
+
+struct StatsTagKey {
+    uint64_t id; /* domain key or pid */
+    const StatsTagTable::Tag *tag;
+
+    bool operator==(const StatsTagKey& other) const
+    {
+        return id == other.id && tag == other.tag;
+    }
+};
+
+struct StatsPidValue {
+    ShardStats statsAll;
+    ShardStats stats[TypeNum];
+    StatsSeries series;
+
+    uint64_t Weight() const
+    {
+        return statsAll.Weight();
+    }
+
+    void Inherit(uint64_t error)
+    {
+        statsAll.Inherit(error);
+        for (ShardStats &s : stats) {
+            s.Inherit(error);
+        }
+    }
+};
+
+// Everything one shard counted since the last reset
+class StatsShardData {
+public:
+    // topK bounds every table but the tags one, 0 keeps every entry
+    StatsShardData(std::shared_ptr<StatsTagTable> tags, size_t topK, ProcNameCache &names)
+        : m_tags(std::move(tags)), m_names(names), m_domains(topK), m_domainTags(topK), m_pids(topK),
+        m_pidTags(topK) {}
+
+    void Count(const StatsInfo &info, bool tagEnable);
+    void MergeInto(LogTypeDomainTable &domainStats, PidTable &pidStats, uint32_t (&lines)[LevelNum],
+        uint64_t (&lens)[LevelNum]) const;
+    void MergeSeriesInto(const StatsSeriesRqst &rqst, uint32_t now, StatsSeriesBucket *buckets) const;
+    const std::shared_ptr<StatsTagTable>& GetTags() const
+    {
+        return m_tags;
+    }
+
+private:
+    std::shared_ptr<StatsTagTable> m_tags;
+    ProcNameCache &m_names;
+    std::atomic<uint32_t> m_totalLines[LevelNum] {};
+    std::atomic<uint64_t> m_totalLens[LevelNum] {};
+    StatsSeries m_totalSeries;
+    StatsShardTable<uint64_t, StatsDomainValue> m_domains; /* key: type << 32 | domain */
+    StatsShardTable<StatsTagKey, ShardStats> m_domainTags;
+    StatsShardTable<uint64_t, StatsPidValue> m_pids;
+    StatsShardTable<StatsTagKey, ShardStats> m_pidTags;
+};
+
+/*
+ * Statistics counted by one thread. Only the owner thread writes its data, so counting takes no
+ * lock. m_seq is odd while the owner counts, which lets Replace() know when the data it swapped
+ * out is no longer used.
+ */
+class StatsShard {
+public:
+    explicit StatsShard(std::unique_ptr<StatsShardData> data);
+    ~StatsShard();
+
+    void Count(const StatsInfo &info, bool tagEnable);
+    std::unique_ptr<StatsShardData> Replace(std::unique_ptr<StatsShardData> data);
+    const StatsShardData& GetData() const
+    {
+        return *m_data.load(std::memory_order_acquire);
+    }
+    std::thread::id GetOwner() const
+    {
+        return m_owner;
+    }
+
+private:
+    const std::thread::id m_owner;
+    std::atomic<StatsShardData*> m_data;
+    std::atomic<uint32_t> m_seq {0};
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif // LOG_STATS_SHARD_H
@@ -0,0 +1,71 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef PROC_NAME_CACHE_H
+#define PROC_NAME_CACHE_H
+
+#include <condition_variable>
+#include <cstdint>
+#include <list>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+namespace OHOS {
+namespace HiviewDFX {
+/*
+ * Names of the processes counted by LogStats. Counting a new pid only queues it, a worker thread
+ * reads /proc for everything queued since its last wakeup. The start time of the process is kept
+ * with its name: a pid queued again is only resolved again if it now belongs to another process,
+ * and a process which exited keeps its name. At most MAX_NAMES names are kept, the one least
+ * recently resolved or asked for makes room for a new one.
+ */
+class ProcNameCache {
+public:
+    static constexpr size_t MAX_PENDING = 4096;
+    static constexpr size_t MAX_NAMES = 4096;
+
+    ProcNameCache() = default;
+    ~ProcNameCache();
+
+    void Request(uint32_t pid);
+    // Empty until the worker resolved the pid
+    std::string Get(uint32_t pid) const;
+    void Clear();
+
+private:
+    struct Entry {
+        std::string name;
+        uint64_t startTime = 0;
+        std::list<uint32_t>::iterator lruPos;
+    };
+
+    void WorkerThread();
+    // Call with m_mtx locked
+    void Store(uint32_t pid, Entry& resolved);
+
+    mutable std::mutex m_mtx;
+    std::condition_variable m_cv;
+    std::vector<uint32_t> m_pending;
+    std::unordered_map<uint32_t, Entry> m_names;
+    mutable std::list<uint32_t> m_lru; /* pids of m_names, most recently used first */
+    std::thread m_worker;
+    bool m_stop = false;
+};
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif // PROC_NAME_CACHE_H
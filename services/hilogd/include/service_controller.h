@@ -19,8 +19,7 @@
 #include <array>
 #include <vector>
 #include <atomic>
-#include <condition_variable>
-#include <future>
+#include <functional>
 #include <memory>
 #include <mutex>
 #include <socket.h>
@@ -42,17 +41,50 @@ public:
     static constexpr int MAX_DATA_LEN = 2048;
     using PacketBuf = std::array<char, MAX_DATA_LEN>;
 
+    // What the client is left waiting for after a step. Nothing blocks on the client between steps, the caller
+    // resumes the output once the event it waits for happened.
+    enum class State {
+        DONE, /* request served, the connection can be closed */
+        WAIT_DATA, /* output reached the end of the buffer, onReady is called when new logs come */
+        WAIT_WRITABLE, /* socket can't take the next frame */
+        WAIT_CLOSE /* end of output sent, the client acks or closes, see FinishOutput */
+    };
+
     ServiceController(std::unique_ptr<Socket> communicationSocket, LogCollector& collector, HilogBuffer& hilogBuffer,
-        HilogBuffer& kmsgBuffer);
+        HilogBuffer& kmsgBuffer, std::function<void()> onReady);
     ~ServiceController();
 
-    void CommunicationLoop(std::atomic<bool>& stopLoop, const CmdList& list);
+    // Reads and serves one request, call it once the socket is readable
+    State HandleRequest(const CmdList& list);
+    // Sends the logs which are ready, call it on onReady or once the socket is writable again
+    State ContinueOutput();
+    // Reads the end ack if it came, call it when the client sent something after the end, or after a timeout
+    void FinishOutput();
 
 private:
+    struct OutputContext {
+        explicit OutputContext(const LogFilter& filter) : filter(filter) {}
+        CompiledLogFilter filter;
+        HilogBuffer* buffer = nullptr;
+        HilogBuffer::ReaderId readId = 0;
+        int tailCount = 0;
+        size_t lines = 0; /* 0 for no limit */
+        size_t linesCountDown = 0;
+        bool noBlock = false;
+        bool batchMode = false;
+        bool end = false; /* no more query, the end record follows the logs in the batch */
+        bool endPacked = false;
+        LogBatch batch;
+        size_t count = 0; /* logs of the batch to send */
+        size_t next = 0; /* next of them to pack */
+        std::vector<char> frame;
+        size_t used = 0; /* bytes of frame not written yet */
+    };
+
     int GetMsgHeader(MsgHeader& hdr);
     int GetRqst(const MsgHeader& hdr, char* rqst, int expectedLen);
     void WriteErrorRsp(int code);
-    void WriteRspHeader(IoctlCmd cmd, size_t len);
+    void WriteRspHeader(IoctlCmd cmd, size_t len, uint8_t ver = MSG_VER);
     template<typename T>
     void RequestHandler(const MsgHeader& hdr, std::function<void(const T& rqst)> handle);
 
@@ -62,18 +94,12 @@ private:
     int CheckPersistStartRqst(const PersistStartRqst &rqst);
     void PersistStartRqst2Msg(const PersistStartRqst &rqst, LogPersistStartMsg &msg);
     // log query
-    int WriteQueryResponse(OptCRef<HilogData> pData);
+    bool QueryOutput(OutputContext& out);
+    void PackOutputFrame(OutputContext& out);
     // statistics
-    void SendOverallStats(const LogStats& stats);
-    void SendLogTypeDomainStats(const LogStats& stats);
-    void SendDomainStats(const LogStats& stats);
-    void SendDomainTagStats(const LogStats& stats);
-    void SendProcStats(const LogStats& stats);
-    void SendProcLogTypeStats(const LogStats& stats);
-    void SendProcTagStats(const LogStats& stats);
-    void SendTagStats(const TagTable &tagTable);
+    void WriteStatsSnapshot(const std::vector<char>& snapshot, const std::vector<size_t>& msgLens, uint8_t ver);
     // cmd handlers
-    void HandleOutputRqst(const OutputRqst &rqst);
+    State HandleOutputRqst(const OutputRqst &rqst, uint8_t ver);
     void HandlePersistStartRqst(const PersistStartRqst &rqst);
     void HandlePersistStopRqst(const PersistStopRqst &rqst);
     void HandlePersistQueryRqst(const PersistQueryRqst& rqst);
@@ -81,7 +107,8 @@ private:
     void HandlePersistClearRqst();
     void HandleBufferSizeGetRqst(const BufferSizeGetRqst& rqst);
     void HandleBufferSizeSetRqst(const BufferSizeSetRqst& rqst);
-    void HandleStatsQueryRqst(const StatsQueryRqst& rqst);
+    void HandleStatsQueryRqst(const StatsQueryRqst& rqst, uint8_t ver);
+    void HandleStatsSeriesRqst(const StatsSeriesRqst& rqst);
     void HandleStatsClearRqst(const StatsClearRqst& rqst);
     void HandleDomainFlowCtrlRqst(const DomainFlowCtrlRqst& rqst);
     void HandleLogRemoveRqst(const LogRemoveRqst& rqst);
@@ -96,8 +123,8 @@ private:
     HilogBuffer& m_kmsgBuffer;
     HilogBuffer::ReaderId m_hilogBufferReader;
     HilogBuffer::ReaderId m_kmsgBufferReader;
-    std::condition_variable m_notifyNewDataCv;
-    std::mutex m_notifyNewDataMtx;
+    std::function<void()> m_onReady;
+    std::unique_ptr<OutputContext> m_output;
 };
 
 template<typename T>
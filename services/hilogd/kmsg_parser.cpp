@@ -16,24 +16,20 @@
 #include "kmsg_parser.h"
 #include "hilog/log.h"
 
-#include <cstdlib>
+#include <algorithm>
+#include <charconv>
 #include <cinttypes>
-#include <iostream>
-#include <string>
-#include <thread>
-#include <chrono>
-#include <fstream>
-#include <regex>
-#include <sys/time.h>
-#include <unistd.h>
-#include <fcntl.h>
-#include <sys/types.h>
-#include <string_view>
+#include <ctime>
+#include <securec.h>
 
 namespace OHOS {
 namespace HiviewDFX {
-using namespace std::chrono;
-using namespace std::literals;
+static constexpr uint64_t SEC2USEC = 1000000;
+static constexpr uint64_t USEC2NSEC = 1000;
+static constexpr uint64_t SEC2NSEC = 1000000000;
+static constexpr uint16_t SYSLOG_PRI_MASK = 0x07; /* the rest is the facility */
+static constexpr size_t KMSG_MAX_TEXT_LEN = MAX_LOG_LEN - 1;
+static constexpr size_t KMSG_LOST_TEXT_LEN = 64;
 
 // Avoid name collision between sys/syslog.h and our log_c.h
 #undef LOG_FATAL
@@ -79,31 +75,175 @@ static uint16_t KmsgLevelMap(uint16_t prio)
     return level;
 }
 
-std::optional<HilogMsgWrapper> KmsgParser::ParseKmsg(const std::vector<char>& kmsgBuffer)
+// Reads the number at the start of s and removes it
+static bool TakeNumber(std::string_view& s, uint64_t& value)
 {
-    std::string kmsgStr(kmsgBuffer.data());
-    std::string tagStr = "";
-    size_t tagLen = tagStr.size();
-    // Now build HilogMsg and insert it into buffer
-    auto len = kmsgStr.size() + 1;
-    auto msgLen = sizeof(HilogMsg) + tagLen + len + 1;
-    HilogMsgWrapper msgWrap((std::vector<char>(msgLen, '\0')));
-    HilogMsg& msg = msgWrap.GetHilogMsg();
-    msg.len = msgLen;
-    msg.tagLen = tagLen + 1;
-    msg.type = LOG_KMSG;
-    msg.level = KmsgLevelMap(LOG_INFO);
-    struct timespec ts = {0};
-    (void)clock_gettime(CLOCK_REALTIME, &ts);
-    msg.tv_sec = static_cast<uint32_t>(ts.tv_sec);
-    msg.tv_nsec = static_cast<uint32_t>(ts.tv_nsec);
-    if (strncpy_s(msg.tag, msgLen - sizeof(HilogMsg), tagStr.c_str(), tagLen) != 0) {
-        return {};
+    auto [end, ec] = std::from_chars(s.data(), s.data() + s.size(), value);
+    if (ec != std::errc() || end == s.data()) {
+        return false;
+    }
+    s.remove_prefix(end - s.data());
+    return true;
+}
+
+static bool TakeChar(std::string_view& s, char c)
+{
+    if (s.empty() || s.front() != c) {
+        return false;
+    }
+    s.remove_prefix(1);
+    return true;
+}
+
+KmsgParser::KmsgParser() : m_buffer(sizeof(HilogMsg) + 1 + KMSG_MAX_TEXT_LEN + 1, 0)
+{
+    m_lastLevel = KmsgLevelMap(Priority::PV6);
+}
+
+const HilogMsg* KmsgParser::ParseNext(std::string_view& data)
+{
+    size_t end = data.find('\n');
+    std::string_view line = data.substr(0, end);
+    size_t used = (end == std::string_view::npos) ? data.size() : end + 1;
+    // Dictionary lines, and /dev/kmsg continuation lines of older kernels, belong to the record
+    while (used < data.size() && data[used] == ' ') {
+        end = data.find('\n', used);
+        used = (end == std::string_view::npos) ? data.size() : end + 1;
+    }
+    if (line.empty()) {
+        data.remove_prefix(used);
+        return nullptr;
+    }
+    if (line.front() == '<') {
+        data.remove_prefix(used);
+        return ParseProcKmsg(line);
+    }
+    bool keepLine = false;
+    const HilogMsg* msg = ParseDevKmsg(line, keepLine);
+    if (!keepLine) {
+        data.remove_prefix(used);
+    }
+    return msg;
+}
+
+const HilogMsg* KmsgParser::ParseDevKmsg(std::string_view line, bool& keepLine)
+{
+    size_t semicolon = line.find(';');
+    std::string_view header = line.substr(0, semicolon);
+    uint64_t prio = 0;
+    uint64_t seq = 0;
+    uint64_t usec = 0;
+    if (semicolon == std::string_view::npos || !TakeNumber(header, prio) || !TakeChar(header, ',') ||
+        !TakeNumber(header, seq) || !TakeChar(header, ',') || !TakeNumber(header, usec) || !TakeChar(header, ',')) {
+        // Not a record, kept as it is rather than lost
+        return BuildMsg(m_lastLevel, 0, line);
+    }
+    if (m_lastSeq != NO_SEQ) {
+        if (seq <= m_lastSeq) {
+            return nullptr;
+        }
+        if (seq - m_lastSeq > 1) {
+            uint64_t lost = seq - m_lastSeq - 1;
+            m_lastSeq = seq - 1;
+            keepLine = true;
+            return BuildLostMsg(lost, usec);
+        }
+    }
+    m_lastSeq = seq;
+    std::string_view text = line.substr(semicolon + 1);
+    // '+' marks the following fragments of a line the kernel printed in several parts
+    if (!header.empty() && header.front() == '+') {
+        return BuildMsg(m_lastLevel, m_lastUsec, text);
+    }
+    return BuildMsg(KmsgLevelMap(static_cast<uint16_t>(prio) & SYSLOG_PRI_MASK), usec, text);
+}
+
+const HilogMsg* KmsgParser::ParseProcKmsg(std::string_view line)
+{
+    std::string_view text = line.substr(1);
+    uint64_t prio = 0;
+    if (!TakeNumber(text, prio) || !TakeChar(text, '>')) {
+        return BuildMsg(m_lastLevel, 0, line);
+    }
+    uint16_t level = KmsgLevelMap(static_cast<uint16_t>(prio) & SYSLOG_PRI_MASK);
+    // The timestamp is only there with printk.time
+    std::string_view ts = text;
+    uint64_t sec = 0;
+    uint64_t usec = 0;
+    if (TakeChar(ts, '[')) {
+        ts.remove_prefix(std::min(ts.find_first_not_of(' '), ts.size()));
+        if (TakeNumber(ts, sec) && TakeChar(ts, '.') && TakeNumber(ts, usec) && TakeChar(ts, ']')) {
+            (void)TakeChar(ts, ' ');
+            return BuildMsg(level, sec * SEC2USEC + usec, ts);
+        }
+    }
+    return BuildMsg(level, 0, text);
+}
+
+// Dated like the record after the gap, the level and time of fragments stay with the records
+const HilogMsg* KmsgParser::BuildLostMsg(uint64_t lost, uint64_t monoUsec)
+{
+    char text[KMSG_LOST_TEXT_LEN] = {0};
+    int len = snprintf_s(text, sizeof(text), sizeof(text) - 1, "%" PRIu64 " kernel lines lost", lost);
+    if (len < 0) {
+        return nullptr;
     }
-    if (strncpy_s(CONTENT_PTR((&msg)), msgLen - sizeof(HilogMsg) - tagLen, kmsgStr.c_str(), len) != 0) {
-        return {};
+    uint16_t lastLevel = m_lastLevel;
+    uint64_t lastUsec = m_lastUsec;
+    const HilogMsg* msg = BuildMsg(LOG_WARN, monoUsec, std::string_view(text, len));
+    m_lastLevel = lastLevel;
+    m_lastUsec = lastUsec;
+    return msg;
+}
+
+// monoUsec is the kernel timestamp, 0 if the record has none and the current time is used
+const HilogMsg* KmsgParser::BuildMsg(uint16_t level, uint64_t monoUsec, std::string_view text)
+{
+    uint64_t realNsec = 0;
+    uint64_t monoNsec = 0;
+    if (monoUsec == 0) {
+        struct timespec real = {0};
+        struct timespec mono = {0};
+        (void)clock_gettime(CLOCK_REALTIME, &real);
+        (void)clock_gettime(CLOCK_MONOTONIC, &mono);
+        realNsec = static_cast<uint64_t>(real.tv_sec) * SEC2NSEC + real.tv_nsec;
+        monoNsec = static_cast<uint64_t>(mono.tv_sec) * SEC2NSEC + mono.tv_nsec;
+    } else {
+        // Records come in kernel time order, the clocks are read again once it moved by a second
+        if (monoUsec < m_offsetUsec || monoUsec - m_offsetUsec >= SEC2USEC) {
+            struct timespec real = {0};
+            struct timespec mono = {0};
+            (void)clock_gettime(CLOCK_REALTIME, &real);
+            (void)clock_gettime(CLOCK_MONOTONIC, &mono);
+            m_offsetNsec = (static_cast<int64_t>(real.tv_sec) - mono.tv_sec) * static_cast<int64_t>(SEC2NSEC) +
+                (real.tv_nsec - mono.tv_nsec);
+            m_offsetUsec = monoUsec;
+        }
+        monoNsec = monoUsec * USEC2NSEC;
+        realNsec = static_cast<uint64_t>(static_cast<int64_t>(monoNsec) + m_offsetNsec);
+    }
+    m_lastLevel = level;
+    m_lastUsec = monoUsec;
+
+    size_t textLen = std::min(text.size(), KMSG_MAX_TEXT_LEN);
+    HilogMsg& msg = *reinterpret_cast<HilogMsg*>(m_buffer.data());
+    msg.len = sizeof(HilogMsg) + 1 + textLen + 1;
+    msg.version = HILOG_MSG_VERSION_TEXT;
+    msg.type = LOG_KMSG;
+    msg.level = level;
+    msg.tagLen = 1;
+    msg.tv_sec = static_cast<uint32_t>(realNsec / SEC2NSEC);
+    msg.tv_nsec = static_cast<uint32_t>(realNsec % SEC2NSEC);
+    msg.mono_sec = static_cast<uint32_t>(monoNsec / SEC2NSEC);
+    msg.pid = 0;
+    msg.tid = 0;
+    msg.domain = 0;
+    msg.tag[0] = '\0';
+    if (textLen > 0 && memcpy_s(msg.tag + 1, KMSG_MAX_TEXT_LEN, text.data(), textLen) != EOK) {
+        return nullptr;
     }
-    return msgWrap;
+    msg.tag[1 + textLen] = '\0';
+    return &msg;
 }
 } // namespace HiviewDFX
 } // namespace OHOS
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <algorithm>
+#include <iostream>
+#include <new>
+#include <securec.h>
+
+#include "log_batch.h"
+#include "log_binary.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+// A batch holds at least one log of the maximum size
+static constexpr size_t MIN_BATCH_SIZE = sizeof(HilogMsg) + MAX_TAG_LEN + MAX_LOG_LEN;
+
+LogBatch::LogBatch(size_t size, size_t maxCount) : m_maxCount(std::max<size_t>(maxCount, 1))
+{
+    size = std::max(size, MIN_BATCH_SIZE);
+    m_data.reset(new (std::nothrow) char[size]);
+    if (m_data == nullptr) {
+        std::cerr << "Can't allocate log batch, size: " << size << std::endl;
+        return;
+    }
+    m_size = size;
+    m_offsets.reserve(m_maxCount);
+}
+
+bool LogBatch::CanHold(const HilogMsg& msg) const
+{
+    // A binary log is formatted into the batch, its text may be longer than the record
+    size_t need = (msg.version == HILOG_MSG_VERSION_BINARY) ? sizeof(HilogMsg) + msg.tagLen + MAX_LOG_LEN : msg.len;
+    return !Full() && m_size - m_used >= need;
+}
+
+bool LogBatch::Append(const HilogMsg& msg)
+{
+    if (!CanHold(msg)) {
+        return false;
+    }
+    if (msg.version == HILOG_MSG_VERSION_BINARY) {
+        return AppendBinary(msg);
+    }
+    char* record = m_data.get() + m_used;
+    if (memcpy_s(record, m_size - m_used, &msg, msg.len) != EOK) {
+        std::cerr << "Can't copy log into batch" << std::endl;
+        return false;
+    }
+    // Readers use tag and content as C strings, terminate them whatever the writer sent
+    HilogMsg* copy = reinterpret_cast<HilogMsg *>(record);
+    copy->tag[copy->tagLen - 1] = '\0';
+    record[copy->len - 1] = '\0';
+    m_offsets.push_back(static_cast<uint32_t>(m_used));
+    m_used += msg.len;
+    return true;
+}
+
+// Readers only ever see text, the process left the formatting of binary logs to them
+bool LogBatch::AppendBinary(const HilogMsg& msg)
+{
+    char* record = m_data.get() + m_used;
+    size_t headLen = sizeof(HilogMsg) + msg.tagLen;
+    if (memcpy_s(record, m_size - m_used, &msg, headLen) != EOK) {
+        std::cerr << "Can't copy log into batch" << std::endl;
+        return false;
+    }
+    HilogMsg* copy = reinterpret_cast<HilogMsg *>(record);
+    copy->tag[copy->tagLen - 1] = '\0';
+    int textLen = DecodeBinaryLog(CONTENT_PTR((&msg)), CONTENT_LEN((&msg)), record + headLen, MAX_LOG_LEN);
+    copy->version = HILOG_MSG_VERSION_TEXT;
+    copy->len = static_cast<uint16_t>(headLen + textLen + 1);
+    m_offsets.push_back(static_cast<uint32_t>(m_used));
+    m_used += copy->len;
+    return true;
+}
+
+void LogBatch::Clear()
+{
+    m_used = 0;
+    m_offsets.clear();
+}
+
+const HilogMsg& LogBatch::At(size_t index) const
+{
+    return *reinterpret_cast<const HilogMsg *>(m_data.get() + m_offsets[index]);
+}
+} // namespace HiviewDFX
+} // namespace OHOS
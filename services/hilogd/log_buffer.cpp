@@ -13,11 +13,12 @@
  * limitations under the License.
  */
 
+#include <algorithm>
 #include <cstring>
 #include <thread>
 #include <vector>
 #include <sys/time.h>
-#include <regex>
+#include <securec.h>
 #include <string>
 
 #include <hilog_common.h>
@@ -43,9 +44,6 @@ static inline int ConvertBufType(int type)
 
 HilogBuffer::HilogBuffer(bool isSupportSkipLog) : m_isSupportSkipLog(isSupportSkipLog)
 {
-    for (int i = 0; i < LOG_TYPE_MAX; i++) {
-        sizeByType[i] = 0;
-    }
     InitBuffLen();
     InitBuffHead();
 }
@@ -86,6 +84,45 @@ void HilogBuffer::InitBuffHead()
 HilogBuffer::~HilogBuffer() {}
 
 size_t HilogBuffer::Insert(const HilogMsg& msg, bool& isFull)
+{
+    size_t elemSize = 0;
+    {
+        std::lock_guard<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
+        elemSize = InsertLocked(msg, isFull);
+    }
+    if (elemSize > 0) {
+        // Notify readers about new element added
+        OnNewItem(ConvertBufType(msg.type));
+    }
+    return elemSize;
+}
+
+size_t HilogBuffer::InsertBatch(const LogBatch& batch, size_t first)
+{
+    size_t newLogs[LOG_TYPE_MAX] = {0};
+    size_t i = first;
+    {
+        std::lock_guard<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
+        for (; i < batch.Count(); i++) {
+            bool isFull = false;
+            const HilogMsg& msg = batch.At(i);
+            if (InsertLocked(msg, isFull) > 0) {
+                newLogs[ConvertBufType(msg.type)]++;
+            } else if (isFull) {
+                break;
+            }
+        }
+    }
+    for (int t = 0; t < LOG_TYPE_MAX; t++) {
+        if (newLogs[t] > 0) {
+            OnNewItem(t, newLogs[t]);
+        }
+    }
+    return i;
+}
+
+// Call with hilogBufferMutex held exclusively
+size_t HilogBuffer::InsertLocked(const HilogMsg& msg, bool& isFull)
 {
     size_t elemSize = CONTENT_LEN((&msg)); /* include '\0' */
     if (unlikely(msg.tagLen > MAX_TAG_LEN || msg.tagLen == 0 || elemSize > MAX_LOG_LEN ||
@@ -93,157 +130,104 @@ size_t HilogBuffer::Insert(const HilogMsg& msg, bool& isFull)
         return 0;
     }
     isFull = false;
-    {
-        std::lock_guard<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
-        int bufferType = ConvertBufType(msg.type);
-
-        // Delete old entries when full
-        if (elemSize + sizeByType[bufferType] >= g_maxBufferSizeByType[bufferType]) {
-            // Drop 5% of maximum log when full
-            std::list<HilogData>::iterator it = hilogDataList.begin();
-            static const float DROP_RATIO = 0.05;
-            while (sizeByType[bufferType] > g_maxBufferSizeByType[bufferType] * (1 - DROP_RATIO) &&
-                it != hilogDataList.end()) {
-                if (ConvertBufType((*it).type) != bufferType) {    // Only remove old logs of the same type
-                    ++it;
-                    continue;
-                }
-
-                if (IsItemUsed(it)) {
-                    isFull = true;
-                    return 0;
-                }
-
-                OnDeleteItem(it, DeleteReason::BUFF_OVERFLOW);
-                size_t cLen = it->len - it->tagLen;
-                sizeByType[ConvertBufType((*it).type)] -= cLen;
-                it = hilogDataList.erase(it);
-            }
+    int bufferType = ConvertBufType(msg.type);
+    LogRingBuffer& ring = m_rings[bufferType];
+    // Storage of a log type is allocated when its first log arrives
+    if (!ring.IsAllocated()) {
+        ring = LogRingBuffer(g_maxBufferSizeByType[bufferType]);
+    }
+    size_t recordSize = LogRingBuffer::RecordSize(msg);
+    if (recordSize > ring.Capacity()) {
+        return 0;
+    }
 
-            // Re-confirm if enough elements has been removed
-            if (sizeByType[bufferType] >= g_maxBufferSizeByType[bufferType]) {
-                std::cout << "Failed to clean old logs." << std::endl;
-            }
+    // Delete oldest entries of the same type until the new log fits
+    while (!ring.HasRoom(recordSize)) {
+        Offset head = ring.Begin();
+        if (IsItemUsed(bufferType, head)) {
+            isFull = true;
+            return 0;
         }
-
-        // Append new log into HilogBuffer
-        hilogDataList.emplace_back(msg);
-        // Update current size of HilogBuffer
-        sizeByType[bufferType] += elemSize;
-        OnPushBackedItem(hilogDataList);
+        OnDeleteItem(bufferType, head, DeleteReason::BUFF_OVERFLOW);
+        ring.PopFront();
     }
 
-    // Notify readers about new element added
-    OnNewItem(hilogDataList);
+    // Append new log into HilogBuffer
+    Offset oldEnd = ring.End();
+    Offset pos = ring.Append(msg, ++m_seq);
+    OnPushBackedItem(bufferType, oldEnd, pos);
     return elemSize;
 }
 
-// Replace wildcard with regex
-static std::string WildcardToRegex(const std::string& wildcard)
+// Pick the ring whose next log is the oldest one, so logs of all types come out in arrival order
+int HilogBuffer::NextRing(const Offset (&pos)[LOG_TYPE_MAX], uint16_t ringMask) const
 {
-    // Original and Replacement char array
-    const static char* WILDCARDS = "*?[]+.^&";
-    const static std::string REPLACEMENT_S[] = {".*", ".", "\\[", "\\]", "\\+", "\\.", "\\^", "\\&"};
-    // Modify every wildcard to regex
-    std::string result = "";
-    for (char c : wildcard) {
-        // strchr matches wildcard and char
-        if (std::strchr(WILDCARDS, c) != nullptr) {
-            size_t index = std::strchr(WILDCARDS, c) - WILDCARDS;
-            result += REPLACEMENT_S[index];
-        } else {
-            result += c;
+    int next = -1;
+    uint64_t minSeq = UINT64_MAX;
+    for (int t = 0; t < LOG_TYPE_MAX; t++) {
+        if ((ringMask & (0b01 << t)) == 0 || pos[t] == m_rings[t].End()) {
+            continue;
+        }
+        uint64_t seq = m_rings[t].SeqAt(pos[t]);
+        if (seq < minSeq) {
+            minSeq = seq;
+            next = t;
         }
     }
-    return result;
+    return next;
 }
 
-static bool LogMatchFilter(const LogFilter& filter, const HilogData& logData)
+void HilogBuffer::PositionReader(BufferReader& reader, const CompiledLogFilter& filter, int tailCount)
 {
-    // types & levels match
-    if (((static_cast<uint16_t>(0b01 << logData.type)) & filter.types) == 0) {
-        return false;
-    }
-    if (((static_cast<uint16_t>(0b01 << logData.level)) & filter.levels) == 0) {
-        return false;
-    }
-
-    int i = 0;
-    // domain match
-    static constexpr uint32_t LOW_BYTE = 0xFF;
-    static constexpr uint32_t LOW_BYTE_REVERSE = ~LOW_BYTE;
-    /* 1) domain id equals exactly: (0xd012345 == 0xd012345)
-       2) last 8 bits is sub domain id, if it's 0xFF, compare high 24 bits:
-       (0xd0123ff & 0xffffff00 == 0xd012345 & 0xffffff00) */
-    bool match = false;
-    for (i = 0; i < filter.domainCount; i++) {
-        if ((logData.domain == filter.domains[i]) || ((static_cast<uint8_t>(filter.domains[i]) == LOW_BYTE)
-             && ((logData.domain & LOW_BYTE_REVERSE) == (filter.domains[i] & LOW_BYTE_REVERSE)))) {
-            match = true;
-            break;
+    reader.m_ringMask = 0;
+    for (int t = 0; t < LOG_TYPE_MAX; t++) {
+        if ((filter.GetFilter().types & (0b01 << t)) != 0) {
+            reader.m_ringMask |= (0b01 << ConvertBufType(t));
         }
+        reader.m_pos[t] = m_rings[t].Begin();
     }
-    if (filter.domainCount && match == filter.blackDomain) {
-        return false;
+    reader.m_started = true;
+    if (tailCount <= 0) {
+        return;
     }
-    match = false;
-    // tag match
-    for (i = 0; i < filter.tagCount; i++) {
-        if (strcmp(logData.tag, filter.tags[i]) == 0) {
-            match = true;
-            break;
+
+    // Count the matched logs, then skip all of them except the last tailCount ones
+    Offset pos[LOG_TYPE_MAX];
+    std::copy(std::begin(reader.m_pos), std::end(reader.m_pos), std::begin(pos));
+    size_t matched = 0;
+    for (int t = NextRing(pos, reader.m_ringMask); t >= 0; t = NextRing(pos, reader.m_ringMask)) {
+        if (filter.Match(m_rings[t].MsgAt(pos[t]))) {
+            matched++;
         }
+        pos[t] = m_rings[t].Next(pos[t]);
     }
-    if (filter.tagCount && match == filter.blackTag) {
-        return false;
-    }
-    match = false;
-    // pid match
-    for (i = 0; i < filter.pidCount; i++) {
-        if (logData.pid == filter.pids[i]) {
-            match = true;
+    size_t toSkip = matched > static_cast<size_t>(tailCount) ? matched - tailCount : 0;
+    while (toSkip > 0) {
+        int t = NextRing(reader.m_pos, reader.m_ringMask);
+        if (t < 0) {
             break;
         }
-    }
-    if (filter.pidCount && match == filter.blackPid) {
-        return false;
-    }
-    // regular expression match
-    if (filter.regex[0] != 0) {
-        // Added a WildcardToRegex function for invalid regex.
-        std::string wildcardRegex = WildcardToRegex(filter.regex);
-        std::regex regExpress(wildcardRegex);
-        if (std::regex_search(logData.content, regExpress) == false) {
-            return false;
+        if (filter.Match(m_rings[t].MsgAt(reader.m_pos[t]))) {
+            toSkip--;
         }
+        reader.m_pos[t] = m_rings[t].Next(reader.m_pos[t]);
     }
-    return true;
 }
 
-std::optional<HilogData> HilogBuffer::Query(const LogFilter& filter, const ReaderId& id, int tailCount)
+size_t HilogBuffer::Query(const CompiledLogFilter& filter, const ReaderId& id, LogBatch& batch, int tailCount,
+    uint64_t endSeq)
 {
+    batch.Clear();
     auto reader = GetReader(id);
     if (!reader) {
         std::cerr << "Reader not registered!\n";
-        return std::nullopt;
+        return 0;
     }
 
     std::shared_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
 
-    if (reader->m_msgList != &hilogDataList) {
-        reader->m_msgList = &hilogDataList;
-        if (tailCount == 0) {
-            reader->m_pos = hilogDataList.begin();
-        } else {
-            reader->m_pos = hilogDataList.end();
-            reader->m_pos--;
-        }
-        for (int i = 0; (i < tailCount) && (reader->m_pos != hilogDataList.begin());) {
-            if (LogMatchFilter(filter, (*reader->m_pos))) {
-                i++;
-            }
-            reader->m_pos--;
-        }
+    if (!reader->m_started) {
+        PositionReader(*reader, filter, tailCount);
     }
 
     if (reader->skipped) {
@@ -251,21 +235,32 @@ std::optional<HilogData> HilogBuffer::Query(const LogFilter& filter, const Reade
         const string tmpStr = msg + to_string(reader->skipped);
         std::vector<char> buf(MAX_LOG_LEN, 0);
         HilogMsg *headMsg = reinterpret_cast<HilogMsg *>(buf.data());
-        if (GenerateHilogMsgInside(*headMsg, tmpStr, LOG_CORE) == RET_SUCCESS) {
-            const HilogData logData(*headMsg);
+        if (GenerateHilogMsgInside(*headMsg, tmpStr, LOG_CORE) == RET_SUCCESS && batch.Append(*headMsg)) {
             reader->skipped = 0;
-            return logData;
         }
     }
 
-    while (reader->m_pos != hilogDataList.end()) {
-        const HilogData& logData = *reader->m_pos;
-        reader->m_pos++;
-        if (LogMatchFilter(filter, logData)) {
-            return logData;
+    // Copy matched logs until the batch is full, the reader stays on the first log which doesn't fit
+    bool moved = false;
+    for (int t = NextRing(reader->m_pos, reader->m_ringMask); t >= 0 && !batch.Full();
+        t = NextRing(reader->m_pos, reader->m_ringMask)) {
+        if (m_rings[t].SeqAt(reader->m_pos[t]) >= endSeq) {
+            break;
+        }
+        const HilogMsg& msg = m_rings[t].MsgAt(reader->m_pos[t]);
+        if (filter.Match(msg)) {
+            if (!batch.Append(msg)) {
+                break;
+            }
         }
+        reader->m_pos[t] = m_rings[t].Next(reader->m_pos[t]);
+        moved = true;
+    }
+    lock.unlock();
+    if (moved) {
+        OnReadProgress();
     }
-    return std::nullopt;
+    return batch.Count();
 }
 
 int32_t HilogBuffer::Delete(uint16_t logType)
@@ -273,26 +268,87 @@ int32_t HilogBuffer::Delete(uint16_t logType)
     if (logType >= LOG_TYPE_MAX) {
         return ERR_LOG_TYPE_INVALID;
     }
-    size_t sum = 0;
+    int bufferType = ConvertBufType(logType);
     std::unique_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
-    std::list<HilogData>::iterator it = hilogDataList.begin();
+    LogRingBuffer& ring = m_rings[bufferType];
+    if (!ring.IsAllocated()) {
+        return 0;
+    }
+    // Delete logs corresponding to queryCondition, other types sharing the buffer are kept
+    size_t sum = RebuildRing(bufferType, ring.Capacity(), [logType](const HilogMsg& msg) {
+        return msg.type != logType;
+    }, DeleteReason::CMD_CLEAR);
+    lock.unlock();
+    OnReadProgress();
+    return static_cast<int32_t>(sum);
+}
 
-    // Delete logs corresponding to queryCondition
-    while (it != hilogDataList.end()) {
-        // Only remove old logs of the same type
-        if ((*it).type != logType) {
-            ++it;
-            continue;
+// Move the logs accepted by keep into a ring of the given capacity, dropping the oldest ones if they don't fit.
+// Readers are moved to the same log in the new ring, or to the next kept one if their log is gone.
+size_t HilogBuffer::RebuildRing(int ringType, size_t capacity, const std::function<bool(const HilogMsg&)>& keep,
+    DeleteReason reason)
+{
+    LogRingBuffer& ring = m_rings[ringType];
+    std::vector<Offset> kept;
+    size_t keptSize = 0;
+    for (Offset pos = ring.Begin(); pos != ring.End(); pos = ring.Next(pos)) {
+        const HilogMsg& msg = ring.MsgAt(pos);
+        if (keep(msg)) {
+            kept.push_back(pos);
+            keptSize += LogRingBuffer::RecordSize(msg);
         }
-        // Delete corresponding logs
-        OnDeleteItem(it, DeleteReason::CMD_CLEAR);
+    }
+    size_t oldSize = ring.Size();
+    if (kept.empty() && capacity == ring.Capacity()) {
+        ring.Clear();
+        std::shared_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
+        for (auto& [id, readerPtr] : m_logReaders) {
+            readerPtr->m_pos[ringType] = ring.End();
+        }
+        return oldSize;
+    }
 
-        size_t cLen = it->len - it->tagLen;
-        sum += cLen;
-        sizeByType[(*it).type] -= cLen;
-        it = hilogDataList.erase(it);
+    LogRingBuffer newRing(capacity);
+    if (!newRing.IsAllocated()) {
+        return 0;
+    }
+    size_t first = 0;
+    while (keptSize > newRing.Capacity()) {
+        keptSize -= LogRingBuffer::RecordSize(ring.MsgAt(kept[first]));
+        first++;
+    }
+    std::vector<Offset> newPos(kept.size(), 0);
+    for (size_t i = first; i < kept.size(); i++) {
+        newPos[i] = newRing.Append(ring.MsgAt(kept[i]), ring.SeqAt(kept[i]));
+    }
+    {
+        std::shared_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
+        for (auto& [id, readerPtr] : m_logReaders) {
+            Offset oldPos = readerPtr->m_pos[ringType];
+            auto it = std::lower_bound(kept.begin() + first, kept.end(), oldPos);
+            readerPtr->m_pos[ringType] = (it == kept.end()) ? newRing.End() : newPos[it - kept.begin()];
+            if (reason == DeleteReason::BUFF_OVERFLOW && readerPtr->m_started) {
+                auto dropped = std::lower_bound(kept.begin(), kept.begin() + first, oldPos);
+                readerPtr->skipped += static_cast<uint32_t>((kept.begin() + first) - dropped);
+            }
+        }
+    }
+    ring = std::move(newRing);
+    return oldSize - ring.Size();
+}
+
+uint64_t HilogBuffer::GetReaderSeq(const ReaderId& id)
+{
+    auto reader = GetReader(id);
+    if (!reader) {
+        return 0;
+    }
+    std::shared_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
+    if (!reader->m_started) {
+        return 0;
     }
-    return sum;
+    int t = NextRing(reader->m_pos, reader->m_ringMask);
+    return (t >= 0) ? m_rings[t].SeqAt(reader->m_pos[t]) : m_seq + 1;
 }
 
 HilogBuffer::ReaderId HilogBuffer::CreateBufReader(std::function<void()> onNewDataCallback)
@@ -315,55 +371,109 @@ void HilogBuffer::RemoveBufReader(const ReaderId& id)
     if (it != m_logReaders.end()) {
         m_logReaders.erase(it);
     }
+    lock.unlock();
+    OnReadProgress();
 }
 
-bool HilogBuffer::IsItemUsed(LogMsgContainer::iterator itemPos)
+bool HilogBuffer::IsItemUsed(int ringType, Offset pos)
 {
     if (m_isSupportSkipLog) {
         return false;
     }
     std::shared_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
     for (auto& [id, readerPtr] : m_logReaders) {
-        if (readerPtr->m_pos == itemPos) {
+        if (readerPtr->m_started && (readerPtr->m_ringMask & (0b01 << ringType)) != 0 &&
+            readerPtr->m_pos[ringType] == pos) {
             return true;
         }
     }
     return false;
 }
 
-void HilogBuffer::OnDeleteItem(LogMsgContainer::iterator itemPos, DeleteReason reason)
+void HilogBuffer::OnDeleteItem(int ringType, Offset pos, DeleteReason reason)
 {
     std::shared_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
     for (auto& [id, readerPtr] : m_logReaders) {
-        if (readerPtr->m_pos == itemPos) {
-            readerPtr->m_pos = std::next(itemPos);
-            if (reason == DeleteReason::BUFF_OVERFLOW) {
+        if (readerPtr->m_started && readerPtr->m_pos[ringType] == pos) {
+            readerPtr->m_pos[ringType] = m_rings[ringType].Next(pos);
+            if (reason == DeleteReason::BUFF_OVERFLOW && (readerPtr->m_ringMask & (0b01 << ringType)) != 0) {
                 readerPtr->skipped++;
             }
         }
     }
 }
 
-void HilogBuffer::OnPushBackedItem(LogMsgContainer& msgList)
+void HilogBuffer::OnPushBackedItem(int ringType, Offset oldEnd, Offset pos)
 {
+    // A padding may be placed in front of the new log, readers waiting at the end jump over it
+    if (oldEnd == pos) {
+        return;
+    }
     std::shared_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
     for (auto& [id, readerPtr] : m_logReaders) {
-        if (readerPtr->m_pos == msgList.end()) {
-            readerPtr->m_pos = std::prev(msgList.end());
+        if (readerPtr->m_started && readerPtr->m_pos[ringType] == oldEnd) {
+            readerPtr->m_pos[ringType] = pos;
         }
     }
 }
 
-void HilogBuffer::OnNewItem(LogMsgContainer& msgList)
+void HilogBuffer::OnNewItem(int ringType, size_t count)
 {
     std::shared_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
     for (auto& [id, readerPtr] : m_logReaders) {
-        if (readerPtr->m_msgList == &msgList && readerPtr->m_onNewDataCallback) {
+        // A reader which is busy reading costs a load per log, not a wakeup
+        if (!readerPtr->m_parked.load(std::memory_order_acquire) || !readerPtr->m_started ||
+            (readerPtr->m_ringMask & (0b01 << ringType)) == 0 || !readerPtr->m_onNewDataCallback) {
+            continue;
+        }
+        size_t newCount = readerPtr->m_newCount.fetch_add(count, std::memory_order_relaxed) + count;
+        if (newCount < readerPtr->m_wakeCount.load(std::memory_order_relaxed)) {
+            continue;
+        }
+        if (readerPtr->m_parked.exchange(false)) {
             readerPtr->m_onNewDataCallback();
         }
     }
 }
 
+void HilogBuffer::ParkReader(const ReaderId& id, size_t minCount)
+{
+    std::shared_ptr<BufferReader> reader = GetReader(id);
+    if (reader == nullptr) {
+        return;
+    }
+    reader->m_wakeCount.store(std::max<size_t>(minCount, 1), std::memory_order_relaxed);
+    reader->m_newCount.store(0, std::memory_order_relaxed);
+    reader->m_parked.store(true, std::memory_order_release);
+}
+
+void HilogBuffer::OnReadProgress()
+{
+    // Only a buffer which doesn't skip logs waits for its readers
+    if (m_isSupportSkipLog) {
+        return;
+    }
+    {
+        std::lock_guard<decltype(m_progressMtx)> lock(m_progressMtx);
+        m_readProgress++;
+    }
+    m_progressCv.notify_all();
+}
+
+uint64_t HilogBuffer::GetReadProgress()
+{
+    std::lock_guard<decltype(m_progressMtx)> lock(m_progressMtx);
+    return m_readProgress;
+}
+
+void HilogBuffer::WaitReadProgress(uint64_t progress, std::chrono::milliseconds timeout)
+{
+    std::unique_lock<decltype(m_progressMtx)> lock(m_progressMtx);
+    (void)m_progressCv.wait_for(lock, timeout, [this, progress]() {
+        return m_readProgress != progress;
+    });
+}
+
 std::shared_ptr<HilogBuffer::BufferReader> HilogBuffer::GetReader(const ReaderId& id)
 {
     std::shared_lock<decltype(m_logReaderMtx)> lock(m_logReaderMtx);
@@ -393,6 +503,10 @@ int32_t HilogBuffer::SetBuffLen(uint16_t logType, uint64_t buffSize)
     }
     std::unique_lock<decltype(hilogBufferMutex)> lock(hilogBufferMutex);
     g_maxBufferSizeByType[logType] = buffSize;
+    LogRingBuffer& ring = m_rings[logType];
+    if (ring.IsAllocated() && ring.Capacity() != LogRingBuffer::AlignCapacity(buffSize)) {
+        (void)RebuildRing(logType, buffSize, [](const HilogMsg&) { return true; }, DeleteReason::BUFF_OVERFLOW);
+    }
     return RET_SUCCESS;
 }
 
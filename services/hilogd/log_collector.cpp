@@ -20,6 +20,7 @@
 #include <string>
 #include <thread>
 #include <string_view>
+#include <securec.h>
 
 #include "log_kmsg.h"
 #include "flow_control.h"
@@ -38,7 +39,7 @@ void LogCollector::InsertDropInfo(const HilogMsg &msg, int droppedCount)
     HilogMsg *dropMsg = reinterpret_cast<HilogMsg *>(buffer.data());
     if (dropMsg != nullptr) {
         dropMsg->len     = buffer.size();
-        dropMsg->version = msg.version;
+        dropMsg->version = HILOG_MSG_VERSION_TEXT;
         dropMsg->type    = msg.type;
         dropMsg->level   = msg.level;
         dropMsg->tagLen = tag.size();
@@ -140,5 +141,19 @@ void LogCollector::SetDebuggable(bool on)
 {
     debug = on;
 }
+
+void LogCollector::SetInputStatsSource(std::function<HilogInputSocketServer::InputStats()> source)
+{
+    m_inputStatsSource = source;
+}
+
+bool LogCollector::GetInputStats(HilogInputSocketServer::InputStats& stats) const
+{
+    if (!m_inputStatsSource) {
+        return false;
+    }
+    stats = m_inputStatsSource();
+    return true;
+}
 } // namespace HiviewDFX
 } // namespace OHOS
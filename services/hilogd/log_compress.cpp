@@ -17,12 +17,16 @@
 #include <iostream>
 #include <cstring>
 #include <cstdlib>
-#include <vector>
+#include <endian.h>
 
 #include <securec.h>
 
+#include <hilog_persist.h>
+
 namespace OHOS {
 namespace HiviewDFX {
+static constexpr uLong DEFLATE_FLUSH_MARGIN = 16;
+
 StringMap LogCompress::g_CompressTypes = StringMap({
         {COMPRESS_TYPE_NONE, "none"}, {COMPRESS_TYPE_ZLIB, "zlib"}, {COMPRESS_TYPE_ZSTD, "zstd"}
     }, COMPRESS_TYPE_ZLIB, "unknown");
@@ -37,144 +41,185 @@ uint16_t LogCompress::Str2CompressType(const std::string& str)
     return g_CompressTypes.GetKey(str);
 }
 
-int NoneCompress::Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressedBuffer)
+int NoneCompress::Compress(const LogPersisterBuffer &inBuffer, LogCompressBuffer &compressedBuffer)
 {
-    void *dest = compressedBuffer.content + compressedBuffer.offset;
-    size_t destSize = MAX_PERSISTER_BUFFER_SIZE - compressedBuffer.offset;
-    if (memcpy_s(dest, destSize, inBuffer.content, inBuffer.offset) != 0) {
+    void *dest = compressedBuffer.Reserve(inBuffer.offset);
+    if (memcpy_s(dest, inBuffer.offset, inBuffer.content, inBuffer.offset) != 0) {
         return -1;
     }
     compressedBuffer.offset += inBuffer.offset;
     return 0;
 }
 
-int ZlibCompress::Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressedBuffer)
+ZlibCompress::~ZlibCompress()
+{
+    if (m_inited) {
+        (void)deflateEnd(&cStream);
+    }
+}
+
+int ZlibCompress::Compress(const LogPersisterBuffer &inBuffer, LogCompressBuffer &compressedBuffer)
 {
-    cStream.zalloc = Z_NULL;
-    cStream.zfree = Z_NULL;
-    cStream.opaque = Z_NULL;
-    if (deflateInit2(&cStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+    if (inBuffer.offset == 0) {
+        return 0;
+    }
+    if (Deflate(inBuffer.content, inBuffer.offset, compressedBuffer, Z_SYNC_FLUSH) != 0) {
         return -1;
     }
-    uint32_t zdlen = deflateBound(&cStream, inBuffer.offset);
-    std::vector<char> zdataBuf(zdlen, 0);
-    char* zdata = zdataBuf.data();
-    if (zdata == nullptr) {
-        std::cerr << "no enough memory!\n";
+    m_pending = true;
+    return 0;
+}
+
+int ZlibCompress::Finish(LogCompressBuffer &compressedBuffer)
+{
+    if (!m_pending) {
+        return 0;
+    }
+    m_pending = false;
+    int ret = Deflate(nullptr, 0, compressedBuffer, Z_FINISH);
+    (void)deflateReset(&cStream);
+    return ret;
+}
+
+// An empty gzip member which carries the index in its extra field
+int ZlibCompress::AppendIndex(const char *index, uint32_t len, LogCompressBuffer &compressedBuffer)
+{
+    static constexpr uint8_t GZIP_FLAG_EXTRA = 0x04;
+    static constexpr uint8_t GZIP_OS_UNKNOWN = 0xff;
+    static constexpr uint32_t SUBFIELD_HEAD_LEN = 4;
+    uint32_t extraLen = SUBFIELD_HEAD_LEN + len;
+    uint8_t header[] = { 0x1f, 0x8b, Z_DEFLATED, GZIP_FLAG_EXTRA, 0, 0, 0, 0, 0, GZIP_OS_UNKNOWN,
+        static_cast<uint8_t>(extraLen), static_cast<uint8_t>(extraLen >> 8),
+        PERSIST_INDEX_SUBFIELD_ID1, PERSIST_INDEX_SUBFIELD_ID2,
+        static_cast<uint8_t>(len), static_cast<uint8_t>(len >> 8) };
+    // final empty block, then crc32 and size of the empty content
+    static constexpr uint8_t tail[] = { 0x03, 0x00, 0, 0, 0, 0, 0, 0, 0, 0 };
+    if (extraLen > UINT16_MAX) {
         return -1;
     }
-    size_t const toRead = CHUNK;
-    size_t src_pos = 0;
-    size_t dst_pos = 0;
-    size_t read = inBuffer.offset;
-    int flush = 0;
-    do {
-        bool flag = read - src_pos < toRead;
-        if (flag) {
-            (void)memset_s(buffIn, CHUNK, 0, CHUNK);
-            if (memmove_s(buffIn, CHUNK, inBuffer.content + src_pos, read - src_pos) != 0) {
-                return -1;
-            }
-            cStream.avail_in = read - src_pos;
-            src_pos += read - src_pos;
-        } else {
-            (void)memset_s(buffIn, CHUNK, 0, CHUNK);
-            if (memmove_s(buffIn, CHUNK, inBuffer.content + src_pos, toRead) != 0) {
-                return -1;
-            }
-            src_pos += toRead;
-            cStream.avail_in = toRead;
+    size_t destSize = sizeof(header) + len + sizeof(tail);
+    char *dest = compressedBuffer.Reserve(destSize);
+    if (memcpy_s(dest, destSize, header, sizeof(header)) != 0 ||
+        memcpy_s(dest + sizeof(header), destSize - sizeof(header), index, len) != 0 ||
+        memcpy_s(dest + sizeof(header) + len, destSize - sizeof(header) - len, tail, sizeof(tail)) != 0) {
+        return -1;
+    }
+    compressedBuffer.offset += sizeof(header) + len + sizeof(tail);
+    return 0;
+}
+
+int ZlibCompress::Deflate(const char *in, uint32_t inLen, LogCompressBuffer &compressedBuffer, int flush)
+{
+    if (!m_inited) {
+        cStream.zalloc = Z_NULL;
+        cStream.zfree = Z_NULL;
+        cStream.opaque = Z_NULL;
+        if (deflateInit2(&cStream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, MAX_WBITS + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+            return -1;
         }
-        flush = flag ? Z_FINISH : Z_NO_FLUSH;
-        cStream.next_in = reinterpret_cast<Bytef*>(buffIn);
-        /* run deflate() on input until output buffer not full, finish
-           compression if all of source has been read in */
-        do {
-            cStream.avail_out = CHUNK;
-            cStream.next_out = reinterpret_cast<Bytef*>(buffOut);
-            if (deflate(&cStream, flush) == Z_STREAM_ERROR) {
-                return -1;
-            }
-            unsigned have = CHUNK - cStream.avail_out;
-            if (memmove_s(zdata + dst_pos, zdlen - dst_pos, buffOut, have) != 0) {
-                return -1;
-            }
-            dst_pos += have;
-            if (unlikely(zdlen < dst_pos)) { // zdataBuf is not long enough, shoudn't happen
-                return -1;
-            }
-        } while (cStream.avail_out == 0);
-    } while (flush != Z_FINISH);
-    /* clean up and return */
-    (void)deflateEnd(&cStream);
-    if (memcpy_s(compressedBuffer.content + compressedBuffer.offset,
-        MAX_PERSISTER_BUFFER_SIZE - compressedBuffer.offset, zdata, dst_pos) != 0) {
+        m_inited = true;
+    }
+    cStream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(in));
+    cStream.avail_in = inLen;
+    // deflateBound() leaves out the markers of flushes, the loop grows the buffer if they don't fit
+    uLong room = deflateBound(&cStream, inLen) + DEFLATE_FLUSH_MARGIN;
+    for (;;) {
+        cStream.next_out = reinterpret_cast<Bytef*>(compressedBuffer.Reserve(room));
+        cStream.avail_out = room;
+        int ret = deflate(&cStream, flush);
+        compressedBuffer.offset += room - cStream.avail_out;
+        if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+            break;
+        }
+        bool done = (flush == Z_FINISH) ? (ret == Z_STREAM_END) : (cStream.avail_in == 0 && cStream.avail_out != 0);
+        if (done) {
+            return 0;
+        }
+    }
+    (void)deflateReset(&cStream);
+    m_pending = false;
+    return -1;
+}
+
+ZstdCompress::~ZstdCompress()
+{
+#ifdef USING_ZSTD_COMPRESS
+    ZSTD_freeCCtx(cctx);
+#endif // #ifdef USING_ZSTD_COMPRESS
+}
+
+int ZstdCompress::Compress(const LogPersisterBuffer &inBuffer, LogCompressBuffer &compressedBuffer)
+{
+#ifdef USING_ZSTD_COMPRESS
+    if (inBuffer.offset == 0) {
+        return 0;
+    }
+    if (CompressStream(inBuffer.content, inBuffer.offset, compressedBuffer, ZSTD_e_flush) != 0) {
         return -1;
     }
-    compressedBuffer.offset += dst_pos;
+    m_pending = true;
+#endif // #ifdef USING_ZSTD_COMPRESS
+    return 0;
+}
+
+int ZstdCompress::Finish(LogCompressBuffer &compressedBuffer)
+{
+#ifdef USING_ZSTD_COMPRESS
+    if (!m_pending) {
+        return 0;
+    }
+    m_pending = false;
+    return CompressStream(nullptr, 0, compressedBuffer, ZSTD_e_end);
+#else
     return 0;
+#endif // #ifdef USING_ZSTD_COMPRESS
 }
 
-int ZstdCompress::Compress(const LogPersisterBuffer &inBuffer, LogPersisterBuffer &compressedBuffer)
+int ZstdCompress::AppendIndex(const char *index, uint32_t len, LogCompressBuffer &compressedBuffer)
 {
 #ifdef USING_ZSTD_COMPRESS
-    uint32_t zdlen = ZSTD_CStreamOutSize();
-    std::vector<char> zdataBuf(zdlen, 0);
-    char* zdata = zdataBuf.data();
-    if (zdata == nullptr) {
-        std::cerr << "no enough memory!\n";
+    // A skippable frame: magic and length, little endian, then the index
+    uint32_t head[] = { htole32(ZSTD_MAGIC_SKIPPABLE_START), htole32(len) };
+    size_t destSize = sizeof(head) + len;
+    char *dest = compressedBuffer.Reserve(destSize);
+    if (memcpy_s(dest, destSize, head, sizeof(head)) != 0 ||
+        memcpy_s(dest + sizeof(head), destSize - sizeof(head), index, len) != 0) {
         return -1;
     }
-    ZSTD_EndDirective mode;
-    int compressionlevel = 1;
-    cctx = ZSTD_createCCtx();
+    compressedBuffer.offset += sizeof(head) + len;
+#endif // #ifdef USING_ZSTD_COMPRESS
+    return 0;
+}
+
+#ifdef USING_ZSTD_COMPRESS
+int ZstdCompress::CompressStream(const char *in, uint32_t inLen, LogCompressBuffer &compressedBuffer,
+    ZSTD_EndDirective mode)
+{
     if (cctx == nullptr) {
-        std::cerr << "ZSTD_createCCtx() failed!\n";
-        return -1;
+        int compressionlevel = 1;
+        cctx = ZSTD_createCCtx();
+        if (cctx == nullptr) {
+            std::cerr << "ZSTD_createCCtx() failed!\n";
+            return -1;
+        }
+        ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, compressionlevel);
     }
-    ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, compressionlevel);
-    size_t const toRead = CHUNK;
-    auto src_pos = 0;
-    auto dst_pos = 0;
-    size_t read = inBuffer.offset;
-    ZSTD_inBuffer input;
+    ZSTD_inBuffer input = {in, inLen, 0};
+    // The bound leaves out what flushing and ending the frame add, the loop grows the buffer for it
+    size_t room = ZSTD_compressBound(inLen);
+    size_t remaining;
     do {
-        bool flag = read - src_pos < toRead;
-        if (flag) {
-            (void)memset_s(buffIn, CHUNK, 0, CHUNK);
-            if (memmove_s(buffIn, CHUNK, inBuffer.content + src_pos, read - src_pos) != 0) {
-                return -1;
-            }
-            input = {buffIn, read - src_pos, 0};
-            src_pos += read - src_pos;
-        } else {
-            (void)memset_s(buffIn, CHUNK, 0, CHUNK);
-            if (memmove_s(buffIn, CHUNK, inBuffer.content + src_pos, toRead) != 0) {
-                return -1;
-            }
-            input = {buffIn, toRead, 0};
-            src_pos += toRead;
-        }
-        mode = flag ? ZSTD_e_end : ZSTD_e_continue;
-        int finished;
-        do {
-            ZSTD_outBuffer output = {buffOut, CHUNK, 0};
-            size_t const remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
-            if (memmove_s(zdata + dst_pos, zdlen - dst_pos, reinterpret_cast<Bytef*>(buffOut), output.pos) != 0) {
-                return -1;
-            }
-            dst_pos += output.pos;
-            finished = flag ? (remaining == 0) : (input.pos == input.size);
-        } while (!finished);
-    } while (mode != ZSTD_e_end);
-    ZSTD_freeCCtx(cctx);
-    if (memcpy_s(compressedBuffer.content + compressedBuffer.offset,
-        MAX_PERSISTER_BUFFER_SIZE - compressedBuffer.offset, zdata, dst_pos) != 0) {
+        ZSTD_outBuffer output = {compressedBuffer.Reserve(room), room, 0};
+        remaining = ZSTD_compressStream2(cctx, &output, &input, mode);
+        compressedBuffer.offset += output.pos;
+    } while (!ZSTD_isError(remaining) && remaining != 0);
+    if (remaining != 0) {
+        (void)ZSTD_CCtx_reset(cctx, ZSTD_reset_session_only);
+        m_pending = false;
         return -1;
     }
-    compressedBuffer.offset += dst_pos;
-#endif // #ifdef USING_ZSTD_COMPRESS
     return 0;
 }
+#endif // #ifdef USING_ZSTD_COMPRESS
 } // namespace HiviewDFX
 } // namespace OHOS
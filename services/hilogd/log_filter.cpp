@@ -0,0 +1,145 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <cstring>
+#include <securec.h>
+
+#include <hilog_common.h>
+
+#include "log_binary.h"
+#include "log_filter.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+static constexpr uint32_t LOW_BYTE = 0xFF;
+static constexpr uint32_t LOW_BYTE_REVERSE = ~LOW_BYTE;
+
+// Replace wildcard with regex
+std::string WildcardToRegex(const std::string& wildcard)
+{
+    // Original and Replacement char array
+    const static char* WILDCARDS = "*?[]+.^&";
+    const static std::string REPLACEMENT_S[] = {".*", ".", "\\[", "\\]", "\\+", "\\.", "\\^", "\\&"};
+    // Modify every wildcard to regex
+    std::string result = "";
+    for (char c : wildcard) {
+        // strchr matches wildcard and char
+        if (std::strchr(WILDCARDS, c) != nullptr) {
+            size_t index = std::strchr(WILDCARDS, c) - WILDCARDS;
+            result += REPLACEMENT_S[index];
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+CompiledLogFilter::CompiledLogFilter(const LogFilter& filter)
+{
+    if (memcpy_s(&m_filter, sizeof(m_filter), &filter, sizeof(filter)) != EOK) {
+        std::cerr << "Can't copy log filter" << std::endl;
+    }
+    /* 1) domain id equals exactly: (0xd012345 == 0xd012345)
+       2) last 8 bits is sub domain id, if it's 0xFF, compare high 24 bits:
+       (0xd0123ff & 0xffffff00 == 0xd012345 & 0xffffff00) */
+    for (int i = 0; i < m_filter.domainCount && i < MAX_DOMAINS; i++) {
+        uint32_t domain = m_filter.domains[i];
+        uint32_t mask = (static_cast<uint8_t>(domain) == LOW_BYTE) ? LOW_BYTE_REVERSE : ~0u;
+        m_domains.push_back({domain & mask, mask});
+    }
+    for (int i = 0; i < m_filter.tagCount && i < MAX_TAGS; i++) {
+        m_filter.tags[i][MAX_TAG_LEN - 1] = '\0';
+        m_tags.emplace_back(m_filter.tags[i]);
+    }
+    for (int i = 0; i < m_filter.pidCount && i < MAX_PIDS; i++) {
+        m_pids.push_back(m_filter.pids[i]);
+    }
+    m_filter.regex[MAX_REGEX_STR_LEN - 1] = '\0';
+    if (m_filter.regex[0] != 0) {
+        // Added a WildcardToRegex function for invalid regex.
+        m_regex.emplace(WildcardToRegex(m_filter.regex));
+    }
+}
+
+bool CompiledLogFilter::MatchDomain(uint32_t domain) const
+{
+    for (const auto& term : m_domains) {
+        if ((domain & term.mask) == term.value) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CompiledLogFilter::MatchTag(std::string_view tag) const
+{
+    for (const auto& term : m_tags) {
+        if (term == tag) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CompiledLogFilter::MatchPid(uint32_t pid) const
+{
+    for (uint32_t term : m_pids) {
+        if (term == pid) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool CompiledLogFilter::MatchRegex(const HilogMsg& msg) const
+{
+    if (msg.version != HILOG_MSG_VERSION_BINARY) {
+        return std::regex_search(CONTENT_PTR((&msg)), *m_regex);
+    }
+    // The expression applies to the text readers will get
+    char text[MAX_LOG_LEN];
+    (void)DecodeBinaryLog(CONTENT_PTR((&msg)), CONTENT_LEN((&msg)), text, sizeof(text));
+    return std::regex_search(text, *m_regex);
+}
+
+bool CompiledLogFilter::Match(const HilogMsg& msg) const
+{
+    // types & levels match
+    if (((static_cast<uint16_t>(0b01 << msg.type)) & m_filter.types) == 0) {
+        return false;
+    }
+    if (((static_cast<uint16_t>(0b01 << msg.level)) & m_filter.levels) == 0) {
+        return false;
+    }
+    if (!m_domains.empty() && MatchDomain(msg.domain) == m_filter.blackDomain) {
+        return false;
+    }
+    if (!m_tags.empty()) {
+        std::string_view tag(msg.tag, strnlen(msg.tag, msg.tagLen));
+        if (MatchTag(tag) == m_filter.blackTag) {
+            return false;
+        }
+    }
+    if (!m_pids.empty() && MatchPid(msg.pid) == m_filter.blackPid) {
+        return false;
+    }
+    // regular expression match
+    if (m_regex.has_value() && !MatchRegex(msg)) {
+        return false;
+    }
+    return true;
+}
+} // namespace HiviewDFX
+} // namespace OHOS
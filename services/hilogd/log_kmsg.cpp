@@ -14,8 +14,10 @@
  */
 
 #include "log_kmsg.h"
+#include <chrono>
 #include <cstdlib>
 #include <cinttypes>
+#include <cstring>
 #include <iostream>
 #include <string>
 #include <thread>
@@ -24,10 +26,12 @@
 #include <sys/syslog.h>
 #include <unistd.h>
 #include <fcntl.h>
+#include <poll.h>
 #include <sys/types.h>
 #include <sys/stat.h>
 #include <sys/prctl.h>
 #include <init_file.h>
+#include <securec.h>
 #include <hilog/log.h>
 #include <log_utils.h>
 
@@ -36,9 +40,19 @@ namespace HiviewDFX {
 using namespace std;
 
 constexpr int OPEN_KMSG_TIME = 3000; // 3s
-constexpr int RETRY_WAIT = 10; // 10us
+constexpr int KMSG_POLL_TIMEOUT = 1000; // 1s, bounds how long Stop waits for the reading thread
+constexpr size_t KMSG_BATCH_COUNT = 64;
+constexpr std::chrono::milliseconds KMSG_FULL_WAIT(100);
 const char* PROC_KMSG = "/proc/kmsg";
 const char* DEV_KMSG = "/dev/kmsg";
+const char* BOOT_ID_PATH = "/proc/sys/kernel/random/boot_id";
+static const std::string KMSG_RESUME_PATH = std::string(HILOG_FILE_DIR) + KMSG_RESUME_INFO;
+constexpr std::chrono::seconds KMSG_SEQ_SAVE_INTERVAL(1);
+
+using KmsgResumeInfo = struct {
+    char bootId[40]; /* uuid text with its '\0', padded */
+    uint64_t seq; /* last record ingested */
+};
 
 LogKmsg& LogKmsg::GetInstance(HilogBuffer& hilogBuffer)
 {
@@ -46,36 +60,146 @@ LogKmsg& LogKmsg::GetInstance(HilogBuffer& hilogBuffer)
     return logKmsg;
 }
 
-ssize_t LogKmsg::LinuxReadOneKmsg(KmsgParser& parser)
+ssize_t LogKmsg::LinuxReadKmsgBatch(KmsgParser& parser)
 {
-    std::vector<char> kmsgBuffer(BUFSIZ, '\0');
-    ssize_t size = -1;
-    do {
-        size = read(kmsgCtl, kmsgBuffer.data(), BUFSIZ - 1);
-    } while (size < 0 && errno == EPIPE);
-    if (size > 0) {
-        std::optional<HilogMsgWrapper> msgWrap = parser.ParseKmsg(kmsgBuffer);
-        if (msgWrap.has_value()) {
-            bool isFull = false;
-            hilogBuffer.Insert(msgWrap->GetHilogMsg(), isFull);
-            while (isFull) {
-                usleep(RETRY_WAIT);
-                hilogBuffer.Insert(msgWrap->GetHilogMsg(), isFull);
+    struct pollfd pfd = {kmsgCtl, POLLIN, 0};
+    int ret = poll(&pfd, 1, KMSG_POLL_TIMEOUT);
+    if (ret <= 0) {
+        return (ret == 0 || errno == EINTR) ? 0 : -1;
+    }
+    // Drain what is pending into one batch, so the log buffer is locked once per wakeup
+    ssize_t total = 0;
+    for (size_t i = 0; i < KMSG_BATCH_COUNT; i++) {
+        ssize_t size = -1;
+        do {
+            size = read(kmsgCtl, readBuffer.data(), readBuffer.size() - 1);
+        } while (size < 0 && errno == EPIPE);
+        if (size <= 0) {
+            if (total == 0 && size < 0 && errno != EAGAIN && errno != EINTR) {
+                total = -1;
+            }
+            break;
+        }
+        total += size;
+        // One /dev/kmsg read is one record, a /proc/kmsg read may hold several lines
+        std::string_view data(readBuffer.data(), size);
+        while (!data.empty()) {
+            const HilogMsg *msg = parser.ParseNext(data);
+            if (msg == nullptr) {
+                continue;
+            }
+            if (!batch.Append(*msg)) {
+                FlushKmsgBatch();
+                if (!batch.Append(*msg)) {
+                    continue;
+                }
             }
+            batchSeqs.push_back(parser.GetLastSeq());
         }
     }
-    return size;
+    FlushKmsgBatch();
+    return total;
+}
+
+void LogKmsg::FlushKmsgBatch()
+{
+    // Kmsg buffer doesn't skip logs, when a reader holds the oldest log wait for it to move on
+    size_t next = 0;
+    while (next < batch.Count() && threadStatus != STOP) {
+        uint64_t progress = hilogBuffer.GetReadProgress();
+        next = hilogBuffer.InsertBatch(batch, next);
+        if (next < batch.Count()) {
+            hilogBuffer.WaitReadProgress(progress, KMSG_FULL_WAIT);
+        }
+    }
+    // Stopping drops what wasn't inserted, those records are read again by the next reader
+    if (next > 0 && next <= batchSeqs.size()) {
+        insertedSeq = batchSeqs[next - 1];
+    }
+    batch.Clear();
+    batchSeqs.clear();
+}
+
+static std::string GetBootId()
+{
+    std::ifstream file(BOOT_ID_PATH);
+    std::string bootId;
+    if (!std::getline(file, bootId)) {
+        return "";
+    }
+    return bootId;
+}
+
+// /dev/kmsg keeps the kernel ring, a restarted reader skips what it already ingested in this boot
+void LogKmsg::LoadKmsgSeq(KmsgParser& parser)
+{
+    bootId = GetBootId();
+    if (bootId.empty()) {
+        return;
+    }
+    FILE* infile = fopen(KMSG_RESUME_PATH.c_str(), "r");
+    if (infile == nullptr) {
+        return;
+    }
+    KmsgResumeInfo info = { 0 };
+    uint64_t hashSum = 0;
+    bool readOk = fread(&info, sizeof(info), 1, infile) == 1 && fread(&hashSum, sizeof(hashSum), 1, infile) == 1;
+    fclose(infile);
+    if (!readOk || hashSum != GenerateHash(reinterpret_cast<char *>(&info), sizeof(info))) {
+        std::cout << "Kmsg resume info checksum failed" << std::endl;
+        return;
+    }
+    // Sequence numbers start over with each boot
+    if (strncmp(info.bootId, bootId.c_str(), sizeof(info.bootId)) != 0) {
+        return;
+    }
+    parser.SetLastSeq(info.seq);
+    savedSeq = info.seq;
+    insertedSeq = info.seq;
+    std::cout << "Resume kmsg after seq " << info.seq << std::endl;
+}
+
+// Written at most once per interval, a crash re-reads the records of the last interval
+void LogKmsg::SaveKmsgSeq(uint64_t seq, bool force)
+{
+    auto now = std::chrono::steady_clock::now();
+    if (bootId.empty() || seq == KmsgParser::NO_SEQ || seq == savedSeq ||
+        (!force && now - lastSaveTime < KMSG_SEQ_SAVE_INTERVAL)) {
+        return;
+    }
+    KmsgResumeInfo info = { 0 };
+    if (strncpy_s(info.bootId, sizeof(info.bootId), bootId.c_str(), sizeof(info.bootId) - 1) != EOK) {
+        return;
+    }
+    info.seq = seq;
+    uint64_t hash = GenerateHash(reinterpret_cast<char *>(&info), sizeof(info));
+    FILE* outfile = fopen(KMSG_RESUME_PATH.c_str(), "w");
+    if (outfile == nullptr) {
+        return;
+    }
+    bool writeOk = fwrite(&info, sizeof(info), 1, outfile) == 1 && fwrite(&hash, sizeof(hash), 1, outfile) == 1;
+    if (fclose(outfile) == 0 && writeOk) {
+        savedSeq = seq;
+    }
+    lastSaveTime = now;
 }
 
 int LogKmsg::LinuxReadAllKmsg()
 {
     ssize_t rdFailTimes = 0;
     const ssize_t maxFailTime = 10;
-    if (access(PROC_KMSG, R_OK) != 0) {
+    std::unique_ptr<KmsgParser> parser = std::make_unique<KmsgParser>();
+    if (parser == nullptr) {
+        return -1;
+    }
+    // Reading /proc/kmsg consumes the records, only /dev/kmsg gives them again
+    bool isDevKmsg = access(PROC_KMSG, R_OK) != 0;
+    if (isDevKmsg) {
         this->kmsgCtl = GetControlFile(DEV_KMSG);
         if (this->kmsgCtl < 0) {
             return RET_FAIL;
         }
+        LoadKmsgSeq(*parser);
     } else {
         int ret = WaitingToDo(OPEN_KMSG_TIME, PROC_KMSG, [this] (const string &path) {
             this->kmsgCtl = open(path.c_str(), O_RDONLY);
@@ -90,28 +214,37 @@ int LogKmsg::LinuxReadAllKmsg()
         }
     }
 
-    std::cout << "Open kmsg success." << std::endl;
-    std::unique_ptr<KmsgParser> parser = std::make_unique<KmsgParser>();
-    if (parser == nullptr) {
-        return -1;
+    int flags = fcntl(this->kmsgCtl, F_GETFL);
+    if (flags < 0 || fcntl(this->kmsgCtl, F_SETFL, flags | O_NONBLOCK) < 0) {
+        std::cout << "Cannot set kmsg nonblock " << errno << std::endl;
+        return RET_FAIL;
     }
+    std::cout << "Open kmsg success." << std::endl;
+    int ret = 1;
     while (true) {
         if (threadStatus == STOP) {
             break;
         }
-        ssize_t sz = LinuxReadOneKmsg(*parser);
+        ssize_t sz = LinuxReadKmsgBatch(*parser);
+        if (isDevKmsg) {
+            SaveKmsgSeq(insertedSeq, false);
+        }
         if (sz < 0) {
             rdFailTimes++;
             if (maxFailTime < rdFailTimes) {
                 std::cout << "Read kmsg failed more than maxFailTime" << std::endl;
-                return -1;
+                ret = -1;
+                break;
             }
             sleep(1);
             continue;
         }
         rdFailTimes = 0;
     }
-    return 1;
+    if (isDevKmsg) {
+        SaveKmsgSeq(insertedSeq, true);
+    }
+    return ret;
 }
 
 void LogKmsg::ReadAllKmsg()
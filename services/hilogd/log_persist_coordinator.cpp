@@ -0,0 +1,215 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_persist_coordinator.h"
+
+#include <sys/prctl.h>
+
+#include <iostream>
+#include <map>
+#include <string>
+
+#include "log_persister.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+static const std::chrono::seconds MAX_LOG_WRITE_INTERVAL(5);
+static const std::chrono::milliseconds PERSIST_WAKE_DELAY(1000);
+
+static bool IsEmptyThread(const std::thread& th)
+{
+    static const std::thread EMPTY_THREAD;
+    return th.get_id() == EMPTY_THREAD.get_id();
+}
+
+static LogFilter AllLogsFilter()
+{
+    LogFilter filter = { 0 };
+    filter.types = static_cast<uint16_t>(~0);
+    filter.levels = static_cast<uint16_t>(~0);
+    return filter;
+}
+
+LogPersistCoordinator& LogPersistCoordinator::GetInstance(HilogBuffer& buffer)
+{
+    // Never destroyed, their threads run as long as hilogd does
+    static std::mutex mtx;
+    static std::map<const HilogBuffer*, LogPersistCoordinator*>* coordinators =
+        new std::map<const HilogBuffer*, LogPersistCoordinator*>();
+    std::lock_guard<std::mutex> lock(mtx);
+    LogPersistCoordinator*& coordinator = (*coordinators)[&buffer];
+    if (coordinator == nullptr) {
+        coordinator = new LogPersistCoordinator(buffer);
+    }
+    return *coordinator;
+}
+
+// The shared reader reads every type, jobs pick theirs by their own filters
+LogPersistCoordinator::LogPersistCoordinator(HilogBuffer& buffer) : m_hilogBuffer(buffer), m_filter(AllLogsFilter())
+{
+}
+
+void LogPersistCoordinator::Attach(const std::shared_ptr<LogPersister>& job)
+{
+    {
+        std::lock_guard<decltype(m_jobsMtx)> lock(m_jobsMtx);
+        if (m_bufReader == 0) {
+            m_bufReader = m_hilogBuffer.CreateBufReader([this]() { NotifyNewLogAvailable(); });
+        } else if (uint64_t endSeq = m_hilogBuffer.GetReaderSeq(m_bufReader); endSeq > 0) {
+            // The job gets the logs the shared reader passed already on its own, up to where it stands
+            HilogBuffer::ReaderId catchUpReader = m_hilogBuffer.CreateBufReader([]() {});
+            while (m_hilogBuffer.Query(*job->m_filter, catchUpReader, m_batch, 0, endSeq) > 0) {
+                job->WriteLogBatch(m_batch);
+            }
+            m_hilogBuffer.RemoveBufReader(catchUpReader);
+        }
+        m_jobs.push_back({ job, std::chrono::steady_clock::now() });
+        if (IsEmptyThread(m_readThread)) {
+            m_readThread = std::thread([this]() { ReadLoop(); });
+        }
+    }
+    NotifyNewLogAvailable();
+}
+
+void LogPersistCoordinator::Detach(const LogPersister* job)
+{
+    std::list<PersistJob> detached; // released unlocked, it may hold the last reference
+    std::lock_guard<decltype(m_jobsMtx)> lock(m_jobsMtx);
+    for (auto it = m_jobs.begin(); it != m_jobs.end();) {
+        auto next = std::next(it);
+        if (it->persister.get() == job) {
+            detached.splice(detached.end(), m_jobs, it);
+        }
+        it = next;
+    }
+    if (m_jobs.empty() && m_bufReader != 0) {
+        // A reader nobody needs would hold a full buffer back
+        m_hilogBuffer.RemoveBufReader(m_bufReader);
+        m_bufReader = 0;
+    }
+}
+
+void LogPersistCoordinator::Refresh(LogPersister& job)
+{
+    // The job catches up first, unlocked, so the logs handed over now have room
+    job.WaitPipelineIdle();
+    std::lock_guard<decltype(m_jobsMtx)> lock(m_jobsMtx);
+    (void)ReadOnce();
+    (void)job.FlushPlainLogs(false);
+}
+
+void LogPersistCoordinator::NotifyNewLogAvailable()
+{
+    {
+        std::lock_guard<decltype(m_wakeMtx)> lk(m_wakeMtx);
+        m_wake = true;
+    }
+    m_wakeCv.notify_one();
+}
+
+// Woken once per batch worth of logs rather than per log, a trickle waits at most the wake delay.
+// Without jobs there is nothing to read or flush, Attach() wakes the thread.
+void LogPersistCoordinator::WaitNewLogs()
+{
+    bool hasJobs = false;
+    {
+        std::lock_guard<decltype(m_jobsMtx)> lock(m_jobsMtx);
+        if (m_bufReader != 0) {
+            m_hilogBuffer.ParkReader(m_bufReader, LogBatch::DEFAULT_BATCH_COUNT);
+            hasJobs = true;
+        }
+    }
+    std::unique_lock<decltype(m_wakeMtx)> lk(m_wakeMtx);
+    if (hasJobs) {
+        (void)m_wakeCv.wait_for(lk, PERSIST_WAKE_DELAY, [this]() { return m_wake; });
+    } else {
+        m_wakeCv.wait(lk, [this]() { return m_wake; });
+    }
+    m_wake = false;
+}
+
+void LogPersistCoordinator::ReadLoop()
+{
+    prctl(PR_SET_NAME, "hilogd.pst");
+    for (;;) {
+        size_t count = 0;
+        {
+            std::lock_guard<decltype(m_jobsMtx)> lock(m_jobsMtx);
+            count = ReadOnce();
+            if (count == 0) {
+                FlushIdleJobs();
+            }
+        }
+        if (count == 0) {
+            WaitNewLogs();
+        }
+    }
+}
+
+size_t LogPersistCoordinator::ReadOnce()
+{
+    if (m_bufReader == 0) {
+        return 0;
+    }
+    size_t count = m_hilogBuffer.Query(m_filter, m_bufReader, m_batch);
+    if (count > 0) {
+        DispatchBatch();
+    }
+    return count;
+}
+
+void LogPersistCoordinator::DispatchBatch()
+{
+    auto now = std::chrono::steady_clock::now();
+    std::string formatedLog;
+    for (size_t i = 0; i < m_batch.Count(); i++) {
+        const HilogMsg& msg = m_batch.At(i);
+        bool formated = false;
+        for (auto& job : m_jobs) {
+            LogPersister& persister = *job.persister;
+            if (!persister.m_filter->Match(msg)) {
+                continue;
+            }
+            if (!persister.m_binaryRecords && !formated) {
+                LogPersister::FormatLog(msg, formatedLog);
+                formated = true;
+            }
+            if (persister.WriteLogData(msg, formatedLog, false)) {
+                job.droppedLines++;
+                continue;
+            }
+            if (job.droppedLines > 0) {
+                std::cerr << " Persist job " << persister.m_startMsg.jobId << " fell behind, " <<
+                    job.droppedLines << " logs dropped\n";
+                job.droppedLines = 0;
+            }
+            job.lastLogTime = now;
+        }
+    }
+}
+
+void LogPersistCoordinator::FlushIdleJobs()
+{
+    auto now = std::chrono::steady_clock::now();
+    for (auto& job : m_jobs) {
+        // A job still busy with its earlier chunks is tried again next time
+        if (now - job.lastLogTime >= MAX_LOG_WRITE_INTERVAL && job.persister->FlushPlainLogs(false)) {
+            std::cout << "no log timeout, write log forcely" << std::endl;
+            job.lastLogTime = now;
+        }
+    }
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -17,7 +17,6 @@
 
 #include <sys/mman.h>
 #include <sys/stat.h>
-#include <sys/prctl.h>
 
 #include <fcntl.h>
 #include <securec.h>
@@ -39,21 +38,44 @@
 #include <unistd.h>
 
 #include <hilog_common.h>
+#include <hilog_persist.h>
 #include <log_buffer.h>
 #include <log_compress.h>
 #include <log_print.h>
 #include <log_utils.h>
 
+#include "log_persist_coordinator.h"
+#include "log_persister_pool.h"
+
 namespace OHOS {
 namespace HiviewDFX {
 using namespace std;
 
-static const int MAX_LOG_WRITE_INTERVAL = 5;
+// room left in the index buffer for the container around the index
+static constexpr uint32_t INDEX_CONTAINER_RESERVED = 64;
+static constexpr size_t MAX_INDEX_ENTRIES = (MAX_PERSISTER_BUFFER_SIZE - INDEX_CONTAINER_RESERVED -
+    sizeof(PersistIndexTrailer)) / sizeof(PersistIndexEntry);
+
+static bool IsEarlier(uint32_t sec, uint32_t nsec, uint32_t otherSec, uint32_t otherNsec)
+{
+    return sec < otherSec || (sec == otherSec && nsec < otherNsec);
+}
 
-static bool IsEmptyThread(const std::thread& th)
+// Adds the lines of next to entry, the caller sets the compressed range
+static void MergeIndexEntry(PersistIndexEntry& entry, const PersistIndexEntry& next)
 {
-    static const std::thread EMPTY_THREAD;
-    return th.get_id() == EMPTY_THREAD.get_id();
+    if (next.count == 0) {
+        return;
+    }
+    if (entry.count == 0 || IsEarlier(next.minSec, next.minNsec, entry.minSec, entry.minNsec)) {
+        entry.minSec = next.minSec;
+        entry.minNsec = next.minNsec;
+    }
+    if (entry.count == 0 || IsEarlier(entry.maxSec, entry.maxNsec, next.maxSec, next.maxNsec)) {
+        entry.maxSec = next.maxSec;
+        entry.maxNsec = next.maxNsec;
+    }
+    entry.count += next.count;
 }
 
 std::recursive_mutex LogPersister::s_logPersistersMtx;
@@ -67,23 +89,19 @@ std::shared_ptr<LogPersister> LogPersister::CreateLogPersister(HilogBuffer &buff
 LogPersister::LogPersister(HilogBuffer &buffer) : m_hilogBuffer(buffer)
 {
     m_mappedPlainLogFile = nullptr;
-    m_bufReader = m_hilogBuffer.CreateBufReader([this]() { NotifyNewLogAvailable(); });
     m_startMsg = { 0 };
 }
 
 LogPersister::~LogPersister()
 {
-    m_hilogBuffer.RemoveBufReader(m_bufReader);
     Deinit();
 }
 
 int LogPersister::InitCompression()
 {
-    m_compressBuffer = std::make_unique<LogPersisterBuffer>();
-    if (!m_compressBuffer) {
-        return RET_FAIL;
-    }
-    switch (m_startMsg.compressAlg) {
+    m_compressBuffers.resize(PERSIST_SLOT_NUM);
+    m_binaryRecords = (m_startMsg.compressAlg & PERSIST_BINARY_FLAG) != 0;
+    switch (m_startMsg.compressAlg & ~PERSIST_BINARY_FLAG) {
         case COMPRESS_TYPE_NONE:
             m_compressor = std::make_unique<NoneCompress>();
             break;
@@ -105,7 +123,7 @@ int LogPersister::InitCompression()
 int LogPersister::InitFileRotator(const PersistRecoveryInfo& info, bool restore)
 {
     std::string fileSuffix = "";
-    switch (m_startMsg.compressAlg) {
+    switch (m_startMsg.compressAlg & ~PERSIST_BINARY_FLAG) {
         case CompressAlg::COMPRESS_TYPE_ZSTD:
             fileSuffix = ".zst";
             break;
@@ -150,6 +168,7 @@ int LogPersister::Init(const PersistRecoveryInfo& info, bool restore)
     if (CheckRegistered(m_startMsg.jobId, path)) {
         return ERR_LOG_PERSIST_TASK_EXISTED;
     }
+    m_filter = std::make_unique<CompiledLogFilter>(m_startMsg.filter);
     if (InitCompression() !=  RET_SUCCESS) {
         return ERR_LOG_PERSIST_COMPRESS_INIT_FAIL;
     }
@@ -177,8 +196,11 @@ int LogPersister::Deinit()
     }
 
     Stop();
+    WaitPipelineIdle();
+    FinishOpenFrame();
+    FinishCompressedFile();
 
-    munmap(m_mappedPlainLogFile, sizeof(LogPersisterBuffer));
+    munmap(m_mappedPlainLogFile, sizeof(PersistPlainFile));
     std::cout << "Removing unmapped plain log file: " << m_plainLogFilePath << "\n";
     if (remove(m_plainLogFilePath.c_str())) {
         std::cerr << "File: " << m_plainLogFilePath << " can't be removed. ";
@@ -203,12 +225,20 @@ int LogPersister::PrepareUncompressedFile(const std::string& parentPath, bool re
         return ERR_LOG_PERSIST_FILE_OPEN_FAIL;
     }
 
+    struct stat st;
+    bool knownLayout = fstat(fileno(plainTextFile), &st) == 0 &&
+        static_cast<size_t>(st.st_size) == sizeof(PersistPlainFile);
+    if (restore && !knownLayout) {
+        std::cerr << " Uncompressed log file has an unknown layout, dropping it\n";
+        ftruncate(fileno(plainTextFile), 0);
+        restore = false;
+    }
     if (!restore) {
-        ftruncate(fileno(plainTextFile), sizeof(LogPersisterBuffer));
+        ftruncate(fileno(plainTextFile), sizeof(PersistPlainFile));
         fflush(plainTextFile);
         fsync(fileno(plainTextFile));
     }
-    m_mappedPlainLogFile = reinterpret_cast<LogPersisterBuffer*>(mmap(nullptr, sizeof(LogPersisterBuffer),
+    m_mappedPlainLogFile = reinterpret_cast<PersistPlainFile*>(mmap(nullptr, sizeof(PersistPlainFile),
         PROT_READ | PROT_WRITE, MAP_SHARED, fileno(plainTextFile), 0));
     if (fclose(plainTextFile)) {
         std::cerr << "File: " << plainTextFile << " can't be closed. ";
@@ -220,45 +250,102 @@ int LogPersister::PrepareUncompressedFile(const std::string& parentPath, bool re
         return RET_FAIL;
     }
     if (restore) {
+        // try to store previous uncompressed logs, oldest slot first
+        uint32_t head = m_mappedPlainLogFile->head % PERSIST_SLOT_NUM;
+        for (uint32_t i = 0; i < PERSIST_SLOT_NUM; i++) {
+            uint32_t slot = (head + i) % PERSIST_SLOT_NUM;
 #ifdef DEBUG
-        std::cout << " Recovered persister, Offset=" << m_mappedPlainLogFile->offset << "\n";
+            std::cout << " Recovered persister, slot=" << slot << " Offset="
+                << m_mappedPlainLogFile->slots[slot].offset << "\n";
 #endif
-        // try to store previous uncompressed logs
-        auto compressionResult = m_compressor->Compress(*m_mappedPlainLogFile, *m_compressBuffer);
-        if (compressionResult != 0) {
-            std::cerr << " Compression error. Result:" << compressionResult << "\n";
-            return RET_FAIL;
+            if (m_mappedPlainLogFile->slots[slot].offset == 0) {
+                continue;
+            }
+            CompressChunk(slot);
+            WriteChunk(slot);
         }
-        WriteCompressedLogs();
     } else {
-        m_mappedPlainLogFile->offset = 0;
+        for (auto& slot : m_mappedPlainLogFile->slots) {
+            slot.offset = 0;
+        }
+        for (auto& frame : m_mappedPlainLogFile->frames) {
+            frame = { 0 };
+        }
     }
+    m_mappedPlainLogFile->head = 0;
     return 0;
 }
 
-void LogPersister::NotifyNewLogAvailable()
-{
-    m_receiveLogCv.notify_one();
-}
-
-bool LogPersister::WriteUncompressedLogs(std::string& logLine)
+bool LogPersister::WriteUncompressedLogs(const std::string& logLine)
 {
+    LogPersisterBuffer& plainLogs = m_mappedPlainLogFile->slots[m_filled % PERSIST_SLOT_NUM];
     uint16_t size = logLine.length();
-    uint32_t remainingSpace = MAX_PERSISTER_BUFFER_SIZE - m_mappedPlainLogFile->offset;
+    uint32_t remainingSpace = MAX_PERSISTER_BUFFER_SIZE - plainLogs.offset;
     if (remainingSpace < size) {
         return false;
     }
-    char* currentContentPos = m_mappedPlainLogFile->content + m_mappedPlainLogFile->offset;
+    char* currentContentPos = plainLogs.content + plainLogs.offset;
     int r = memcpy_s(currentContentPos, remainingSpace, logLine.c_str(), logLine.length());
     if (r != 0) {
         std::cout << " Can't copy part of memory!\n";
         return true;
     }
-    m_mappedPlainLogFile->offset += logLine.length();
+    plainLogs.offset += logLine.length();
     return true;
 }
 
-int LogPersister::WriteLogData(const HilogData& logData)
+bool LogPersister::WriteRecord(const HilogMsg& logData)
+{
+    LogPersisterBuffer& plainLogs = m_mappedPlainLogFile->slots[m_filled % PERSIST_SLOT_NUM];
+    PersistBlockHeader* block = reinterpret_cast<PersistBlockHeader*>(plainLogs.content);
+    if (plainLogs.offset == 0) {
+        *block = { PERSIST_BLOCK_MAGIC, PERSIST_BLOCK_VERSION, 0, 0, sizeof(PersistBlockHeader), 0,
+            logData.tv_sec, logData.tv_nsec, logData.tv_sec, logData.tv_nsec };
+        plainLogs.offset = sizeof(PersistBlockHeader);
+    }
+    uint32_t remainingSpace = MAX_PERSISTER_BUFFER_SIZE - plainLogs.offset;
+    if (remainingSpace < logData.len) {
+        return false;
+    }
+    HilogMsg* record = reinterpret_cast<HilogMsg*>(plainLogs.content + plainLogs.offset);
+    if (memcpy_s(record, remainingSpace, &logData, logData.len) != 0) {
+        std::cout << " Can't copy part of memory!\n";
+        return true;
+    }
+    record->version = HILOG_MSG_VERSION_TEXT;
+    plainLogs.offset += logData.len;
+
+    block->len = plainLogs.offset;
+    block->count++;
+    block->types |= static_cast<uint16_t>(0b01 << logData.type);
+    block->levels |= static_cast<uint16_t>(0b01 << logData.level);
+    if (logData.tv_sec < block->minSec || (logData.tv_sec == block->minSec && logData.tv_nsec < block->minNsec)) {
+        block->minSec = logData.tv_sec;
+        block->minNsec = logData.tv_nsec;
+    }
+    if (logData.tv_sec > block->maxSec || (logData.tv_sec == block->maxSec && logData.tv_nsec > block->maxNsec)) {
+        block->maxSec = logData.tv_sec;
+        block->maxNsec = logData.tv_nsec;
+    }
+    return true;
+}
+
+void LogPersister::AddToFrameInfo(const HilogMsg& logData)
+{
+    PersistIndexEntry& frame = m_mappedPlainLogFile->frames[m_filled % PERSIST_SLOT_NUM];
+    if (frame.count == 0 || IsEarlier(logData.tv_sec, logData.tv_nsec, frame.minSec, frame.minNsec)) {
+        frame.minSec = logData.tv_sec;
+        frame.minNsec = logData.tv_nsec;
+    }
+    if (frame.count == 0 || IsEarlier(frame.maxSec, frame.maxNsec, logData.tv_sec, logData.tv_nsec)) {
+        frame.maxSec = logData.tv_sec;
+        frame.maxNsec = logData.tv_nsec;
+    }
+    frame.count++;
+}
+
+// Persisted text has one format, so a log is formatted once for all the text jobs it goes to
+void LogPersister::FormatLog(const HilogMsg& logData, std::string& formatedLog)
 {
     LogContent content = {
         .level = logData.level,
@@ -270,7 +357,7 @@ int LogPersister::WriteLogData(const HilogData& logData)
         .tv_nsec = logData.tv_nsec,
         .mono_sec = logData.mono_sec,
         .tag = logData.tag,
-        .log = logData.content
+        .log = CONTENT_PTR((&logData))
     };
     LogFormat format = {
         .colorful = false,
@@ -281,35 +368,217 @@ int LogPersister::WriteLogData(const HilogData& logData)
     };
     std::ostringstream oss;
     LogPrintWithFormat(content, format, oss);
-    std::string formatedLogStr = oss.str();
-    // Firstly gather uncompressed logs in auxiliary file
-    if (WriteUncompressedLogs(formatedLogStr))
+    formatedLog = oss.str();
+}
+
+int LogPersister::WriteLogData(const HilogMsg& logData, const std::string& formatedLog, bool wait)
+{
+    if (m_binaryRecords) {
+        // Records are rendered by hilog -I when the file is read, nothing is formatted here
+        if (!WriteRecord(logData)) {
+            if (!HandOffChunk(wait) || !WriteRecord(logData)) {
+                return RET_FAIL;
+            }
+        }
+        AddToFrameInfo(logData);
         return 0;
-    // Try to compress auxiliary file
-    auto compressionResult = m_compressor->Compress(*m_mappedPlainLogFile, *m_compressBuffer);
-    if (compressionResult != 0) {
-        std::cerr <<  " Compression error. Result:" << compressionResult << "\n";
-        return RET_FAIL;
     }
-    // Write compressed buffor and clear counters
-    WriteCompressedLogs();
-    // Try again write data that wasn't written at the beginning
-    // If again fail then these logs are skipped
-    return WriteUncompressedLogs(formatedLogStr) ? 0 : RET_FAIL;
+    // Firstly gather uncompressed logs in auxiliary file
+    if (!WriteUncompressedLogs(formatedLog)) {
+        // Pass the full slot on to be compressed and written, and continue in the next one
+        // Try again write data that wasn't written at the beginning
+        // If again fail then these logs are skipped
+        if (!HandOffChunk(wait) || !WriteUncompressedLogs(formatedLog)) {
+            return RET_FAIL;
+        }
+    }
+    AddToFrameInfo(logData);
+    return 0;
 }
 
-inline void LogPersister::WriteCompressedLogs()
+// Queues the current slot for compression and waits until the next slot is free again. Without wait
+// the slot is only queued if the next one is free already, false means it's kept.
+bool LogPersister::HandOffChunk(bool wait)
 {
-    if (m_mappedPlainLogFile->offset == 0)
-        return;
-    m_fileRotator->Input(m_compressBuffer->content, m_compressBuffer->offset);
-    m_plainLogSize += m_mappedPlainLogFile->offset;
+    std::unique_lock<decltype(m_pipelineMtx)> lk(m_pipelineMtx);
+    if (!wait && m_filled + 1 - m_written >= PERSIST_SLOT_NUM) {
+        return false;
+    }
+    m_filled++;
+    if (!m_compressing) {
+        m_compressing = true;
+        LogPersisterPool::GetInstance().Schedule([shared = shared_from_this()]() { shared->CompressLoop(); });
+    }
+    m_pipelineCv.wait(lk, [this]() { return m_filled - m_written < PERSIST_SLOT_NUM; });
+    return true;
+}
+
+bool LogPersister::FlushPlainLogs(bool wait)
+{
+    if (m_mappedPlainLogFile->slots[m_filled % PERSIST_SLOT_NUM].offset > 0) {
+        return HandOffChunk(wait);
+    }
+    return true;
+}
+
+void LogPersister::WaitPipelineIdle()
+{
+    std::unique_lock<decltype(m_pipelineMtx)> lk(m_pipelineMtx);
+    m_pipelineCv.wait(lk, [this]() { return m_written == m_filled; });
+}
+
+// Runs on the pool, chunks of one persister are compressed in order by one worker at a time
+void LogPersister::CompressLoop()
+{
+    std::unique_lock<decltype(m_pipelineMtx)> lk(m_pipelineMtx);
+    while (m_compressed < m_filled) {
+        uint32_t slot = m_compressed % PERSIST_SLOT_NUM;
+        lk.unlock();
+        CompressChunk(slot);
+        lk.lock();
+        m_compressed++;
+        if (!m_writing) {
+            m_writing = true;
+            LogPersisterPool::GetInstance().Schedule([shared = shared_from_this()]() { shared->WriteLoop(); });
+        }
+    }
+    m_compressing = false;
+}
+
+// Runs on the pool alongside the compression of the following chunks
+void LogPersister::WriteLoop()
+{
+    std::unique_lock<decltype(m_pipelineMtx)> lk(m_pipelineMtx);
+    while (m_written < m_compressed) {
+        uint32_t slot = m_written % PERSIST_SLOT_NUM;
+        lk.unlock();
+        WriteChunk(slot);
+        lk.lock();
+        m_written++;
+        m_pipelineCv.notify_all();
+    }
+    m_writing = false;
+}
+
+void LogPersister::CompressChunk(uint32_t slot)
+{
+    LogPersisterBuffer& plainLogs = m_mappedPlainLogFile->slots[slot];
+    LogCompressBuffer& compressed = m_compressBuffers[slot];
+    compressed.offset = 0;
+    // Chunks are flushed into the open frame, which ends after PERSIST_FRAME_SIZE of logs or with the file,
+    // so any frame of the file can be inflated without the others
+    auto compressionResult = m_compressor->Compress(plainLogs, compressed);
+    m_framePlainSize += plainLogs.offset;
+    m_plainLogSize += plainLogs.offset;
     if (m_plainLogSize >= m_startMsg.fileSize) {
         m_plainLogSize = 0;
-        m_fileRotator->FinishInput();
+        m_rotateAfter[slot] = true;
+    }
+    if (compressionResult == 0 && (m_framePlainSize >= PERSIST_FRAME_SIZE || m_rotateAfter[slot])) {
+        compressionResult = m_compressor->Finish(compressed);
+        m_frameEnds[slot] = true;
+        m_framePlainSize = 0;
+    }
+    if (compressionResult != 0) {
+        std::cerr << " Compression error. Result:" << compressionResult << "\n";
+        compressed.offset = 0;
+        // The compressor starts a new stream, the frame ends with what is written of it
+        m_frameEnds[slot] = true;
+        m_framePlainSize = 0;
+    }
+}
+
+void LogPersister::WriteChunk(uint32_t slot)
+{
+    LogCompressBuffer& compressed = m_compressBuffers[slot];
+    PersistIndexEntry& chunk = m_mappedPlainLogFile->frames[slot];
+    if (compressed.offset > 0 && m_fileRotator->Input(compressed.content.data(), compressed.offset) == 0) {
+        if (m_frame.len == 0) {
+            m_frame.offset = m_fileOffset;
+        }
+        m_frame.len += compressed.offset;
+        MergeIndexEntry(m_frame, chunk);
+        m_fileOffset += compressed.offset;
+    }
+    compressed.offset = 0;
+    if (m_frameEnds[slot]) {
+        m_frameEnds[slot] = false;
+        EndFrame();
+    }
+    if (m_rotateAfter[slot]) {
+        m_rotateAfter[slot] = false;
+        FinishCompressedFile();
+    }
+    chunk = { 0 };
+    m_mappedPlainLogFile->slots[slot].offset = 0;
+    m_mappedPlainLogFile->head = (slot + 1) % PERSIST_SLOT_NUM;
+}
+
+void LogPersister::EndFrame()
+{
+    if (m_frame.len > 0) {
+        m_fileIndex.push_back(m_frame);
+    }
+    m_frame = { 0 };
+}
+
+// Ends the frame the compressor still has open, only while the pipeline is idle
+void LogPersister::FinishOpenFrame()
+{
+    if (m_framePlainSize == 0) {
+        return;
+    }
+    m_framePlainSize = 0;
+    m_tailBuffer.offset = 0;
+    if (m_compressor->Finish(m_tailBuffer) == 0 && m_tailBuffer.offset > 0 &&
+        m_fileRotator->Input(m_tailBuffer.content.data(), m_tailBuffer.offset) == 0) {
+        m_frame.len += m_tailBuffer.offset;
+        m_fileOffset += m_tailBuffer.offset;
+    }
+    EndFrame();
+}
+
+// Ends the current file with the index of its frames
+void LogPersister::FinishCompressedFile()
+{
+    EndFrame();
+    if (!m_fileIndex.empty()) {
+        AppendFileIndex();
+    }
+    m_fileIndex.clear();
+    m_fileOffset = 0;
+    m_fileRotator->FinishInput();
+}
+
+void LogPersister::AppendFileIndex()
+{
+    // Neighbouring frames share an entry when the index of a very large file wouldn't fit
+    while (m_fileIndex.size() > MAX_INDEX_ENTRIES) {
+        size_t merged = 0;
+        for (size_t i = 0; i < m_fileIndex.size(); i += 2, merged++) {
+            PersistIndexEntry entry = m_fileIndex[i];
+            if (i + 1 < m_fileIndex.size()) {
+                const PersistIndexEntry& next = m_fileIndex[i + 1];
+                entry.len = next.offset + next.len - entry.offset;
+                MergeIndexEntry(entry, next);
+            }
+            m_fileIndex[merged] = entry;
+        }
+        m_fileIndex.resize(merged);
+    }
+    PersistIndexTrailer trailer = { static_cast<uint32_t>(m_fileIndex.size()), PERSIST_INDEX_VERSION,
+        PERSIST_INDEX_MAGIC };
+    std::string index(reinterpret_cast<const char*>(m_fileIndex.data()),
+        m_fileIndex.size() * sizeof(PersistIndexEntry));
+    index.append(reinterpret_cast<const char*>(&trailer), sizeof(trailer));
+    m_tailBuffer.offset = 0;
+    if (m_compressor->AppendIndex(index.data(), index.length(), m_tailBuffer) != 0) {
+        std::cerr << " Can't append the file index\n";
+        return;
+    }
+    if (m_tailBuffer.offset > 0) {
+        m_fileRotator->Input(m_tailBuffer.content.data(), m_tailBuffer.offset);
     }
-    m_compressBuffer->offset = 0;
-    m_mappedPlainLogFile->offset = 0;
 }
 
 void LogPersister::Start()
@@ -320,45 +589,27 @@ void LogPersister::Start()
             std::cerr << " Log persister wasn't inited!\n";
             return;
         }
+        if (m_attached) {
+            std::cout << " Persister already started!\n";
+            return;
+        }
+        m_attached = true;
     }
-
-    if (IsEmptyThread(m_persisterThread)) {
-        m_persisterThread = std::thread([shared = shared_from_this()]() {
-            shared->ReceiveLogLoop();
-        });
-    } else {
-        std::cout << " Persister thread already started!\n";
-    }
+    LogPersistCoordinator::GetInstance(m_hilogBuffer).Attach(shared_from_this());
 }
 
-int LogPersister::ReceiveLogLoop()
+// Logs read for this job alone, each one is formatted here
+void LogPersister::WriteLogBatch(const LogBatch& batch)
 {
-    prctl(PR_SET_NAME, "hilogd.pst");
-    std::cout << "Persist ReceiveLogLoop " << std::this_thread::get_id() << "\n";
-    for (;;) {
-        if (m_stopThread) {
-            break;
+    std::string formatedLog;
+    for (size_t i = 0; i < batch.Count(); i++) {
+        if (!m_binaryRecords) {
+            FormatLog(batch.At(i), formatedLog);
         }
-        std::optional<HilogData> data = m_hilogBuffer.Query(m_startMsg.filter, m_bufReader);
-        if (data.has_value()) {
-            if (WriteLogData(data.value())) {
-                std::cerr << " Can't write new log data!\n";
-            }
-        } else {
-            std::unique_lock<decltype(m_receiveLogCvMtx)> lk(m_receiveLogCvMtx);
-            static const std::chrono::seconds waitTime(MAX_LOG_WRITE_INTERVAL);
-            if (cv_status::timeout == m_receiveLogCv.wait_for(lk, waitTime)) {
-                std::cout << "no log timeout, write log forcely" << std::endl;
-                (void)m_compressor->Compress(*m_mappedPlainLogFile, *m_compressBuffer);
-                WriteCompressedLogs();
-            }
+        if (WriteLogData(batch.At(i), formatedLog)) {
+            std::cerr << " Can't write new log data!\n";
         }
     }
-    // try to compress the remaining log in cache
-    (void)m_compressor->Compress(*m_mappedPlainLogFile, *m_compressBuffer);
-    WriteCompressedLogs();
-    m_fileRotator->FinishInput();
-    return 0;
 }
 
 int LogPersister::Query(std::list<LogPersistQueryResult> &results)
@@ -397,39 +648,22 @@ int LogPersister::Kill(uint32_t id)
 void LogPersister::Stop()
 {
     std::cout << "Exiting LogPersister!\n";
-    if (IsEmptyThread(m_persisterThread)) {
-        std::cout << "Thread was exited or not started!\n";
+    if (!m_attached) {
+        std::cout << "Persister was stopped or not started!\n";
         return;
     }
-
-    m_stopThread = true;
-    m_receiveLogCv.notify_all();
-
-    if (m_persisterThread.joinable()) {
-        m_persisterThread.join();
-    }
+    LogPersistCoordinator::GetInstance(m_hilogBuffer).Detach(this);
+    m_attached = false;
+    // try to compress the remaining log in cache
+    FlushPlainLogs();
+    WaitPipelineIdle();
 }
 
 int LogPersister::Refresh(uint32_t id)
 {
     auto logPersisterPtr = GetLogPersisterById(id);
     if (logPersisterPtr) {
-        std::optional<HilogData> data = logPersisterPtr->m_hilogBuffer.Query(logPersisterPtr->m_startMsg.filter,
-            logPersisterPtr->m_bufReader);
-        if (data.has_value()) {
-            if (logPersisterPtr->WriteLogData(data.value())) {
-                std::cerr << " Can't write new log data!\n";
-            }
-        } else {
-            std::unique_lock<decltype(logPersisterPtr->m_receiveLogCvMtx)> lk(logPersisterPtr->m_receiveLogCvMtx);
-            static const std::chrono::seconds waitTime(MAX_LOG_WRITE_INTERVAL);
-            if (cv_status::timeout == logPersisterPtr->m_receiveLogCv.wait_for(lk, waitTime)) {
-                std::cout << "no log timeout, write log forcely" << std::endl;
-                (void)logPersisterPtr->m_compressor->Compress(*(logPersisterPtr->m_mappedPlainLogFile),
-                    *(logPersisterPtr->m_compressBuffer));
-                logPersisterPtr->WriteCompressedLogs();
-            }
-        }
+        LogPersistCoordinator::GetInstance(logPersisterPtr->m_hilogBuffer).Refresh(*logPersisterPtr);
         return 0;
     }
     std::cerr << " Log persister with id: " << id << " does not exist.\n";
@@ -0,0 +1,76 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_persister_pool.h"
+
+#include <sys/prctl.h>
+
+namespace OHOS {
+namespace HiviewDFX {
+LogPersisterPool& LogPersisterPool::GetInstance()
+{
+    static LogPersisterPool pool;
+    return pool;
+}
+
+LogPersisterPool::LogPersisterPool(size_t workerNum)
+{
+    for (size_t i = 0; i < workerNum; i++) {
+        m_workers.emplace_back([this]() { WorkerLoop(); });
+    }
+}
+
+LogPersisterPool::~LogPersisterPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_stop = true;
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers) {
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+}
+
+void LogPersisterPool::Schedule(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_tasks.push_back(std::move(task));
+    }
+    m_cv.notify_one();
+}
+
+void LogPersisterPool::WorkerLoop()
+{
+    prctl(PR_SET_NAME, "hilogd.pstw");
+    for (;;) {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_mtx);
+            m_cv.wait(lock, [this]() { return m_stop || !m_tasks.empty(); });
+            if (m_stop) {
+                return;
+            }
+            task = std::move(m_tasks.front());
+            m_tasks.pop_front();
+        }
+        task();
+    }
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <iostream>
+#include <new>
+#include <securec.h>
+
+#include "log_ring_buffer.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+LogRingBuffer::LogRingBuffer(size_t capacity)
+{
+    capacity = AlignCapacity(capacity);
+    m_data.reset(new (std::nothrow) char[capacity]);
+    if (m_data == nullptr) {
+        std::cerr << "Can't allocate log ring buffer, size: " << capacity << std::endl;
+        return;
+    }
+    m_capacity = capacity;
+}
+
+size_t LogRingBuffer::RecordSize(const HilogMsg& msg)
+{
+    size_t size = sizeof(uint64_t) + msg.len;
+    return (size + RECORD_ALIGN - 1) & ~(RECORD_ALIGN - 1);
+}
+
+bool LogRingBuffer::HasRoom(size_t recordSize) const
+{
+    if (recordSize > m_capacity) {
+        return false;
+    }
+    size_t phys = m_tail % m_capacity;
+    size_t need = recordSize;
+    if (phys + recordSize > m_capacity) {
+        // the rest of the storage becomes padding, record starts at physical 0
+        need += m_capacity - phys;
+    }
+    return m_capacity - Size() >= need;
+}
+
+LogRingBuffer::Offset LogRingBuffer::Append(const HilogMsg& msg, uint64_t seq)
+{
+    size_t recordSize = RecordSize(msg);
+    size_t phys = m_tail % m_capacity;
+    if (phys + recordSize > m_capacity) {
+        *reinterpret_cast<uint64_t *>(Phys(m_tail)) = PADDING_SEQ;
+        bool empty = Empty();
+        m_tail += m_capacity - phys;
+        if (empty) {
+            m_head = m_tail;
+        }
+    }
+    Offset pos = m_tail;
+    char* record = Phys(pos);
+    *reinterpret_cast<uint64_t *>(record) = seq;
+    if (memcpy_s(record + sizeof(uint64_t), recordSize - sizeof(uint64_t), &msg, msg.len) != EOK) {
+        std::cerr << "Can't copy log into ring buffer" << std::endl;
+    }
+    m_tail += recordSize;
+    m_count++;
+    return pos;
+}
+
+void LogRingBuffer::PopFront()
+{
+    if (Empty()) {
+        return;
+    }
+    m_head = Next(m_head);
+    m_count--;
+}
+
+void LogRingBuffer::Clear()
+{
+    m_head = m_tail;
+    m_count = 0;
+}
+
+LogRingBuffer::Offset LogRingBuffer::SkipPadding(Offset pos) const
+{
+    if (pos != m_tail && SeqAt(pos) == PADDING_SEQ) {
+        return pos + (m_capacity - pos % m_capacity);
+    }
+    return pos;
+}
+
+LogRingBuffer::Offset LogRingBuffer::Next(Offset pos) const
+{
+    return SkipPadding(pos + RecordSize(MsgAt(pos)));
+}
+
+uint64_t LogRingBuffer::SeqAt(Offset pos) const
+{
+    return *reinterpret_cast<const uint64_t *>(Phys(pos));
+}
+
+const HilogMsg& LogRingBuffer::MsgAt(Offset pos) const
+{
+    return *reinterpret_cast<const HilogMsg *>(Phys(pos) + sizeof(uint64_t));
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -0,0 +1,288 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_shm_ingest.h"
+
+#include <cerrno>
+#include <csignal>
+#include <ctime>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace OHOS {
+namespace HiviewDFX {
+static constexpr int DRAIN_BUDGET = 256; /* logs read from one ring before visiting the next one */
+static constexpr int IDLE_WAIT_MS = 1000; /* also the period of the reader beat */
+static constexpr int MAX_EVENTS = 16;
+
+static uint32_t MonoSeconds()
+{
+    struct timespec ts = {0};
+    (void)clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint32_t>(ts.tv_sec);
+}
+
+LogShmIngest::LogShmIngest(LogCollector& collector) : m_collector(collector), m_buffer(MAX_SOCKET_PACKET_LEN)
+{
+}
+
+LogShmIngest::~LogShmIngest()
+{
+    Stop();
+}
+
+int LogShmIngest::Start()
+{
+    if (m_thread.joinable()) {
+        return RET_SUCCESS;
+    }
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_wakeFd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (m_epollFd < 0 || m_wakeFd < 0) {
+        std::cerr << "Can't create shm ingest fds, errno: " << errno << std::endl;
+        Stop();
+        return RET_FAIL;
+    }
+    struct epoll_event ev = {};
+    ev.events = EPOLLIN;
+    ev.data.fd = m_wakeFd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_wakeFd, &ev) < 0) {
+        Stop();
+        return RET_FAIL;
+    }
+    m_stop.store(false);
+    m_thread = std::thread([this]() {
+        IngestThread();
+    });
+    return RET_SUCCESS;
+}
+
+void LogShmIngest::Stop()
+{
+    m_stop.store(true);
+    if (m_thread.joinable()) {
+        (void)eventfd_write(m_wakeFd, 1);
+        m_thread.join();
+    }
+    for (auto& ring : m_rings) {
+        ReleaseRing(ring);
+    }
+    m_rings.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMtx);
+        for (auto& ring : m_pending) {
+            ReleaseRing(ring);
+        }
+        m_pending.clear();
+    }
+    if (m_wakeFd >= 0) {
+        close(m_wakeFd);
+        m_wakeFd = -1;
+    }
+    if (m_epollFd >= 0) {
+        close(m_epollFd);
+        m_epollFd = -1;
+    }
+}
+
+void LogShmIngest::AddRing(const ucred& cred, int memFd, int eventFd)
+{
+    if (m_stop.load() || m_ringCount.load() >= MAX_RINGS) {
+        close(memFd);
+        close(eventFd);
+        return;
+    }
+    // The ring must not shrink under our mapping, otherwise reading it could SIGBUS hilogd
+    int seals = fcntl(memFd, F_GET_SEALS);
+    struct stat st = {0};
+    if (seals < 0 || (static_cast<unsigned int>(seals) & F_SEAL_SHRINK) == 0 || fstat(memFd, &st) < 0 ||
+        st.st_size < static_cast<off_t>(HILOG_SHM_HEADER_SIZE + HILOG_SHM_MIN_RING_SIZE) ||
+        st.st_size > static_cast<off_t>(HILOG_SHM_HEADER_SIZE + HILOG_SHM_MAX_RING_SIZE)) {
+        close(memFd);
+        close(eventFd);
+        return;
+    }
+    size_t memSize = static_cast<size_t>(st.st_size);
+    void *mem = mmap(nullptr, memSize, PROT_READ | PROT_WRITE, MAP_SHARED, memFd, 0);
+    close(memFd);
+    if (mem == MAP_FAILED) {
+        close(eventFd);
+        return;
+    }
+    const HilogShmRingHeader *header = static_cast<const HilogShmRingHeader *>(mem);
+    uint32_t size = __atomic_load_n(&header->size, __ATOMIC_RELAXED);
+    if (header->magic != HILOG_SHM_MAGIC || header->version != HILOG_SHM_VERSION || (size & (size - 1)) != 0 ||
+        HILOG_SHM_HEADER_SIZE + size != memSize) {
+        munmap(mem, memSize);
+        close(eventFd);
+        return;
+    }
+    // The ingest thread reads it after epoll, it must never block there
+    int flags = fcntl(eventFd, F_GETFL);
+    if (flags < 0 || fcntl(eventFd, F_SETFL, static_cast<unsigned int>(flags) | O_NONBLOCK) < 0) {
+        munmap(mem, memSize);
+        close(eventFd);
+        return;
+    }
+
+    auto ring = std::make_unique<Ring>();
+    ring->cred = cred;
+    ring->mem = mem;
+    ring->memSize = memSize;
+    ring->size = size;
+    ring->eventFd = eventFd;
+    m_ringCount.fetch_add(1);
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMtx);
+        m_pending.push_back(std::move(ring));
+    }
+    (void)eventfd_write(m_wakeFd, 1);
+}
+
+void LogShmIngest::ReleaseRing(std::unique_ptr<Ring>& ring)
+{
+    if (ring == nullptr) {
+        return;
+    }
+    if (ring->eventFd >= 0) {
+        (void)epoll_ctl(m_epollFd, EPOLL_CTL_DEL, ring->eventFd, nullptr);
+        close(ring->eventFd);
+        ring->eventFd = -1;
+    }
+    if (ring->mem != nullptr) {
+        munmap(ring->mem, ring->memSize);
+        ring->mem = nullptr;
+    }
+    ring.reset();
+    m_ringCount.fetch_sub(1);
+}
+
+void LogShmIngest::AttachPending(uint32_t now)
+{
+    std::vector<std::unique_ptr<Ring>> pending;
+    {
+        std::lock_guard<std::mutex> lock(m_pendingMtx);
+        std::swap(pending, m_pending);
+    }
+    for (auto& ring : pending) {
+        // A process sends its ring again if it believes hilogd restarted, only the newest one is read
+        for (auto it = m_rings.begin(); it != m_rings.end(); ++it) {
+            if ((*it)->cred.pid == ring->cred.pid) {
+                ReleaseRing(*it);
+                m_rings.erase(it);
+                break;
+            }
+        }
+        struct epoll_event ev = {};
+        ev.events = EPOLLIN;
+        ev.data.fd = ring->eventFd;
+        if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, ring->eventFd, &ev) < 0) {
+            ReleaseRing(ring);
+            continue;
+        }
+        ring->ring.Attach(ring->mem, ring->size);
+        ring->ring.Beat(now);
+        ring->ring.SetState(SHM_ATTACHED);
+        m_rings.push_back(std::move(ring));
+    }
+}
+
+bool LogShmIngest::Drain(Ring& ring)
+{
+    for (int i = 0; i < DRAIN_BUDGET; i++) {
+        size_t len = 0;
+        HilogShmRing::ReadResult result = ring.ring.Read(m_buffer.data(), m_buffer.size(), len);
+        if (result == HilogShmRing::ReadResult::EMPTY) {
+            return false;
+        }
+        if (result == HilogShmRing::ReadResult::CORRUPTED) {
+            ring.corrupted = true;
+            return false;
+        }
+        ring.ring.Commit();
+        m_buffer[len - 1] = 0;
+        m_collector.onDataRecv(ring.cred, m_buffer, static_cast<int>(len));
+    }
+    return true;
+}
+
+bool LogShmIngest::PrepareIdle()
+{
+    for (auto& ring : m_rings) {
+        if (!ring->ring.PrepareIdle()) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void LogShmIngest::Housekeeping(uint32_t now)
+{
+    for (auto it = m_rings.begin(); it != m_rings.end();) {
+        Ring& ring = **it;
+        ring.ring.Beat(now);
+        if (kill(ring.cred.pid, 0) < 0 && errno == ESRCH) {
+            // What the process wrote before it died is still read
+            while (Drain(ring)) {}
+            ReleaseRing(*it);
+            it = m_rings.erase(it);
+            continue;
+        }
+        ++it;
+    }
+}
+
+void LogShmIngest::IngestThread()
+{
+    prctl(PR_SET_NAME, "hilogd.shm");
+    struct epoll_event events[MAX_EVENTS];
+    uint32_t lastCheck = 0;
+    while (!m_stop.load()) {
+        uint32_t now = MonoSeconds();
+        AttachPending(now);
+        if (now != lastCheck) {
+            Housekeeping(now);
+            lastCheck = now;
+        }
+        bool more = false;
+        for (auto it = m_rings.begin(); it != m_rings.end();) {
+            more = Drain(**it) || more;
+            if ((*it)->corrupted) {
+                std::cerr << "Shm ring of pid " << (*it)->cred.pid << " is corrupted, detach it" << std::endl;
+                (*it)->ring.SetState(SHM_DETACHED);
+                ReleaseRing(*it);
+                it = m_rings.erase(it);
+                continue;
+            }
+            ++it;
+        }
+        if (more || !PrepareIdle()) {
+            continue;
+        }
+        int count = epoll_wait(m_epollFd, events, MAX_EVENTS, IDLE_WAIT_MS);
+        for (int i = 0; i < count; i++) {
+            eventfd_t value;
+            (void)eventfd_read(events[i].data.fd, &value);
+        }
+    }
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -19,12 +19,15 @@
 #include <properties.h>
 
 #include "log_stats.h"
+#include "log_stats_shard.h"
 
 namespace OHOS {
 namespace HiviewDFX {
 using namespace std;
 
-LogStats::LogStats()
+static std::atomic<uint64_t> g_nextStatsId(1);
+
+LogStats::LogStats() : id(g_nextStatsId.fetch_add(1)), topK(GetStatsTopK())
 {
     Reset();
     enable = IsStatsEnable();
@@ -76,6 +79,7 @@ static void UpdateStats(StatsEntry &entry, const StatsInfo &info)
 static void ResetStatsEntry(StatsEntry &entry)
 {
     entry.dropped = 0;
+    entry.errLines = 0;
     entry.tmpLines = 0;
     entry.freqMax = 0;
     entry.realTimeFreqMax.SetTimeStamp(0, 0);
@@ -95,6 +99,7 @@ static void ResetStatsEntry(StatsEntry &entry)
 static void StatsInfo2NewStatsEntry(const StatsInfo &info, StatsEntry &entry)
 {
     entry.dropped = info.dropped;
+    entry.errLines = 0;
     entry.tmpLines = 1;
     entry.freqMax = 0;
     entry.realTimeFreqMax.SetTimeStamp(info.tv_sec, info.tv_nsec);
@@ -115,74 +120,380 @@ static void StatsInfo2NewStatsEntry(const StatsInfo &info, StatsEntry &entry)
     entry.len[lvl] = info.len;
 }
 
-void LogStats::UpdateTagTable(TagTable& tt, const StatsInfo &info)
+static uint64_t MixHash(uint64_t key)
+{
+    // finalizer of splitmix64, the low bits of domains and pids alone collide a lot
+    static constexpr uint64_t MIX1 = 0xbf58476d1ce4e5b9ULL;
+    static constexpr uint64_t MIX2 = 0x94d049bb133111ebULL;
+    static constexpr int SHIFT1 = 30;
+    static constexpr int SHIFT2 = 27;
+    static constexpr int SHIFT3 = 31;
+    key = (key ^ (key >> SHIFT1)) * MIX1;
+    key = (key ^ (key >> SHIFT2)) * MIX2;
+    return key ^ (key >> SHIFT3);
+}
+
+static size_t TagKeyHash(const StatsTagKey &key)
+{
+    return MixHash(key.id ^ MixHash(key.tag->value));
+}
+
+// Only the owner thread updates a counter, a plain load and store is enough
+template<typename T, typename U>
+static inline void AddRelaxed(std::atomic<T> &counter, U value)
 {
-    if (!tagEnable) {
-        return;
+    counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+const StatsTagTable::Tag& StatsTagTable::Intern(std::string_view tag)
+{
+    size_t hash = std::hash<std::string_view>()(tag);
+    const Tag *found = m_tags.Find(tag, hash);
+    if (found != nullptr) {
+        return *found;
     }
-    auto itt = tt.find(info.tag);
-    if (itt != tt.end()) {
-        UpdateStats(itt->second, info);
+    std::lock_guard<std::mutex> lk(m_insertMtx);
+    return m_tags.Get(tag, hash, [this](uint32_t &tagId) {
+        tagId = m_nextId++;
+    });
+}
+
+void ShardStats::Update(const StatsInfo &info)
+{
+    if (m_used) {
+        UpdateStats(m_entry, info);
     } else {
-        TagStatsEntry entry;
-        StatsInfo2NewStatsEntry(info, entry);
-        (void)tt.emplace(info.tag, entry);
+        StatsInfo2NewStatsEntry(info, m_entry);
+        m_used = true;
     }
+    int lvl = IdxLvl(info.level);
+    m_lines[lvl].store(m_entry.lines[lvl], std::memory_order_relaxed);
+    m_len[lvl].store(m_entry.len[lvl], std::memory_order_relaxed);
+    m_dropped.store(m_entry.dropped, std::memory_order_relaxed);
+    m_freqMax.store(m_entry.GetFreqMax(), std::memory_order_relaxed);
+    m_freqMaxSec.store(m_entry.realTimeFreqMax.tv_sec, std::memory_order_relaxed);
+    m_freqMaxNsec.store(m_entry.realTimeFreqMax.tv_nsec, std::memory_order_relaxed);
+    m_throughputMax.store(m_entry.GetThroughputMax(), std::memory_order_relaxed);
+    m_tpMaxSec.store(m_entry.realTimeThroughputMax.tv_sec, std::memory_order_relaxed);
+    m_tpMaxNsec.store(m_entry.realTimeThroughputMax.tv_nsec, std::memory_order_relaxed);
 }
 
-void LogStats::UpdateDomainTable(const StatsInfo &info)
+void ShardStats::Clear()
 {
-    DomainTable& t = domainStats[info.type];
-    auto it = t.find(info.domain);
-    if (it != t.end()) {
-        UpdateStats(it->second.stats, info);
-    } else {
-        DomainStatsEntry entry;
-        StatsInfo2NewStatsEntry(info, entry.stats);
-        auto result = t.emplace(info.domain, entry);
-        if (!result.second) {
-            cerr << "Add entry to DomainTable error" << endl;
-            return;
+    ResetStatsEntry(m_entry);
+    m_entry.realTimeLast.SetTimeStamp(0, 0);
+    m_used = true;
+}
+
+uint64_t ShardStats::Weight() const
+{
+    return static_cast<uint64_t>(m_entry.GetTotalLines()) + m_error;
+}
+
+void ShardStats::Inherit(uint64_t error)
+{
+    m_error = static_cast<uint32_t>(std::min<uint64_t>(error, UINT32_MAX));
+    m_errLines.store(m_error, std::memory_order_relaxed);
+}
+
+void ShardStats::MergeInto(StatsEntry &entry) const
+{
+    for (int i = 0; i < LevelNum; i++) {
+        entry.lines[i] += m_lines[i].load(std::memory_order_relaxed);
+        entry.len[i] += m_len[i].load(std::memory_order_relaxed);
+    }
+    entry.dropped += m_dropped.load(std::memory_order_relaxed);
+    entry.errLines += m_errLines.load(std::memory_order_relaxed);
+    float freqMax = m_freqMax.load(std::memory_order_relaxed);
+    if (freqMax > entry.freqMax) {
+        entry.freqMax = freqMax;
+        entry.realTimeFreqMax.SetTimeStamp(m_freqMaxSec.load(std::memory_order_relaxed),
+            m_freqMaxNsec.load(std::memory_order_relaxed));
+    }
+    float throughputMax = m_throughputMax.load(std::memory_order_relaxed);
+    if (throughputMax > entry.throughputMax) {
+        entry.throughputMax = throughputMax;
+        entry.realTimeThroughputMax.SetTimeStamp(m_tpMaxSec.load(std::memory_order_relaxed),
+            m_tpMaxNsec.load(std::memory_order_relaxed));
+    }
+}
+
+void StatsSeries::AddTo(Bucket (&ring)[MAX_SERIES_BUCKETS], uint32_t stamp, const StatsInfo &info)
+{
+    Bucket &bucket = ring[stamp % MAX_SERIES_BUCKETS];
+    uint32_t current = bucket.stamp.load(std::memory_order_relaxed);
+    if (current != stamp) {
+        if (current > stamp) {
+            return; // a late log, its bucket already went to a newer second or minute
         }
-        it = result.first;
+        bucket.stamp.store(0, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+        bucket.lines.store(0, std::memory_order_relaxed);
+        bucket.len.store(0, std::memory_order_relaxed);
+        bucket.dropped.store(0, std::memory_order_relaxed);
+        bucket.stamp.store(stamp, std::memory_order_release);
     }
-    UpdateTagTable(it->second.tagStats, info);
+    AddRelaxed(bucket.lines, 1);
+    AddRelaxed(bucket.len, info.len);
+    AddRelaxed(bucket.dropped, info.dropped);
 }
 
-void LogStats::UpdatePidTable(const StatsInfo &info)
+void StatsSeries::Add(const StatsInfo &info)
 {
-    PidTable& t = pidStats;
-    auto it = t.find(info.pid);
-    if (it != t.end()) {
-        UpdateStats(it->second.statsAll, info);
-        UpdateStats(it->second.stats[info.type], info);
-    } else {
-        PidStatsEntry entry;
-        StatsInfo2NewStatsEntry(info, entry.statsAll);
-        for (StatsEntry &e : entry.stats) {
-            ResetStatsEntry(e);
+    static constexpr uint32_t MIN2SEC = 60;
+    AddTo(m_seconds, info.mono_sec + 1, info);
+    AddTo(m_minutes, info.mono_sec / MIN2SEC + 1, info);
+}
+
+void StatsSeries::MergeInto(StatsSeriesUnit unit, uint32_t now, uint32_t count, StatsSeriesBucket *buckets) const
+{
+    static constexpr uint32_t MIN2SEC = 60;
+    const Bucket (&ring)[MAX_SERIES_BUCKETS] = (unit == StatsSeriesUnit::MINUTE) ? m_minutes : m_seconds;
+    uint32_t last = ((unit == StatsSeriesUnit::MINUTE) ? now / MIN2SEC : now) + 1;
+    for (uint32_t i = 0; i < count && i < last; i++) {
+        uint32_t stamp = last - i;
+        const Bucket &bucket = ring[stamp % MAX_SERIES_BUCKETS];
+        if (bucket.stamp.load(std::memory_order_acquire) != stamp) {
+            continue;
+        }
+        uint32_t lines = bucket.lines.load(std::memory_order_relaxed);
+        uint32_t len = bucket.len.load(std::memory_order_relaxed);
+        uint32_t dropped = bucket.dropped.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (bucket.stamp.load(std::memory_order_relaxed) != stamp) {
+            continue;
+        }
+        StatsSeriesBucket &out = buckets[count - 1 - i];
+        out.lines += lines;
+        out.len += len;
+        out.dropped += dropped;
+    }
+}
+
+void StatsShardData::Count(const StatsInfo &info, bool tagEnable)
+{
+    int lvl = IdxLvl(info.level);
+    AddRelaxed(m_totalLines[lvl], 1);
+    AddRelaxed(m_totalLens[lvl], info.len);
+    m_totalSeries.Add(info);
+    const StatsTagTable::Tag *tag = tagEnable ? &m_tags->Intern(info.tag) : nullptr;
+    auto noInit = [](auto &) {};
+
+    uint64_t domainKey = (static_cast<uint64_t>(info.type) << 32) | info.domain;
+    StatsDomainValue &domain = m_domains.Track(domainKey, MixHash(domainKey), noInit).value;
+    domain.stats.Update(info);
+    domain.series.Add(info);
+    if (tag != nullptr) {
+        StatsTagKey key = { domainKey, tag };
+        m_domainTags.Track(key, TagKeyHash(key), noInit).value.Update(info);
+    }
+
+    auto initPid = [this, &info](StatsPidValue &v) {
+        // As LogStats always did, the types a pid logs later start from a cleared entry
+        for (int i = 0; i < TypeNum; i++) {
+            if (i != info.type) {
+                v.stats[i].Clear();
+            }
+        }
+        m_names.Request(info.pid);
+    };
+    StatsPidValue &pid = m_pids.Track(static_cast<uint64_t>(info.pid), MixHash(info.pid), initPid).value;
+    pid.statsAll.Update(info);
+    pid.stats[info.type].Update(info);
+    pid.series.Add(info);
+    if (tag != nullptr) {
+        StatsTagKey key = { info.pid, tag };
+        m_pidTags.Track(key, TagKeyHash(key), noInit).value.Update(info);
+    }
+}
+
+static void InitMergedEntry(StatsEntry &entry)
+{
+    ResetStatsEntry(entry);
+    entry.realTimeLast.SetTimeStamp(0, 0);
+}
+
+void StatsShardData::MergeInto(LogTypeDomainTable &domainStats, PidTable &pidStats, uint32_t (&lines)[LevelNum],
+    uint64_t (&lens)[LevelNum]) const
+{
+    for (int i = 0; i < LevelNum; i++) {
+        lines[i] += m_totalLines[i].load(std::memory_order_relaxed);
+        lens[i] += m_totalLens[i].load(std::memory_order_relaxed);
+    }
+    auto domainEntry = [&domainStats](uint64_t domainKey) -> DomainStatsEntry& {
+        DomainTable &t = domainStats[domainKey >> 32];
+        uint32_t domain = static_cast<uint32_t>(domainKey);
+        auto it = t.find(domain);
+        if (it == t.end()) {
+            it = t.emplace(domain, DomainStatsEntry()).first;
+            InitMergedEntry(it->second.stats);
+        }
+        return it->second;
+    };
+    m_domains.ForEach([&domainEntry](const auto &e) {
+        e.value.stats.MergeInto(domainEntry(e.key).stats);
+    });
+    m_domainTags.ForEach([&domainStats](const auto &e) {
+        // Like pids below, a domain is published before its tags
+        DomainTable &t = domainStats[e.key.id >> 32];
+        auto dit = t.find(static_cast<uint32_t>(e.key.id));
+        if (dit == t.end()) {
+            return;
+        }
+        TagTable &tt = dit->second.tagStats;
+        auto it = tt.find(e.key.tag->key);
+        if (it == tt.end()) {
+            it = tt.emplace(e.key.tag->key, TagStatsEntry()).first;
+            InitMergedEntry(it->second);
         }
-        entry.stats[info.type] = entry.statsAll;
-        entry.name = GetNameByPid(info.pid);
-        auto result = t.emplace(info.pid, entry);
-        if (!result.second) {
-            cerr << "Add entry to PidTable error" << endl;
+        e.value.MergeInto(it->second);
+    });
+
+    auto pidEntry = [&pidStats](uint32_t pid) -> PidStatsEntry& {
+        auto it = pidStats.find(pid);
+        if (it == pidStats.end()) {
+            it = pidStats.emplace(pid, PidStatsEntry()).first;
+            InitMergedEntry(it->second.statsAll);
+            for (StatsEntry &e : it->second.stats) {
+                InitMergedEntry(e);
+            }
+        }
+        return it->second;
+    };
+    m_pids.ForEach([&pidEntry](const auto &e) {
+        PidStatsEntry &entry = pidEntry(static_cast<uint32_t>(e.key));
+        e.value.statsAll.MergeInto(entry.statsAll);
+        for (int i = 0; i < TypeNum; i++) {
+            e.value.stats[i].MergeInto(entry.stats[i]);
+        }
+    });
+    m_pidTags.ForEach([&pidStats](const auto &e) {
+        // Pid entries are published before their tags, the pid is already merged unless it was evicted
+        auto pit = pidStats.find(static_cast<uint32_t>(e.key.id));
+        if (pit == pidStats.end()) {
             return;
         }
-        it = result.first;
+        TagTable &tt = pit->second.tagStats;
+        auto it = tt.find(e.key.tag->key);
+        if (it == tt.end()) {
+            it = tt.emplace(e.key.tag->key, TagStatsEntry()).first;
+            InitMergedEntry(it->second);
+        }
+        e.value.MergeInto(it->second);
+    });
+}
+
+void StatsShardData::MergeSeriesInto(const StatsSeriesRqst &rqst, uint32_t now, StatsSeriesBucket *buckets) const
+{
+    switch (rqst.scope) {
+        case StatsSeriesScope::BY_DOMAIN:
+            // Summed over all log types
+            m_domains.ForEach([&rqst, now, buckets](const auto &e) {
+                if (static_cast<uint32_t>(e.key) == rqst.id) {
+                    e.value.series.MergeInto(rqst.unit, now, rqst.count, buckets);
+                }
+            });
+            break;
+        case StatsSeriesScope::BY_PID:
+            m_pids.ForEach([&rqst, now, buckets](const auto &e) {
+                if (e.key == rqst.id) {
+                    e.value.series.MergeInto(rqst.unit, now, rqst.count, buckets);
+                }
+            });
+            break;
+        default:
+            m_totalSeries.MergeInto(rqst.unit, now, rqst.count, buckets);
+            break;
     }
-    UpdateTagTable(it->second.tagStats, info);
+}
+
+StatsShard::StatsShard(std::unique_ptr<StatsShardData> data)
+    : m_owner(std::this_thread::get_id()), m_data(data.release())
+{
+}
+
+StatsShard::~StatsShard()
+{
+    delete m_data.load();
+}
+
+void StatsShard::Count(const StatsInfo &info, bool tagEnable)
+{
+    uint32_t seq = m_seq.load(std::memory_order_relaxed) + 1;
+    // The odd sequence must be visible before the data is loaded, both are seq_cst
+    m_seq.store(seq);
+    m_data.load()->Count(info, tagEnable);
+    m_seq.store(seq + 1, std::memory_order_release);
+}
+
+std::unique_ptr<StatsShardData> StatsShard::Replace(std::unique_ptr<StatsShardData> data)
+{
+    std::unique_ptr<StatsShardData> old(m_data.exchange(data.release()));
+    // If the owner is counting, it may still use the old data until its sequence changes
+    uint32_t seq = m_seq.load();
+    if ((seq & 1) != 0) {
+        while (m_seq.load(std::memory_order_acquire) == seq) {
+            std::this_thread::yield();
+        }
+    }
+    return old;
+}
+
+StatsShard& LogStats::GetShard()
+{
+    thread_local uint64_t cachedId = 0;
+    thread_local StatsShard *cachedShard = nullptr;
+    if (cachedId == id) {
+        return *cachedShard;
+    }
+    std::scoped_lock lk(shardsLock);
+    std::thread::id self = std::this_thread::get_id();
+    auto it = std::find_if(shards.begin(), shards.end(), [&self](const auto &shard) {
+        return shard->GetOwner() == self;
+    });
+    if (it == shards.end()) {
+        shards.push_back(std::make_unique<StatsShard>(std::make_unique<StatsShardData>(tags, topK, names)));
+        it = shards.end() - 1;
+    }
+    cachedId = id;
+    cachedShard = it->get();
+    return *cachedShard;
 }
 
 void LogStats::Count(const StatsInfo &info)
 {
     if (enable) {
-        std::scoped_lock lk(lock);
-        int index = IdxLvl(info.level);
-        totalLines[index]++;
-        totalLens[index] += info.len;
-        UpdateDomainTable(info);
-        UpdatePidTable(info);
+        GetShard().Count(info, tagEnable);
+    }
+}
+
+void LogStats::Merge()
+{
+    for (auto &t : domainStats) {
+        t.clear();
+    }
+    pidStats.clear();
+    for (int i = 0; i < LevelNum; i++) {
+        totalLines[i] = 0;
+        totalLens[i] = 0;
+    }
+    std::scoped_lock lk(shardsLock);
+    for (const auto &shard : shards) {
+        shard->GetData().MergeInto(domainStats, pidStats, totalLines, totalLens);
+    }
+    for (auto &it : pidStats) {
+        it.second.name = names.Get(it.first);
+        // The worker compares the start time, so a reused pid has its new name and a name which made
+        // room for others is back by the next query
+        names.Request(it.first);
+    }
+}
+
+void LogStats::MergeSeries(const StatsSeriesRqst &rqst, uint32_t now, StatsSeriesBucket *buckets)
+{
+    std::scoped_lock lk(shardsLock);
+    for (const auto &shard : shards) {
+        shard->GetData().MergeSeriesInto(rqst, now, buckets);
     }
 }
 
@@ -199,6 +510,13 @@ void LogStats::Reset()
         totalLines[i] = 0;
         totalLens[i] = 0;
     }
+    // Old tags are freed with the last shard data which refers to them
+    std::scoped_lock shardsLk(shardsLock);
+    tags = std::make_shared<StatsTagTable>();
+    for (auto &shard : shards) {
+        (void)shard->Replace(std::make_unique<StatsShardData>(tags, topK, names));
+    }
+    names.Clear();
 }
 
 const LogTypeDomainTable& LogStats::GetDomainTable() const
@@ -241,6 +559,11 @@ bool LogStats::IsTagEnable() const
     return tagEnable;
 }
 
+size_t LogStats::GetTopK() const
+{
+    return topK;
+}
+
 std::unique_lock<std::mutex> LogStats::GetLock()
 {
     std::unique_lock<std::mutex> lk(lock);
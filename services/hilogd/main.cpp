@@ -30,6 +30,7 @@
 #include "flow_control.h"
 #include "log_kmsg.h"
 #include "log_collector.h"
+#include "log_shm_ingest.h"
 #include "service_controller.h"
 
 #ifdef DEBUG
@@ -155,7 +156,19 @@ int HilogdEntry()
     };
 #endif
 
-    HilogInputSocketServer incomingLogsServer(onDataReceive);
+#ifdef __RECV_MSG_WITH_UCRED_
+    LogShmIngest shmIngest(logCollector);
+#endif
+    HilogInputSocketServer incomingLogsServer(onDataReceive, GetInputBatchSize(), GetInputWorkerNum());
+    logCollector.SetInputStatsSource([&incomingLogsServer]() { return incomingLogsServer.GetStats(); });
+#ifdef __RECV_MSG_WITH_UCRED_
+    // Processes logging through shared memory hand their ring over the input socket
+    if (shmIngest.Start() == RET_SUCCESS) {
+        incomingLogsServer.SetShmSetupHandler([&shmIngest](const ucred& cred, int memFd, int eventFd) {
+            shmIngest.AddRing(cred, memFd, eventFd);
+        });
+    }
+#endif
     if (incomingLogsServer.Init() < 0) {
 #ifdef DEBUG
         cout << "Failed to init input server socket ! ";
@@ -207,6 +220,7 @@ int HilogdEntry()
             IoctlCmd::BUFFERSIZE_SET_RQST,
             IoctlCmd::STATS_QUERY_RQST,
             IoctlCmd::STATS_CLEAR_RQST,
+            IoctlCmd::STATS_SERIES_RQST,
             IoctlCmd::DOMAIN_FLOWCTRL_RQST,
             IoctlCmd::LOG_REMOVE_RQST,
             IoctlCmd::KMSG_ENABLE_RQST,
@@ -0,0 +1,167 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "proc_name_cache.h"
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+
+#include <securec.h>
+#include <log_utils.h>
+
+namespace OHOS {
+namespace HiviewDFX {
+static constexpr int STAT_PATH_LEN = 32;
+static constexpr int STAT_LEN = 512;
+static constexpr int STARTTIME_FIELD = 22; /* in /proc/<pid>/stat, the name is field 2 */
+
+// Returns 0 if the process doesn't exist
+static uint64_t GetStartTime(uint32_t pid)
+{
+    char path[STAT_PATH_LEN] = { 0 };
+    if (snprintf_s(path, STAT_PATH_LEN, STAT_PATH_LEN - 1, "/proc/%u/stat", pid) <= 0) {
+        return 0;
+    }
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        return 0;
+    }
+    char stat[STAT_LEN] = { 0 };
+    ssize_t len = read(fd, stat, STAT_LEN - 1);
+    close(fd);
+    if (len <= 0) {
+        return 0;
+    }
+    // The name may contain spaces and parentheses, fields are counted after its last ')'
+    char *field = strrchr(stat, ')');
+    for (int i = 2; i < STARTTIME_FIELD && field != nullptr; i++) {
+        field = strchr(field + 1, ' ');
+    }
+    return (field == nullptr) ? 0 : strtoull(field + 1, nullptr, 10);
+}
+
+ProcNameCache::~ProcNameCache()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mtx);
+        m_stop = true;
+    }
+    m_cv.notify_one();
+    if (m_worker.joinable()) {
+        m_worker.join();
+    }
+}
+
+void ProcNameCache::Request(uint32_t pid)
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    if (m_stop || m_pending.size() >= MAX_PENDING) {
+        return;
+    }
+    if (!m_worker.joinable()) {
+        m_worker = std::thread([this]() {
+            WorkerThread();
+        });
+    }
+    m_pending.push_back(pid);
+    if (m_pending.size() == 1) {
+        m_cv.notify_one();
+    }
+}
+
+std::string ProcNameCache::Get(uint32_t pid) const
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    auto it = m_names.find(pid);
+    if (it == m_names.end()) {
+        return "";
+    }
+    m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+    return it->second.name;
+}
+
+void ProcNameCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(m_mtx);
+    m_names.clear();
+    m_lru.clear();
+}
+
+void ProcNameCache::Store(uint32_t pid, Entry& resolved)
+{
+    auto it = m_names.find(pid);
+    if (it != m_names.end()) {
+        it->second.name = std::move(resolved.name);
+        it->second.startTime = resolved.startTime;
+        m_lru.splice(m_lru.begin(), m_lru, it->second.lruPos);
+        return;
+    }
+    if (m_names.size() >= MAX_NAMES) {
+        m_names.erase(m_lru.back());
+        m_lru.pop_back();
+    }
+    m_lru.push_front(pid);
+    resolved.lruPos = m_lru.begin();
+    m_names.emplace(pid, std::move(resolved));
+}
+
+void ProcNameCache::WorkerThread()
+{
+    prctl(PR_SET_NAME, "hilogd.pidname");
+    std::vector<uint32_t> batch;
+    std::vector<Entry> resolved;
+    std::unique_lock<std::mutex> lock(m_mtx);
+    for (;;) {
+        m_cv.wait(lock, [this]() {
+            return m_stop || !m_pending.empty();
+        });
+        if (m_stop) {
+            return;
+        }
+        batch.clear();
+        std::swap(batch, m_pending);
+        std::sort(batch.begin(), batch.end());
+        batch.erase(std::unique(batch.begin(), batch.end()), batch.end());
+        resolved.assign(batch.size(), Entry());
+        for (size_t i = 0; i < batch.size(); i++) {
+            auto it = m_names.find(batch[i]);
+            resolved[i].startTime = (it == m_names.end()) ? 0 : it->second.startTime;
+        }
+
+        lock.unlock();
+        for (size_t i = 0; i < batch.size(); i++) {
+            uint64_t startTime = GetStartTime(batch[i]);
+            if (startTime == 0 || startTime == resolved[i].startTime) {
+                resolved[i].startTime = 0; // exited or still the same process, keep the name
+                continue;
+            }
+            resolved[i].name = GetNameByPid(batch[i]);
+            resolved[i].startTime = resolved[i].name.empty() ? 0 : startTime;
+        }
+        lock.lock();
+
+        for (size_t i = 0; i < batch.size(); i++) {
+            if (resolved[i].startTime != 0) {
+                Store(batch[i], resolved[i]);
+            }
+        }
+    }
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -14,11 +14,13 @@
  */
 #include <algorithm>
 #include <array>
+#include <cerrno>
 #include <chrono>
 #include <cstdio>
 #include <cstring>
 #include <ctime>
 #include <fcntl.h>
+#include <poll.h>
 #include <iostream>
 #include <memory>
 #include <optional>
@@ -34,6 +36,7 @@
 #include <securec.h>
 #include <hilog/log.h>
 #include <hilog_common.h>
+#include <hilog_persist.h>
 #include <log_utils.h>
 #include <properties.h>
 
@@ -68,11 +71,12 @@ inline bool IsKmsg(uint16_t types)
 }
 
 ServiceController::ServiceController(std::unique_ptr<Socket> communicationSocket,
-    LogCollector& collector, HilogBuffer& hilogBuffer, HilogBuffer& kmsgBuffer)
+    LogCollector& collector, HilogBuffer& hilogBuffer, HilogBuffer& kmsgBuffer, std::function<void()> onReady)
     : m_communicationSocket(std::move(communicationSocket)),
     m_logCollector(collector),
     m_hilogBuffer(hilogBuffer),
-    m_kmsgBuffer(kmsgBuffer)
+    m_kmsgBuffer(kmsgBuffer),
+    m_onReady(std::move(onReady))
 {
     m_hilogBufferReader = m_hilogBuffer.CreateBufReader([this]() { NotifyForNewData(); });
     m_kmsgBufferReader = m_kmsgBuffer.CreateBufReader([this]() { NotifyForNewData(); });
@@ -80,9 +84,9 @@ ServiceController::ServiceController(std::unique_ptr<Socket> communicationSocket
 
 ServiceController::~ServiceController()
 {
+    // No new data callback runs once the readers are removed
     m_hilogBuffer.RemoveBufReader(m_hilogBufferReader);
     m_kmsgBuffer.RemoveBufReader(m_kmsgBufferReader);
-    m_notifyNewDataCv.notify_all();
 }
 
 inline bool IsValidFileName(const std::string& strFileName)
@@ -121,9 +125,9 @@ int ServiceController::GetRqst(const MsgHeader& hdr, char* rqst, int expectedLen
     return RET_SUCCESS;
 }
 
-void ServiceController::WriteRspHeader(IoctlCmd cmd, size_t len)
+void ServiceController::WriteRspHeader(IoctlCmd cmd, size_t len, uint8_t ver)
 {
-    MsgHeader header = {MSG_VER, static_cast<uint8_t>(cmd), 0, static_cast<uint16_t>(len)};
+    MsgHeader header = {ver, static_cast<uint8_t>(cmd), 0, static_cast<uint16_t>(len)};
     (void)m_communicationSocket->Write(reinterpret_cast<char*>(&header), sizeof(MsgHeader));
     return;
 }
@@ -135,15 +139,9 @@ void ServiceController::WriteErrorRsp(int code)
     return;
 }
 
-int ServiceController::WriteQueryResponse(OptCRef<HilogData> pData)
+static void HilogMsg2OutputRsp(const HilogMsg& data, OutputRsp& rsp)
 {
-    OutputRsp rsp;
-    if (pData == std::nullopt) {
-        rsp.end = true; // tell client it's the last messsage
-        return m_communicationSocket->Write(reinterpret_cast<char*>(&rsp), sizeof(rsp));
-    }
-    const HilogData& data = pData->get();
-    rsp.len = data.len; /* data len, equals tagLen plus content length, include '\0' */
+    rsp.len = data.len - sizeof(HilogMsg); /* data len, equals tagLen plus content length, include '\0' */
     rsp.level = data.level;
     rsp.type = data.type;
     rsp.tagLen = data.tagLen; /* include '\0' */
@@ -154,16 +152,113 @@ int ServiceController::WriteQueryResponse(OptCRef<HilogData> pData)
     rsp.tv_nsec = data.tv_nsec;
     rsp.mono_sec = data.mono_sec;
     rsp.end = false;
-    static const int vec_num = 2;
-    iovec vec[vec_num];
-    vec[0].iov_base = &rsp;
-    vec[0].iov_len = sizeof(OutputRsp);
-    vec[1].iov_base = data.tag;
-    vec[1].iov_len = data.len;
-    return m_communicationSocket->WriteV(vec, vec_num);
 }
 
-static void StatsEntry2StatsRsp(const StatsEntry &entry, StatsRsp &rsp)
+// Takes the next logs to send, false if the output waits for new logs
+bool ServiceController::QueryOutput(OutputContext& out)
+{
+    out.next = 0;
+    out.count = out.buffer->Query(out.filter, out.readId, out.batch, out.tailCount);
+    if (out.count == 0) {
+        if (out.noBlock) {
+            // reach the end of buffer and don't block
+            out.end = true;
+        } else {
+            // Parked before looking again, so logs inserted in between still call back
+            out.buffer->ParkReader(out.readId);
+            out.count = out.buffer->Query(out.filter, out.readId, out.batch, out.tailCount);
+            if (out.count == 0) {
+                return false;
+            }
+        }
+    }
+    if (out.lines && out.count >= out.linesCountDown) {
+        out.count = out.linesCountDown;
+        out.end = true;
+    }
+    out.linesCountDown -= out.lines ? out.count : 0;
+    return true;
+}
+
+// MSG_VER_OUTPUT_BATCH: packs as many logs as fit into frames of at most OUTPUT_FRAME_MAX_LEN bytes, the end
+// record goes after them. Older clients get one log, or the end record, per message.
+void ServiceController::PackOutputFrame(OutputContext& out)
+{
+    auto fits = [&out](size_t len) {
+        return out.used == 0 || (out.batchMode && out.used + len <= out.frame.size());
+    };
+    while (out.next < out.count) {
+        const HilogMsg& msg = out.batch.At(out.next);
+        size_t dataLen = msg.len - sizeof(HilogMsg);
+        if (!fits(sizeof(OutputRsp) + dataLen)) {
+            return;
+        }
+        out.next++;
+        OutputRsp* rsp = reinterpret_cast<OutputRsp *>(out.frame.data() + out.used);
+        HilogMsg2OutputRsp(msg, *rsp);
+        if (memcpy_s(rsp->data, out.frame.size() - out.used - sizeof(OutputRsp), msg.tag, dataLen) != EOK) {
+            continue;
+        }
+        out.used += sizeof(OutputRsp) + dataLen;
+    }
+    if (out.end && !out.endPacked && fits(sizeof(OutputRsp))) {
+        OutputRsp* rsp = reinterpret_cast<OutputRsp *>(out.frame.data() + out.used);
+        (void)memset_s(rsp, sizeof(OutputRsp), 0, sizeof(OutputRsp));
+        rsp->end = true; // tell client it's the last messsage
+        out.used += sizeof(OutputRsp);
+        out.endPacked = true;
+    }
+}
+
+ServiceController::State ServiceController::ContinueOutput()
+{
+    if (m_output == nullptr) {
+        return State::DONE;
+    }
+    OutputContext& out = *m_output;
+    for (;;) {
+        if (out.used > 0) {
+            if (m_communicationSocket->Write(out.frame.data(), out.used) < 0) {
+                if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                    return State::WAIT_WRITABLE;
+                }
+                // write socket failed, it means that client has disconnected
+                std::cerr << "Client disconnect" << std::endl;
+                return State::DONE;
+            }
+            out.used = 0;
+        }
+        if (out.next < out.count || (out.end && !out.endPacked)) {
+            PackOutputFrame(out);
+            continue;
+        }
+        if (out.end) {
+            // Let client receive all messages and exit gracefully, batch clients ack the end record
+            return (out.batchMode || out.count > 0) ? State::WAIT_CLOSE : State::DONE;
+        }
+        if (!QueryOutput(out)) {
+            return State::WAIT_DATA;
+        }
+    }
+}
+
+void ServiceController::FinishOutput()
+{
+    if (m_output == nullptr || !m_output->batchMode) {
+        return;
+    }
+    MsgHeader hdr = {0};
+    int ret = m_communicationSocket->Read(reinterpret_cast<char *>(&hdr), sizeof(MsgHeader));
+    if (ret < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        // Client acks or closes the socket once it has read the end record, don't wait for a stuck one forever
+        std::cerr << "Wait output end ack timeout" << std::endl;
+    } else if (ret == static_cast<int>(sizeof(MsgHeader)) && hdr.cmd != static_cast<uint8_t>(IoctlCmd::OUTPUT_END_ACK)) {
+        std::cerr << "Unexpected cmd while waiting output end ack: " << static_cast<int>(hdr.cmd) << std::endl;
+    }
+}
+
+// errLines gets the lines the entry may lack, the snapshot carries them after the tables
+static void StatsEntry2StatsRsp(const StatsEntry &entry, StatsRsp &rsp, std::vector<uint32_t>& errLines)
 {
     // can't use std::copy, because StatsRsp is a packet struct
     int i = 0;
@@ -172,6 +267,7 @@ static void StatsEntry2StatsRsp(const StatsEntry &entry, StatsRsp &rsp)
         rsp.len[i] = entry.len[i];
     }
     rsp.dropped = entry.dropped;
+    errLines.push_back(entry.errLines);
     rsp.freqMax = entry.GetFreqMax();
     rsp.freqMaxSec = entry.realTimeFreqMax.tv_sec;
     rsp.freqMaxNsec = entry.realTimeFreqMax.tv_nsec;
@@ -180,11 +276,48 @@ static void StatsEntry2StatsRsp(const StatsEntry &entry, StatsRsp &rsp)
     rsp.tpMaxNsec = entry.realTimeThroughputMax.tv_nsec;
 }
 
-void ServiceController::SendOverallStats(const LogStats& stats)
+static uint16_t StatsTableNum(size_t size)
+{
+    return static_cast<uint16_t>(std::min<size_t>(size, UINT16_MAX));
+}
+
+// The pointer is valid until the next append, msgLens gets the MSG_VER message the entries make
+template<typename T>
+static T* AppendStats(std::vector<char>& snapshot, std::vector<size_t>& msgLens, size_t num)
+{
+    size_t offset = snapshot.size();
+    if (num > 0) {
+        snapshot.resize(offset + num * sizeof(T), 0);
+        msgLens.push_back(num * sizeof(T));
+    }
+    return reinterpret_cast<T *>(snapshot.data() + offset);
+}
+
+static void AppendTagStats(std::vector<char>& snapshot, std::vector<size_t>& msgLens, std::vector<uint32_t>& errLines,
+    const TagTable& tagTable)
+{
+    uint16_t num = StatsTableNum(tagTable.size());
+    TagStatsRsp *tStats = AppendStats<TagStatsRsp>(snapshot, msgLens, num);
+    auto it = tagTable.begin();
+    for (uint16_t i = 0; i < num; i++, ++it) {
+        (void)strncpy_s(tStats[i].tag, MAX_TAG_LEN, it->first.c_str(), MAX_TAG_LEN - 1);
+        StatsEntry2StatsRsp(it->second, tStats[i].stats, errLines);
+    }
+}
+
+static uint16_t ProcTypeNum(const PidStatsEntry& entry)
+{
+    uint16_t typeNum = 0;
+    for (auto &it : entry.stats) {
+        if (it.GetTotalLines() != 0) {
+            typeNum++;
+        }
+    }
+    return typeNum;
+}
+
+static void BuildOverallStats(const LogStats& stats, StatsQueryRsp& rsp)
 {
-    StatsQueryRsp rsp;
-    const LogTypeDomainTable& ldTable = stats.GetDomainTable();
-    const PidTable& pTable = stats.GetPidTable();
     const LogTimeStamp tsBegin = stats.GetBeginTs();
     rsp.tsBeginSec = tsBegin.tv_sec;
     rsp.tsBeginNsec = tsBegin.tv_nsec;
@@ -196,235 +329,140 @@ void ServiceController::SendOverallStats(const LogStats& stats)
     stats.GetTotalLines(rsp.totalLines);
     stats.GetTotalLens(rsp.totalLens);
     rsp.typeNum = 0;
-    for (const DomainTable &dt : ldTable) {
-        if (dt.size() == 0) {
-            continue;
+    for (const DomainTable &dt : stats.GetDomainTable()) {
+        if (dt.size() != 0) {
+            rsp.typeNum++;
         }
-        rsp.typeNum++;
     }
-    rsp.ldStats = nullptr;
-    rsp.procNum = pTable.size();
-    rsp.pStats = nullptr;
-    m_communicationSocket->Write(reinterpret_cast<char *>(&rsp), sizeof(StatsQueryRsp));
+    rsp.procNum = StatsTableNum(stats.GetPidTable().size());
 }
 
-void ServiceController::SendLogTypeDomainStats(const LogStats& stats)
+static void BuildDomainStats(const LogStats& stats, std::vector<char>& snapshot, std::vector<size_t>& msgLens,
+    std::vector<uint32_t>& errLines, uint16_t typeNum)
 {
     const LogTypeDomainTable& ldTable = stats.GetDomainTable();
-    int typeNum = 0;
-    for (const DomainTable &dt : ldTable) {
-        if (dt.size() == 0) {
-            continue;
+    LogTypeDomainStatsRsp *ldStats = AppendStats<LogTypeDomainStatsRsp>(snapshot, msgLens, typeNum);
+    uint16_t i = 0;
+    for (uint16_t type = 0; type < TypeNum; type++) {
+        if (ldTable[type].size() != 0) {
+            ldStats[i].type = type;
+            ldStats[i].domainNum = StatsTableNum(ldTable[type].size());
+            i++;
         }
-        typeNum++;
-    }
-    int msgSize = typeNum * sizeof(LogTypeDomainStatsRsp);
-    if (msgSize == 0) {
-        return;
-    }
-    char* tmp = new (std::nothrow) char[msgSize];
-    if (tmp == nullptr) {
-        return;
     }
-    if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-        delete []tmp;
-        tmp = nullptr;
-        return;
-    }
-    LogTypeDomainStatsRsp *ldStats = reinterpret_cast<LogTypeDomainStatsRsp *>(tmp);
-    int i = 0;
-    int j = 0;
     for (const DomainTable &dt : ldTable) {
-        j++;
-        if (dt.size() == 0) {
-            continue;
+        uint16_t num = StatsTableNum(dt.size());
+        DomainStatsRsp *dStats = AppendStats<DomainStatsRsp>(snapshot, msgLens, num);
+        auto it = dt.begin();
+        for (uint16_t j = 0; j < num; j++, ++it) {
+            dStats[j].domain = it->first;
+            StatsEntry2StatsRsp(it->second.stats, dStats[j].stats, errLines);
+            dStats[j].tagNum = stats.IsTagEnable() ? StatsTableNum(it->second.tagStats.size()) : 0;
         }
-        ldStats[i].type = (j - 1);
-        ldStats[i].domainNum = dt.size();
-        i++;
     }
-    m_communicationSocket->Write(tmp, msgSize);
-    delete []tmp;
-    tmp = nullptr;
-}
-
-void ServiceController::SendDomainStats(const LogStats& stats)
-{
-    const LogTypeDomainTable& ldTable = stats.GetDomainTable();
-    for (const DomainTable &dt : ldTable) {
-        if (dt.size() == 0) {
-            continue;
-        }
-        int msgSize = dt.size() * sizeof(DomainStatsRsp);
-        char *tmp = new (std::nothrow) char[msgSize];
-        if (tmp == nullptr) {
-            return;
-        }
-        if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-            delete []tmp;
-            tmp = nullptr;
-            return;
-        }
-        DomainStatsRsp *dStats = reinterpret_cast<DomainStatsRsp *>(tmp);
-        int i = 0;
-        for (auto &it : dt) {
-            dStats[i].domain = it.first;
-            if (!stats.IsTagEnable()) {
-                dStats[i].tagNum = 0;
-            } else {
-                dStats[i].tagNum = it.second.tagStats.size();
-            }
-            if (dStats[i].tagNum == 0) {
-                dStats[i].tStats = nullptr;
-            }
-            StatsEntry2StatsRsp(it.second.stats, dStats[i].stats);
-            i++;
-        }
-        m_communicationSocket->Write(tmp, msgSize);
-        delete []tmp;
-        tmp = nullptr;
+    if (!stats.IsTagEnable()) {
+        return;
     }
-}
-
-void ServiceController::SendDomainTagStats(const LogStats& stats)
-{
-    const LogTypeDomainTable& ldTable = stats.GetDomainTable();
     for (const DomainTable &dt : ldTable) {
-        if (dt.size() == 0) {
-            continue;
-        }
-        for (auto &it : dt) {
-            SendTagStats(it.second.tagStats);
+        uint16_t num = StatsTableNum(dt.size());
+        auto it = dt.begin();
+        for (uint16_t j = 0; j < num; j++, ++it) {
+            AppendTagStats(snapshot, msgLens, errLines, it->second.tagStats);
         }
     }
 }
 
-void ServiceController::SendProcStats(const LogStats& stats)
+static void BuildProcStats(const LogStats& stats, std::vector<char>& snapshot, std::vector<size_t>& msgLens,
+    std::vector<uint32_t>& errLines, uint16_t procNum)
 {
     const PidTable& pTable = stats.GetPidTable();
-    int msgSize =  pTable.size() * sizeof(ProcStatsRsp);
-    if (msgSize == 0) {
-        return;
-    }
-    char* tmp = new (std::nothrow) char[msgSize];
-    if (tmp == nullptr) {
-        return;
-    }
-    if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-        delete []tmp;
-        tmp = nullptr;
-        return;
-    }
-    ProcStatsRsp *pStats = reinterpret_cast<ProcStatsRsp *>(tmp);
-    int i = 0;
-    for (auto &it : pTable) {
+    ProcStatsRsp *pStats = AppendStats<ProcStatsRsp>(snapshot, msgLens, procNum);
+    auto it = pTable.begin();
+    for (uint16_t i = 0; i < procNum; i++, ++it) {
         ProcStatsRsp &procStats = pStats[i];
-        i++;
-        procStats.pid = it.first;
-        if (strncpy_s(procStats.name, MAX_PROC_NAME_LEN, it.second.name.c_str(), MAX_PROC_NAME_LEN - 1) != 0) {
-            continue;
-        }
-        StatsEntry2StatsRsp(it.second.statsAll, procStats.stats);
-        procStats.typeNum = 0;
-        for (auto &itt : it.second.stats) {
-            if (itt.GetTotalLines() == 0) {
-                continue;
+        procStats.pid = it->first;
+        (void)strncpy_s(procStats.name, MAX_PROC_NAME_LEN, it->second.name.c_str(), MAX_PROC_NAME_LEN - 1);
+        StatsEntry2StatsRsp(it->second.statsAll, procStats.stats, errLines);
+        procStats.typeNum = ProcTypeNum(it->second);
+        procStats.tagNum = stats.IsTagEnable() ? StatsTableNum(it->second.tagStats.size()) : 0;
+    }
+    it = pTable.begin();
+    for (uint16_t i = 0; i < procNum; i++, ++it) {
+        LogTypeStatsRsp *lStats = AppendStats<LogTypeStatsRsp>(snapshot, msgLens, ProcTypeNum(it->second));
+        uint16_t j = 0;
+        for (uint16_t type = 0; type < TypeNum; type++) {
+            const StatsEntry &entry = it->second.stats[type];
+            if (entry.GetTotalLines() != 0) {
+                lStats[j].type = type;
+                StatsEntry2StatsRsp(entry, lStats[j].stats, errLines);
+                j++;
             }
-            procStats.typeNum++;
-        }
-        if (!stats.IsTagEnable()) {
-            procStats.tagNum = 0;
-        } else {
-            procStats.tagNum = it.second.tagStats.size();
-        }
-        if (procStats.tagNum == 0) {
-            procStats.tStats = nullptr;
         }
     }
-    m_communicationSocket->Write(tmp, msgSize);
-    delete []tmp;
-    tmp = nullptr;
-}
-
-void ServiceController::SendProcLogTypeStats(const LogStats& stats)
-{
-    const PidTable& pTable = stats.GetPidTable();
-    for (auto &it : pTable) {
-        int typeNum = 0;
-        for (auto &itt : it.second.stats) {
-            if (itt.GetTotalLines() == 0) {
-                continue;
-            }
-            typeNum++;
-        }
-        int msgSize =  typeNum * sizeof(LogTypeStatsRsp);
-        if (msgSize == 0) {
-            return;
-        }
-        char* tmp = new (std::nothrow) char[msgSize];
-        if (tmp == nullptr) {
-            return;
-        }
-        if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-            delete []tmp;
-            tmp = nullptr;
-            return;
-        }
-        LogTypeStatsRsp *lStats = reinterpret_cast<LogTypeStatsRsp *>(tmp);
-        int i = 0;
-        int j = 0;
-        for (auto &itt : it.second.stats) {
-            j++;
-            if (itt.GetTotalLines() == 0) {
-                continue;
-            }
-            LogTypeStatsRsp &logTypeStats = lStats[i];
-            logTypeStats.type = (j - 1);
-            StatsEntry2StatsRsp(itt, logTypeStats.stats);
-            i++;
-        }
-        m_communicationSocket->Write(tmp, msgSize);
-        delete []tmp;
-        tmp = nullptr;
+    if (!stats.IsTagEnable()) {
+        return;
+    }
+    it = pTable.begin();
+    for (uint16_t i = 0; i < procNum; i++, ++it) {
+        AppendTagStats(snapshot, msgLens, errLines, it->second.tagStats);
     }
 }
 
-void ServiceController::SendProcTagStats(const LogStats& stats)
+// Copies the merged statistics in the StatsSnapshotHeader layout, call with GetLock() held
+static void BuildStatsSnapshot(const LogStats& stats, const HilogInputSocketServer::InputStats& input,
+    std::vector<char>& snapshot, std::vector<size_t>& msgLens)
 {
-    const PidTable& pTable = stats.GetPidTable();
-    for (auto &it : pTable) {
-        SendTagStats(it.second.tagStats);
-    }
+    snapshot.assign(sizeof(StatsSnapshotHeader), 0);
+    msgLens.clear();
+    StatsQueryRsp *rsp = AppendStats<StatsQueryRsp>(snapshot, msgLens, 1);
+    BuildOverallStats(stats, *rsp);
+    uint16_t typeNum = rsp->typeNum;
+    uint16_t procNum = rsp->procNum;
+    std::vector<uint32_t> errLines;
+    BuildDomainStats(stats, snapshot, msgLens, errLines, typeNum);
+    BuildProcStats(stats, snapshot, msgLens, errLines, procNum);
+    // Not a MSG_VER message, older clients don't get it
+    size_t offset = snapshot.size();
+    snapshot.resize(offset + sizeof(StatsSnapshotExtra) + errLines.size() * sizeof(uint32_t), 0);
+    StatsSnapshotExtra *extra = reinterpret_cast<StatsSnapshotExtra *>(snapshot.data() + offset);
+    extra->topK = stats.GetTopK();
+    extra->input.packets = input.packets;
+    extra->input.bytes = input.bytes;
+    extra->input.recvCalls = input.recvCalls;
+    extra->input.dropped = input.dropped;
+    extra->input.queueFull = input.queueFull;
+    extra->entryNum = errLines.size();
+    if (!errLines.empty()) {
+        (void)memcpy_s(snapshot.data() + offset + sizeof(StatsSnapshotExtra), errLines.size() * sizeof(uint32_t),
+            errLines.data(), errLines.size() * sizeof(uint32_t));
+    }
+    StatsSnapshotHeader *header = reinterpret_cast<StatsSnapshotHeader *>(snapshot.data());
+    header->version = STATS_SNAPSHOT_VERSION;
+    header->len = snapshot.size();
 }
 
-void ServiceController::SendTagStats(const TagTable &tagTable)
+void ServiceController::WriteStatsSnapshot(const std::vector<char>& snapshot, const std::vector<size_t>& msgLens,
+    uint8_t ver)
 {
-    int msgSize =  tagTable.size() * sizeof(TagStatsRsp);
-    if (msgSize == 0) {
-        return;
-    }
-    char* tmp = new (std::nothrow) char[msgSize];
-    if (tmp == nullptr) {
-        return;
-    }
-    if (memset_s(tmp, msgSize, 0, msgSize) != 0) {
-        delete []tmp;
-        tmp = nullptr;
+    if (ver >= MSG_VER_STATS_SNAPSHOT) {
+        WriteRspHeader(IoctlCmd::STATS_QUERY_RSP, sizeof(StatsQueryRsp), MSG_VER_STATS_SNAPSHOT);
+        for (size_t offset = 0; offset < snapshot.size(); offset += OUTPUT_FRAME_MAX_LEN) {
+            size_t len = std::min<size_t>(snapshot.size() - offset, OUTPUT_FRAME_MAX_LEN);
+            if (m_communicationSocket->Write(snapshot.data() + offset, len) < 0) {
+                return;
+            }
+        }
         return;
     }
-    TagStatsRsp *tStats = reinterpret_cast<TagStatsRsp *>(tmp);
-    int i = 0;
-    for (auto &itt : tagTable) {
-        TagStatsRsp &tagStats = tStats[i];
-        if (strncpy_s(tagStats.tag, MAX_TAG_LEN, itt.first.c_str(), MAX_TAG_LEN - 1) != 0) {
-            continue;
+    // Older clients read every table as its own message
+    WriteRspHeader(IoctlCmd::STATS_QUERY_RSP, sizeof(StatsQueryRsp));
+    size_t offset = sizeof(StatsSnapshotHeader);
+    for (size_t len : msgLens) {
+        if (m_communicationSocket->Write(snapshot.data() + offset, len) < 0) {
+            return;
         }
-        i++;
-        StatsEntry2StatsRsp(itt.second, tagStats.stats);
+        offset += len;
     }
-    m_communicationSocket->Write(tmp, msgSize);
-    delete []tmp;
-    tmp = nullptr;
 }
 
 int ServiceController::CheckOutputRqst(const OutputRqst& rqst)
@@ -498,48 +536,62 @@ void ServiceController::LogFilterFromOutputRqst(const OutputRqst& rqst, LogFilte
     }
 }
 
-void ServiceController::HandleOutputRqst(const OutputRqst &rqst)
+ServiceController::State ServiceController::HandleOutputRqst(const OutputRqst &rqst, uint8_t ver)
 {
     // check OutputRqst
     int ret = CheckOutputRqst(rqst);
     if (ret != RET_SUCCESS) {
         WriteErrorRsp(ret);
-        return;
+        return State::DONE;
     }
     LogFilter filter = {0};
     LogFilterFromOutputRqst(rqst, filter);
+    auto out = std::make_unique<OutputContext>(filter);
     int lines = rqst.headLines ? rqst.headLines : rqst.tailLines;
-    int tailCount = rqst.tailLines;
-    int linesCountDown = lines;
+    out->tailCount = rqst.tailLines;
+    out->lines = static_cast<size_t>(lines);
+    out->linesCountDown = out->lines;
+    out->noBlock = rqst.noBlock;
 
     bool isKmsg = IsKmsg(filter.types);
-    HilogBuffer& logBuffer = isKmsg ? m_kmsgBuffer : m_hilogBuffer;
-    HilogBuffer::ReaderId readId = isKmsg ? m_kmsgBufferReader : m_hilogBufferReader;
+    out->buffer = isKmsg ? &m_kmsgBuffer : &m_hilogBuffer;
+    out->readId = isKmsg ? m_kmsgBufferReader : m_hilogBufferReader;
 
-    WriteRspHeader(IoctlCmd::OUTPUT_RSP, sizeof(OutputRsp));
-    for (;;) {
-        std::optional<HilogData> data = logBuffer.Query(filter, readId, tailCount);
-        if (!data.has_value()) {
-            if (rqst.noBlock) {
-                // reach the end of buffer and don't block
-                (void)WriteQueryResponse(std::nullopt);
-                break;
-            }
-            std::unique_lock<decltype(m_notifyNewDataMtx)> ul(m_notifyNewDataMtx);
-            m_notifyNewDataCv.wait(ul);
-            continue;
-        }
-        int ret = WriteQueryResponse(data.value());
-        if (ret < 0) { // write socket failed, it means that client has disconnected
-            std::cerr << "Client disconnect" << std::endl;
-            break;
-        }
-        if (lines && (--linesCountDown) <= 0) {
-            (void)WriteQueryResponse(std::nullopt);
-            sleep(1); // let client receive all messages and exit gracefully
-            break;
-        }
+    // Clients which don't know the batch framing still get one log per message
+    out->batchMode = (ver >= MSG_VER_OUTPUT_BATCH);
+    out->frame.resize(out->batchMode ? OUTPUT_FRAME_MAX_LEN : sizeof(OutputRsp) + MAX_LOG_LEN);
+    WriteRspHeader(IoctlCmd::OUTPUT_RSP, sizeof(OutputRsp), out->batchMode ? MSG_VER_OUTPUT_BATCH : MSG_VER);
+
+    // From now on a slow client leaves its frames pending instead of blocking the thread serving it
+    int fd = m_communicationSocket->GetHandler();
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        std::cerr << "Set output socket nonblock failed" << std::endl;
+        return State::DONE;
+    }
+    m_output = std::move(out);
+    return ContinueOutput();
+}
+
+// "<compress algorithm>[+bin]" of PersistStartRqst::stream to LogPersistStartMsg::compressAlg and back
+static uint16_t Stream2CompressAlg(const string& stream)
+{
+    static const string binarySuffix = PERSIST_BINARY_STREAM_SUFFIX;
+    if (stream.size() >= binarySuffix.size() &&
+        stream.compare(stream.size() - binarySuffix.size(), binarySuffix.size(), binarySuffix) == 0) {
+        return LogCompress::Str2CompressType(stream.substr(0, stream.size() - binarySuffix.size())) |
+            PERSIST_BINARY_FLAG;
     }
+    return LogCompress::Str2CompressType(stream);
+}
+
+static string CompressAlg2Stream(uint16_t compressAlg)
+{
+    string stream = LogCompress::CompressType2Str(compressAlg & ~PERSIST_BINARY_FLAG);
+    if (compressAlg & PERSIST_BINARY_FLAG) {
+        stream += PERSIST_BINARY_STREAM_SUFFIX;
+    }
+    return stream;
 }
 
 int ServiceController::CheckPersistStartRqst(const PersistStartRqst &rqst)
@@ -561,6 +613,11 @@ int ServiceController::CheckPersistStartRqst(const PersistStartRqst &rqst)
     if (rqst.fileNum && (rqst.fileNum > MAX_LOG_FILE_NUM || rqst.fileNum < MIN_LOG_FILE_NUM)) {
         return ERR_LOG_FILE_NUM_INVALID;
     }
+    // hilog -I only inflates gzip, a zstd file of records couldn't be read back
+    uint16_t compressAlg = Stream2CompressAlg(string(rqst.stream, strnlen(rqst.stream, MAX_STREAM_NAME_LEN)));
+    if ((compressAlg & PERSIST_BINARY_FLAG) != 0 && (compressAlg & ~PERSIST_BINARY_FLAG) == COMPRESS_TYPE_ZSTD) {
+        return ERR_LOG_PERSIST_STREAM_INVALID;
+    }
     return RET_SUCCESS;
 }
 
@@ -568,7 +625,7 @@ void ServiceController::PersistStartRqst2Msg(const PersistStartRqst &rqst, LogPe
 {
     LogFilterFromOutputRqst(rqst.outputFilter, msg.filter);
     bool isKmsgType = rqst.outputFilter.types == (0b01 << LOG_KMSG);
-    msg.compressAlg = LogCompress::Str2CompressType(rqst.stream);
+    msg.compressAlg = Stream2CompressAlg(string(rqst.stream, strnlen(rqst.stream, MAX_STREAM_NAME_LEN)));
     msg.fileSize = rqst.fileSize == 0 ? DEFAULT_PERSIST_FILE_SIZE : rqst.fileSize;
     msg.fileNum = rqst.fileNum == 0 ? DEFAULT_PERSIST_FILE_NUM : rqst.fileNum;
     msg.jobId = rqst.jobId;
@@ -681,7 +738,7 @@ void ServiceController::HandlePersistQueryRqst(const PersistQueryRqst& rqst)
             return;
         }
         if (strncpy_s(task.stream, MAX_STREAM_NAME_LEN,
-            LogCompress::CompressType2Str(it->compressAlg).c_str(), MAX_STREAM_NAME_LEN - 1) != EOK) {
+            CompressAlg2Stream(it->compressAlg).c_str(), MAX_STREAM_NAME_LEN - 1) != EOK) {
             return;
         }
         rsp.jobNum++;
@@ -777,27 +834,51 @@ void ServiceController::HandleBufferSizeSetRqst(const BufferSizeSetRqst& rqst)
     (void)m_communicationSocket->Write(reinterpret_cast<char*>(&rsp), sizeof(rsp));
 }
 
-void ServiceController::HandleStatsQueryRqst(const StatsQueryRqst& rqst)
+void ServiceController::HandleStatsQueryRqst(const StatsQueryRqst& rqst, uint8_t ver)
 {
     LogStats& stats = m_hilogBuffer.GetStatsInfo();
     if (!stats.IsEnable()) {
         WriteErrorRsp(ERR_STATS_NOT_ENABLE);
         return;
     }
-    std::unique_lock<std::mutex> lk(stats.GetLock());
+    std::vector<char> snapshot;
+    std::vector<size_t> msgLens;
+    HilogInputSocketServer::InputStats input = {0};
+    (void)m_logCollector.GetInputStats(input);
+    {
+        std::unique_lock<std::mutex> lk(stats.GetLock());
+        stats.Merge();
+        BuildStatsSnapshot(stats, input, snapshot, msgLens);
+    }
+    WriteStatsSnapshot(snapshot, msgLens, ver);
+}
 
-    WriteRspHeader(IoctlCmd::STATS_QUERY_RSP, sizeof(StatsQueryRsp));
-    SendOverallStats(stats);
-    SendLogTypeDomainStats(stats);
-    SendDomainStats(stats);
-    if (stats.IsTagEnable()) {
-        SendDomainTagStats(stats);
+void ServiceController::HandleStatsSeriesRqst(const StatsSeriesRqst& rqst)
+{
+    LogStats& stats = m_hilogBuffer.GetStatsInfo();
+    if (!stats.IsEnable()) {
+        WriteErrorRsp(ERR_STATS_NOT_ENABLE);
+        return;
     }
-    SendProcStats(stats);
-    SendProcLogTypeStats(stats);
-    if (stats.IsTagEnable()) {
-        SendProcTagStats(stats);
+    if (rqst.count == 0 || rqst.count > MAX_SERIES_BUCKETS ||
+        (rqst.unit != StatsSeriesUnit::SECOND && rqst.unit != StatsSeriesUnit::MINUTE)) {
+        WriteErrorRsp(ERR_INVALID_ARGUMENT);
+        return;
     }
+    StatsSeriesRsp rsp = {};
+    rsp.unit = rqst.unit;
+    rsp.count = rqst.count;
+    LogTimeStamp tsNow(CLOCK_REALTIME);
+    LogTimeStamp monoNow(CLOCK_MONOTONIC);
+    // Buckets follow monotonic time, a minute one started some seconds before now
+    static constexpr uint32_t MIN2SEC = 60;
+    rsp.endSec = tsNow.tv_sec - ((rqst.unit == StatsSeriesUnit::MINUTE) ? monoNow.tv_sec % MIN2SEC : 0);
+    {
+        std::unique_lock<std::mutex> lk(stats.GetLock());
+        stats.MergeSeries(rqst, monoNow.tv_sec, rsp.buckets);
+    }
+    WriteRspHeader(IoctlCmd::STATS_SERIES_RSP, sizeof(rsp));
+    (void)m_communicationSocket->Write(reinterpret_cast<char*>(&rsp), sizeof(rsp));
 }
 
 void ServiceController::HandleStatsClearRqst(const StatsClearRqst& rqst)
@@ -864,25 +945,25 @@ bool ServiceController::IsValidCmd(const CmdList& list, IoctlCmd cmd)
     return (it != list.end());
 }
 
-void ServiceController::CommunicationLoop(std::atomic<bool>& stopLoop, const CmdList& list)
+ServiceController::State ServiceController::HandleRequest(const CmdList& list)
 {
-    std::cout << "ServiceController Loop Begin" << std::endl;
     MsgHeader hdr;
     int ret = GetMsgHeader(hdr);
     if (ret != RET_SUCCESS) {
-        return;
+        return State::DONE;
     }
     IoctlCmd cmd = static_cast<IoctlCmd>(hdr.cmd);
     std::cout << "Receive cmd: " << static_cast<int>(cmd) << endl;
     if (!IsValidCmd(list, cmd)) {
         cout << "Not valid cmd for this executor" << endl;
         WriteErrorRsp(ERR_INVALID_RQST_CMD);
-        return;
+        return State::DONE;
     }
+    State state = State::DONE;
     switch (cmd) {
         case IoctlCmd::OUTPUT_RQST: {
-            RequestHandler<OutputRqst>(hdr, [this](const OutputRqst& rqst) {
-                HandleOutputRqst(rqst);
+            RequestHandler<OutputRqst>(hdr, [this, &hdr, &state](const OutputRqst& rqst) {
+                state = HandleOutputRqst(rqst, hdr.ver);
             });
             break;
         }
@@ -917,8 +998,8 @@ void ServiceController::CommunicationLoop(std::atomic<bool>& stopLoop, const Cmd
             break;
         }
         case IoctlCmd::STATS_QUERY_RQST: {
-            RequestHandler<StatsQueryRqst>(hdr, [this](const StatsQueryRqst& rqst) {
-                HandleStatsQueryRqst(rqst);
+            RequestHandler<StatsQueryRqst>(hdr, [this, &hdr](const StatsQueryRqst& rqst) {
+                HandleStatsQueryRqst(rqst, hdr.ver);
             });
             break;
         }
@@ -958,18 +1039,26 @@ void ServiceController::CommunicationLoop(std::atomic<bool>& stopLoop, const Cmd
             });
             break;
         }
+        case IoctlCmd::STATS_SERIES_RQST: {
+            RequestHandler<StatsSeriesRqst>(hdr, [this](const StatsSeriesRqst& rqst) {
+                HandleStatsSeriesRqst(rqst);
+            });
+            break;
+        }
         default: {
             std::cerr << " Unknown message. Skipped!" << endl;
             break;
         }
     }
-    stopLoop.store(true);
-    std::cout << " ServiceController Loop End" << endl;
+    return state;
 }
 
 void ServiceController::NotifyForNewData()
 {
-    m_notifyNewDataCv.notify_one();
+    // Only called once the output ran dry and its reader was parked
+    if (m_onReady) {
+        m_onReady();
+    }
 }
 
 int RestorePersistJobs(HilogBuffer& hilogBuffer, HilogBuffer& kmsgBuffer)
@@ -985,7 +1074,7 @@ int RestorePersistJobs(HilogBuffer& hilogBuffer, HilogBuffer& kmsgBuffer)
         size_t length = strlen(ent->d_name);
         std::string pPath(ent->d_name, length);
         if (length >= INFO_SUFFIX && pPath.substr(length - INFO_SUFFIX, length) == ".info") {
-            if (pPath == "hilog.info") {
+            if (pPath == "hilog.info" || pPath == KMSG_RESUME_INFO) {
                 continue;
             }
             std::cout << " Found a persist job! Path: " << LOG_PERSISTER_DIR + pPath << "\n";
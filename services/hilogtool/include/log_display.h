@@ -17,11 +17,13 @@
 #define LOG_DISPLAY_H
 
 #include "hilog_common.h"
+#include "log_ioctl.h"
 
 namespace OHOS {
 namespace HiviewDFX {
 using namespace std;
-void HilogShowLogStatsInfo(const StatsQueryRsp& rsp);
+void HilogShowLogStatsInfo(const StatsQueryRsp& rsp, const StatsQueryExtra& extra);
+void HilogShowLogStatsSeries(const StatsSeriesRqst& rqst, const StatsSeriesRsp& rsp);
 } // namespace HiviewDFX
 } // namespace OHOS
 #endif
@@ -0,0 +1,43 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#ifndef LOG_PERSIST_READER_H
+#define LOG_PERSIST_READER_H
+
+#include <cstdint>
+#include <functional>
+#include <string>
+
+#include "hilog_common.h"
+#include "log_filter.h"
+
+namespace OHOS {
+namespace HiviewDFX {
+using PersistLogHandler = std::function<void(const HilogMsg& msg)>;
+/* realtime of the wanted logs in nanoseconds, both ends included */
+struct PersistTimeRange {
+    uint64_t begin = 0;
+    uint64_t end = UINT64_MAX;
+};
+/*
+ * Reads back a file of a binary persist job, see hilog_persist.h. Gzip files are inflated as they are
+ * read. Of a finished file only the frames its index places in range are read, a file still being
+ * written or cut by a crash has no index and is read up to its last flushed block.
+ */
+int ReadPersistFile(const std::string& path, const LogFilter& filter, const PersistTimeRange& range,
+    const PersistLogHandler& handle);
+} // namespace HiviewDFX
+} // namespace OHOS
+#endif
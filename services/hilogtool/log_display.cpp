@@ -112,14 +112,24 @@ static uint64_t GetTotalLen(const StatsRsp &rsp)
     return len;
 }
 
-static void PrintStats(const StatsRsp &rsp)
+static string LinesStr(const StatsRsp &rsp, const StatsQueryExtra& extra)
+{
+    string lines = to_string(GetTotalLines(rsp));
+    auto it = extra.errLines.find(&rsp);
+    if (it != extra.errLines.end()) {
+        lines += "(+" + to_string(it->second) + ")";
+    }
+    return lines;
+}
+
+static void PrintStats(const StatsRsp &rsp, const StatsQueryExtra& extra)
 {
     cout << fixed;
     cout << setw(FREQ_W) << setprecision(FLOAT_PRECSION) << rsp.freqMax << colCmd;
     cout << setw(TIME_W) << TimeStr(rsp.freqMaxSec, rsp.freqMaxNsec) << colCmd;
     cout << setw(TP_W) << setprecision(FLOAT_PRECSION) << rsp.throughputMax << colCmd;
     cout << setw(TIME_W) << TimeStr(rsp.tpMaxSec, rsp.tpMaxNsec) << colCmd;
-    cout << setw(LINES_W) << GetTotalLines(rsp) << colCmd;
+    cout << setw(LINES_W) << LinesStr(rsp, extra) << colCmd;
     cout << setw(LENGTH_W) << Size2Str(GetTotalLen(rsp)) << colCmd;
     cout << setw(DROPPED_W) << rsp.dropped << colCmd;
 }
@@ -141,31 +151,34 @@ static string DurationStr(uint32_t tv_sec, uint32_t tv_nsec)
     return buffer;
 }
 
+// Sorts pointers to the entries, extra finds an entry by its address
 template<typename T>
-static void SortByLens(vector<T>& v, const T* list, int num)
+static void SortByLens(vector<const T*>& v, const T* list, int num)
 {
-    v.insert(v.begin(), list, list + num);
-    std::sort(v.begin(), v.end(), [](T& a, T& b) {
-        return GetTotalLen(a.stats) > GetTotalLen(b.stats);
+    for (int i = 0; i < num; i++) {
+        v.push_back(list + i);
+    }
+    std::sort(v.begin(), v.end(), [](const T* a, const T* b) {
+        return GetTotalLen(a->stats) > GetTotalLen(b->stats);
     });
 }
 
-static void SortDomainList(vector<DomainStatsRsp>& vd, const DomainStatsRsp* domainList, int num)
+static void SortDomainList(vector<const DomainStatsRsp*>& vd, const DomainStatsRsp* domainList, int num)
 {
     SortByLens(vd, domainList, num);
 }
 
-static void SortProcList(vector<ProcStatsRsp>& vp, const ProcStatsRsp* procList, int num)
+static void SortProcList(vector<const ProcStatsRsp*>& vp, const ProcStatsRsp* procList, int num)
 {
     SortByLens(vp, procList, num);
 }
 
-static void SortTagList(vector<TagStatsRsp>& vt, const TagStatsRsp* tagList, int num)
+static void SortTagList(vector<const TagStatsRsp*>& vt, const TagStatsRsp* tagList, int num)
 {
     SortByLens(vt, tagList, num);
 }
 
-static void HilogShowDomainStatsInfo(const StatsQueryRsp& rsp)
+static void HilogShowDomainStatsInfo(const StatsQueryRsp& rsp, const StatsQueryExtra& extra)
 {
     cout << "Domain Table:" << endl;
     PrintDomainTitle();
@@ -178,27 +191,27 @@ static void HilogShowDomainStatsInfo(const StatsQueryRsp& rsp)
         if (ldStats.dStats == nullptr) {
             continue;
         }
-        vector<DomainStatsRsp> vd; // sort domain list
+        vector<const DomainStatsRsp*> vd; // sort domain list
         SortDomainList(vd, ldStats.dStats, ldStats.domainNum);
         for (j = 0; j < ldStats.domainNum; j++) {
-            DomainStatsRsp &dStats = vd[j];
+            const DomainStatsRsp &dStats = *vd[j];
             cout << setw(LOGTYPE_W) << LogType2Str(ldStats.type) << colCmd;
             cout << std::hex << "0x" << setw(DOMAIN_W) << dStats.domain << std::dec << colCmd;
             cout << setw(TAG_W) << "-" << colCmd;
-            PrintStats(dStats.stats);
+            PrintStats(dStats.stats, extra);
             cout << endl;
             uint16_t k = 0;
             if (dStats.tStats == nullptr) {
                 continue;
             }
-            vector<TagStatsRsp> vt; // sort tag list
+            vector<const TagStatsRsp*> vt; // sort tag list
             SortTagList(vt, dStats.tStats, dStats.tagNum);
             for (k = 0; k < dStats.tagNum; k++) {
-                TagStatsRsp &tStats = vt[k];
+                const TagStatsRsp &tStats = *vt[k];
                 cout << setw(LOGTYPE_W) << LogType2Str(ldStats.type) << colCmd;
                 cout << std::hex << "0x" << setw(DOMAIN_W) << dStats.domain << std::dec << colCmd;
                 cout << setw(TAG_W) << tStats.tag << colCmd;
-                PrintStats(tStats.stats);
+                PrintStats(tStats.stats, extra);
                 cout << endl;
             }
         }
@@ -226,7 +239,7 @@ static inline void HiLogShowProcInfo(const std::string& logType, uint32_t pid, c
     cout << setw(TAG_W) << tag << colCmd;
 }
 
-static void HilogShowProcStatsInfo(const StatsQueryRsp& rsp)
+static void HilogShowProcStatsInfo(const StatsQueryRsp& rsp, const StatsQueryExtra& extra)
 {
     cout << "Pid Table:" << endl;
     PrintPidTitle();
@@ -236,13 +249,13 @@ static void HilogShowProcStatsInfo(const StatsQueryRsp& rsp)
     if (rsp.pStats == nullptr) {
         return;
     }
-    vector<ProcStatsRsp> vp; // sort process list
+    vector<const ProcStatsRsp*> vp; // sort process list
     SortProcList(vp, rsp.pStats, rsp.procNum);
     for (i = 0; i < rsp.procNum; i++) {
-        ProcStatsRsp &pStats = vp[i];
+        const ProcStatsRsp &pStats = *vp[i];
         string name = GetProcessName(pStats);
         HiLogShowProcInfo("-", pStats.pid, name, "-");
-        PrintStats(pStats.stats);
+        PrintStats(pStats.stats, extra);
         cout << endl;
         uint16_t j = 0;
         if (pStats.lStats == nullptr) {
@@ -254,24 +267,24 @@ static void HilogShowProcStatsInfo(const StatsQueryRsp& rsp)
                 continue;
             }
             HiLogShowProcInfo(LogType2Str(lStats.type), pStats.pid, name, "-");
-            PrintStats(lStats.stats);
+            PrintStats(lStats.stats, extra);
             cout << endl;
         }
         if (pStats.tStats == nullptr) {
             continue;
         }
-        vector<TagStatsRsp> vt; // sort tag list
+        vector<const TagStatsRsp*> vt; // sort tag list
         SortTagList(vt, pStats.tStats, pStats.tagNum);
         for (j = 0; j < pStats.tagNum; j++) {
-            TagStatsRsp &tStats = vt[j];
+            const TagStatsRsp &tStats = *vt[j];
             HiLogShowProcInfo("-", pStats.pid, name, std::string(tStats.tag));
-            PrintStats(tStats.stats);
+            PrintStats(tStats.stats, extra);
             cout << endl;
         }
     }
 }
 
-void HilogShowLogStatsInfo(const StatsQueryRsp& rsp)
+void HilogShowLogStatsInfo(const StatsQueryRsp& rsp, const StatsQueryExtra& extra)
 {
     cout << std::left;
     cout << "Log statistic report (Duration: " << DurationStr(rsp.durationSec, rsp.durationNsec);
@@ -286,6 +299,15 @@ void HilogShowLogStatsInfo(const StatsQueryRsp& rsp)
         return;
     }
     cout << "Total lines: " << lines << ", length: " << Size2Str(lens) << endl;
+    const StatsInputCounters& input = extra.input;
+    if (input.recvCalls != 0) {
+        cout << "Input socket packets: " << input.packets << ", length: " << Size2Str(input.bytes);
+        cout << ", receive calls: " << input.recvCalls << ", dropped: " << input.dropped;
+        cout << ", queue full: " << input.queueFull << endl;
+    }
+    if (extra.topK != 0) {
+        cout << "Top " << extra.topK << " entries per table are tracked, LINES(+n) may lack up to n lines" << endl;
+    }
     static const int PERCENT = 100;
     for (int i = 0; i < LevelNum; i++) {
         string level = LogLevel2Str(static_cast<uint16_t>(i + LevelBase));
@@ -298,9 +320,38 @@ void HilogShowLogStatsInfo(const StatsQueryRsp& rsp)
         cout<< endl;
     }
     cout << setw(STATS_W) << setfill('-') << "-" << endl;
-    HilogShowDomainStatsInfo(rsp);
+    HilogShowDomainStatsInfo(rsp, extra);
     cout << setw(STATS_W) << setfill('-') << "-" << endl;
-    HilogShowProcStatsInfo(rsp);
+    HilogShowProcStatsInfo(rsp, extra);
+}
+
+void HilogShowLogStatsSeries(const StatsSeriesRqst& rqst, const StatsSeriesRsp& rsp)
+{
+    bool minutes = (rsp.unit == StatsSeriesUnit::MINUTE);
+    uint32_t unitSecs = minutes ? MIN2SEC : 1;
+    cout << std::left;
+    cout << "Log rate of the last " << static_cast<int>(rsp.count) << (minutes ? " minutes" : " seconds");
+    if (rqst.scope == StatsSeriesScope::BY_DOMAIN) {
+        cout << " (domain 0x" << std::hex << rqst.id << std::dec << ")";
+    } else if (rqst.scope == StatsSeriesScope::BY_PID) {
+        cout << " (pid " << rqst.id << ")";
+    }
+    cout << ", the last " << (minutes ? "minute" : "second") << " is still counted:" << endl;
+    cout << setw(TIME_W) << "TIME" << colCmd;
+    cout << setw(FREQ_W) << "LINES/S" << colCmd;
+    cout << setw(TP_W) << "LENGTH/S" << colCmd;
+    cout << setw(DROPPED_W) << "DROPPED" << colCmd;
+    cout << endl;
+    cout << fixed;
+    for (int i = 0; i < rsp.count && i < MAX_SERIES_BUCKETS; i++) {
+        const StatsSeriesBucket &bucket = rsp.buckets[i];
+        uint32_t sec = rsp.endSec - (rsp.count - 1 - i) * unitSecs;
+        cout << setw(TIME_W) << TimeStr(sec, 0) << colCmd;
+        cout << setw(FREQ_W) << setprecision(FLOAT_PRECSION) << (static_cast<float>(bucket.lines) / unitSecs) << colCmd;
+        cout << setw(TP_W) << Size2Str(bucket.len / unitSecs) << colCmd;
+        cout << setw(DROPPED_W) << bucket.dropped << colCmd;
+        cout << endl;
+    }
 }
 } // namespace HiviewDFX
 } // namespace OHOS
\ No newline at end of file
@@ -0,0 +1,218 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include "log_persist_reader.h"
+
+#include <algorithm>
+#include <fstream>
+#include <vector>
+#include <zlib.h>
+#include <securec.h>
+
+#include <hilog_persist.h>
+
+namespace OHOS {
+namespace HiviewDFX {
+using namespace std;
+static constexpr size_t READ_CHUNK = 64 * 1024;
+static constexpr unsigned char GZIP_MAGIC[] = {0x1f, 0x8b};
+static constexpr uint64_t NSEC_PER_SEC = 1000000000ULL;
+/* the empty gzip member carrying the index, see ZlibCompress::AppendIndex() */
+static constexpr unsigned char INDEX_MEMBER_HEAD[] = {0x1f, 0x8b, Z_DEFLATED, 0x04};
+static constexpr size_t INDEX_MEMBER_HEAD_LEN = 16;
+static constexpr unsigned char INDEX_MEMBER_TAIL[] = {0x03, 0x00, 0, 0, 0, 0, 0, 0, 0, 0};
+static constexpr size_t XLEN_POS = 10;
+static constexpr size_t SUBFIELD_POS = 12;
+static constexpr size_t SUBFIELD_LEN_POS = 14;
+
+static uint64_t ToNsec(uint32_t sec, uint32_t nsec)
+{
+    return sec * NSEC_PER_SEC + nsec;
+}
+
+static bool InRange(const PersistTimeRange& range, uint64_t min, uint64_t max)
+{
+    return max >= range.begin && min <= range.end;
+}
+
+static uint16_t ReadLe16(const unsigned char* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+// Hands over the records of the complete blocks in data, consumed tells where the incomplete one starts
+static int ParseBlocks(const vector<char>& data, size_t len, const CompiledLogFilter& filter,
+    const PersistTimeRange& range, const PersistLogHandler& handle, size_t& consumed)
+{
+    const LogFilter& wanted = filter.GetFilter();
+    size_t pos = 0;
+    while (len - pos >= sizeof(PersistBlockHeader)) {
+        PersistBlockHeader block;
+        if (memcpy_s(&block, sizeof(block), data.data() + pos, sizeof(block)) != EOK) {
+            return RET_FAIL;
+        }
+        if (block.magic != PERSIST_BLOCK_MAGIC || block.version != PERSIST_BLOCK_VERSION ||
+            block.len < sizeof(PersistBlockHeader) || block.len > MAX_PERSISTER_BUFFER_SIZE) {
+            return ERR_PERSIST_FILE_FORMAT_INVALID;
+        }
+        if (len - pos < block.len) {
+            break;
+        }
+        if ((block.types & wanted.types) != 0 && (block.levels & wanted.levels) != 0 &&
+            InRange(range, ToNsec(block.minSec, block.minNsec), ToNsec(block.maxSec, block.maxNsec))) {
+            size_t offset = pos + sizeof(PersistBlockHeader);
+            size_t end = pos + block.len;
+            for (uint32_t i = 0; i < block.count && end - offset >= sizeof(HilogMsg); i++) {
+                const HilogMsg* msg = reinterpret_cast<const HilogMsg*>(data.data() + offset);
+                // Tag and content are printed as strings, both must end with their '\0'
+                if (msg->tagLen == 0 || msg->len <= sizeof(HilogMsg) + msg->tagLen || msg->len > end - offset ||
+                    msg->tag[msg->tagLen - 1] != '\0' || data[offset + msg->len - 1] != '\0') {
+                    return ERR_PERSIST_FILE_FORMAT_INVALID;
+                }
+                uint64_t time = ToNsec(msg->tv_sec, msg->tv_nsec);
+                if (InRange(range, time, time) && filter.Match(*msg)) {
+                    handle(*msg);
+                }
+                offset += msg->len;
+            }
+        }
+        pos += block.len;
+    }
+    consumed = pos;
+    return RET_SUCCESS;
+}
+
+// Reads the index a finished gzip file ends with, false if there is none
+static bool LoadIndex(ifstream& file, vector<PersistIndexEntry>& index)
+{
+    file.seekg(0, ios::end);
+    uint64_t size = static_cast<uint64_t>(file.tellg());
+    unsigned char end[sizeof(PersistIndexTrailer) + sizeof(INDEX_MEMBER_TAIL)];
+    if (size < INDEX_MEMBER_HEAD_LEN + sizeof(end) ||
+        !file.seekg(size - sizeof(end)).read(reinterpret_cast<char*>(end), sizeof(end)) ||
+        memcmp(end + sizeof(PersistIndexTrailer), INDEX_MEMBER_TAIL, sizeof(INDEX_MEMBER_TAIL)) != 0) {
+        return false;
+    }
+    PersistIndexTrailer trailer;
+    (void)memcpy_s(&trailer, sizeof(trailer), end, sizeof(trailer));
+    uint64_t indexLen = static_cast<uint64_t>(trailer.count) * sizeof(PersistIndexEntry) + sizeof(trailer);
+    if (trailer.magic != PERSIST_INDEX_MAGIC || trailer.version != PERSIST_INDEX_VERSION ||
+        indexLen + INDEX_MEMBER_HEAD_LEN + sizeof(INDEX_MEMBER_TAIL) > size) {
+        return false;
+    }
+    uint64_t memberPos = size - sizeof(INDEX_MEMBER_TAIL) - indexLen - INDEX_MEMBER_HEAD_LEN;
+    unsigned char head[INDEX_MEMBER_HEAD_LEN];
+    if (!file.seekg(memberPos).read(reinterpret_cast<char*>(head), sizeof(head)) ||
+        memcmp(head, INDEX_MEMBER_HEAD, sizeof(INDEX_MEMBER_HEAD)) != 0 ||
+        head[SUBFIELD_POS] != PERSIST_INDEX_SUBFIELD_ID1 || head[SUBFIELD_POS + 1] != PERSIST_INDEX_SUBFIELD_ID2 ||
+        ReadLe16(head + SUBFIELD_LEN_POS) != indexLen || ReadLe16(head + XLEN_POS) != indexLen + 4) {
+        return false;
+    }
+    index.resize(trailer.count);
+    if (!file.read(reinterpret_cast<char*>(index.data()), trailer.count * sizeof(PersistIndexEntry))) {
+        return false;
+    }
+    for (const auto& entry : index) {
+        if (static_cast<uint64_t>(entry.offset) + entry.len > memberPos) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// Inflates at most len bytes from the current position of the file and parses the blocks in them
+static int ReadFrames(ifstream& file, uint64_t len, bool gzip, const CompiledLogFilter& filter,
+    const PersistTimeRange& range, const PersistLogHandler& handle)
+{
+    vector<char> in(READ_CHUNK);
+    vector<char> data;
+    size_t used = 0;
+    z_stream stream = {};
+    if (gzip && inflateInit2(&stream, MAX_WBITS + 16) != Z_OK) {
+        return RET_FAIL;
+    }
+    int ret = RET_SUCCESS;
+    while (ret == RET_SUCCESS && len > 0 && file.read(in.data(), min<uint64_t>(len, in.size())).gcount() > 0) {
+        size_t inLen = static_cast<size_t>(file.gcount());
+        len -= inLen;
+        if (!gzip) {
+            data.resize(used + inLen);
+            (void)memcpy_s(data.data() + used, inLen, in.data(), inLen);
+            used += inLen;
+        } else {
+            stream.next_in = reinterpret_cast<Bytef*>(in.data());
+            stream.avail_in = inLen;
+            do {
+                data.resize(used + READ_CHUNK);
+                stream.next_out = reinterpret_cast<Bytef*>(data.data() + used);
+                stream.avail_out = READ_CHUNK;
+                int zret = inflate(&stream, Z_NO_FLUSH);
+                used += READ_CHUNK - stream.avail_out;
+                if (zret == Z_STREAM_END) {
+                    (void)inflateReset(&stream); // every chunk hilogd compressed is a member of its own
+                } else if (zret == Z_BUF_ERROR && stream.avail_out != 0) {
+                    break;
+                } else if (zret != Z_OK && zret != Z_BUF_ERROR) {
+                    ret = ERR_PERSIST_FILE_FORMAT_INVALID;
+                    break;
+                }
+            } while (stream.avail_in > 0 || stream.avail_out == 0);
+        }
+        size_t consumed = 0;
+        if (int parsed = ParseBlocks(data, used, filter, range, handle, consumed); parsed != RET_SUCCESS) {
+            ret = parsed;
+        }
+        data.erase(data.begin(), data.begin() + consumed);
+        used -= consumed;
+    }
+    if (gzip) {
+        (void)inflateEnd(&stream);
+    }
+    return ret;
+}
+
+int ReadPersistFile(const string& path, const LogFilter& filter, const PersistTimeRange& range,
+    const PersistLogHandler& handle)
+{
+    ifstream file(path, ios::binary);
+    if (!file.is_open()) {
+        return ERR_LOG_PERSIST_FILE_OPEN_FAIL;
+    }
+    CompiledLogFilter compiledFilter(filter);
+    unsigned char magic[sizeof(GZIP_MAGIC)] = {0};
+    bool gzip = file.read(reinterpret_cast<char*>(magic), sizeof(magic)) &&
+        memcmp(magic, GZIP_MAGIC, sizeof(GZIP_MAGIC)) == 0;
+    vector<PersistIndexEntry> index;
+    if (!gzip || !LoadIndex(file, index)) {
+        file.clear();
+        file.seekg(0);
+        return ReadFrames(file, UINT64_MAX, gzip, compiledFilter, range, handle);
+    }
+    // Only the frames overlapping the range are inflated
+    for (const auto& entry : index) {
+        if (entry.count == 0 ||
+            !InRange(range, ToNsec(entry.minSec, entry.minNsec), ToNsec(entry.maxSec, entry.maxNsec))) {
+            continue;
+        }
+        file.clear();
+        file.seekg(entry.offset);
+        if (int ret = ReadFrames(file, entry.len, gzip, compiledFilter, range, handle); ret != RET_SUCCESS) {
+            return ret;
+        }
+    }
+    return RET_SUCCESS;
+}
+} // namespace HiviewDFX
+} // namespace OHOS
@@ -30,6 +30,7 @@
 #include <properties.h>
 
 #include "log_display.h"
+#include "log_persist_reader.h"
 
 namespace OHOS {
 namespace HiviewDFX {
@@ -137,6 +138,12 @@ static void StatisticHelper()
     << "  Query log statistic information." << endl
     << "  Set param persist.sys.hilog.stats true to enable statistic." << endl
     << "  Set param persist.sys.hilog.stats.tag true to enable statistic of log tag." << endl
+    << "  Set param persist.sys.hilog.stats.topk N to keep only the N busiest domains, tags" << endl
+    << "  and processes, their lines are shown with the most they may lack." << endl
+    << "  The names of tags are not limited, each one is kept until the statistic is cleared." << endl
+    << "-R <N>, --rate=<N>" << endl
+    << "  Show the log rate of the last N seconds, N is at most 60." << endl
+    << "  Use Nm for the last N minutes, combine with -D or -P for one domain or process." << endl
     << "-S" << endl
     << "  Clear hilogd statistic information." << endl;
 }
@@ -167,11 +174,21 @@ static void PersistTaskHelper()
     << "    Set log file compressed algorithm, options are:" << endl
     << "      none       write file with non-compressed logs." << endl
     << "      zlib       write file with zlib compressed logs." << endl
+    << "    Append +bin to none or zlib, e.g. zlib+bin, to store logs as records rather than text," << endl
+    << "    it costs hilogd less CPU. Such files are read with -I." << endl
     << "  -j <jobid>, --jobid<jobid>" << endl
     << "    Start/stop specific task of <jobid>." << endl
     << "    <jobid> range: [" << JOB_ID_MIN << ", 0x" << hex << JOB_ID_MAX << dec << ")." << endl
     << "  User can start task with options (t/L/D/T/P/e/v) as if using them when \"Query logs\" too." << endl
-    << "  **It's a persistant configuration**" << endl;
+    << "  **It's a persistant configuration**" << endl
+    << "-I <filename>, --input=<filename>" << endl
+    << "  Print a file written by a +bin persistance task, <filename> is looked up in " << HILOG_FILE_DIR << endl
+    << "  if it has no path. Options t/L/D/T/P/e/v apply as when querying logs." << endl
+    << "  -i <begin>[,<end>], --interval=<begin>[,<end>]" << endl
+    << "    Show only logs written in the interval, which is open ended without <end>. A time could be:" << endl
+    << "    seconds since 1970/1/1, \"YYYY-MM-DD HH:MM:SS\" or \"MM-DD HH:MM:SS\" of this year," << endl
+    << "    each optionally followed by a fraction of second, e.g. \"05-20 10:30:00.500\"." << endl
+    << "    Only the parts of a finished file holding such logs are read." << endl;
 }
 
 static void PrivateHelper()
@@ -297,7 +314,9 @@ enum class ControlCmd {
     CMD_BUFFER_SIZE_SET,
     CMD_STATS_INFO_QUERY,
     CMD_STATS_INFO_CLEAR,
+    CMD_STATS_SERIES_QUERY,
     CMD_PERSIST_TASK,
+    CMD_PERSIST_FILE_READ,
     CMD_PRIVATE_FEATURE_SET,
     CMD_KMSG_FEATURE_SET,
     CMD_FLOWCONTROL_FEATURE_SET,
@@ -334,6 +353,8 @@ struct HilogArgs {
     bool wrap = false;
     bool noBlock = false;
     uint16_t tailLines = 0;
+    uint64_t beginTime = 0;
+    uint64_t endTime = UINT64_MAX;
 
     void ToOutputRqst(OutputRqst& rqst)
     {
@@ -365,6 +386,42 @@ struct HilogArgs {
         rqst.tailLines = tailLines;
     }
 
+    void ToLogFormat(LogFormat& format)
+    {
+        format.colorful = colorful;
+        format.timeFormat = ((timeFormat == FormatTime::INVALID) ? FormatTime::TIME : timeFormat);
+        format.timeAccuFormat = ((timeAccuFormat == FormatTimeAccu::INVALID) ? FormatTimeAccu::MSEC : timeAccuFormat);
+        format.year = year;
+        format.zone = zone;
+        format.wrap = wrap;
+    }
+
+    void ToLogFilter(LogFilter& filter)
+    {
+        OutputRqst rqst = { 0 };
+        ToOutputRqst(rqst);
+        filter.types = (types == 0) ? static_cast<uint16_t>(~0) : types; // the task chose the types already
+        filter.levels = (levels == 0) ? static_cast<uint16_t>(~0) : levels;
+        filter.blackDomain = rqst.blackDomain;
+        filter.domainCount = rqst.domainCount;
+        if (memcpy_s(filter.domains, sizeof(filter.domains), rqst.domains, sizeof(rqst.domains)) != EOK) {
+            return;
+        }
+        filter.blackTag = rqst.blackTag;
+        filter.tagCount = rqst.tagCount;
+        if (memcpy_s(filter.tags, sizeof(filter.tags), rqst.tags, sizeof(rqst.tags)) != EOK) {
+            return;
+        }
+        filter.blackPid = rqst.blackPid;
+        filter.pidCount = rqst.pidCount;
+        if (memcpy_s(filter.pids, sizeof(filter.pids), rqst.pids, sizeof(rqst.pids)) != EOK) {
+            return;
+        }
+        if (memcpy_s(filter.regex, sizeof(filter.regex), rqst.regex, sizeof(rqst.regex)) != EOK) {
+            return;
+        }
+    }
+
     void ToPersistStartRqst(PersistStartRqst& rqst)
     {
         ToOutputRqst(rqst.outputFilter);
@@ -405,6 +462,19 @@ struct HilogArgs {
         }
     }
 
+    void ToStatsSeriesRqst(StatsSeriesRqst& rqst)
+    {
+        if (pidCount > 0) {
+            rqst.scope = StatsSeriesScope::BY_PID;
+            rqst.id = pids[0];
+        } else if (domainCount > 0) {
+            rqst.scope = StatsSeriesScope::BY_DOMAIN;
+            rqst.id = domains[0];
+        } else {
+            rqst.scope = StatsSeriesScope::TOTAL;
+        }
+    }
+
     void ToLogRemoveRqst(LogRemoveRqst& rqst)
     {
         rqst.types = types;
@@ -437,15 +507,8 @@ static int QueryLogHandler(HilogArgs& context, const char *arg)
             .tag = rsp.data,
             .log = (rsp.data + rsp.tagLen)
         };
-        LogFormat format = {
-            .colorful = context.colorful,
-            .timeFormat = ((context.timeFormat == FormatTime::INVALID) ? FormatTime::TIME : context.timeFormat),
-            .timeAccuFormat =
-                ((context.timeAccuFormat == FormatTimeAccu::INVALID) ? FormatTimeAccu::MSEC : context.timeAccuFormat),
-            .year = context.year,
-            .zone = context.zone,
-            .wrap = context.wrap
-        };
+        LogFormat format = { 0 };
+        context.ToLogFormat(format);
         LogPrintWithFormat(content, format);
         return static_cast<int>(SUCCESS_CONTINUE);
     });
@@ -455,6 +518,102 @@ static int QueryLogHandler(HilogArgs& context, const char *arg)
     return RET_SUCCESS;
 }
 
+static int PersistFileReadHandler(HilogArgs& context, const char *arg)
+{
+    string path = arg;
+    if (path.find('/') == string::npos) {
+        path = HILOG_FILE_DIR + path;
+    }
+    LogFilter filter = { 0 };
+    context.ToLogFilter(filter);
+    LogFormat format = { 0 };
+    context.ToLogFormat(format);
+    PersistTimeRange range;
+    range.begin = context.beginTime;
+    range.end = context.endTime;
+    return ReadPersistFile(path, filter, range, [&format](const HilogMsg& msg) {
+        LogContent content = {
+            .level = msg.level,
+            .type = msg.type,
+            .pid = msg.pid,
+            .tid = msg.tid,
+            .domain = msg.domain,
+            .tv_sec = msg.tv_sec,
+            .tv_nsec = msg.tv_nsec,
+            .mono_sec = msg.mono_sec,
+            .tag = msg.tag,
+            .log = CONTENT_PTR((&msg))
+        };
+        LogPrintWithFormat(content, format);
+    });
+}
+
+static constexpr uint64_t NSEC_PER_SEC = 1000000000ULL;
+static constexpr size_t NSEC_DIGITS = 9;
+// Seconds since epoch or a local date and time, optionally with a fraction of second
+static bool Str2RealTime(const string& str, uint64_t& realTime)
+{
+    string whole = str;
+    uint64_t nsec = 0;
+    size_t dot = str.find('.');
+    if (dot != string::npos) {
+        string fraction = str.substr(dot + 1);
+        if (fraction.empty() || fraction.length() > NSEC_DIGITS || !IsNumericStr(fraction)) {
+            return false;
+        }
+        fraction.append(NSEC_DIGITS - fraction.length(), '0');
+        nsec = strtoull(fraction.c_str(), nullptr, 10); // 10 : decimal
+        whole = str.substr(0, dot);
+    }
+    uint64_t sec = 0;
+    if (IsNumericStr(whole)) {
+        sec = strtoull(whole.c_str(), nullptr, 10); // 10 : decimal
+    } else {
+        time_t now = time(nullptr);
+        struct tm tmTime = {};
+        const char *end = nullptr;
+        for (const char *timeFormat : {"%Y-%m-%d %H:%M:%S", "%m-%d %H:%M:%S"}) {
+            if (localtime_r(&now, &tmTime) == nullptr) {
+                return false;
+            }
+            end = strptime(whole.c_str(), timeFormat, &tmTime);
+            if (end != nullptr && *end == '\0') {
+                break;
+            }
+        }
+        if (end == nullptr || *end != '\0') {
+            return false;
+        }
+        tmTime.tm_isdst = -1;
+        time_t local = mktime(&tmTime);
+        if (local < 0) {
+            return false;
+        }
+        sec = static_cast<uint64_t>(local);
+    }
+    if (sec > (UINT64_MAX - nsec) / NSEC_PER_SEC) {
+        return false;
+    }
+    realTime = sec * NSEC_PER_SEC + nsec;
+    return true;
+}
+
+static int IntervalHandler(HilogArgs& context, const char *arg)
+{
+    string interval = arg;
+    size_t comma = interval.find(',');
+    if (!Str2RealTime(interval.substr(0, comma), context.beginTime)) {
+        return ERR_INVALID_ARGUMENT;
+    }
+    if (comma != string::npos && !Str2RealTime(interval.substr(comma + 1), context.endTime)) {
+        return ERR_INVALID_ARGUMENT;
+    }
+    if (context.endTime < context.beginTime) {
+        return ERR_INVALID_ARGUMENT;
+    }
+    return RET_SUCCESS;
+}
+
 static int HeadHandler(HilogArgs& context, const char *arg)
 {
     if (IsNumericStr(arg) == false) {
@@ -779,8 +938,8 @@ static int StatsInfoQueryHandler(HilogArgs& context, const char *arg)
     StatsQueryRqst rqst = { 0 };
     context.ToStatsQueryRqst(rqst);
     LogIoctl ioctl(IoctlCmd::STATS_QUERY_RQST, IoctlCmd::STATS_QUERY_RSP);
-    int ret = ioctl.RequestStatsQuery(rqst, [&rqst](const StatsQueryRsp& rsp) {
-        HilogShowLogStatsInfo(rsp);
+    int ret = ioctl.RequestStatsQuery(rqst, [&rqst](const StatsQueryRsp& rsp, const StatsQueryExtra& extra) {
+        HilogShowLogStatsInfo(rsp, extra);
         return RET_SUCCESS;
     });
     if (ret != RET_SUCCESS) {
@@ -789,6 +948,36 @@ static int StatsInfoQueryHandler(HilogArgs& context, const char *arg)
     return ret;
 }
 
+static int StatsSeriesQueryHandler(HilogArgs& context, const char *arg)
+{
+    StatsSeriesRqst rqst = { 0 };
+    context.ToStatsSeriesRqst(rqst);
+    string count = arg;
+    rqst.unit = StatsSeriesUnit::SECOND;
+    if (!count.empty() && (count.back() == 'm' || count.back() == 's')) {
+        rqst.unit = (count.back() == 'm') ? StatsSeriesUnit::MINUTE : StatsSeriesUnit::SECOND;
+        count.pop_back();
+    }
+    if (!IsNumericStr(count)) {
+        return ERR_NOT_NUMBER_STR;
+    }
+    int num = 0;
+    (void)StrToInt(count, num);
+    if (num <= 0 || num > MAX_SERIES_BUCKETS) {
+        return ERR_INVALID_ARGUMENT;
+    }
+    rqst.count = static_cast<uint8_t>(num);
+    LogIoctl ioctl(IoctlCmd::STATS_SERIES_RQST, IoctlCmd::STATS_SERIES_RSP);
+    int ret = ioctl.Request<StatsSeriesRqst, StatsSeriesRsp>(rqst, [&rqst](const StatsSeriesRsp& rsp) {
+        HilogShowLogStatsSeries(rqst, rsp);
+        return RET_SUCCESS;
+    });
+    if (ret != RET_SUCCESS) {
+        cout << "Statistic rate query failed" << endl;
+    }
+    return ret;
+}
+
 static int StatsInfoClearHandler(HilogArgs& context, const char *arg)
 {
     StatsClearRqst rqst = { 0 };
@@ -1042,6 +1231,8 @@ static OptEntry optEntries[] = {
     {'g', nullptr, ControlCmd::CMD_BUFFER_SIZE_QUERY, BufferSizeGetHandler, false, 1},
     {'G', "buffer-size", ControlCmd::CMD_BUFFER_SIZE_SET, BufferSizeSetHandler, true, 1},
     {'h', "help", ControlCmd::CMD_HELP, HelpHandler, false, 1},
+    {'i', "interval", ControlCmd::NOT_CMD, IntervalHandler, true, 1},
+    {'I', "input", ControlCmd::CMD_PERSIST_FILE_READ, PersistFileReadHandler, true, 1},
     {'j', "jobid", ControlCmd::NOT_CMD, JobIdHandler, true, 1},
     {'k', "kmsg", ControlCmd::CMD_KMSG_FEATURE_SET, KmsgFeatureSetHandler, true, 1},
     {'l', "length", ControlCmd::NOT_CMD, FileLengthHandler, true, 1},
@@ -1052,6 +1243,7 @@ static OptEntry optEntries[] = {
     {'P', "pid", ControlCmd::NOT_CMD, PidHandler, true, 1},
     {'Q', "flowctrl", ControlCmd::CMD_FLOWCONTROL_FEATURE_SET, FlowControlFeatureSetHandler, true, 1},
     {'r', nullptr, ControlCmd::CMD_REMOVE, RemoveHandler, false, 1},
+    {'R', "rate", ControlCmd::CMD_STATS_SERIES_QUERY, StatsSeriesQueryHandler, true, 1},
     {'s', "statistics", ControlCmd::CMD_STATS_INFO_QUERY, StatsInfoQueryHandler, false, 1},
     {'S', nullptr, ControlCmd::CMD_STATS_INFO_CLEAR, StatsInfoClearHandler, false, 1},
     {'t', "type", ControlCmd::NOT_CMD, TypeHandler, true, 1},
@@ -1061,7 +1253,7 @@ static OptEntry optEntries[] = {
     {'x', "exit", ControlCmd::CMD_QUERY, NoBlockHandler, false, 1},
     {'z', "tail", ControlCmd::CMD_QUERY, TailHandler, true, 1},
     {0, nullptr, ControlCmd::NOT_CMD, nullptr, false, 1}, // End default entry
-}; // "hxz:grsSa:v:e:t:L:G:f:l:n:j:w:p:k:D:T:b:Q:m:P:"
+}; // "hxz:grsSa:v:e:t:L:G:f:l:n:j:w:p:k:D:T:b:Q:m:P:R:I:i:"
 static constexpr int OPT_ENTRY_CNT = sizeof(optEntries) / sizeof(OptEntry);
 
 static void GetOpts(string& opts, struct option(&longOptions)[OPT_ENTRY_CNT])
@@ -0,0 +1,107 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <securec.h>
+
+#include "hilog/log.h"
+#include "kmsg_parser.h"
+
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr int RECORD_COUNT = 1024;
+
+std::vector<std::string> MakeDevKmsgRecords()
+{
+    std::vector<std::string> records;
+    for (int i = 0; i < RECORD_COUNT; i++) {
+        std::string record = std::to_string(i % 8) + "," + std::to_string(1000 + i) + "," +
+            std::to_string(1234567 + i * 1000) + ",-;";
+        record += "[pid:" + std::to_string(100 + i % 50) + ",cpu0,kworker]: benchmark kernel line " +
+            std::to_string(i) + " with some payload text\n";
+        if (i % 4 == 0) {
+            record += " SUBSYSTEM=usb\n DEVICE=c189:1\n";
+        }
+        records.push_back(std::move(record));
+    }
+    return records;
+}
+
+// What KmsgParser::ParseKmsg did before: a std::string copy and a vector per record, no header parsing
+size_t LegacyParse(const std::vector<char>& kmsgBuffer)
+{
+    std::string kmsgStr(kmsgBuffer.data());
+    auto len = kmsgStr.size() + 1;
+    auto msgLen = sizeof(HilogMsg) + len + 1;
+    std::vector<char> msgBuffer(msgLen, '\0');
+    HilogMsg& msg = *reinterpret_cast<HilogMsg *>(msgBuffer.data());
+    msg.len = msgLen;
+    msg.tagLen = 1;
+    msg.type = LOG_KMSG;
+    msg.level = LOG_INFO;
+    struct timespec ts = {0};
+    (void)clock_gettime(CLOCK_REALTIME, &ts);
+    msg.tv_sec = static_cast<uint32_t>(ts.tv_sec);
+    msg.tv_nsec = static_cast<uint32_t>(ts.tv_nsec);
+    if (strncpy_s(CONTENT_PTR((&msg)), msgLen - sizeof(HilogMsg) - 1, kmsgStr.c_str(), len) != 0) {
+        return 0;
+    }
+    return msg.len;
+}
+
+void BM_LegacyKmsgParse(benchmark::State& state)
+{
+    auto records = MakeDevKmsgRecords();
+    std::vector<char> kmsgBuffer(BUFSIZ, '\0');
+    for (auto _ : state) {
+        size_t total = 0;
+        for (const auto& record : records) {
+            // LogKmsg read every record into a zeroed BUFSIZ vector
+            std::fill(kmsgBuffer.begin(), kmsgBuffer.end(), '\0');
+            (void)memcpy_s(kmsgBuffer.data(), BUFSIZ - 1, record.data(), record.size());
+            total += LegacyParse(kmsgBuffer);
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORD_COUNT);
+}
+
+void BM_KmsgParse(benchmark::State& state)
+{
+    auto records = MakeDevKmsgRecords();
+    KmsgParser parser;
+    for (auto _ : state) {
+        size_t total = 0;
+        for (const auto& record : records) {
+            std::string_view data(record);
+            while (!data.empty()) {
+                const HilogMsg *msg = parser.ParseNext(data);
+                total += (msg == nullptr) ? 0 : msg->len;
+            }
+        }
+        benchmark::DoNotOptimize(total);
+    }
+    state.SetItemsProcessed(state.iterations() * RECORD_COUNT);
+}
+} // namespace
+
+BENCHMARK(BM_LegacyKmsgParse);
+BENCHMARK(BM_KmsgParse);
+BENCHMARK_MAIN();
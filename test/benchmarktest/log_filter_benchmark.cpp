@@ -0,0 +1,162 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <benchmark/benchmark.h>
+#include <cstring>
+#include <regex>
+#include <string>
+#include <vector>
+#include <securec.h>
+
+#include "log_filter.h"
+
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr int LOG_COUNT = 1024;
+
+std::vector<std::vector<char>> MakeLogs()
+{
+    std::vector<std::vector<char>> logs;
+    for (int i = 0; i < LOG_COUNT; i++) {
+        std::string tag = "Tag" + std::to_string(i % 64);
+        std::string content = "benchmark log line " + std::to_string(i) + " with some payload text";
+        std::vector<char> buf(sizeof(HilogMsg) + tag.size() + 1 + content.size() + 1, 0);
+        HilogMsg *msg = reinterpret_cast<HilogMsg *>(buf.data());
+        msg->len = buf.size();
+        msg->type = LOG_CORE;
+        msg->level = LOG_INFO;
+        msg->tagLen = tag.size() + 1;
+        msg->pid = 1000 + (i % 32);
+        msg->domain = 0xD002D00 + (i % 16);
+        (void)memcpy_s(msg->tag, buf.size() - sizeof(HilogMsg), tag.c_str(), tag.size() + 1);
+        (void)memcpy_s(msg->tag + msg->tagLen, content.size() + 1, content.c_str(), content.size() + 1);
+        logs.push_back(std::move(buf));
+    }
+    return logs;
+}
+
+LogFilter MakeFilter(int terms, bool withRegex)
+{
+    LogFilter filter = {0};
+    filter.types = 0xFFFF;
+    filter.levels = 0xFFFF;
+    filter.domainCount = std::min(terms, MAX_DOMAINS);
+    for (int i = 0; i < filter.domainCount; i++) {
+        filter.domains[i] = 0xD002D00 + i;
+    }
+    filter.tagCount = std::min(terms, MAX_TAGS);
+    for (int i = 0; i < filter.tagCount; i++) {
+        std::string tag = "Tag" + std::to_string(i * 2);
+        (void)strcpy_s(filter.tags[i], MAX_TAG_LEN, tag.c_str());
+    }
+    filter.pidCount = std::min(terms, MAX_PIDS);
+    for (int i = 0; i < filter.pidCount; i++) {
+        filter.pids[i] = 1000 + i;
+    }
+    if (withRegex) {
+        (void)strcpy_s(filter.regex, MAX_REGEX_STR_LEN, "line*payload");
+    }
+    return filter;
+}
+
+// The matching done by HilogBuffer before CompiledLogFilter: linear scans and a regex built per log
+bool LegacyMatch(const LogFilter& filter, const HilogMsg& msg)
+{
+    if (((static_cast<uint16_t>(0b01 << msg.type)) & filter.types) == 0 ||
+        ((static_cast<uint16_t>(0b01 << msg.level)) & filter.levels) == 0) {
+        return false;
+    }
+    static constexpr uint32_t LOW_BYTE = 0xFF;
+    static constexpr uint32_t LOW_BYTE_REVERSE = ~LOW_BYTE;
+    bool match = false;
+    for (int i = 0; i < filter.domainCount; i++) {
+        if ((msg.domain == filter.domains[i]) || ((static_cast<uint8_t>(filter.domains[i]) == LOW_BYTE)
+             && ((msg.domain & LOW_BYTE_REVERSE) == (filter.domains[i] & LOW_BYTE_REVERSE)))) {
+            match = true;
+            break;
+        }
+    }
+    if (filter.domainCount && match == filter.blackDomain) {
+        return false;
+    }
+    match = false;
+    for (int i = 0; i < filter.tagCount; i++) {
+        if (strcmp(msg.tag, filter.tags[i]) == 0) {
+            match = true;
+            break;
+        }
+    }
+    if (filter.tagCount && match == filter.blackTag) {
+        return false;
+    }
+    match = false;
+    for (int i = 0; i < filter.pidCount; i++) {
+        if (msg.pid == filter.pids[i]) {
+            match = true;
+            break;
+        }
+    }
+    if (filter.pidCount && match == filter.blackPid) {
+        return false;
+    }
+    if (filter.regex[0] != 0) {
+        std::regex regExpress(WildcardToRegex(filter.regex));
+        if (std::regex_search(CONTENT_PTR((&msg)), regExpress) == false) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void BM_LegacyFilter(benchmark::State& state)
+{
+    auto logs = MakeLogs();
+    LogFilter filter = MakeFilter(state.range(0), state.range(1) != 0);
+    for (auto _ : state) {
+        int matched = 0;
+        for (const auto& log : logs) {
+            matched += LegacyMatch(filter, *reinterpret_cast<const HilogMsg *>(log.data())) ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(matched);
+    }
+    state.SetItemsProcessed(state.iterations() * LOG_COUNT);
+}
+
+void BM_CompiledFilter(benchmark::State& state)
+{
+    auto logs = MakeLogs();
+    LogFilter filter = MakeFilter(state.range(0), state.range(1) != 0);
+    CompiledLogFilter compiled(filter);
+    for (auto _ : state) {
+        int matched = 0;
+        for (const auto& log : logs) {
+            matched += compiled.Match(*reinterpret_cast<const HilogMsg *>(log.data())) ? 1 : 0;
+        }
+        benchmark::DoNotOptimize(matched);
+    }
+    state.SetItemsProcessed(state.iterations() * LOG_COUNT);
+}
+
+// Args: {filter terms, regex on/off}
+void FilterArgs(benchmark::internal::Benchmark* b)
+{
+    b->Args({0, 1})->Args({1, 0})->Args({10, 0})->Args({10, 1});
+}
+} // namespace
+
+BENCHMARK(BM_LegacyFilter)->Apply(FilterArgs);
+BENCHMARK(BM_CompiledFilter)->Apply(FilterArgs);
+BENCHMARK_MAIN();
@@ -0,0 +1,100 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+
+#include <atomic>
+#include <benchmark/benchmark.h>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "hilog/log.h"
+#include "properties.h"
+
+using namespace OHOS::HiviewDFX;
+
+namespace {
+constexpr int TAG_COUNT = 64;
+constexpr unsigned int BENCH_DOMAIN = 0xD002D00;
+
+const std::vector<std::string>& GetTags()
+{
+    static const std::vector<std::string> tags = []() {
+        std::vector<std::string> v;
+        for (int i = 0; i < TAG_COUNT; i++) {
+            v.push_back("BenchTag" + std::to_string(i));
+        }
+        return v;
+    }();
+    return tags;
+}
+
+// Every benchmark thread logs under its own tag
+const char *GetThreadTag()
+{
+    static std::atomic<int> nextIndex(0);
+    thread_local int index = nextIndex.fetch_add(1) % TAG_COUNT;
+    return GetTags()[index].c_str();
+}
+
+// The tag level lookup of libhilog before the lock-free tables: a reader lock and a std::string per lookup
+uint16_t LegacyGetTagLevel(const std::string& tag)
+{
+    static std::shared_timed_mutex levelMtx;
+    static std::unordered_map<std::string, uint16_t> levelMap;
+    {
+        std::shared_lock<std::shared_timed_mutex> lock(levelMtx);
+        auto it = levelMap.find(tag);
+        if (it != levelMap.end()) {
+            return it->second;
+        }
+    }
+    std::unique_lock<std::shared_timed_mutex> lock(levelMtx);
+    return levelMap.insert({ tag, LOG_LEVEL_MIN }).first->second;
+}
+
+void BM_LegacyTagLevel(benchmark::State& state)
+{
+    const char *tag = GetThreadTag();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(LegacyGetTagLevel(tag));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_TagLevel(benchmark::State& state)
+{
+    const char *tag = GetThreadTag();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(GetTagLevel(tag));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+void BM_IsLoggable(benchmark::State& state)
+{
+    const char *tag = GetThreadTag();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(HiLogIsLoggable(BENCH_DOMAIN, tag, LOG_DEBUG));
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+} // namespace
+
+BENCHMARK(BM_LegacyTagLevel)->Threads(1)->Threads(32)->Threads(64)->UseRealTime();
+BENCHMARK(BM_TagLevel)->Threads(1)->Threads(32)->Threads(64)->UseRealTime();
+BENCHMARK(BM_IsLoggable)->Threads(1)->Threads(32)->Threads(64)->UseRealTime();
+BENCHMARK_MAIN();
@@ -256,4 +256,36 @@ HWTEST_F(HilogPrintTest, HilogKmsgPrivacyTest, TestSize.Level1)
     EXPECT_TRUE(IsExistInCmdResult("hilog -t kmsg -x |grep HILOGTEST_C", msg));
     (void)GetCmdResultFromPopen("hilog -p on");
 }
+
+/**
+ * @tc.name: Dfx_HilogPrintTest_HilogCallsiteCacheTest
+ * @tc.desc: Disabled logs don't evaluate their arguments and see level changes.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogPrintTest, HilogCallsiteCacheTest, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "HilogCallsiteCacheTest: start.";
+    int evaluated = 0;
+    int domainEvaluated = 0;
+    auto logDebug = [&evaluated, &domainEvaluated]() {
+        HILOG_IMPL(LOG_CORE, LOG_DEBUG, (++domainEvaluated, 0xD002D00), "HILOGTEST_C", "%{public}d", ++evaluated);
+    };
+    logDebug();
+    logDebug();
+    EXPECT_EQ(evaluated, 0);
+    EXPECT_EQ(domainEvaluated, 2);
+
+    // A tag which isn't a constant is never cached
+    std::string tag = "HILOGTEST_C";
+    HILOG_IMPL(LOG_CORE, LOG_DEBUG, 0xD002D00, tag.c_str(), "%{public}d", ++evaluated);
+    EXPECT_EQ(evaluated, 1);
+
+    (void)GetCmdResultFromPopen("hilog -b D -D d002d00");
+    // The change is seen once the process checks a log, the next log of the site then has the new level
+    EXPECT_TRUE(HiLogIsLoggable(0xD002D00, "HILOGTEST_C", LOG_DEBUG));
+    logDebug();
+    EXPECT_EQ(evaluated, 2);
+    EXPECT_EQ(domainEvaluated, 3);
+    (void)GetCmdResultFromPopen("hilog -b I -D d002d00");
+}
 } // namespace
\ No newline at end of file
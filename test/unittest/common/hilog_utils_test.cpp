@@ -14,15 +14,27 @@
  */
 #include "hilog_utils_test.h"
 #include "hilog_common.h"
+#include <log_binary.h>
 #include <log_utils.h>
 #include <hilog/log_c.h>
+#include <climits>
 #include <list>
+#include <vector>
 
 using namespace std;
 using namespace testing::ext;
 using namespace OHOS;
 using namespace OHOS::HiviewDFX;
 
+static int EncodeBinary(char *buf, size_t bufLen, int priv, const char *fmt, ...)
+{
+    va_list ap;
+    va_start(ap, fmt);
+    int ret = EncodeBinaryLog(buf, bufLen, 0, priv, fmt, ap);
+    va_end(ap);
+    return ret;
+}
+
 static std::string GetCmdResultFromPopen(const std::string& cmd)
 {
     if (cmd.empty()) {
@@ -272,4 +284,87 @@ HWTEST_F(HilogUtilsTest, HilogUtilsTest_010, TestSize.Level1)
     EXPECT_EQ(HexStr2Uint(str, success), hexNum);
     EXPECT_FALSE(success);
 }
+
+/**
+ * @tc.name: Dfx_HilogUtilsTest_HilogUtilsTest_011
+ * @tc.desc: EncodeBinaryLog & DecodeBinaryLog.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogUtilsTest, HilogUtilsTest_011, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "HilogUtilsTest_011: start.";
+    char buf[MAX_LOG_LEN] = {0};
+    char text[MAX_LOG_LEN] = {0};
+    int len = EncodeBinary(buf, sizeof(buf), 1, "%{public}d %{public}-5s| %s %{public}lld %{public}.2f %{public}*x%%",
+        -12, "ab", "secret", -1LL, 2.5, 4, 255);
+    ASSERT_GT(len, 0);
+    int textLen = DecodeBinaryLog(buf, len, text, sizeof(text));
+    EXPECT_EQ(textLen, strlen(text));
+    EXPECT_STREQ(text, "-12 ab   | <private> -1 2.50   ff%");
+
+    len = EncodeBinary(buf, sizeof(buf), 0, "%s %{private}d", "shown", 1);
+    ASSERT_GT(len, 0);
+    (void)DecodeBinaryLog(buf, len, text, sizeof(text));
+    EXPECT_STREQ(text, "shown 1");
+
+    // Left to the text formatting
+    EXPECT_EQ(EncodeBinary(buf, sizeof(buf), 1, "%{public}ls", L"wide"), -1);
+    EXPECT_EQ(EncodeBinary(buf, sizeof(buf), 1, "%{public}Lf", 1.0L), -1);
+    EXPECT_EQ(EncodeBinary(buf, sizeof(buf), 1, "%{unknown}d", 1), -1);
+    std::string longStr(MAX_LOG_LEN, 'a');
+    EXPECT_EQ(EncodeBinary(buf, sizeof(buf), 1, "%{public}s", longStr.c_str()), -1);
+
+    // Truncated content ends the text
+    len = EncodeBinary(buf, sizeof(buf), 1, "%{public}d %{public}s", 1, "abc");
+    ASSERT_GT(len, 0);
+    (void)DecodeBinaryLog(buf, len - 3, text, sizeof(text));
+    EXPECT_STREQ(text, "1 ");
+}
+
+// Empty prefix, the format and the arguments of a binary log as EncodeBinaryLog lays them out
+static std::string MakeBinaryLog(const std::string& fmt, const std::vector<int>& intArgs)
+{
+    constexpr uint8_t argInt = 2; // ARG_INT
+    std::string content(1, '\0');
+    content += fmt;
+    content += '\0';
+    for (int value : intArgs) {
+        content += static_cast<char>(argInt);
+        content.append(reinterpret_cast<const char *>(&value), sizeof(value));
+    }
+    content += '\0';
+    return content;
+}
+
+/**
+ * @tc.name: Dfx_HilogUtilsTest_HilogUtilsTest_012
+ * @tc.desc: DecodeBinaryLog of damaged records.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogUtilsTest, HilogUtilsTest_012, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "HilogUtilsTest_012: start.";
+    char buf[MAX_LOG_LEN] = {0};
+    char text[MAX_LOG_LEN] = {0};
+    EXPECT_EQ(EncodeBinary(buf, sizeof(buf), 1, "%{public}-+ 0#-+ 0#d", 1), -1);
+
+    // More flags than a conversion can have
+    std::string flags(MAX_LOG_LEN / 2, '-');
+    std::string content = MakeBinaryLog("a%" + flags + "d", {1});
+    (void)DecodeBinaryLog(content.data(), content.size(), text, sizeof(text));
+    EXPECT_STREQ(text, "a");
+
+    // '*' values the writer never stores
+    content = MakeBinaryLog("b%*d", {INT_MIN, 1});
+    (void)DecodeBinaryLog(content.data(), content.size(), text, sizeof(text));
+    EXPECT_STREQ(text, "b");
+    content = MakeBinaryLog("c%.*d", {INT_MAX, 1});
+    (void)DecodeBinaryLog(content.data(), content.size(), text, sizeof(text));
+    EXPECT_STREQ(text, "c");
+
+    // Width and precision as stored by the writer
+    content = MakeBinaryLog("%-+ 0#*.*d|", {-3, 2, 7});
+    (void)DecodeBinaryLog(content.data(), content.size(), text, sizeof(text));
+    EXPECT_STREQ(text, "+07|");
+}
 } // namespace
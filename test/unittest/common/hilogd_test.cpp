@@ -0,0 +1,1075 @@
+/*
+ * Copyright (c) 2026 Huawei Device Co., Ltd.
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *     http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ */
+#include "hilogd_test.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+#include <fstream>
+#include <glob.h>
+#include <mutex>
+#include <random>
+#include <string>
+#include <string_view>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include <hilog/log_c.h>
+#include <securec.h>
+#include <zlib.h>
+#include "hilog_common.h"
+#include "hilog_input_socket_server.h"
+#include "hilog_shm_ring.h"
+#include "hilog_persist.h"
+#include "kmsg_parser.h"
+#include "log_batch.h"
+#include "log_buffer.h"
+#include "log_compress.h"
+#include "log_persist_reader.h"
+#include "log_persister.h"
+#include "log_ring_buffer.h"
+
+using namespace std;
+using namespace testing::ext;
+using namespace OHOS;
+using namespace OHOS::HiviewDFX;
+
+static constexpr uint32_t PERSIST_BASE_SEC = 1700000000;
+static constexpr int PERSIST_CHUNK = 100; /* logs a Refresh() surely hands over, less than a LogBatch */
+static constexpr int PERSIST_ERROR_EVERY = 10;
+static constexpr uint64_t NSEC_PER_SECOND = 1000000000ULL;
+
+static string KmsgText(const HilogMsg *msg)
+{
+    return string(msg->tag + msg->tagLen);
+}
+
+// The buffer of normal logs hilogd has, persist jobs of all tests read it
+static HilogBuffer& GetTestBuffer()
+{
+    static HilogBuffer *buffer = new HilogBuffer(false);
+    return *buffer;
+}
+
+// The buffer of kernel logs, hilogd keeps them apart from the normal ones
+static HilogBuffer& GetTestKmsgBuffer()
+{
+    static HilogBuffer *buffer = new HilogBuffer(false);
+    return *buffer;
+}
+
+// Log number i of a pid says "line <i>", is dated i seconds after PERSIST_BASE_SEC and every tenth one is an error
+static vector<char> MakeLog(uint16_t type, uint32_t pid, int i, size_t padding = 0)
+{
+    string content = "line " + to_string(i) + string(padding, ' ');
+    vector<char> data(sizeof(HilogMsg) + sizeof("tag") + content.size() + 1, 0);
+    HilogMsg *msg = reinterpret_cast<HilogMsg *>(data.data());
+    msg->len = data.size();
+    msg->type = type;
+    msg->level = (i % PERSIST_ERROR_EVERY == 0) ? LOG_ERROR : LOG_INFO;
+    msg->tagLen = sizeof("tag");
+    msg->pid = pid;
+    msg->tv_sec = PERSIST_BASE_SEC + static_cast<uint32_t>(i);
+    (void)strcpy_s(msg->tag, msg->tagLen, "tag");
+    (void)strcpy_s(msg->tag + msg->tagLen, content.size() + 1, content.c_str());
+    return data;
+}
+
+static void InsertLogs(HilogBuffer& buffer, uint16_t type, uint32_t pid, int first, int count, size_t padding = 0)
+{
+    for (int i = first; i < first + count; i++) {
+        vector<char> data = MakeLog(type, pid, i, padding);
+        bool isFull = false;
+        (void)buffer.Insert(*reinterpret_cast<HilogMsg *>(data.data()), isFull);
+    }
+}
+
+static int LogLine(const HilogMsg& msg)
+{
+    int line = -1;
+    (void)sscanf_s(msg.tag + msg.tagLen, "line %d", &line);
+    return line;
+}
+
+// The numbers of the lines a reader gets until the buffer has no more, the lines it missed are added to missed
+static vector<int> QueryLines(HilogBuffer& buffer, HilogBuffer::ReaderId id, const LogFilter& filter,
+    int tailCount = 0, uint32_t *missed = nullptr)
+{
+    CompiledLogFilter compiled(filter);
+    LogBatch batch;
+    vector<int> lines;
+    while (buffer.Query(compiled, id, batch, tailCount) > 0) {
+        for (size_t i = 0; i < batch.Count(); i++) {
+            const HilogMsg& msg = batch.At(i);
+            uint32_t count = 0;
+            if (sscanf_s(msg.tag + msg.tagLen, "========Slow reader missed log lines: %u", &count) == 1) {
+                if (missed != nullptr) {
+                    *missed += count;
+                }
+                continue;
+            }
+            lines.push_back(LogLine(msg));
+        }
+    }
+    return lines;
+}
+
+// A job of the given types persisting the logs of pid into HILOG_FILE_DIR<name>.*
+static int StartPersistJob(HilogBuffer& buffer, uint32_t jobId, const string& name, uint16_t compressAlg,
+    uint16_t types, uint32_t pid)
+{
+    PersistRecoveryInfo info = {0};
+    info.msg.compressAlg = compressAlg;
+    string path = HILOG_FILE_DIR + name;
+    (void)strcpy_s(info.msg.filePath, FILE_PATH_MAX_LEN, path.c_str());
+    info.msg.fileSize = MAX_LOG_FILE_SIZE;
+    info.msg.fileNum = MIN_LOG_FILE_NUM;
+    info.msg.jobId = jobId;
+    info.msg.filter.types = types;
+    info.msg.filter.levels = static_cast<uint16_t>(~0);
+    info.msg.filter.pidCount = 1;
+    info.msg.filter.pids[0] = pid;
+    shared_ptr<LogPersister> persister = LogPersister::CreateLogPersister(buffer);
+    int ret = persister->Init(info, false);
+    if (ret != RET_SUCCESS) {
+        return ret;
+    }
+    persister->Start();
+    return RET_SUCCESS;
+}
+
+// Inserts the logs in pieces the job surely gets before each Refresh(), a Refresh() hands over the chunk it fills
+static void PersistLogs(HilogBuffer& buffer, uint32_t jobId, uint16_t type, uint32_t pid, int count,
+    int logsPerFrame = PERSIST_CHUNK)
+{
+    for (int i = 0; i < count; i += logsPerFrame) {
+        InsertLogs(buffer, type, pid, i, min(logsPerFrame, count - i));
+        (void)LogPersister::Refresh(jobId);
+    }
+}
+
+static vector<string> GetPersistFiles(const string& name)
+{
+    vector<string> files;
+    glob_t found = {};
+    if (glob((HILOG_FILE_DIR + name + ".*").c_str(), 0, nullptr, &found) == 0) {
+        files.assign(found.gl_pathv, found.gl_pathv + found.gl_pathc);
+    }
+    globfree(&found);
+    return files;
+}
+
+static void RemovePersistFiles(const string& name)
+{
+    for (const string& file : GetPersistFiles(name)) {
+        (void)remove(file.c_str());
+    }
+}
+
+static LogFilter AllLogs()
+{
+    LogFilter filter = {0};
+    filter.types = static_cast<uint16_t>(~0);
+    filter.levels = static_cast<uint16_t>(~0);
+    return filter;
+}
+
+// The numbers of the lines read
+static int ReadPersistLines(const string& path, const LogFilter& filter, const PersistTimeRange& range,
+    vector<int>& lines)
+{
+    return ReadPersistFile(path, filter, range, [&lines](const HilogMsg& msg) {
+        if (int line = LogLine(msg); line >= 0) {
+            lines.push_back(line);
+        }
+    });
+}
+
+static vector<int> Sequence(int first, int count, int step = 1)
+{
+    vector<int> lines;
+    for (int i = 0; i < count; i++) {
+        lines.push_back(first + i * step);
+    }
+    return lines;
+}
+
+static LogFilter LogsOfPid(uint32_t pid)
+{
+    LogFilter filter = AllLogs();
+    filter.pidCount = 1;
+    filter.pids[0] = pid;
+    return filter;
+}
+
+static string GetCmdResultFromPopen(const string& cmd)
+{
+    FILE* fp = popen(cmd.c_str(), "r");
+    if (fp == nullptr) {
+        return "";
+    }
+    string ret = "";
+    char* buffer = nullptr;
+    size_t len = 0;
+    while (getline(&buffer, &len, fp) != -1) {
+        ret += buffer;
+    }
+    if (buffer != nullptr) {
+        free(buffer);
+    }
+    pclose(fp);
+    return ret;
+}
+
+static string ReadWholeFile(const string& path)
+{
+    ifstream in(path, ios::binary);
+    return string((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+}
+
+// The index a finished gzip file ends with, empty if there is none
+static vector<PersistIndexEntry> GetFileIndex(const string& content)
+{
+    static constexpr uint8_t memberTail[] = { 0x03, 0x00, 0, 0, 0, 0, 0, 0, 0, 0 };
+    vector<PersistIndexEntry> index;
+    PersistIndexTrailer trailer = {0};
+    if (content.size() < sizeof(trailer) + sizeof(memberTail) ||
+        content.compare(content.size() - sizeof(memberTail), sizeof(memberTail),
+            reinterpret_cast<const char*>(memberTail), sizeof(memberTail)) != 0) {
+        return index;
+    }
+    size_t trailerPos = content.size() - sizeof(memberTail) - sizeof(trailer);
+    (void)memcpy_s(&trailer, sizeof(trailer), content.data() + trailerPos, sizeof(trailer));
+    if (trailer.magic != PERSIST_INDEX_MAGIC || trailer.count * sizeof(PersistIndexEntry) > trailerPos) {
+        return index;
+    }
+    size_t indexLen = trailer.count * sizeof(PersistIndexEntry);
+    index.resize(trailer.count);
+    (void)memcpy_s(index.data(), indexLen, content.data() + trailerPos - indexLen, indexLen);
+    return index;
+}
+
+// Gzip members of the file, as gzip sees them
+static size_t CountGzipMembers(const string& content)
+{
+    z_stream stream = {};
+    if (inflateInit2(&stream, MAX_WBITS + 16) != Z_OK) {
+        return 0;
+    }
+    vector<char> out(MAX_PERSISTER_BUFFER_SIZE);
+    stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(content.data()));
+    stream.avail_in = content.size();
+    size_t members = 0;
+    while (stream.avail_in > 0) {
+        stream.next_out = reinterpret_cast<Bytef*>(out.data());
+        stream.avail_out = out.size();
+        int ret = inflate(&stream, Z_NO_FLUSH);
+        if (ret == Z_STREAM_END) {
+            members++;
+            (void)inflateReset(&stream);
+        } else if (ret != Z_OK) {
+            break;
+        }
+    }
+    (void)inflateEnd(&stream);
+    return members;
+}
+
+static PersistTimeRange SecondsRange(uint32_t beginSec, uint32_t endSec)
+{
+    PersistTimeRange range;
+    range.begin = static_cast<uint64_t>(beginSec) * NSEC_PER_SECOND;
+    range.end = static_cast<uint64_t>(endSec) * NSEC_PER_SECOND;
+    return range;
+}
+
+static constexpr int SHM_RING_EMPTY = -2;
+static constexpr int SHM_RING_CORRUPTED = -3;
+
+// Header and data area of a shared memory ring, 8 bytes aligned
+static vector<uint64_t> NewShmRingMem(uint32_t size)
+{
+    return vector<uint64_t>((HILOG_SHM_HEADER_SIZE + size) / sizeof(uint64_t), 0);
+}
+
+static bool WriteShmLog(HilogShmRing& ring, int i)
+{
+    vector<char> data = MakeLog(LOG_APP, getpid(), i);
+    const HilogMsg *msg = reinterpret_cast<const HilogMsg *>(data.data());
+    const char *fmt = msg->tag + msg->tagLen;
+    return ring.Write(*msg, msg->tag, msg->tagLen, fmt, msg->len - sizeof(HilogMsg) - msg->tagLen);
+}
+
+// Bytes log number i takes in a shared memory ring: the commit word and the log, 8 bytes aligned
+static uint64_t ShmRecordLen(int i)
+{
+    constexpr uint64_t align = 8;
+    return (sizeof(uint32_t) + MakeLog(LOG_APP, getpid(), i).size() + align - 1) & ~(align - 1);
+}
+
+// The line number of the next log in the ring, SHM_RING_EMPTY or SHM_RING_CORRUPTED
+static int ReadShmLine(HilogShmRing& ring)
+{
+    vector<char> buffer(MAX_SOCKET_PACKET_LEN);
+    size_t len = 0;
+    HilogShmRing::ReadResult result = ring.Read(buffer.data(), buffer.size(), len);
+    if (result == HilogShmRing::ReadResult::EMPTY) {
+        return SHM_RING_EMPTY;
+    }
+    if (result == HilogShmRing::ReadResult::CORRUPTED) {
+        return SHM_RING_CORRUPTED;
+    }
+    return LogLine(*reinterpret_cast<const HilogMsg *>(buffer.data()));
+}
+
+namespace {
+/**
+ * @tc.name: Dfx_HilogdTest_KmsgParserTest_001
+ * @tc.desc: KmsgParser of /dev/kmsg records.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, KmsgParserTest_001, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "KmsgParserTest_001: start.";
+    KmsgParser parser;
+    // The facility bits are ignored, syslog priorities map to hilog levels
+    const pair<int, uint16_t> levels[] = {
+        {0, LOG_FATAL}, {1, LOG_FATAL}, {2, LOG_FATAL}, {3, LOG_ERROR}, {4, LOG_WARN}, {5, LOG_WARN},
+        {6, LOG_INFO}, {7, LOG_DEBUG}, {8 + 3, LOG_ERROR}, {24 + 6, LOG_INFO},
+    };
+    uint64_t seq = 1;
+    for (auto [prio, level] : levels) {
+        string record = to_string(prio) + "," + to_string(seq++) + ",1000000,-;prio " + to_string(prio) + "\n";
+        string_view data = record;
+        const HilogMsg *msg = parser.ParseNext(data);
+        ASSERT_NE(msg, nullptr);
+        EXPECT_EQ(msg->level, level) << record;
+        EXPECT_EQ(msg->type, LOG_KMSG);
+        EXPECT_EQ(KmsgText(msg), "prio " + to_string(prio));
+        EXPECT_TRUE(data.empty());
+    }
+
+    // Dictionary lines belong to the record, the timestamp is the kernel monotonic time
+    string records = "4,11,12345678,-;first\n SUBSYSTEM=usb\n DEVICE=c189:1\n7,12,13000000,+;second\n";
+    string_view data = records;
+    const HilogMsg *msg = parser.ParseNext(data);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_EQ(msg->level, LOG_WARN);
+    EXPECT_EQ(msg->mono_sec, 12u);
+    struct timespec real = {0};
+    struct timespec mono = {0};
+    (void)clock_gettime(CLOCK_REALTIME, &real);
+    (void)clock_gettime(CLOCK_MONOTONIC, &mono);
+    int64_t realSec = static_cast<int64_t>(real.tv_sec) - mono.tv_sec + 12; // 12: kernel time of the record
+    EXPECT_LE(llabs(static_cast<int64_t>(msg->tv_sec) - realSec), 1);
+    EXPECT_EQ(KmsgText(msg), "first");
+    EXPECT_EQ(data, "7,12,13000000,+;second\n");
+    // A fragment keeps the level and time of the line it continues
+    msg = parser.ParseNext(data);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_EQ(msg->level, LOG_WARN);
+    EXPECT_EQ(msg->mono_sec, 12u);
+    EXPECT_EQ(KmsgText(msg), "second");
+    EXPECT_EQ(parser.GetLastSeq(), 12u);
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_KmsgParserTest_002
+ * @tc.desc: KmsgParser of sequence gaps, records seen before and /proc/kmsg lines.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, KmsgParserTest_002, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "KmsgParserTest_002: start.";
+    KmsgParser parser;
+    parser.SetLastSeq(100);
+    string records = "6,90,1000000,-;seen\n6,105,2000000,-;after gap\n";
+    string_view data = records;
+    EXPECT_EQ(parser.ParseNext(data), nullptr);
+    // The lost lines come first, the record after the gap stays in data
+    const HilogMsg *msg = parser.ParseNext(data);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_EQ(msg->level, LOG_WARN);
+    EXPECT_EQ(msg->mono_sec, 2u);
+    EXPECT_EQ(KmsgText(msg), "4 kernel lines lost");
+    EXPECT_EQ(data, "6,105,2000000,-;after gap\n");
+    msg = parser.ParseNext(data);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_EQ(msg->level, LOG_INFO);
+    EXPECT_EQ(KmsgText(msg), "after gap");
+    EXPECT_EQ(parser.GetLastSeq(), 105u);
+    EXPECT_TRUE(data.empty());
+
+    records = "<3>[   42.000123] proc line\n<6>no timestamp\nneither format\n\n";
+    data = records;
+    msg = parser.ParseNext(data);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_EQ(msg->level, LOG_ERROR);
+    EXPECT_EQ(msg->mono_sec, 42u);
+    EXPECT_EQ(KmsgText(msg), "proc line");
+    msg = parser.ParseNext(data);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_EQ(msg->level, LOG_INFO);
+    EXPECT_EQ(KmsgText(msg), "no timestamp");
+    // Kept as text with the level of the line before
+    msg = parser.ParseNext(data);
+    ASSERT_NE(msg, nullptr);
+    EXPECT_EQ(msg->level, LOG_INFO);
+    EXPECT_EQ(KmsgText(msg), "neither format");
+    EXPECT_EQ(parser.ParseNext(data), nullptr);
+    EXPECT_TRUE(data.empty());
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_PersistReaderTest_001
+ * @tc.desc: Logs persisted as records read back whole, filtered and from a cut file.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, PersistReaderTest_001, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "PersistReaderTest_001: start.";
+    constexpr int logCount = 1000;
+    constexpr uint32_t pidBase = 40000;
+    constexpr uint32_t jobIdBase = 100;
+    for (uint16_t alg : {COMPRESS_TYPE_NONE, COMPRESS_TYPE_ZLIB}) {
+        string name = "hilogd_test_records_" + to_string(alg);
+        RemovePersistFiles(name);
+        uint32_t jobId = jobIdBase + alg;
+        uint32_t pid = pidBase + alg;
+        ASSERT_EQ(StartPersistJob(GetTestBuffer(), jobId, name, alg | PERSIST_BINARY_FLAG, 1 << LOG_APP, pid),
+            RET_SUCCESS);
+        PersistLogs(GetTestBuffer(), jobId, LOG_APP, pid, logCount);
+        ASSERT_EQ(LogPersister::Kill(jobId), RET_SUCCESS);
+        vector<string> files = GetPersistFiles(name);
+        ASSERT_EQ(files.size(), 1u);
+
+        vector<int> lines;
+        EXPECT_EQ(ReadPersistLines(files[0], AllLogs(), PersistTimeRange(), lines), RET_SUCCESS);
+        EXPECT_EQ(lines, Sequence(0, logCount));
+
+        LogFilter errors = AllLogs();
+        errors.levels = 1 << LOG_ERROR;
+        lines.clear();
+        EXPECT_EQ(ReadPersistLines(files[0], errors, PersistTimeRange(), lines), RET_SUCCESS);
+        EXPECT_EQ(lines, Sequence(0, logCount / PERSIST_ERROR_EVERY, PERSIST_ERROR_EVERY));
+        LogFilter kmsg = AllLogs();
+        kmsg.types = 1 << LOG_KMSG;
+        lines.clear();
+        EXPECT_EQ(ReadPersistLines(files[0], kmsg, PersistTimeRange(), lines), RET_SUCCESS);
+        EXPECT_TRUE(lines.empty());
+
+        // A file cut by a crash gives the logs up to the cut
+        string cutPath = HILOG_FILE_DIR + name + ".cut";
+        {
+            ifstream in(files[0], ios::binary);
+            string content((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+            ofstream out(cutPath, ios::binary);
+            out.write(content.data(), content.size() / 2);
+        }
+        lines.clear();
+        EXPECT_EQ(ReadPersistLines(cutPath, AllLogs(), PersistTimeRange(), lines), RET_SUCCESS);
+        EXPECT_GT(lines.size(), 0u);
+        EXPECT_LT(lines.size(), static_cast<size_t>(logCount));
+        EXPECT_EQ(lines, Sequence(0, lines.size()));
+        RemovePersistFiles(name);
+    }
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_PersistCompressTest_001
+ * @tc.desc: A full chunk which doesn't compress is compressed whole.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, PersistCompressTest_001, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "PersistCompressTest_001: start.";
+    auto chunk = make_unique<LogPersisterBuffer>();
+    mt19937 noise(MAX_PERSISTER_BUFFER_SIZE);
+    for (char& c : chunk->content) {
+        c = static_cast<char>(noise());
+    }
+    chunk->offset = MAX_PERSISTER_BUFFER_SIZE;
+    ZlibCompress compressor;
+    LogCompressBuffer compressed;
+    for (int i = 0; i < 2; i++) { /* a flushed chunk and then one which ends the member */
+        ASSERT_EQ(compressor.Compress(*chunk, compressed), 0);
+    }
+    ASSERT_EQ(compressor.Finish(compressed), 0);
+    EXPECT_GT(compressed.offset, 2 * MAX_PERSISTER_BUFFER_SIZE);
+
+    string inflated(2 * MAX_PERSISTER_BUFFER_SIZE + 1, '\0');
+    z_stream stream = {};
+    ASSERT_EQ(inflateInit2(&stream, MAX_WBITS + 16), Z_OK);
+    stream.next_in = reinterpret_cast<Bytef *>(compressed.content.data());
+    stream.avail_in = compressed.offset;
+    stream.next_out = reinterpret_cast<Bytef *>(inflated.data());
+    stream.avail_out = inflated.size();
+    EXPECT_EQ(inflate(&stream, Z_FINISH), Z_STREAM_END);
+    EXPECT_EQ(stream.total_out, 2 * MAX_PERSISTER_BUFFER_SIZE);
+    (void)inflateEnd(&stream);
+    string expected(chunk->content, MAX_PERSISTER_BUFFER_SIZE);
+    EXPECT_EQ(inflated.substr(0, stream.total_out), expected + expected);
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_PersistIndexTest_001
+ * @tc.desc: Chunks are flushed into frames of PERSIST_FRAME_SIZE, reads inflate only the frames in range.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, PersistIndexTest_001, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "PersistIndexTest_001: start.";
+    constexpr int logCount = 3000;
+    constexpr int logsPerRefresh = 50;
+    constexpr size_t padding = 1000; /* logsPerRefresh of them still make one LogBatch */
+    constexpr uint32_t pid = 41000;
+    constexpr uint32_t jobId = 110;
+    string name = "hilogd_test_index";
+    RemovePersistFiles(name);
+    ASSERT_EQ(StartPersistJob(GetTestBuffer(), jobId, name, COMPRESS_TYPE_ZLIB | PERSIST_BINARY_FLAG, 1 << LOG_APP,
+        pid), RET_SUCCESS);
+    for (int i = 0; i < logCount; i += logsPerRefresh) {
+        InsertLogs(GetTestBuffer(), LOG_APP, pid, i, logsPerRefresh, padding);
+        (void)LogPersister::Refresh(jobId);
+    }
+    ASSERT_EQ(LogPersister::Kill(jobId), RET_SUCCESS);
+    vector<string> files = GetPersistFiles(name);
+    ASSERT_EQ(files.size(), 1u);
+    string content = ReadWholeFile(files[0]);
+
+    // Every Refresh() hands over a chunk, a frame only ends once PERSIST_FRAME_SIZE of logs are in it
+    size_t logsLen = MakeLog(LOG_APP, pid, 0, padding).size() * logCount;
+    size_t frames = CountGzipMembers(content) - 1; /* the index is a member of its own */
+    EXPECT_GE(frames, logsLen / (PERSIST_FRAME_SIZE + MAX_PERSISTER_BUFFER_SIZE));
+    EXPECT_LE(frames, logsLen / PERSIST_FRAME_SIZE + 1);
+    ASSERT_GE(frames, 2u);
+    vector<PersistIndexEntry> index = GetFileIndex(content);
+    EXPECT_EQ(index.size(), frames);
+    uint32_t offset = 0;
+    uint32_t count = 0;
+    for (const auto& entry : index) {
+        EXPECT_EQ(entry.offset, offset);
+        EXPECT_EQ(entry.minSec, PERSIST_BASE_SEC + count);
+        count += entry.count;
+        EXPECT_EQ(entry.maxSec, PERSIST_BASE_SEC + count - 1);
+        offset = entry.offset + entry.len;
+    }
+    EXPECT_EQ(count, static_cast<uint32_t>(logCount));
+
+    vector<int> lines;
+    EXPECT_EQ(ReadPersistLines(files[0], AllLogs(), PersistTimeRange(), lines), RET_SUCCESS);
+    EXPECT_EQ(lines, Sequence(0, logCount));
+    constexpr int rangeFirst = 100; /* in the first frame */
+    constexpr int rangeCount = 10;
+    uint32_t rangeBegin = PERSIST_BASE_SEC + rangeFirst;
+    PersistTimeRange range = SecondsRange(rangeBegin, rangeBegin + rangeCount - 1);
+    lines.clear();
+    EXPECT_EQ(ReadPersistLines(files[0], AllLogs(), range, lines), RET_SUCCESS);
+    EXPECT_EQ(lines, Sequence(rangeFirst, rangeCount));
+
+    // With the second entry broken only a read touching it fails
+    string brokenPath = HILOG_FILE_DIR + name + ".broken";
+    {
+        string broken = content;
+        (void)memset_s(&broken[index[1].offset], index[1].len, 0, index[1].len);
+        ofstream out(brokenPath, ios::binary);
+        out.write(broken.data(), broken.size());
+    }
+    lines.clear();
+    EXPECT_NE(ReadPersistLines(brokenPath, AllLogs(), PersistTimeRange(), lines), RET_SUCCESS);
+    lines.clear();
+    EXPECT_EQ(ReadPersistLines(brokenPath, AllLogs(), range, lines), RET_SUCCESS);
+    EXPECT_EQ(lines, Sequence(rangeFirst, rangeCount));
+    RemovePersistFiles(name);
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_PersistIndexTest_002
+ * @tc.desc: Gzip files with an index are still read by gzip and zcat.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, PersistIndexTest_002, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "PersistIndexTest_002: start.";
+    constexpr int logCount = 500;
+    constexpr int logsPerFrame = 10;
+    constexpr uint32_t pidBase = 41100;
+    constexpr uint32_t jobIdBase = 120;
+    for (uint16_t binary : {uint16_t(0), PERSIST_BINARY_FLAG}) {
+        string name = "hilogd_test_gzip_" + to_string(binary);
+        RemovePersistFiles(name);
+        uint32_t jobId = jobIdBase + binary;
+        uint32_t pid = pidBase + binary;
+        ASSERT_EQ(StartPersistJob(GetTestBuffer(), jobId, name, COMPRESS_TYPE_ZLIB | binary, 1 << LOG_APP, pid),
+            RET_SUCCESS);
+        PersistLogs(GetTestBuffer(), jobId, LOG_APP, pid, logCount, logsPerFrame);
+        ASSERT_EQ(LogPersister::Kill(jobId), RET_SUCCESS);
+        vector<string> files = GetPersistFiles(name);
+        ASSERT_EQ(files.size(), 1u);
+        string content = ReadWholeFile(files[0]);
+        EXPECT_EQ(GetFileIndex(content).size() + 1, CountGzipMembers(content));
+
+        EXPECT_EQ(GetCmdResultFromPopen("gzip -t " + files[0] + " && echo ok"), "ok\n");
+        // every line, the records of binary files included, comes out once
+        EXPECT_EQ(GetCmdResultFromPopen("zcat " + files[0] + " | grep -ao 'line [0-9]*' | uniq | grep -c ."),
+            to_string(logCount) + "\n");
+        RemovePersistFiles(name);
+    }
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_PersistCoordinatorTest_001
+ * @tc.desc: A kmsg job and a normal job running together each persist the logs of their own buffer.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, PersistCoordinatorTest_001, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "PersistCoordinatorTest_001: start.";
+    struct TestJob {
+        HilogBuffer& buffer;
+        uint32_t jobId;
+        uint16_t type;
+        int logCount;
+        string name;
+    };
+    constexpr uint32_t pid = 42000;
+    TestJob jobs[] = {
+        {GetTestKmsgBuffer(), 130, LOG_KMSG, 300, "hilogd_test_kmsg"},
+        {GetTestBuffer(), 131, LOG_APP, 500, "hilogd_test_app"},
+    };
+    for (const auto& job : jobs) {
+        RemovePersistFiles(job.name);
+        ASSERT_EQ(StartPersistJob(job.buffer, job.jobId, job.name, COMPRESS_TYPE_NONE | PERSIST_BINARY_FLAG,
+            1 << job.type, pid), RET_SUCCESS);
+    }
+    for (int i = 0; i < jobs[1].logCount; i += PERSIST_CHUNK) {
+        for (const auto& job : jobs) {
+            InsertLogs(job.buffer, job.type, pid, i, max(0, min(PERSIST_CHUNK, job.logCount - i)));
+            (void)LogPersister::Refresh(job.jobId);
+        }
+    }
+    for (const auto& job : jobs) {
+        ASSERT_EQ(LogPersister::Kill(job.jobId), RET_SUCCESS);
+        vector<string> files = GetPersistFiles(job.name);
+        ASSERT_EQ(files.size(), 1u);
+        LogFilter filter = AllLogs();
+        filter.types = 1 << job.type;
+        vector<int> lines;
+        EXPECT_EQ(ReadPersistLines(files[0], filter, PersistTimeRange(), lines), RET_SUCCESS);
+        EXPECT_EQ(lines, Sequence(0, job.logCount)) << job.name;
+        lines.clear();
+        EXPECT_EQ(ReadPersistLines(files[0], AllLogs(), PersistTimeRange(), lines), RET_SUCCESS);
+        EXPECT_EQ(lines.size(), static_cast<size_t>(job.logCount)) << job.name;
+        RemovePersistFiles(job.name);
+    }
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_RingBufferTest_001
+ * @tc.desc: LogRingBuffer pads the end instead of wrapping a record and drops the oldest records for room.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, RingBufferTest_001, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "RingBufferTest_001: start.";
+    constexpr size_t capacity = 1000;
+    constexpr uint64_t logCount = 100;
+    LogRingBuffer ring(capacity + 3);
+    ASSERT_TRUE(ring.IsAllocated());
+    EXPECT_EQ(ring.Capacity(), capacity);
+    EXPECT_EQ(LogRingBuffer::AlignCapacity(capacity + 3), capacity);
+    vector<char> huge = MakeLog(LOG_APP, 0, 0, capacity);
+    EXPECT_FALSE(ring.HasRoom(LogRingBuffer::RecordSize(*reinterpret_cast<HilogMsg *>(huge.data()))));
+
+    uint64_t firstSeq = 1;
+    size_t paddings = 0;
+    for (uint64_t seq = 1; seq <= logCount; seq++) {
+        vector<char> data = MakeLog(LOG_APP, 0, static_cast<int>(seq), seq % 7 * 5); // 7, 5: sizes vary
+        const HilogMsg& msg = *reinterpret_cast<HilogMsg *>(data.data());
+        size_t recordSize = LogRingBuffer::RecordSize(msg);
+        while (!ring.HasRoom(recordSize)) {
+            ring.PopFront();
+            firstSeq++;
+        }
+        LogRingBuffer::Offset end = ring.End();
+        LogRingBuffer::Offset pos = ring.Append(msg, seq);
+        if (pos != end) {
+            paddings++;
+        }
+        EXPECT_LE(pos % capacity + recordSize, capacity);
+        EXPECT_LE(ring.Size(), capacity);
+        EXPECT_EQ(ring.Count(), seq - firstSeq + 1);
+        // The records left come back in order, the padding between them is skipped
+        uint64_t expected = firstSeq;
+        for (pos = ring.Begin(); pos != ring.End(); pos = ring.Next(pos), expected++) {
+            EXPECT_EQ(ring.SeqAt(pos), expected);
+            EXPECT_EQ(LogLine(ring.MsgAt(pos)), static_cast<int>(expected));
+        }
+        EXPECT_EQ(expected, seq + 1);
+    }
+    EXPECT_GT(firstSeq, 1u);
+    EXPECT_GT(paddings, 0u);
+    ring.Clear();
+    EXPECT_TRUE(ring.Empty());
+    EXPECT_EQ(ring.Count(), 0u);
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_BufferTest_001
+ * @tc.desc: Logs of all rings are read in arrival order, from the tail, by type and after a type is deleted.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, BufferTest_001, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "BufferTest_001: start.";
+    constexpr int logCount = 30;
+    constexpr int tailCount = 5;
+    constexpr uint32_t pid = 43000;
+    const uint16_t types[] = {LOG_APP, LOG_CORE, LOG_INIT};
+    constexpr int typeCount = sizeof(types) / sizeof(types[0]);
+    HilogBuffer buffer(true);
+    for (int i = 0; i < logCount; i++) {
+        InsertLogs(buffer, types[i % typeCount], pid, i, 1);
+    }
+    HilogBuffer::ReaderId id = buffer.CreateBufReader([]() {});
+    EXPECT_EQ(QueryLines(buffer, id, LogsOfPid(pid)), Sequence(0, logCount));
+    buffer.RemoveBufReader(id);
+    id = buffer.CreateBufReader([]() {});
+    EXPECT_EQ(QueryLines(buffer, id, LogsOfPid(pid), tailCount), Sequence(logCount - tailCount, tailCount));
+    buffer.RemoveBufReader(id);
+    LogFilter core = LogsOfPid(pid);
+    core.types = 1 << LOG_CORE;
+    id = buffer.CreateBufReader([]() {});
+    EXPECT_EQ(QueryLines(buffer, id, core), Sequence(1, logCount / typeCount, typeCount));
+    buffer.RemoveBufReader(id);
+
+    EXPECT_GT(buffer.Delete(LOG_APP), 0);
+    vector<int> left;
+    for (int i = 0; i < logCount; i++) {
+        if (types[i % typeCount] != LOG_APP) {
+            left.push_back(i);
+        }
+    }
+    id = buffer.CreateBufReader([]() {});
+    EXPECT_EQ(QueryLines(buffer, id, LogsOfPid(pid)), left);
+    buffer.RemoveBufReader(id);
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_BufferTest_002
+ * @tc.desc: A full ring drops its oldest logs, a resized one keeps the newest, readers are told what they missed.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, BufferTest_002, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "BufferTest_002: start.";
+    constexpr int firstCount = 10;
+    constexpr int logCount = 300;
+    constexpr size_t padding = 1000; /* logCount of these take more than twice MIN_BUFFER_SIZE */
+    constexpr uint32_t pid = 43100;
+    const LogFilter filter = LogsOfPid(pid);
+    HilogBuffer buffer(true);
+    int64_t oldLen = buffer.GetBuffLen(LOG_INIT);
+    ASSERT_EQ(buffer.SetBuffLen(LOG_INIT, MIN_BUFFER_SIZE * 2 + 3), RET_SUCCESS);
+    HilogBuffer::ReaderId reader = buffer.CreateBufReader([]() {});
+    InsertLogs(buffer, LOG_INIT, pid, 0, firstCount, padding);
+    EXPECT_EQ(QueryLines(buffer, reader, filter), Sequence(0, firstCount));
+    InsertLogs(buffer, LOG_INIT, pid, firstCount, logCount - firstCount, padding);
+    uint32_t missed = 0;
+    vector<int> lines = QueryLines(buffer, reader, filter, 0, &missed);
+    ASSERT_FALSE(lines.empty());
+    int first = lines[0];
+    EXPECT_GT(first, firstCount);
+    EXPECT_EQ(lines, Sequence(first, logCount - first));
+    EXPECT_EQ(missed, static_cast<uint32_t>(first - firstCount));
+
+    // The same size again, an unaligned one, keeps every log
+    ASSERT_EQ(buffer.SetBuffLen(LOG_INIT, MIN_BUFFER_SIZE * 2 + 3), RET_SUCCESS);
+    HilogBuffer::ReaderId all = buffer.CreateBufReader([]() {});
+    EXPECT_EQ(QueryLines(buffer, all, filter), lines);
+    buffer.RemoveBufReader(all);
+
+    // Shrinking keeps the newest logs, a reader on a dropped log goes on from the oldest kept one
+    HilogBuffer::ReaderId slow = buffer.CreateBufReader([]() {});
+    LogBatch one(LogBatch::DEFAULT_BATCH_SIZE, 1);
+    ASSERT_EQ(buffer.Query(CompiledLogFilter(filter), slow, one), 1u);
+    EXPECT_EQ(LogLine(one.At(0)), first);
+    ASSERT_EQ(buffer.SetBuffLen(LOG_INIT, MIN_BUFFER_SIZE), RET_SUCCESS);
+    missed = 0;
+    vector<int> kept = QueryLines(buffer, slow, filter, 0, &missed);
+    ASSERT_FALSE(kept.empty());
+    EXPECT_LT(kept.size(), lines.size());
+    EXPECT_EQ(kept, Sequence(kept[0], logCount - kept[0]));
+    EXPECT_EQ(missed, static_cast<uint32_t>(kept[0] - first - 1));
+    buffer.RemoveBufReader(slow);
+
+    InsertLogs(buffer, LOG_INIT, pid, logCount, 1, padding);
+    EXPECT_EQ(QueryLines(buffer, reader, filter), Sequence(logCount, 1));
+    buffer.RemoveBufReader(reader);
+    EXPECT_EQ(buffer.SetBuffLen(LOG_INIT, oldLen), RET_SUCCESS);
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_BufferTest_003
+ * @tc.desc: A buffer which doesn't skip logs is full while its oldest log isn't read.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, BufferTest_003, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "BufferTest_003: start.";
+    constexpr int maxCount = 1000;
+    constexpr size_t padding = 1000;
+    constexpr uint32_t pid = 43200;
+    const LogFilter filter = LogsOfPid(pid);
+    HilogBuffer buffer(false);
+    HilogBuffer::ReaderId reader = buffer.CreateBufReader([]() {});
+    EXPECT_TRUE(QueryLines(buffer, reader, filter).empty());
+    int inserted = 0;
+    bool isFull = false;
+    for (; inserted < maxCount && !isFull; inserted++) {
+        vector<char> data = MakeLog(LOG_INIT, pid, inserted, padding);
+        if (buffer.Insert(*reinterpret_cast<HilogMsg *>(data.data()), isFull) == 0) {
+            break;
+        }
+    }
+    EXPECT_TRUE(isFull);
+    EXPECT_LT(inserted, maxCount);
+    EXPECT_EQ(QueryLines(buffer, reader, filter), Sequence(0, inserted));
+    vector<char> data = MakeLog(LOG_INIT, pid, inserted, padding);
+    EXPECT_GT(buffer.Insert(*reinterpret_cast<HilogMsg *>(data.data()), isFull), 0u);
+    EXPECT_FALSE(isFull);
+    buffer.RemoveBufReader(reader);
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_InputServerTest_001
+ * @tc.desc: Batched receiving hands the packets of a sender to a worker in order and counts them.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, InputServerTest_001, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "InputServerTest_001: start.";
+    constexpr int packetNum = 2000;
+    constexpr size_t packetLen = 64;
+    const string socketName = "hilogd_test_input";
+    mutex mtx;
+    vector<int> received;
+    HilogInputSocketServer* serverPtr = nullptr;
+    auto handler = [&](const ucred& cred, vector<char>& data, int len) {
+        // hold the first packet until the receiving thread has waited for the worker once
+        for (int i = 0; i < 5000 && serverPtr->GetStats().queueFull == 0; i++) {
+            this_thread::sleep_for(chrono::milliseconds(1));
+        }
+        EXPECT_EQ(cred.pid, getpid());
+        EXPECT_EQ(len, static_cast<int>(packetLen));
+        int seq = 0;
+        (void)memcpy_s(&seq, sizeof(seq), data.data(), sizeof(seq));
+        lock_guard<mutex> lock(mtx);
+        received.push_back(seq);
+    };
+    HilogInputSocketServer server(handler, 8, 2, socketName);
+    serverPtr = &server;
+    ASSERT_GE(server.Init(), 0);
+    ASSERT_EQ(server.RunServingThread(), HilogInputSocketServer::ServerThreadState::JUST_STARTED);
+
+    int fd = socket(AF_UNIX, SOCK_DGRAM, 0);
+    ASSERT_GE(fd, 0);
+    sockaddr_un addr = {0};
+    addr.sun_family = AF_UNIX;
+    string path = string(SOCKET_FILE_DIR) + socketName;
+    ASSERT_EQ(strcpy_s(addr.sun_path, sizeof(addr.sun_path), path.c_str()), EOK);
+    ASSERT_EQ(connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)), 0);
+    vector<char> oversize(MAX_SOCKET_PACKET_LEN + 1, 'x');
+    EXPECT_EQ(send(fd, oversize.data(), oversize.size(), 0), static_cast<ssize_t>(oversize.size()));
+    vector<char> packet(packetLen, 'a');
+    for (int seq = 0; seq < packetNum; seq++) {
+        (void)memcpy_s(packet.data(), packet.size(), &seq, sizeof(seq));
+        ASSERT_EQ(send(fd, packet.data(), packet.size(), 0), static_cast<ssize_t>(packet.size()));
+    }
+    close(fd);
+    for (int i = 0; i < 5000; i++) {
+        {
+            lock_guard<mutex> lock(mtx);
+            if (received.size() >= static_cast<size_t>(packetNum)) {
+                break;
+            }
+        }
+        this_thread::sleep_for(chrono::milliseconds(1));
+    }
+    server.StopServingThread();
+
+    EXPECT_EQ(received, Sequence(0, packetNum));
+    HilogInputSocketServer::InputStats stats = server.GetStats();
+    EXPECT_EQ(stats.packets, static_cast<uint64_t>(packetNum));
+    EXPECT_EQ(stats.bytes, packetNum * packetLen);
+    EXPECT_GE(stats.dropped, 1u);
+    EXPECT_GT(stats.queueFull, 0u);
+    EXPECT_GT(stats.recvCalls, 0u);
+    EXPECT_LE(stats.recvCalls, packetNum + stats.dropped);
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_ShmRingTest_001
+ * @tc.desc: Records skip the end of the ring with a padding record and come out in order over several laps.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, ShmRingTest_001, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "ShmRingTest_001: start.";
+    constexpr int rounds = 40;
+    constexpr int logsPerRound = 30;
+    constexpr int first = 1000; /* every record has the same length */
+    vector<uint64_t> mem = NewShmRingMem(HILOG_SHM_MIN_RING_SIZE);
+    HilogShmRing writer;
+    HilogShmRing reader;
+    writer.Init(mem.data(), HILOG_SHM_MIN_RING_SIZE);
+    reader.Attach(mem.data(), HILOG_SHM_MIN_RING_SIZE);
+    vector<int> lines;
+    for (int round = 0; round < rounds; round++) {
+        for (int i = 0; i < logsPerRound; i++) {
+            ASSERT_TRUE(WriteShmLog(writer, first + round * logsPerRound + i));
+        }
+        int line;
+        while ((line = ReadShmLine(reader)) >= 0) {
+            lines.push_back(line);
+        }
+        EXPECT_EQ(line, SHM_RING_EMPTY);
+        reader.Commit();
+    }
+    EXPECT_EQ(lines, Sequence(first, rounds * logsPerRound));
+    const HilogShmRingHeader *header = writer.Header();
+    uint64_t recordsLen = static_cast<uint64_t>(rounds) * logsPerRound * ShmRecordLen(first);
+    EXPECT_GT(header->reserve, 3ULL * HILOG_SHM_MIN_RING_SIZE);
+    EXPECT_GT(header->reserve, recordsLen); /* the rest of the ring was padded at some wraparounds */
+    EXPECT_EQ(header->tail, header->reserve);
+    EXPECT_EQ(header->dropped, 0u);
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_ShmRingTest_002
+ * @tc.desc: A full ring refuses logs until the reader commits the space it consumed.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, ShmRingTest_002, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "ShmRingTest_002: start.";
+    vector<uint64_t> mem = NewShmRingMem(HILOG_SHM_MIN_RING_SIZE);
+    HilogShmRing writer;
+    HilogShmRing reader;
+    writer.Init(mem.data(), HILOG_SHM_MIN_RING_SIZE);
+    reader.Attach(mem.data(), HILOG_SHM_MIN_RING_SIZE);
+    constexpr int first = 1000;
+    int written = 0;
+    while (WriteShmLog(writer, first + written)) {
+        written++;
+    }
+    EXPECT_EQ(written, static_cast<int>(HILOG_SHM_MIN_RING_SIZE / ShmRecordLen(first)));
+    EXPECT_EQ(writer.Header()->dropped, 1u);
+
+    // consumed space is only reused after Commit()
+    EXPECT_EQ(ReadShmLine(reader), first);
+    EXPECT_FALSE(WriteShmLog(writer, first + written));
+    EXPECT_EQ(writer.Header()->dropped, 2u);
+    reader.Commit();
+    EXPECT_TRUE(WriteShmLog(writer, first + written));
+
+    vector<int> lines;
+    int line;
+    while ((line = ReadShmLine(reader)) >= 0) {
+        lines.push_back(line);
+    }
+    EXPECT_EQ(line, SHM_RING_EMPTY);
+    EXPECT_EQ(lines, Sequence(first + 1, written));
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_ShmRingTest_003
+ * @tc.desc: The reader reports a corrupted ring for bad record lengths and bad padding.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, ShmRingTest_003, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "ShmRingTest_003: start.";
+    constexpr uint32_t paddingFlag = 0x80000000;
+    const vector<uint32_t> badWords = {
+        1, /* shorter than a HilogMsg */
+        MAX_SOCKET_PACKET_LEN + 1, /* longer than the read buffer */
+        paddingFlag | 8, /* padding which doesn't reach the end of the ring */
+        paddingFlag | (HILOG_SHM_MIN_RING_SIZE * 2),
+    };
+    for (uint32_t badWord : badWords) {
+        vector<uint64_t> mem = NewShmRingMem(HILOG_SHM_MIN_RING_SIZE);
+        HilogShmRing writer;
+        HilogShmRing reader;
+        writer.Init(mem.data(), HILOG_SHM_MIN_RING_SIZE);
+        reader.Attach(mem.data(), HILOG_SHM_MIN_RING_SIZE);
+        ASSERT_TRUE(WriteShmLog(writer, 0));
+        ASSERT_TRUE(WriteShmLog(writer, 1));
+        EXPECT_EQ(ReadShmLine(reader), 0);
+        uint32_t *word = reinterpret_cast<uint32_t *>(reinterpret_cast<char *>(mem.data()) + HILOG_SHM_HEADER_SIZE +
+            ShmRecordLen(0));
+        *word = badWord;
+        EXPECT_EQ(ReadShmLine(reader), SHM_RING_CORRUPTED) << badWord;
+    }
+
+    // a record which would run past the end of the ring
+    vector<uint64_t> mem = NewShmRingMem(HILOG_SHM_MIN_RING_SIZE);
+    HilogShmRing writer;
+    writer.Init(mem.data(), HILOG_SHM_MIN_RING_SIZE);
+    writer.Header()->tail = HILOG_SHM_MIN_RING_SIZE - sizeof(uint64_t);
+    uint32_t *word = reinterpret_cast<uint32_t *>(reinterpret_cast<char *>(mem.data()) + HILOG_SHM_HEADER_SIZE +
+        writer.Header()->tail);
+    *word = sizeof(HilogMsg) + sizeof(uint64_t);
+    HilogShmRing reader;
+    reader.Attach(mem.data(), HILOG_SHM_MIN_RING_SIZE);
+    EXPECT_EQ(ReadShmLine(reader), SHM_RING_CORRUPTED);
+}
+
+/**
+ * @tc.name: Dfx_HilogdTest_ShmRingTest_004
+ * @tc.desc: A writer wakes an idle reader once, a reader with pending records doesn't go idle.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogdTest, ShmRingTest_004, TestSize.Level1)
+{
+    GTEST_LOG_(INFO) << "ShmRingTest_004: start.";
+    vector<uint64_t> mem = NewShmRingMem(HILOG_SHM_MIN_RING_SIZE);
+    HilogShmRing writer;
+    HilogShmRing reader;
+    writer.Init(mem.data(), HILOG_SHM_MIN_RING_SIZE);
+    reader.Attach(mem.data(), HILOG_SHM_MIN_RING_SIZE);
+
+    ASSERT_TRUE(WriteShmLog(writer, 0));
+    EXPECT_FALSE(writer.ShouldWake()); /* the reader is busy */
+    EXPECT_FALSE(reader.PrepareIdle()); /* the record isn't read yet */
+    EXPECT_EQ(writer.Header()->readerIdle, 0u);
+    EXPECT_EQ(ReadShmLine(reader), 0);
+
+    EXPECT_TRUE(reader.PrepareIdle());
+    EXPECT_EQ(writer.Header()->readerIdle, 1u);
+    ASSERT_TRUE(WriteShmLog(writer, 1));
+    EXPECT_TRUE(writer.ShouldWake());
+    ASSERT_TRUE(WriteShmLog(writer, 2));
+    EXPECT_FALSE(writer.ShouldWake()); /* woken once */
+    EXPECT_EQ(ReadShmLine(reader), 1);
+    EXPECT_EQ(ReadShmLine(reader), 2);
+    EXPECT_EQ(ReadShmLine(reader), SHM_RING_EMPTY);
+}
+} // namespace
@@ -893,4 +893,74 @@ HWTEST_F(HilogToolTest, HandleTest_020, TestSize.Level1)
     }
     (void)GetCmdResultFromPopen("hilog -w start");
 }
+
+/**
+ * @tc.name: Dfx_HilogToolTest_HandleTest_021
+ * @tc.desc: StatsInfoQueryHandler with a top-K limit.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogToolTest, HandleTest_021, TestSize.Level1)
+{
+    /**
+     * @tc.steps: step1. set stats and top-K properties.
+     * @tc.steps: step2. restart hilog service.
+     * @tc.steps: step3. the report tells how many entries are kept.
+     * @tc.steps: step4. restore the properties.
+     */
+    GTEST_LOG_(INFO) << "HandleTest_021: start.";
+    (void)GetCmdResultFromPopen("param set persist.sys.hilog.stats true");
+    (void)GetCmdResultFromPopen("param set persist.sys.hilog.stats.topk 8");
+    (void)GetCmdResultFromPopen("service_control stop hilogd");
+    (void)GetCmdResultFromPopen("service_control start hilogd");
+    sleep(10);
+    EXPECT_EQ(GetStatsTopK(), 8u);
+    std::string cmd = "hilog -s";
+    std::string str = "Top 8 entries per table are tracked";
+    EXPECT_TRUE(IsExistInCmdResult(cmd, str));
+
+    (void)GetCmdResultFromPopen("param set persist.sys.hilog.stats.topk 0");
+    (void)GetCmdResultFromPopen("param set persist.sys.hilog.stats false");
+    (void)GetCmdResultFromPopen("service_control stop hilogd");
+    (void)GetCmdResultFromPopen("service_control start hilogd");
+    sleep(3);
+}
+
+/**
+ * @tc.name: Dfx_HilogToolTest_HandleTest_022
+ * @tc.desc: StatsSeriesQueryHandler.
+ * @tc.type: FUNC
+ */
+HWTEST_F(HilogToolTest, HandleTest_022, TestSize.Level1)
+{
+    /**
+     * @tc.steps: step1. invalid rate windows.
+     * @tc.steps: step2. enable statistic and restart hilog service.
+     * @tc.steps: step3. show the log rate of the last seconds and minutes.
+     */
+    GTEST_LOG_(INFO) << "HandleTest_022: start.";
+    std::string cmd = "hilog -R 0 2>&1";
+    std::string errMsg = ErrorCode2Str(ERR_INVALID_ARGUMENT) + "\n";
+    EXPECT_EQ(GetCmdResultFromPopen(cmd), errMsg);
+    cmd = "hilog -R 61 2>&1";
+    EXPECT_EQ(GetCmdResultFromPopen(cmd), errMsg);
+    cmd = "hilog -R x 2>&1";
+    errMsg = ErrorCode2Str(ERR_NOT_NUMBER_STR) + "\n";
+    EXPECT_EQ(GetCmdResultFromPopen(cmd), errMsg);
+
+    (void)GetCmdResultFromPopen("param set persist.sys.hilog.stats true");
+    (void)GetCmdResultFromPopen("service_control stop hilogd");
+    (void)GetCmdResultFromPopen("service_control start hilogd");
+    sleep(10);
+    cmd = "hilog -R 10";
+    std::string str = "Log rate of the last 10 seconds";
+    EXPECT_TRUE(IsExistInCmdResult(cmd, str));
+    cmd = "hilog -R 5m -D 0xD002D00";
+    str = "Log rate of the last 5 minutes (domain 0xd002d00)";
+    EXPECT_TRUE(IsExistInCmdResult(cmd, str));
+
+    (void)GetCmdResultFromPopen("param set persist.sys.hilog.stats false");
+    (void)GetCmdResultFromPopen("service_control stop hilogd");
+    (void)GetCmdResultFromPopen("service_control start hilogd");
+    sleep(3);
+}
 } // namespace